@@ -21,6 +21,7 @@ in vec3 worldPos;
 in vec3 worldNormal;
 in vec2 fragUV;
 in mat3 TBN;
+in float ditherFade;
 
 out vec4 color;
 
@@ -35,6 +36,8 @@ uniform float k_s;
 
 uniform sampler2D colorTexture;
 uniform bool useColorTexture;
+//impostors, the color texture's alpha is the tree's outline
+uniform bool alphaTest;
 
 uniform sampler2D normalMap;
 uniform bool useNormalMap;
@@ -107,7 +110,26 @@ vec3 computeLightContribution(vec3 N, vec3 V, vec3 worldPos, Light light, Materi
     return attenuation * (diffuse + specular);
 }
 
+//4x4 bayer matrix, thresholds spread evenly over (0, 1)
+float ditherThreshold(vec2 fragCoord) {
+    ivec2 p = ivec2(fragCoord) & 3;
+    int index = p.y * 4 + p.x;
+    const float BAYER[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0,
+                                      3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    return (BAYER[index] + 0.5) / 16.0;
+}
+
 void main() {
+    //trees switching lod: the fading in level keeps the pixels under its fade, the fading out one (fade - 1,
+    //so negative) keeps the rest. together they cover every pixel exactly once
+    if (ditherFade < 1.0) {
+        float threshold = ditherThreshold(gl_FragCoord.xy);
+        bool keep = ditherFade >= 0.0 ? threshold < ditherFade : threshold >= ditherFade + 1.0;
+        if (!keep) {
+            discard;
+        }
+    }
+
     vec3 N;
 
     if (useBumpMap && useNormalMap) {
@@ -129,7 +151,11 @@ void main() {
 
     vec3 baseColor = material.cDiffuse.rgb;
     if (useColorTexture) {
-        baseColor = texture(colorTexture, fragUV).rgb;
+        vec4 texel = texture(colorTexture, fragUV);
+        if (alphaTest && texel.a < 0.5) {
+            discard;
+        }
+        baseColor = texel.rgb;
     }
 
     Material texMaterial = material;
@@ -6,7 +6,21 @@ layout(location = 2) in vec3 tangent;
 layout(location = 3) in vec3 bitangent;
 layout(location = 4) in vec2 uv;
 
+//trees, one instance each: base position + scale, (cos, sin) of the yaw, and the lod dither fade
+layout(location = 5) in vec4 instancePlacement;
+layout(location = 6) in vec2 instanceYaw;
+layout(location = 7) in float instanceFade;
+
 uniform mat4 modelMatrix;
+uniform bool instanced;
+
+//far trees: a unit quad (x -0.5..0.5, y 0..1) turned to face the camera about y, textured with whichever of
+//the impostor atlas's views around the tree is closest to the camera's. the views sit side by side in a row
+uniform bool billboard;
+uniform float billboardSize;
+uniform vec4 billboardRect;     //first view's cell in the atlas, uv offset and size
+uniform int billboardViews;
+uniform vec3 cameraPos;
 uniform mat4 viewMatrix;
 uniform mat4 projMatrix;
 
@@ -14,13 +28,50 @@ out vec3 worldPos;
 out vec3 worldNormal;
 out vec2 fragUV;
 out mat3 TBN;
+out float ditherFade;
+
+void billboardVertex() {
+    vec3 base = instancePlacement.xyz;
+    float size = billboardSize * instancePlacement.w;
+    vec3 toCamera = vec3(cameraPos.x - base.x, 0.0, cameraPos.z - base.z);
+    vec3 forward = length(toCamera) > 0.0001 ? normalize(toCamera) : vec3(0.0, 0.0, 1.0);
+    vec3 right = vec3(forward.z, 0.0, -forward.x);
+
+    //the camera's direction in the tree's own frame picks the view, view i was baked from angle i / views around
+    vec2 local = vec2(instanceYaw.x * forward.x - instanceYaw.y * forward.z,
+                      instanceYaw.y * forward.x + instanceYaw.x * forward.z);
+    float turns = atan(local.x, local.y) / 6.2831853;
+    int view = int(floor(turns * float(billboardViews) + 0.5));
+    view = ((view % billboardViews) + billboardViews) % billboardViews;
+
+    worldPos = base + right * (position.x * size) + vec3(0.0, position.y * size, 0.0);
+    worldNormal = forward;
+    TBN = mat3(right, vec3(0.0, 1.0, 0.0), forward);
+    fragUV = billboardRect.xy + vec2(float(view) * billboardRect.z, 0.0) + uv * billboardRect.zw;
+    ditherFade = instanceFade;
+    gl_Position = projMatrix * viewMatrix * vec4(worldPos, 1.0);
+}
 
 void main() {
-    vec4 worldPosition4 = modelMatrix * vec4(position, 1.0);
+    if (billboard) {
+        billboardVertex();
+        return;
+    }
+
+    mat4 model = modelMatrix;
+    if (instanced) {
+        float s = instancePlacement.w;
+        model = mat4(vec4(instanceYaw.x * s, 0.0, -instanceYaw.y * s, 0.0),
+                     vec4(0.0, s, 0.0, 0.0),
+                     vec4(instanceYaw.y * s, 0.0, instanceYaw.x * s, 0.0),
+                     vec4(instancePlacement.xyz, 1.0));
+    }
+
+    vec4 worldPosition4 = model * vec4(position, 1.0);
     worldPos = worldPosition4.xyz;
 
     // Transform normal, tangent, and bitangent to world space
-    mat3 normalMatrix = transpose(inverse(mat3(modelMatrix)));
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
     vec3 T = normalize(normalMatrix * tangent);
     vec3 B = normalize(normalMatrix * bitangent);
     vec3 N = normalize(normalMatrix * normal);
@@ -34,6 +85,7 @@ void main() {
 
     worldNormal = N;
     fragUV = uv;
+    ditherFade = instanced ? instanceFade : 1.0;
 
     gl_Position = projMatrix * viewMatrix * worldPosition4;
 }
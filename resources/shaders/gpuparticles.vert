@@ -0,0 +1,51 @@
+#version 330 core
+
+//draws the gpu simulated pool straight from its state buffer, one slot per instance. goes with particles.frag
+
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aUV;
+
+layout (location = 2) in vec3 instancePos;
+layout (location = 3) in vec3 instanceLife;    //life, start life, size
+
+out vec2 TexCoords;
+out vec4 Color;
+flat out int Layer;
+out float ViewDepth;
+
+uniform mat4 view;
+uniform mat4 proj;
+
+//slots below fogSlots are fog, the rest dust
+uniform int fogSlots;
+uniform vec4 kindColors[2];     //rgb, peak alpha
+uniform int kindLayers[2];
+
+void main()
+{
+    int kind = gl_InstanceID < fogSlots ? 0 : 1;
+    TexCoords = aUV;
+    Layer = kindLayers[kind];
+
+    //dead slots (and ones that never spawned) go outside the clip volume
+    if (instanceLife.x <= 0.0) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        Color = vec4(0.0);
+        ViewDepth = 0.0;
+        return;
+    }
+
+    //fades in over the first 20% of its life and out over the rest, as on the cpu
+    float lifeRatio = instanceLife.x / instanceLife.y;
+    float fade = clamp(min((1.0 - lifeRatio) * 5.0, lifeRatio * 1.25), 0.0, 1.0);
+    Color = vec4(kindColors[kind].rgb, kindColors[kind].a * fade);
+
+    vec3 camRight = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 camUp    = vec3(view[0][1], view[1][1], view[2][1]);
+    float size = instanceLife.z;
+    vec3 worldPos = instancePos + camRight * aPos.x * size + camUp * aPos.y * size;
+
+    vec4 viewPos = view * vec4(worldPos, 1.0);
+    gl_Position = proj * viewPos;
+    ViewDepth = -viewPos.z;
+}
@@ -0,0 +1,104 @@
+#version 330 core
+
+//one particle slot per vertex, drawn as points with the rasterizer off. the outputs are captured into
+//the other state buffer. GpuParticles::stepReference() is this same tick in c++, keep the two in step
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inVelocity;
+layout (location = 2) in vec3 inDrift;
+layout (location = 3) in vec3 inLife;      //life, start life, size
+
+out vec3 outPosition;
+out vec3 outVelocity;
+out vec3 outDrift;
+out vec3 outLife;
+
+struct KindParams {
+    vec4 motion;    //drift speed, bob speed, bob amount, peak alpha
+    vec4 jitter;    //jitter xz, jitter y, spawn velocity xz spread, spawn velocity y spread
+    vec4 ring;      //min distance, max distance, angle spread, spawn velocity y
+    vec4 band;      //spawn height min, max, life min, life max
+    vec4 shape;     //size min, size max, drift y, drift xz
+};
+
+layout (std140) uniform Emitter {
+    vec4 origin;    //eye, w = delta time
+    vec4 heading;   //x = look angle in xz
+    uvec4 spawn;    //window first slot, window size, pool size, seed
+    uvec4 split;    //fog slots, bit per kind allowed to spawn
+    KindParams kinds[2];
+};
+
+//FastRandom::hash
+uint hash(uint value)
+{
+    uint state = value * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float hashFloat(uint value)
+{
+    return float(hash(value) >> 8u) * (1.0 / 16777216.0);
+}
+
+//FastMath::sin
+float fastSin(float x)
+{
+    const float PI = 3.14159265;
+    const float TWO_PI = 6.28318531;
+    float turns = x * (1.0 / TWO_PI);
+    x -= TWO_PI * float(int(turns + (turns >= 0.0 ? 0.5 : -0.5)));
+    float y = (4.0 / PI) * x - (4.0 / (PI * PI)) * x * abs(x);
+    return 0.225 * (y * abs(y) - y) + y;
+}
+
+void main()
+{
+    uint slot = uint(gl_VertexID);
+    int kind = slot < split.x ? 0 : 1;
+    KindParams p = kinds[kind];
+    float deltaTime = origin.w;
+    uint seed = spawn.w;
+
+    vec3 position = inPosition;
+    vec3 velocity = inVelocity;
+    vec3 drift = inDrift;
+    float life = inLife.x - deltaTime;
+    float startLife = inLife.y;
+    float size = inLife.z;
+
+    //same order as ParticleSystem::updateDrifting
+    position += drift * (p.motion.x * deltaTime);
+    position.y += fastSin((startLife - life) * p.motion.y) * (p.motion.z * deltaTime);
+    velocity.x += (hashFloat(seed + slot) - 0.5) * (p.jitter.x * deltaTime);
+    velocity.y += (hashFloat((seed ^ 0x68e31da4u) + slot) - 0.5) * (p.jitter.y * deltaTime);
+    velocity.z += (hashFloat((seed ^ 0xb5297a4du) + slot) - 0.5) * (p.jitter.x * deltaTime);
+    position += velocity * deltaTime;
+
+    //dead and inside the spawn window: a new particle out in front of the eye, like the cpu spawners
+    uint windowOffset = (slot + spawn.z - spawn.x) % spawn.z;
+    bool canSpawn = (split.y & (1u << uint(kind))) != 0u;
+    if (life <= 0.0 && windowOffset < spawn.y && canSpawn) {
+        uint stream = hash(seed ^ 0x1b873593u ^ slot);
+        float angle = heading.x + (hashFloat(stream) - 0.5) * 2.0 * p.ring.z;
+        float dist = p.ring.x + hashFloat(stream + 1u) * (p.ring.y - p.ring.x);
+        float height = p.band.x + hashFloat(stream + 2u) * (p.band.y - p.band.x);
+        position = origin.xyz + vec3(cos(angle) * dist, height, sin(angle) * dist);
+
+        float driftAngle = hashFloat(stream + 3u) * 6.283185;
+        drift = normalize(vec3(cos(driftAngle) * p.shape.w, p.shape.z, sin(driftAngle) * p.shape.w));
+        velocity = vec3((hashFloat(stream + 4u) - 0.5) * p.jitter.z,
+                        p.ring.w + hashFloat(stream + 5u) * p.jitter.w,
+                        (hashFloat(stream + 6u) - 0.5) * p.jitter.z);
+
+        life = p.band.z + hashFloat(stream + 7u) * (p.band.w - p.band.z);
+        startLife = life;
+        size = p.shape.x + hashFloat(stream + 8u) * (p.shape.y - p.shape.x);
+    }
+
+    outPosition = position;
+    outVelocity = velocity;
+    outDrift = drift;
+    outLife = vec3(life, startLife, size);
+}
@@ -8,19 +8,21 @@ uniform sampler2D gNormal;
 uniform sampler2D gAlbedo;
 uniform sampler2D gVelocity;
 uniform sampler2D sceneTexture;
+uniform sampler2D neighborMaxTexture;
 
 uniform int numSamples;
+uniform bool useTileMax;
 
-void main() {
+const float maxVelocity = 0.1;
+
+vec4 perPixelBlur() {
     vec2 velocity = texture(gVelocity, fragTexCoord).rg;
     float speed = length(velocity);
     
     if (speed < 0.001) {
-        color = texture(sceneTexture, fragTexCoord);
-        return;
+        return texture(sceneTexture, fragTexCoord);
     }
     
-    float maxVelocity = 0.1;
     if (speed > maxVelocity) {
         velocity = normalize(velocity) * maxVelocity;
         speed = maxVelocity;
@@ -38,6 +40,50 @@ void main() {
     }
     
     result /= float(samples + 1);
-    color = vec4(result, 1.0);
+    return vec4(result, 1.0);
 }
 
+vec4 tileMaxBlur() {
+    //dominant velocity of this pixel's tile neighbourhood
+    vec2 tileVelocity = texture(neighborMaxTexture, fragTexCoord).rg;
+    float tileSpeed = length(tileVelocity);
+    
+    //static tile, nothing nearby is moving so skip the gather entirely
+    if (tileSpeed < 0.001) {
+        return texture(sceneTexture, fragTexCoord);
+    }
+    
+    if (tileSpeed > maxVelocity) {
+        tileVelocity = normalize(tileVelocity) * maxVelocity;
+        tileSpeed = maxVelocity;
+    }
+    
+    vec2 centerVelocity = texture(gVelocity, fragTexCoord).rg;
+    float centerSpeed = min(length(centerVelocity), maxVelocity);
+    
+    //tap count follows the tile speed, numSamples is the cap
+    float blurScale = min(tileSpeed * 15.0, 1.0);
+    int samples = max(1, int(float(numSamples) * blurScale));
+    
+    vec3 result = texture(sceneTexture, fragTexCoord).rgb;
+    float totalWeight = 1.0;
+    
+    for (int i = 1; i <= samples; ++i) {
+        float t = float(i) / float(samples + 1);
+        vec2 sampleCoord = clamp(fragTexCoord - tileVelocity * t, vec2(0.0), vec2(1.0));
+        float dist = tileSpeed * t;
+        
+        //a tap contributes if either it or the center pixel moves far enough to cover the gap
+        float sampleSpeed = min(length(texture(gVelocity, sampleCoord).rg), maxVelocity);
+        float weight = max(step(dist, sampleSpeed), step(dist, centerSpeed));
+        
+        result += texture(sceneTexture, sampleCoord).rgb * weight;
+        totalWeight += weight;
+    }
+    
+    return vec4(result / totalWeight, 1.0);
+}
+
+void main() {
+    color = useTileMax ? tileMaxBlur() : perPixelBlur();
+}
@@ -2,19 +2,38 @@
 
 in vec2 TexCoords;
 in vec4 Color;
-flat in int Type;
+flat in int Layer;
+in float ViewDepth;
 
 out vec4 FragColor;
 
-uniform sampler2D sprite;
+//every particle image is a layer, the instance picks its own
+uniform sampler2DArray sprite;
+
+//soft particles: fade out as the scene behind gets close, gone once it's in front
+uniform bool softFade;
+uniform sampler2D sceneDepth;
+uniform vec2 viewportSize;
+uniform float fadeDistance;
+uniform mat4 proj;
 
 void main()
 {
-    vec4 texColor = texture(sprite, TexCoords);
+    vec4 texColor = texture(sprite, vec3(TexCoords, float(Layer)));
     if (texColor.a < 0.05)
         discard;
 
     FragColor = texColor * Color;
+
+    if (softFade) {
+        float depth = texture(sceneDepth, gl_FragCoord.xy / viewportSize).r;
+        //back to view distance, the depth texture can be a different size than the target
+        float sceneDistance = proj[3][2] / (depth * 2.0 - 1.0 + proj[2][2]);
+        float fade = clamp((sceneDistance - ViewDepth) / fadeDistance, 0.0, 1.0);
+        if (fade <= 0.0)
+            discard;
+        FragColor.a *= fade;
+    }
 }
 
 
@@ -6,11 +6,12 @@ layout (location = 1) in vec2 aUV;
 layout (location = 2) in vec3 instancePos;
 layout (location = 3) in float instanceSize;
 layout (location = 4) in vec4 instanceColor;
-layout (location = 5) in int instanceType;
+layout (location = 5) in int instanceLayer;
 
 out vec2 TexCoords;
 out vec4 Color;
-flat out int Type;
+flat out int Layer;
+out float ViewDepth;
 
 uniform mat4 view;
 uniform mat4 proj;
@@ -25,11 +26,13 @@ void main()
         + camRight * aPos.x * instanceSize
         + camUp    * aPos.y * instanceSize;
 
-    gl_Position = proj * view * vec4(worldPos, 1.0);
+    vec4 viewPos = view * vec4(worldPos, 1.0);
+    gl_Position = proj * viewPos;
+    ViewDepth = -viewPos.z;
 
     TexCoords = aUV;
     Color = instanceColor;
-    Type = instanceType;
+    Layer = instanceLayer;
 }
 
 
@@ -0,0 +1,35 @@
+#version 330 core
+
+in vec2 fragTexCoord;
+out vec4 color;
+
+uniform sampler2D sourceTexture;
+uniform vec2 uvScale;      //rendered region / texture size
+uniform bool edgeAware;
+uniform float sharpness;   //0..1
+
+void main() {
+    vec2 texel = 1.0 / vec2(textureSize(sourceTexture, 0));
+    vec2 uvMax = uvScale - 0.5 * texel;
+    vec2 uv = clamp(fragTexCoord * uvScale, 0.5 * texel, uvMax);
+    
+    vec3 c = texture(sourceTexture, uv).rgb;
+    if (!edgeAware) {
+        color = vec4(c, 1.0);
+        return;
+    }
+    
+    vec3 n = texture(sourceTexture, clamp(uv + vec2(0.0, texel.y), 0.5 * texel, uvMax)).rgb;
+    vec3 s = texture(sourceTexture, clamp(uv - vec2(0.0, texel.y), 0.5 * texel, uvMax)).rgb;
+    vec3 e = texture(sourceTexture, clamp(uv + vec2(texel.x, 0.0), 0.5 * texel, uvMax)).rgb;
+    vec3 w = texture(sourceTexture, clamp(uv - vec2(texel.x, 0.0), 0.5 * texel, uvMax)).rgb;
+    
+    //contrast adaptive sharpen: back off where the neighbourhood already has a hard edge so we dont ring
+    vec3 mn = min(c, min(min(n, s), min(e, w)));
+    vec3 mx = max(c, max(max(n, s), max(e, w)));
+    vec3 amp = sqrt(clamp(min(mn, 1.0 - mx) / max(mx, vec3(0.0001)), 0.0, 1.0));
+    vec3 wgt = amp * (-1.0 / mix(8.0, 5.0, sharpness));
+    
+    vec3 result = (c + (n + s + e + w) * wgt) / (1.0 + 4.0 * wgt);
+    color = vec4(clamp(result, 0.0, 1.0), 1.0);
+}
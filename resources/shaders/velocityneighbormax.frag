@@ -0,0 +1,29 @@
+#version 330 core
+
+in vec2 fragTexCoord;
+out vec2 neighborMax;
+
+uniform sampler2D tileMaxTexture;
+
+//spreads each tile's max velocity into its 3x3 neighbourhood so blur can cross tile edges
+void main() {
+    ivec2 tileCount = textureSize(tileMaxTexture, 0);
+    ivec2 tile = ivec2(gl_FragCoord.xy);
+
+    vec2 maxVelocity = vec2(0.0);
+    float maxSpeedSq = 0.0;
+
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            ivec2 coord = clamp(tile + ivec2(x, y), ivec2(0), tileCount - 1);
+            vec2 v = texelFetch(tileMaxTexture, coord, 0).rg;
+            float speedSq = dot(v, v);
+            if (speedSq > maxSpeedSq) {
+                maxSpeedSq = speedSq;
+                maxVelocity = v;
+            }
+        }
+    }
+
+    neighborMax = maxVelocity;
+}
@@ -0,0 +1,30 @@
+#version 330 core
+
+in vec2 fragTexCoord;
+out vec2 tileMax;
+
+uniform sampler2D gVelocity;
+uniform int tileSize;
+
+//one fragment per tile, keeps the longest velocity inside the tile
+void main() {
+    ivec2 texSize = textureSize(gVelocity, 0);
+    ivec2 tileOrigin = ivec2(gl_FragCoord.xy) * tileSize;
+
+    vec2 maxVelocity = vec2(0.0);
+    float maxSpeedSq = 0.0;
+
+    for (int y = 0; y < tileSize; ++y) {
+        for (int x = 0; x < tileSize; ++x) {
+            ivec2 coord = min(tileOrigin + ivec2(x, y), texSize - 1);
+            vec2 v = texelFetch(gVelocity, coord, 0).rg;
+            float speedSq = dot(v, v);
+            if (speedSq > maxSpeedSq) {
+                maxSpeedSq = speedSq;
+                maxVelocity = v;
+            }
+        }
+    }
+
+    tileMax = maxVelocity;
+}
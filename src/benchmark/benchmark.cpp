@@ -0,0 +1,891 @@
+#include "benchmark/benchmark.h"
+#include "realtime.h"
+#include "map/Map.h"
+#include "enemies/enemymanager.h"
+#include "particlesystem/particlesystem.h"
+#include "particlesystem/gpuparticles.h"
+#include "lsystem/treegenerator.h"
+#include "lsystem/treemesher.h"
+#include "blocks/TreePiece.h"
+#include "map/terraintreegenerator.h"
+#include "utils/camera.h"
+#include "utils/depthsort.h"
+#include "utils/parallelfor.h"
+#include "utils/profiler.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+void Benchmark::printUsage() {
+    std::cout << "usage: --benchmark <path.json> [--csv out.csv] [--params map.json] [--seed N]\n"
+              << "                   [--dt seconds] [--frames N] [--size WxH] [--view-distance N]\n"
+              << "       --raycast <rays> [--params map.json] [--seed N] [--view-distance N]\n"
+              << "       --enemies <count[,count...]> [--frames N] [--params map.json] [--seed N] [--view-distance N]\n"
+              << "       --particles <count[,count...]> [--frames N] [--params map.json] [--seed N] [--view-distance N]\n"
+              << "       --gpu-particles <count[,count...]> [--frames N] [--seed N] [--dt seconds]\n"
+              << "       --trees <count> [--seed N]" << std::endl;
+}
+
+void Benchmark::parseCounts(const std::string& value, std::vector<int>& out) {
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t comma = value.find(',', start);
+        if (comma == std::string::npos) {
+            comma = value.size();
+        }
+        out.push_back(std::stoi(value.substr(start, comma - start)));
+        start = comma + 1;
+    }
+}
+
+bool Benchmark::parseArguments(int argc, char* argv[], BenchmarkOptions& options, bool& ok) {
+    ok = true;
+    bool requested = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--benchmark") == 0 || std::strcmp(argv[i], "--raycast") == 0 ||
+            std::strcmp(argv[i], "--enemies") == 0 || std::strcmp(argv[i], "--particles") == 0 ||
+            std::strcmp(argv[i], "--gpu-particles") == 0 || std::strcmp(argv[i], "--trees") == 0) {
+            requested = true;
+            break;
+        }
+    }
+    if (!requested) {
+        return false;
+    }
+
+    //every benchmark option takes a value. anything else is left for QApplication (-platform offscreen and the like)
+    const char* const OPTIONS[] = {"--benchmark", "--csv", "--params", "--seed", "--dt", "--frames", "--view-distance",
+                                   "--raycast", "--enemies", "--particles", "--trees", "--gpu-particles", "--size"};
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (std::find(std::begin(OPTIONS), std::end(OPTIONS), arg) == std::end(OPTIONS)) {
+            continue;
+        }
+        bool hasValue = i + 1 < argc;
+        if (!hasValue) {
+            ok = false;
+            break;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--benchmark") {
+                options.pathFile = value;
+            } else if (arg == "--csv") {
+                options.csvFile = value;
+            } else if (arg == "--params") {
+                options.paramsFile = value;
+            } else if (arg == "--seed") {
+                options.seed = std::stoi(value);
+                options.overrideSeed = true;
+            } else if (arg == "--dt") {
+                options.timestep = std::stof(value);
+            } else if (arg == "--frames") {
+                options.maxFrames = std::stoi(value);
+            } else if (arg == "--view-distance") {
+                options.viewDistance = std::stoi(value);
+            } else if (arg == "--raycast") {
+                options.raycastRays = std::stoi(value);
+            } else if (arg == "--enemies") {
+                parseCounts(value, options.enemyCounts);
+            } else if (arg == "--particles") {
+                parseCounts(value, options.particleCounts);
+            } else if (arg == "--trees") {
+                options.treeCount = std::stoi(value);
+            } else if (arg == "--gpu-particles") {
+                parseCounts(value, options.gpuParticleCounts);
+            } else if (arg == "--size") {
+                size_t x = value.find('x');
+                if (x == std::string::npos) {
+                    ok = false;
+                    break;
+                }
+                options.width = std::stoi(value.substr(0, x));
+                options.height = std::stoi(value.substr(x + 1));
+            }
+        } catch (const std::exception&) {
+            ok = false;
+            break;
+        }
+    }
+
+    bool needsPath = options.raycastRays <= 0 && options.enemyCounts.empty() && options.particleCounts.empty() &&
+                     options.gpuParticleCounts.empty() && options.treeCount <= 0;
+    if ((needsPath && options.pathFile.empty()) || options.timestep <= 0.0f || options.width <= 0 || options.height <= 0) {
+        ok = false;
+    }
+    if (!ok) {
+        printUsage();
+    }
+    return true;
+}
+
+bool Benchmark::loadMapParams(const std::string& filePath, MapBuilderParams& params) {
+    QFile file(QString::fromStdString(filePath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+    if (!doc.isObject()) {
+        return false;
+    }
+
+    //params can be the whole file or the "map" block of a camera path file
+    QJsonObject root = doc.object();
+    QJsonObject map = root.contains("map") ? root["map"].toObject() : root;
+    params.seed = map["seed"].toInt(params.seed);
+    params.frequency = static_cast<float>(map["frequency"].toDouble(params.frequency));
+    params.octaves = map["octaves"].toInt(params.octaves);
+    params.amplitude = static_cast<float>(map["amplitude"].toDouble(params.amplitude));
+    params.persistence = static_cast<float>(map["persistence"].toDouble(params.persistence));
+    params.biomeFrequency = static_cast<float>(map["biomeFrequency"].toDouble(params.biomeFrequency));
+    params.biomeOctaves = map["biomeOctaves"].toInt(params.biomeOctaves);
+    params.biomeWarp = static_cast<float>(map["biomeWarp"].toDouble(params.biomeWarp));
+    return true;
+}
+
+void Benchmark::collectGpuTimes(std::vector<FrameSample>& samples) {
+    //gpu markers resolve two frames late, match them back to samples by profiler frame index
+    const ProfilerFrame* frame = Profiler::getFrame(0);
+    if (frame == nullptr || samples.empty() || frame->index < samples.front().profilerFrame) {
+        return;
+    }
+    size_t sampleIndex = static_cast<size_t>(frame->index - samples.front().profilerFrame);
+    if (sampleIndex >= samples.size()) {
+        return;
+    }
+
+    double gpuUs = 0.0;
+    bool resolved = false;
+    for (const ProfilerEvent& event : frame->events) {
+        if (event.gpu && event.depth == 0 && event.durationUs >= 0.0) {
+            gpuUs += event.durationUs;
+            resolved = true;
+        }
+    }
+    if (resolved) {
+        samples[sampleIndex].gpuMs = gpuUs / 1000.0;
+    }
+}
+
+bool Benchmark::writeCsv(const std::string& filePath, const std::vector<FrameSample>& samples) {
+    std::ofstream out(filePath);
+    if (!out.is_open()) {
+        std::cerr << "[Benchmark] Failed to open " << filePath << " for writing" << std::endl;
+        return false;
+    }
+    out << "frame,sim_time_s,cpu_ms,gpu_ms,draw_calls,resident_chunks,generated_chunks\n";
+    out << std::fixed << std::setprecision(4);
+    for (size_t i = 0; i < samples.size(); i++) {
+        const FrameSample& sample = samples[i];
+        out << i << ',' << sample.simTime << ',' << sample.cpuMs << ',';
+        if (sample.gpuMs >= 0.0) {
+            out << sample.gpuMs;
+        }
+        out << ',' << sample.drawCalls << ',' << sample.residentChunks << ',' << sample.generatedChunks << '\n';
+    }
+    return true;
+}
+
+void Benchmark::printPercentiles(const char* label, std::vector<double> values) {
+    if (values.empty()) {
+        std::cout << "  " << label << ": n/a" << std::endl;
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    //nearest rank
+    auto percentile = [&values](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+        return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+    };
+    double sum = 0.0;
+    for (double v : values) {
+        sum += v;
+    }
+    std::cout << std::fixed << std::setprecision(3)
+              << "  " << label << ": avg " << sum / values.size()
+              << "  p50 " << percentile(50.0) << "  p95 " << percentile(95.0)
+              << "  p99 " << percentile(99.0) << "  max " << values.back() << " ms" << std::endl;
+    std::cout << std::defaultfloat;
+}
+
+bool Benchmark::loadStandaloneParams(const BenchmarkOptions& options, MapBuilderParams& params) {
+    if (!options.paramsFile.empty() && !loadMapParams(options.paramsFile, params)) {
+        std::cerr << "[Benchmark] Failed to load map params from " << options.paramsFile << std::endl;
+        return false;
+    }
+    if (options.overrideSeed) {
+        params.seed = options.seed;
+    }
+    return true;
+}
+
+int Benchmark::runRaycast(const BenchmarkOptions& options) {
+    MapBuilderParams params;
+    if (!loadStandaloneParams(options, params)) {
+        return 1;
+    }
+
+    Map map;
+    map.setNoiseParams(params);
+    int radius = std::max(1, options.viewDistance);
+    for (int chunkZ = -radius; chunkZ <= radius; chunkZ++) {
+        for (int chunkX = -radius; chunkX <= radius; chunkX++) {
+            map.ensureChunkGenerated(chunkX, chunkZ);
+        }
+    }
+
+    //flashlight-ish rays: from eye height over the terrain, mostly level, out to about the flashlight's reach
+    const float MAX_DISTANCE = 32.0f;
+    float extent = static_cast<float>(radius * map.getChunkSize());
+    std::mt19937 gen(static_cast<unsigned int>(params.seed));
+    std::uniform_real_distribution<float> posDist(-extent * 0.5f, extent * 0.5f);
+    std::uniform_real_distribution<float> angleDist(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> pitchDist(-0.6f, 0.2f);
+    std::vector<MapRay> rays(static_cast<size_t>(options.raycastRays));
+    for (MapRay& ray : rays) {
+        float angle = angleDist(gen);
+        ray.origin = glm::vec3(posDist(gen), 2.5f, posDist(gen));
+        ray.direction = glm::vec3(std::cos(angle), pitchDist(gen), std::sin(angle));
+        ray.maxDistance = MAX_DISTANCE;
+    }
+
+    std::cout << "[Benchmark] raycast, " << rays.size() << " rays, seed " << params.seed << ", "
+              << (2 * radius + 1) * (2 * radius + 1) << " chunks" << std::endl;
+
+    auto report = [&rays](const char* label, double seconds, int hitCount) {
+        std::cout << std::fixed << std::setprecision(1)
+                  << "  " << label << ": " << seconds * 1000.0 << " ms, "
+                  << rays.size() / std::max(seconds, 1e-9) / 1.0e6 << " M rays/s, "
+                  << 100.0 * hitCount / std::max<size_t>(rays.size(), 1) << "% hit" << std::endl;
+        std::cout << std::defaultfloat;
+    };
+
+    int hitCount = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const MapRay& ray : rays) {
+        if (map.raycast(ray.origin, ray.direction, ray.maxDistance).hit) {
+            hitCount++;
+        }
+    }
+    report("single", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), hitCount);
+
+    std::vector<RaycastHit> hits;
+    start = std::chrono::steady_clock::now();
+    map.raycastBatch(rays, hits);
+    double batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    hitCount = static_cast<int>(std::count_if(hits.begin(), hits.end(), [](const RaycastHit& hit) { return hit.hit; }));
+    report("batch", batchSeconds, hitCount);
+    return 0;
+}
+
+int Benchmark::runEnemies(const BenchmarkOptions& options) {
+    MapBuilderParams params;
+    if (!loadStandaloneParams(options, params)) {
+        return 1;
+    }
+
+    Map map;
+    map.setNoiseParams(params);
+    int radius = std::max(1, options.viewDistance);
+    for (int chunkZ = -radius; chunkZ <= radius; chunkZ++) {
+        for (int chunkX = -radius; chunkX <= radius; chunkX++) {
+            map.ensureChunkGenerated(chunkX, chunkZ);
+        }
+    }
+
+    //player stands still at the origin with the flashlight sweeping round, so the lit, walking and dying paths all run
+    const int WARMUP_TICKS = 60;
+    int ticks = options.maxFrames > 0 ? options.maxFrames : 600;
+    float spread = static_cast<float>(radius * map.getChunkSize()) * 0.9f;
+    glm::vec3 player(0.0f, 2.0f, 0.0f);
+    std::cout << "[Benchmark] enemies, seed " << params.seed << ", " << ticks << " ticks of " << options.timestep
+              << "s, " << ParallelFor::threadCount() << " threads" << std::endl;
+
+    //the sim builds its viewer from a Camera the same way: fov set, projection redone from the screen aspect.
+    //one far enemy straight ahead has to stay at the far rate, one as far behind goes hidden
+    {
+        Camera viewer;
+        viewer.setPosition(player);
+        viewer.setLook(glm::vec3(0.0f, 0.0f, -1.0f));
+        viewer.setFOV(70.0f);
+        viewer.updateProjectionMatrix(16.0f / 9.0f, 1.0f, 50.0f);
+        EnemyManager enemies;
+        enemies.setAutoSpawnEnabled(false);
+        enemies.spawnEnemy(glm::vec3(0.5f, player.y, -30.5f));
+        enemies.spawnEnemy(glm::vec3(0.5f, player.y, 30.5f));
+        enemies.setViewer(viewer.getProjMatrix() * viewer.getViewMatrix());
+        enemies.update(options.timestep, player, &map, nullptr);
+        const EnemyManager::LodStats& stats = enemies.getLodStats();
+        if (stats.farCount != 1 || stats.hiddenCount != 1) {
+            std::cerr << "[Benchmark] lod check failed: far " << stats.farCount << " hidden " << stats.hiddenCount
+                      << ", expected 1 and 1" << std::endl;
+            return 1;
+        }
+        std::cout << "  lod check: enemy in view far, enemy behind hidden" << std::endl;
+    }
+
+    //same spawn and flashlight sweep with the ai lod on and off, the difference is what the tiers buy
+    for (int count : options.enemyCounts) {
+        for (bool lod : {false, true}) {
+            EnemyManager enemies;
+            enemies.setAutoSpawnEnabled(false);
+            enemies.setLodEnabled(lod);
+            std::mt19937 gen(static_cast<unsigned int>(params.seed));
+            std::uniform_real_distribution<float> posDist(-spread, spread);
+            for (int i = 0; i < count; i++) {
+                float x = posDist(gen);
+                float z = posDist(gen);
+                float y = 4.0f;
+                if (map.getSurfaceHeight(x, z, y)) {
+                    y += 1.0f;
+                }
+                enemies.spawnEnemy(glm::vec3(x, y, z));
+            }
+
+            std::vector<double> tickMs;
+            tickMs.reserve(static_cast<size_t>(ticks));
+            long long nearCount = 0;
+            long long farCount = 0;
+            long long hiddenCount = 0;
+            glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+            for (int tick = 0; tick < WARMUP_TICKS + ticks; tick++) {
+                float angle = tick * options.timestep * 1.5f;
+                glm::vec3 flashlightDir(std::cos(angle), -0.1f, std::sin(angle));
+                enemies.setViewer(projection * glm::lookAt(player, player + flashlightDir, glm::vec3(0.0f, 1.0f, 0.0f)));
+                auto start = std::chrono::steady_clock::now();
+                enemies.updateWithFlashlight(options.timestep, player, &map, true, player, flashlightDir,
+                                             glm::radians(20.0f), nullptr);
+                if (tick >= WARMUP_TICKS) {
+                    tickMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                    const EnemyManager::LodStats& stats = enemies.getLodStats();
+                    nearCount += stats.nearCount;
+                    farCount += stats.farCount;
+                    hiddenCount += stats.hiddenCount;
+                }
+            }
+
+            std::string label = std::to_string(count) + (lod ? " enemies, lod" : " enemies, no lod");
+            printPercentiles(label.c_str(), tickMs);
+            std::cout << "    " << enemies.getEnemyCount() << " left at the end";
+            if (lod && !tickMs.empty()) {
+                long long samples = static_cast<long long>(tickMs.size());
+                std::cout << ", avg tiers near " << nearCount / samples << " far " << farCount / samples
+                          << " hidden " << hiddenCount / samples << ", est. "
+                          << std::fixed << std::setprecision(3) << enemies.getLodStats().totalSavedMs / samples
+                          << " ms/tick saved" << std::defaultfloat;
+            }
+            std::cout << std::endl;
+        }
+    }
+    return 0;
+}
+
+void Benchmark::fillParticles(ParticleSystem& particles, const Camera& camera, int count) {
+    count = std::min(count, particles.m_maxParticles);
+    //round robin over the kinds, stops early if a whole round couldn't place anything
+    while (particles.getParticleCount() < count) {
+        int before = particles.getParticleCount();
+        particles.spawnSingleDirtParticle(camera, 1.0f);
+        particles.spawnSingleFogWisp(camera);
+        particles.spawnDustParticle(camera, 1.0f, 1);
+        particles.spawnLeafParticle(camera, 1.0f);
+        if (particles.getParticleCount() == before) {
+            break;
+        }
+    }
+}
+
+int Benchmark::runParticles(const BenchmarkOptions& options) {
+    MapBuilderParams params;
+    if (!loadStandaloneParams(options, params)) {
+        return 1;
+    }
+
+    Map map;
+    map.setNoiseParams(params);
+    int radius = std::max(1, options.viewDistance);
+    for (int chunkZ = -radius; chunkZ <= radius; chunkZ++) {
+        for (int chunkX = -radius; chunkX <= radius; chunkX++) {
+            map.ensureChunkGenerated(chunkX, chunkZ);
+        }
+    }
+
+    const int WARMUP_TICKS = 60;
+    //keys + sort per frame, what draw() can spend at 100k before it shows
+    const double SORT_BUDGET_MS = 2.0;
+    int ticks = options.maxFrames > 0 ? options.maxFrames : 600;
+    std::cout << "[Benchmark] particles, seed " << params.seed << ", " << ticks << " ticks of " << options.timestep
+              << "s, " << ParallelFor::threadCount() << " sim / " << ParallelFor::threadCount(ParallelFor::RENDER)
+              << " render threads" << std::endl;
+
+    //walking in the forest biome so every spawner runs, topped back up each tick so the count holds.
+    //no gl here, instances go into a plain vector the way draw() writes them into the mapped vbo
+    for (int count : options.particleCounts) {
+        ParticleSystem particles;
+        particles.setMaxParticles(count);
+        Camera camera;
+        float groundY = 0.0f;
+        map.getSurfaceHeight(4.5f, 4.5f, groundY);
+        camera.setPosition(glm::vec3(4.5f, groundY + 1.6f, 4.5f));
+        camera.setLook(glm::vec3(0.0f, 0.0f, -1.0f));
+
+        ParticleSystem::DrawState state;
+        std::vector<ParticleSystem::ParticleInstance> instances;
+        std::vector<uint16_t> sortKeys;
+        DepthSort depthSort;
+        std::vector<double> updateMs;
+        std::vector<double> writeMs;
+        std::vector<double> sortMs;
+        updateMs.reserve(static_cast<size_t>(ticks));
+        writeMs.reserve(static_cast<size_t>(ticks));
+        sortMs.reserve(static_cast<size_t>(ticks));
+        long long updated = 0;
+        int incrementalSorts = 0;
+        for (int tick = 0; tick < WARMUP_TICKS + ticks; tick++) {
+            fillParticles(particles, camera, count);
+            int alive = particles.getParticleCount();
+            auto start = std::chrono::steady_clock::now();
+            particles.update(options.timestep, camera, &map, true, 1.0f, 1);
+            auto updateEnd = std::chrono::steady_clock::now();
+            //fov wide enough that nothing gets culled, the write and sort numbers are for the whole count
+            particles.copyParticles(state, camera.getPosition(), camera.getLook(), 180.0f);
+            instances.resize(state.count());
+            uint32_t runSizes[ParticleSystem::BUCKET_COUNT];
+            ParticleSystem::writeInstances(state, 0.5f, ParticleSystem::ALL_BUCKETS, instances.data(), runSizes);
+            auto writeEnd = std::chrono::steady_clock::now();
+            //looking around slowly, the way draw() sees it frame to frame
+            float yaw = tick * 0.01f;
+            glm::vec3 forward(std::sin(yaw), 0.0f, -std::cos(yaw));
+            sortKeys.resize(instances.size());
+            ParticleSystem::writeSortKeys(instances.data(), instances.size(), camera.getPosition(), forward,
+                                          96.0f, sortKeys.data());
+            depthSort.sort(sortKeys.data(), runSizes, ParticleSystem::BUCKET_COUNT);
+            auto end = std::chrono::steady_clock::now();
+            if (tick >= WARMUP_TICKS) {
+                updateMs.push_back(std::chrono::duration<double, std::milli>(updateEnd - start).count());
+                writeMs.push_back(std::chrono::duration<double, std::milli>(writeEnd - updateEnd).count());
+                sortMs.push_back(std::chrono::duration<double, std::milli>(end - writeEnd).count());
+                updated += alive;
+                incrementalSorts += depthSort.getStats().incremental ? 1 : 0;
+            }
+        }
+
+        double totalUpdateMs = 0.0;
+        for (double ms : updateMs) {
+            totalUpdateMs += ms;
+        }
+        std::string label = std::to_string(count) + " particles, update";
+        printPercentiles(label.c_str(), updateMs);
+        label = std::to_string(count) + " particles, snapshot + instances";
+        printPercentiles(label.c_str(), writeMs);
+        label = std::to_string(count) + " particles, depth sort";
+        printPercentiles(label.c_str(), sortMs);
+        std::vector<double> sortedMs = sortMs;
+        std::sort(sortedMs.begin(), sortedMs.end());
+        double worstMs = sortedMs.empty() ? 0.0 : sortedMs.back();
+        std::cout << "    " << incrementalSorts << "/" << ticks << " sorts picked up the last order, worst "
+                  << std::fixed << std::setprecision(2) << worstMs << " ms of a " << SORT_BUDGET_MS << " ms budget"
+                  << (worstMs > SORT_BUDGET_MS ? " (over)" : "") << std::defaultfloat << std::endl;
+        if (totalUpdateMs > 0.0) {
+            std::cout << "    " << std::fixed << std::setprecision(0) << updated / totalUpdateMs
+                      << " particles/ms updated" << std::defaultfloat << std::endl;
+        }
+    }
+    return 0;
+}
+
+int Benchmark::runGpuParticles(const BenchmarkOptions& options) {
+    //no widget, just a context on an offscreen surface. needs nothing past gl 3.3 core, so mesa's software
+    //rasterizer runs it too: LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./app --gpu-particles 100000
+    QOffscreenSurface surface;
+    surface.create();
+    QOpenGLContext context;
+    if (!context.create() || !context.makeCurrent(&surface)) {
+        std::cerr << "[Benchmark] Could not create an OpenGL context" << std::endl;
+        return 1;
+    }
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+    if (err != GLEW_OK) {
+        std::cerr << "Error while initializing GL: " << glewGetErrorString(err) << std::endl;
+        return 1;
+    }
+    //glew's init can leave an error behind on core profiles
+    while (glGetError() != GL_NO_ERROR) {
+    }
+
+    //the shader and the reference only differ in sin / cos and fma, world units
+    const float TOLERANCE = 0.01f;
+    const int CHECK_INTERVAL = 60;
+    int ticks = options.maxFrames > 0 ? options.maxFrames : 600;
+    uint32_t seed = static_cast<uint32_t>(options.overrideSeed ? options.seed : 1);
+    std::cout << "[Benchmark] gpu particles on " << reinterpret_cast<const char*>(glGetString(GL_RENDERER))
+              << ", seed " << seed << ", " << ticks << " ticks of " << options.timestep << "s" << std::endl;
+
+    bool matched = true;
+    for (int count : options.gpuParticleCounts) {
+        GpuParticles gpu;
+        if (!gpu.initialize(count, count / 4)) {
+            std::cerr << "[Benchmark] Could not set up a gpu particle pool of " << count << std::endl;
+            return 1;
+        }
+        std::vector<GpuParticles::Particle> reference(static_cast<size_t>(count), GpuParticles::Particle{});
+        std::vector<GpuParticles::Particle> readBack;
+
+        //walking forward and turning, fog on so both kinds spawn
+        ParticleSystem::GpuEmitter source;
+        source.enabled = true;
+        source.deltaTime = options.timestep;
+        source.spawnFog = true;
+        source.poolSize = count;
+        std::vector<double> gpuMs;
+        std::vector<double> referenceMs;
+        gpuMs.reserve(static_cast<size_t>(ticks));
+        referenceMs.reserve(static_cast<size_t>(ticks));
+        float maxError = 0.0f;
+        int aliveMismatches = 0;
+        for (int tick = 1; tick <= ticks; tick++) {
+            float yaw = tick * 0.01f;
+            source.look = glm::vec3(std::sin(yaw), 0.0f, -std::cos(yaw));
+            source.eye = glm::vec3(0.0f, 1.6f, 0.0f) + source.look * (tick * options.timestep);
+            GpuParticles::Emitter emitter = ParticleSystem::buildGpuEmitter(source);
+            emitter.spawn.w = FastRandom::hash(seed + static_cast<uint32_t>(tick));
+            gpu.advanceSpawnWindow(emitter);
+
+            auto start = std::chrono::steady_clock::now();
+            gpu.step(emitter);
+            glFinish();
+            auto gpuEnd = std::chrono::steady_clock::now();
+            GpuParticles::stepReference(reference, emitter);
+            auto end = std::chrono::steady_clock::now();
+            gpuMs.push_back(std::chrono::duration<double, std::milli>(gpuEnd - start).count());
+            referenceMs.push_back(std::chrono::duration<double, std::milli>(end - gpuEnd).count());
+
+            if (tick % CHECK_INTERVAL != 0 && tick != ticks) {
+                continue;
+            }
+            gpu.readBack(readBack);
+            for (size_t i = 0; i < reference.size(); i++) {
+                const GpuParticles::Particle& a = readBack[i];
+                const GpuParticles::Particle& b = reference[i];
+                if ((a.life > 0.0f) != (b.life > 0.0f)) {
+                    aliveMismatches++;
+                    continue;
+                }
+                glm::vec3 positionError = glm::abs(a.position - b.position);
+                maxError = std::max({maxError, positionError.x, positionError.y, positionError.z,
+                                     std::abs(a.life - b.life), std::abs(a.size - b.size)});
+            }
+        }
+
+        std::string label = std::to_string(count) + " gpu particles, step";
+        printPercentiles(label.c_str(), gpuMs);
+        label = std::to_string(count) + " gpu particles, c++ reference";
+        printPercentiles(label.c_str(), referenceMs);
+        bool countMatched = maxError <= TOLERANCE && aliveMismatches == 0;
+        std::cout << "    max error " << std::scientific << std::setprecision(2) << maxError << std::defaultfloat
+                  << " (tolerance " << TOLERANCE << "), " << aliveMismatches << " slots alive on only one side"
+                  << (countMatched ? "" : " (MISMATCH)") << std::endl;
+        matched = matched && countMatched;
+        GLenum glError = glGetError();
+        if (glError != GL_NO_ERROR) {
+            std::cerr << "[Benchmark] GL error " << glError << std::endl;
+            matched = false;
+        }
+    }
+    context.doneCurrent();
+    return matched ? 0 : 1;
+}
+
+int Benchmark::runTrees(const BenchmarkOptions& options) {
+    //the tree panel's defaults two levels deeper, so there's some branching to build
+    TreeParameters params;
+    params.trunkLength = 1.0f;
+    params.trunkRadius = 0.05f;
+    params.branchAngle = 30.0f;
+    params.subBranchAngle = 45.0f;
+    params.branchLength = 0.3f;
+    params.numBranchLayers = 3;
+    params.branchesPerLayer = 4;
+    params.branchDepth = 4;
+    const std::pair<TreeType, const char*> TYPES[] = {
+        {TreeType::DEAD_PINE, "dead pine"},
+        {TreeType::DEAD_OAK, "dead oak"},
+        {TreeType::DEAD_BIRCH, "dead birch"}
+    };
+    std::cout << "[Benchmark] trees, " << options.treeCount << " of each, seed " << options.seed << std::endl;
+    uint32_t baseSeed = static_cast<uint32_t>(options.seed);
+
+    //one tree regenerated over and over, after the first it builds without allocating
+    AxialTree tree;
+    for (const auto& [type, name] : TYPES) {
+        params.treeType = type;
+        TreeGenerator::generateTree(params, baseSeed, tree);
+        long long segments = 0;
+        long long branches = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < options.treeCount; i++) {
+            TreeGenerator::generateTree(params, baseSeed + static_cast<uint32_t>(i), tree);
+            segments += static_cast<long long>(tree.segments.size());
+            branches += static_cast<long long>(tree.branches.size());
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << name << ": " << std::fixed << std::setprecision(0) << options.treeCount / seconds
+                  << " trees/s, " << std::setprecision(1) << static_cast<double>(segments) / options.treeCount
+                  << " segments / " << static_cast<double>(branches) / options.treeCount << " branches per tree"
+                  << std::defaultfloat << std::endl;
+    }
+
+    //the same trees meshed both ways. pieces are unindexed, so their vertex count is also what gets drawn
+    TreePiece piece;
+    TreeMesh tubes;
+    std::vector<float> pieceVertices;
+    for (const auto& [type, name] : TYPES) {
+        params.treeType = type;
+        long long tubeVertices = 0;
+        long long tubeIndices = 0;
+        long long pieceVertexCount = 0;
+        double tubeSeconds = 0.0;
+        double pieceSeconds = 0.0;
+        for (int i = 0; i < options.treeCount; i++) {
+            TreeGenerator::generateTree(params, baseSeed + static_cast<uint32_t>(i), tree);
+            auto start = std::chrono::steady_clock::now();
+            TreeMesher::build(tree, TreeMesher::Options(), tubes);
+            auto middle = std::chrono::steady_clock::now();
+            meshTreeAsPieces(tree, piece, pieceVertices);
+            auto end = std::chrono::steady_clock::now();
+            tubeSeconds += std::chrono::duration<double>(middle - start).count();
+            pieceSeconds += std::chrono::duration<double>(end - middle).count();
+            tubeVertices += tubes.vertexCount;
+            tubeIndices += static_cast<long long>(tubes.indices.size());
+            pieceVertexCount += static_cast<long long>(pieceVertices.size() / 14);
+        }
+        double trees = static_cast<double>(options.treeCount);
+        double tubeBytes = (static_cast<double>(tubeVertices) * 14.0 * sizeof(float) + static_cast<double>(tubeIndices) * sizeof(uint32_t)) / trees;
+        double pieceBytes = static_cast<double>(pieceVertexCount) * 14.0 * sizeof(float) / trees;
+        std::cout << "  " << name << " mesh, tubes: " << std::fixed << std::setprecision(0) << tubeVertices / trees
+                  << " vertices, " << tubeIndices / 3.0 / trees << " triangles, " << std::setprecision(1)
+                  << tubeBytes / 1024.0 << " KB, " << std::setprecision(3) << tubeSeconds * 1000.0 / trees << " ms per tree"
+                  << std::endl;
+        std::cout << "  " << name << " mesh, pieces: " << std::setprecision(0) << pieceVertexCount / trees
+                  << " vertices, " << pieceVertexCount / 3.0 / trees << " triangles, " << std::setprecision(1)
+                  << pieceBytes / 1024.0 << " KB, " << std::setprecision(3) << pieceSeconds * 1000.0 / trees << " ms per tree"
+                  << std::defaultfloat << std::endl;
+    }
+
+    //a forest on a grid, each tree seeded from where it stands
+    const int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(options.treeCount)))));
+    auto positionOf = [side](int i) {
+        return glm::vec3(static_cast<float>(i % side) * 4.0f, 0.0f, static_cast<float>(i / side) * 4.0f);
+    };
+    //sums every piece's numbers, enough to tell two forests apart
+    auto checksum = [](const Tree& terrainTree) {
+        double sum = 0.0;
+        for (const TreePieceData& piece : terrainTree.getPieces()) {
+            sum += glm::dot(piece.position + piece.rotation + piece.scale, glm::vec3(1.0f, 3.0f, 7.0f));
+        }
+        return sum;
+    };
+
+    std::vector<double> serial(static_cast<size_t>(options.treeCount));
+    long long pieces = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.treeCount; i++) {
+        glm::vec3 position = positionOf(i);
+        Tree terrainTree = TerrainTreeGenerator::generateTerrainTree(position, TerrainTreeGenerator::seedAt(position, baseSeed), tree);
+        pieces += static_cast<long long>(terrainTree.getPieces().size());
+        serial[static_cast<size_t>(i)] = checksum(terrainTree);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  terrain: " << std::fixed << std::setprecision(0) << options.treeCount / seconds
+              << " trees/s, " << std::setprecision(1) << static_cast<double>(pieces) / options.treeCount
+              << " pieces per tree" << std::defaultfloat << std::endl;
+
+    //same forest again across the worker threads, has to come out identical
+    std::vector<double> parallel(serial.size());
+    start = std::chrono::steady_clock::now();
+    ParallelFor::run(parallel.size(), 64, [&](size_t begin, size_t end) {
+        AxialTree scratch;
+        for (size_t i = begin; i < end; i++) {
+            glm::vec3 position = positionOf(static_cast<int>(i));
+            parallel[i] = checksum(TerrainTreeGenerator::generateTerrainTree(position, TerrainTreeGenerator::seedAt(position, baseSeed), scratch));
+        }
+    });
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int mismatches = 0;
+    for (size_t i = 0; i < serial.size(); i++) {
+        mismatches += serial[i] != parallel[i] ? 1 : 0;
+    }
+    std::cout << "  terrain, " << ParallelFor::threadCount() << " threads: " << std::fixed << std::setprecision(0)
+              << options.treeCount / seconds << " trees/s, " << mismatches << " trees differ from serial"
+              << std::defaultfloat << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+void Benchmark::meshTreeAsPieces(const AxialTree& tree, const TreePiece& piece, std::vector<float>& vertices) {
+    vertices.clear();
+    const std::vector<float>& source = piece.getVertexData();
+    for (const Segment& segment : tree.segments) {
+        //the piece is a y axis cylinder centered on the origin, stretched over the segment
+        glm::vec3 reference = std::abs(segment.direction.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 x = glm::normalize(glm::cross(reference, segment.direction));
+        glm::vec3 z = glm::cross(x, segment.direction);
+        glm::mat3 rotation(x, segment.direction, z);
+        glm::vec3 scale(segment.radius / TreePiece::getRadius(), segment.length / TreePiece::getHeight(),
+                        segment.radius / TreePiece::getRadius());
+        glm::vec3 center = (segment.start + segment.end) * 0.5f;
+        for (size_t v = 0; v < source.size(); v += 14) {
+            glm::vec3 pos = center + rotation * (glm::vec3(source[v], source[v + 1], source[v + 2]) * scale);
+            glm::vec3 normal = glm::normalize(rotation * (glm::vec3(source[v + 3], source[v + 4], source[v + 5]) / scale));
+            glm::vec3 tangent = rotation * glm::vec3(source[v + 6], source[v + 7], source[v + 8]);
+            glm::vec3 bitangent = rotation * glm::vec3(source[v + 9], source[v + 10], source[v + 11]);
+            vertices.insert(vertices.end(), {pos.x, pos.y, pos.z, normal.x, normal.y, normal.z,
+                                             tangent.x, tangent.y, tangent.z, bitangent.x, bitangent.y, bitangent.z,
+                                             source[v + 12], source[v + 13]});
+        }
+    }
+}
+
+int Benchmark::run(const BenchmarkOptions& options) {
+    if (options.raycastRays > 0) {
+        return runRaycast(options);
+    }
+    if (!options.enemyCounts.empty()) {
+        return runEnemies(options);
+    }
+    if (!options.particleCounts.empty()) {
+        return runParticles(options);
+    }
+    if (!options.gpuParticleCounts.empty()) {
+        return runGpuParticles(options);
+    }
+    if (options.treeCount > 0) {
+        return runTrees(options);
+    }
+
+    MapBuilderParams params;
+    const std::string& paramsFile = options.paramsFile.empty() ? options.pathFile : options.paramsFile;
+    if (!loadMapParams(paramsFile, params) && !options.paramsFile.empty()) {
+        std::cerr << "[Benchmark] Failed to load map params from " << paramsFile << std::endl;
+        return 1;
+    }
+    if (options.overrideSeed) {
+        params.seed = options.seed;
+    }
+
+    Map map;
+    map.setNoiseParams(params);
+
+    //never shown, QOpenGLWidget falls back to an offscreen surface + its own fbo
+    Realtime realtime;
+    realtime.setAttribute(Qt::WA_DontShowOnScreen);
+    realtime.resize(options.width, options.height);
+    realtime.show();
+    QCoreApplication::processEvents();
+    if (!realtime.isValid()) {
+        std::cerr << "[Benchmark] Could not create an OpenGL context" << std::endl;
+        return 1;
+    }
+    //ticks driven from advanceFrame so every run steps the same frames, not whatever a second thread managed
+    realtime.setThreadedSimulation(false);
+
+    realtime.setActiveMap(&map);
+    realtime.setFlyingMode(true);
+    realtime.setViewDistance(options.viewDistance);
+    if (!realtime.loadCameraPath(options.pathFile)) {
+        realtime.finish();
+        return 1;
+    }
+    realtime.startPathPlayback();
+    Profiler::setEnabled(true);
+
+    std::cout << "[Benchmark] " << options.pathFile << " seed " << params.seed << ", "
+              << options.width << "x" << options.height << ", dt " << options.timestep << " s" << std::endl;
+
+    std::vector<FrameSample> samples;
+    samples.reserve(static_cast<size_t>(realtime.getPathDuration() / options.timestep) + 8);
+    int lastGenerated = map.getGeneratedChunkCount();
+    float simTime = 0.0f;
+
+    while (realtime.isPathPlaying() && (options.maxFrames <= 0 || static_cast<int>(samples.size()) < options.maxFrames)) {
+        FrameSample sample;
+        sample.profilerFrame = Profiler::getCurrentFrameIndex();
+
+        auto frameStart = std::chrono::steady_clock::now();
+        realtime.advanceFrame(options.timestep);
+        realtime.renderFrame();
+        sample.cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+        simTime += options.timestep;
+        sample.simTime = simTime;
+        sample.gpuMs = -1.0;
+        sample.drawCalls = Profiler::getLastFrameDrawCalls();
+        sample.residentChunks = static_cast<int>(map.getChunks().size());
+        sample.generatedChunks = map.getGeneratedChunkCount() - lastGenerated;
+        lastGenerated = map.getGeneratedChunkCount();
+        samples.push_back(sample);
+
+        collectGpuTimes(samples);
+    }
+
+    //two more frames so the last samples' gpu queries get resolved
+    for (int i = 0; i < 2; i++) {
+        realtime.renderFrame();
+        collectGpuTimes(samples);
+    }
+
+    bool wroteCsv = writeCsv(options.csvFile, samples);
+
+    std::vector<double> cpuTimes;
+    std::vector<double> gpuTimes;
+    long long drawCalls = 0;
+    int generatedChunks = 0;
+    for (const FrameSample& sample : samples) {
+        cpuTimes.push_back(sample.cpuMs);
+        if (sample.gpuMs >= 0.0) {
+            gpuTimes.push_back(sample.gpuMs);
+        }
+        drawCalls += sample.drawCalls;
+        generatedChunks += sample.generatedChunks;
+    }
+
+    std::cout << "[Benchmark] " << samples.size() << " frames";
+    if (!samples.empty()) {
+        std::cout << ", avg " << drawCalls / static_cast<long long>(samples.size()) << " draw calls";
+    }
+    std::cout << ", " << generatedChunks << " chunks generated" << std::endl;
+    printPercentiles("cpu", cpuTimes);
+    printPercentiles("gpu", gpuTimes);
+    FlowField::Stats flowStats = realtime.getFlowFieldStats();
+    if (flowStats.builds > 0) {
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  flow field: " << flowStats.builds << " rebuilds, avg " << flowStats.totalMs / flowStats.builds
+                  << "  max " << flowStats.maxMs << " ms, " << flowStats.unchanged << " chunk changes skipped" << std::endl;
+        std::cout << std::defaultfloat;
+    }
+    EnemyManager::LodStats lodStats = realtime.getEnemyLodStats();
+    std::cout << "  enemy lod: near " << lodStats.nearCount << " far " << lodStats.farCount
+              << " hidden " << lodStats.hiddenCount << " at the end, est. "
+              << std::fixed << std::setprecision(3) << lodStats.totalSavedMs << " ms saved in total" << std::endl;
+    std::cout << std::defaultfloat;
+    if (wroteCsv) {
+        std::cout << "[Benchmark] Wrote " << options.csvFile << std::endl;
+    }
+
+    Profiler::setEnabled(false);
+    realtime.finish();
+    return wroteCsv ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "map/mapbuilder.h"
+
+class AxialTree;
+class Camera;
+class ParticleSystem;
+class TreePiece;
+
+struct BenchmarkOptions {
+    std::string pathFile;
+    std::string csvFile = "benchmark.csv";
+    std::string paramsFile;        //optional, otherwise the "map" block of the path file is used
+    bool overrideSeed = false;
+    int seed = 0;
+    float timestep = 1.0f / 60.0f;
+    int width = 1280;
+    int height = 720;
+    int maxFrames = 0;             //0 runs until the path finishes
+    int viewDistance = 4;
+    int raycastRays = 0;           //--raycast N: time N random rays through generated terrain instead of flying a path
+    std::vector<int> enemyCounts;  //--enemies 1000,10000: time enemy ticks with that many chasing the player, one run each
+    std::vector<int> particleCounts;   //--particles 10000,100000: time particle updates, instance writes and depth sorts at that many
+    int treeCount = 0;             //--trees N: generate and mesh N trees of each kind, trees/sec
+    std::vector<int> gpuParticleCounts;    //--gpu-particles 100000: step a gpu particle pool that big, checked against the c++ reference
+};
+
+//headless flythrough: fixed timestep sim along a camera path, per-frame timings to csv.
+//run under xvfb-run or QT_QPA_PLATFORM=offscreen on machines without a display
+class Benchmark {
+public:
+    //true if the args asked for a benchmark, ok is false when they were malformed
+    static bool parseArguments(int argc, char* argv[], BenchmarkOptions& options, bool& ok);
+    static int run(const BenchmarkOptions& options);
+    static int runRaycast(const BenchmarkOptions& options);
+    static int runEnemies(const BenchmarkOptions& options);
+    static int runParticles(const BenchmarkOptions& options);
+    //makes its own offscreen context, 1 if the gpu and reference pools drift apart
+    static int runGpuParticles(const BenchmarkOptions& options);
+    static int runTrees(const BenchmarkOptions& options);
+
+private:
+    struct FrameSample {
+        unsigned long long profilerFrame;
+        float simTime;
+        double cpuMs;
+        double gpuMs;              //-1 until (unless) the timestamp queries come back
+        int drawCalls;
+        int residentChunks;
+        int generatedChunks;
+    };
+
+    //"1000,10000" onto out
+    static void parseCounts(const std::string& value, std::vector<int>& out);
+    static bool loadMapParams(const std::string& filePath, MapBuilderParams& params);
+    //map params from --params / --seed, false if --params was given and couldn't be read
+    static bool loadStandaloneParams(const BenchmarkOptions& options, MapBuilderParams& params);
+    static void collectGpuTimes(std::vector<FrameSample>& samples);
+    static bool writeCsv(const std::string& filePath, const std::vector<FrameSample>& samples);
+    static void printPercentiles(const char* label, std::vector<double> values);
+    //the old way of meshing a tree, a TreePiece cylinder per segment moved into place, to hold TreeMesher up against
+    static void meshTreeAsPieces(const AxialTree& tree, const TreePiece& piece, std::vector<float>& vertices);
+    //tops particles up to count (capped by its max particles) spread over every kind around the camera
+    static void fillParticles(ParticleSystem& particles, const Camera& camera, int count);
+    static void printUsage();
+};
@@ -11,6 +11,10 @@ public:
     int getVertexCount() const { return static_cast<int>(m_vertexData.size() / 14); }
 
     void generateGeometry();
+    
+    //unscaled mesh size, the collision code builds trunk cylinders from these and the piece's scale
+    static float getRadius() { return m_radius; }
+    static float getHeight() { return m_height; }
 
 private:
     void makeSideSlice(float currentTheta, float nextTheta, int segments);
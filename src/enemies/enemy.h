@@ -1,35 +1,27 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <QElapsedTimer>
-
-class Map;
 
+//one enemy as the renderer sees it. EnemyManager simulates everyone in its own arrays and fills these in
+//for the snapshot, so this is plain data plus the look (flash colours, vibration, death shrink)
 class Enemy {
 public:
-    Enemy(const glm::vec3& position, float sizeMultiplier = 1.0f);
-    
-    void update(float deltaTime, const glm::vec3& targetPosition, Map* map);
-    void updateWithFlashlight(float deltaTime, const glm::vec3& targetPosition, Map* map,
-                              bool flashlightOn, const glm::vec3& flashlightPos, 
-                              const glm::vec3& flashlightDir, float flashlightConeAngle);
-    void render();
+    Enemy() = default;
     
     glm::vec3 getPosition() const { return m_position; }
+    glm::vec3 getCenter() const { return m_position + glm::vec3(0.0f, getEnemyHeight() * 0.5f, 0.0f); }
+    //between the previous and current tick, alpha = 1 is the newest
+    glm::vec3 getRenderPosition(float alpha) const { return glm::mix(m_previousPosition, m_position, alpha); }
     bool isAlive() const { return m_alive; }
-    void setAlive(bool alive);
     float getSizeMultiplier() const { return m_sizeMultiplier; }
     float getHealth() const { return m_health; }
-    void setHealth(float health) { m_health = health; }
     bool isIlluminated() const { return m_isIlluminated; }
     float getIlluminationTime() const { return m_illuminationTime; }
     glm::vec3 getVibrationOffset(float time) const;
     glm::vec4 getFlashColor(float time) const;
     glm::vec4 getRandomFlashColor(float time) const;
-    bool hasTakenDamage() const { return m_hasTakenDamage; }
-    bool checkDamageThisFrame();
     float getTimeSinceLastDamage() const { return m_timeSinceLastDamage; }
-    bool isRecentlyDamaged() const { return m_timeSinceLastDamage < 0.25f; }
+    bool isRecentlyDamaged() const { return m_timeSinceLastDamage < DAMAGE_FLASH_TIME; }
     
     bool isDying() const { return m_isDying; }
     float getDeathProgress() const { return m_deathTimer / DEATH_ANIMATION_DURATION; }
@@ -37,45 +29,31 @@ public:
     glm::vec3 getDeathStartPosition() const { return m_deathStartPosition; }
     
 private:
-    glm::vec3 m_position;
-    glm::vec3 m_velocity;
-    bool m_onGround;
-    bool m_alive;
-    float m_health;
-    float m_previousHealth;
-    bool m_isIlluminated;
-    float m_illuminationTime;
-    bool m_hasTakenDamage;
-    float m_timeSinceLastDamage;
+    friend class EnemyManager;
     
-    bool m_isDying;
-    float m_deathTimer;
-    glm::vec3 m_deathStartPosition;
-    static constexpr float DEATH_ANIMATION_DURATION = 0.3f;
+    glm::vec3 m_position = glm::vec3(0.0f);
+    glm::vec3 m_previousPosition = glm::vec3(0.0f);
+    bool m_alive = false;
+    float m_health = 0.0f;
+    bool m_isIlluminated = false;
+    float m_illuminationTime = 0.0f;
+    float m_timeSinceLastDamage = 1.0f;
     
-    float m_sizeMultiplier;
-    float m_jumpCooldown;
-    float m_jumpTimer;
+    bool m_isDying = false;
+    float m_deathTimer = 0.0f;
+    glm::vec3 m_deathStartPosition = glm::vec3(0.0f);
+    float m_sizeMultiplier = 1.0f;
     
+    static constexpr float DEATH_ANIMATION_DURATION = 0.3f;
+    static constexpr float DAMAGE_FLASH_TIME = 0.25f;
     static constexpr float BASE_ENEMY_WIDTH = 0.6f;
     static constexpr float BASE_ENEMY_HEIGHT = 1.8f;
     static constexpr float GRAVITY = 9.8f;
     static constexpr float BASE_JUMP_SPEED = 5.0f;
     static constexpr float BASE_MOVE_SPEED = 3.6f;
     static constexpr float JUMP_COOLDOWN = 2.0f;
+    static constexpr float CLIMB_JUMP_COOLDOWN = 0.4f;
+    static constexpr float FLOW_FIELD_MIN_DISTANCE = 2.0f;  //closer than this they go straight for the target
     
-    float getEnemyWidth() const { return BASE_ENEMY_WIDTH * m_sizeMultiplier; }
     float getEnemyHeight() const { return BASE_ENEMY_HEIGHT * m_sizeMultiplier; }
-    float getMoveSpeed() const { return BASE_MOVE_SPEED / m_sizeMultiplier; }
-    float getJumpSpeed() const { return BASE_JUMP_SPEED * m_sizeMultiplier; }
-    
-    bool checkCollision(Map* map, const glm::vec3& pos);
-    glm::vec3 resolveCollision(Map* map, const glm::vec3& pos, const glm::vec3& oldPos);
-    glm::vec3 getBoundingBoxMin(const glm::vec3& pos) const;
-    glm::vec3 getBoundingBoxMax(const glm::vec3& pos) const;
-    
-    bool isInFlashlightCone(const glm::vec3& flashlightPos, const glm::vec3& flashlightDir, 
-                            float flashlightConeAngle) const;
-    bool hasLineOfSight(Map* map, const glm::vec3& from, const glm::vec3& to) const;
 };
-
@@ -1,13 +1,16 @@
 #include "enemymanager.h"
 #include "map/Map.h"
 #include "map/mapproperties.h"
+#include "map/VoxelCollision.h"
 #include "utils/audiomanager.h"
+#include "utils/parallelfor.h"
 #include <QStandardPaths>
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
 #include <QResource>
 #include <algorithm>
+#include <chrono>
 #include <random>
 #include <cmath>
 #include <iostream>
@@ -15,7 +18,9 @@
 EnemyManager::EnemyManager() : m_spawnTimer(0.0f), m_spawnInterval(30.0f), m_baseSpawnInterval(30.0f), 
                                  m_currentSpawnInterval(30.0f), m_autoSpawnEnabled(true), 
                                  m_enemyHitSoundsLoaded(false), m_enemyNoiseSoundsLoaded(false),
-                                 m_enemyDeathSoundsLoaded(false) {
+                                 m_enemyDeathSoundsLoaded(false), m_aliveEnemyCount(0),
+                                 m_flowFieldMap(nullptr), m_lodEnabled(true), m_hasViewer(false),
+                                 m_viewProjection(1.0f), m_lodTick(0), m_nextLodPhase(0) {
     m_elapsedTimer.start();
     loadEnemyHitSounds();
     loadEnemyNoiseSounds();
@@ -27,293 +32,540 @@ EnemyManager::EnemyManager() : m_spawnTimer(0.0f), m_spawnInterval(30.0f), m_bas
     m_currentSpawnInterval = m_baseSpawnInterval * intervalVariation(gen);
 }
 
-void EnemyManager::update(float deltaTime, const glm::vec3& cameraPosition, Map* map,
-                          AudioManager* audioManager) {
-    if (m_autoSpawnEnabled) {
-        bool isInMountains = false;
-        if (map != nullptr) {
-            int playerX = static_cast<int>(std::floor(cameraPosition.x));
-            int playerZ = static_cast<int>(std::floor(cameraPosition.z));
-            BiomeType currentBiome = map->getBiomeAt(playerX, playerZ);
-            isInMountains = (currentBiome == BIOME_MOUNTAINS);
-        }
+void EnemyManager::EnemyArrays::push(const glm::vec3& pos, float size, float noiseTimerOffset, uint8_t phase) {
+    position.push_back(pos);
+    previousPosition.push_back(pos);
+    velocity.push_back(glm::vec3(0.0f));
+    separation.push_back(glm::vec3(0.0f));
+    deathStartPosition.push_back(pos);
+    health.push_back(100.0f);
+    sizeMultiplier.push_back(size);
+    illuminationTime.push_back(0.0f);
+    timeSinceLastDamage.push_back(1.0f);
+    deathTimer.push_back(0.0f);
+    jumpTimer.push_back(0.0f);
+    noiseTimer.push_back(noiseTimerOffset);
+    hitSoundTimer.push_back(0.0f);
+    pendingDeltaTime.push_back(0.0f);
+    lodTier.push_back(LOD_NEAR);
+    lodPhase.push_back(phase);
+    flags.push_back(FLAG_ALIVE);
+}
+
+void EnemyManager::EnemyArrays::swapRemove(size_t i) {
+    auto removeAt = [i](auto& values) {
+        values[i] = values.back();
+        values.pop_back();
+    };
+    removeAt(position);
+    removeAt(previousPosition);
+    removeAt(velocity);
+    removeAt(separation);
+    removeAt(deathStartPosition);
+    removeAt(health);
+    removeAt(sizeMultiplier);
+    removeAt(illuminationTime);
+    removeAt(timeSinceLastDamage);
+    removeAt(deathTimer);
+    removeAt(jumpTimer);
+    removeAt(noiseTimer);
+    removeAt(hitSoundTimer);
+    removeAt(pendingDeltaTime);
+    removeAt(lodTier);
+    removeAt(lodPhase);
+    removeAt(flags);
+}
+
+void EnemyManager::EnemyArrays::clear() {
+    position.clear();
+    previousPosition.clear();
+    velocity.clear();
+    separation.clear();
+    deathStartPosition.clear();
+    health.clear();
+    sizeMultiplier.clear();
+    illuminationTime.clear();
+    timeSinceLastDamage.clear();
+    deathTimer.clear();
+    jumpTimer.clear();
+    noiseTimer.clear();
+    hitSoundTimer.clear();
+    pendingDeltaTime.clear();
+    lodTier.clear();
+    lodPhase.clear();
+    flags.clear();
+}
+
+void EnemyManager::updateAutoSpawn(float deltaTime, const glm::vec3& cameraPosition, Map* map, float spawnRadius) {
+    if (!m_autoSpawnEnabled) {
+        return;
+    }
+    bool isInMountains = false;
+    if (map != nullptr) {
+        int playerX = static_cast<int>(std::floor(cameraPosition.x));
+        int playerZ = static_cast<int>(std::floor(cameraPosition.z));
+        BiomeType currentBiome = map->getBiomeAt(playerX, playerZ);
+        isInMountains = (currentBiome == BIOME_MOUNTAINS);
+    }
+    
+    float spawnRateMultiplier = isInMountains ? 2.0f : 1.0f;
+    //counted while rebuilding the grid last tick (+ spawns since), no extra pass over the list
+    if (m_aliveEnemyCount >= MAX_ALIVE_ENEMIES) {
+        return;
+    }
+    m_spawnTimer += deltaTime * spawnRateMultiplier;
+    
+    if (m_spawnTimer >= m_currentSpawnInterval) {
+        static std::random_device rd;
+        static std::mt19937 gen(rd());
+        std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * M_PI);
+        std::uniform_real_distribution<float> heightOffset(-2.0f, 2.0f);
+        std::uniform_real_distribution<float> intervalVariation(0.9f, 1.1f);
         
-        float spawnRateMultiplier = isInMountains ? 2.0f : 1.0f;
-        int aliveEnemyCount = 0;
-        for (const auto& enemy : m_enemies) {
-            if (enemy->isAlive() && !enemy->isDying()) {
-                aliveEnemyCount++;
-            }
-        }
+        float angle = angleDist(gen);
+        const float SPAWN_HEIGHT_OFFSET = 20.0f;
+        const float SPAWN_HEIGHT = cameraPosition.y + SPAWN_HEIGHT_OFFSET;
         
-        if (aliveEnemyCount < 15) {
-            m_spawnTimer += deltaTime * spawnRateMultiplier;
-            
-            if (m_spawnTimer >= m_currentSpawnInterval) {
-                static std::random_device rd;
-                static std::mt19937 gen(rd());
-                std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * M_PI);
-                std::uniform_real_distribution<float> heightOffset(-2.0f, 2.0f);
-                std::uniform_real_distribution<float> intervalVariation(0.9f, 1.1f);
-                
-                float angle = angleDist(gen);
-                const float SPAWN_RADIUS = 33.0f;
-                const float SPAWN_HEIGHT_OFFSET = 20.0f;
-                const float SPAWN_HEIGHT = cameraPosition.y + SPAWN_HEIGHT_OFFSET;
-                
-                float x = cameraPosition.x + SPAWN_RADIUS * cosf(angle);
-                float z = cameraPosition.z + SPAWN_RADIUS * sinf(angle);
-                float y = SPAWN_HEIGHT + heightOffset(gen);
-                
-                glm::vec3 spawnPos = glm::vec3(x, y, z);
-                spawnEnemy(spawnPos);
-                m_spawnTimer = 0.0f;
-                m_currentSpawnInterval = m_baseSpawnInterval * intervalVariation(gen);
-                std::cout << "[Enemy Spawn] Auto-spawned enemy. Next spawn delay: " << m_currentSpawnInterval << "s" << std::endl;
-            }
-        }
+        float x = cameraPosition.x + spawnRadius * cosf(angle);
+        float z = cameraPosition.z + spawnRadius * sinf(angle);
+        float y = SPAWN_HEIGHT + heightOffset(gen);
+        findSpawnHeight(map, x, z, y);
+        
+        glm::vec3 spawnPos = glm::vec3(x, y, z);
+        spawnEnemy(spawnPos);
+        m_spawnTimer = 0.0f;
+        m_currentSpawnInterval = m_baseSpawnInterval * intervalVariation(gen);
+        std::cout << "[Enemy Spawn] Auto-spawned enemy. Next spawn delay: " << m_currentSpawnInterval << "s" << std::endl;
     }
-    
-    // Remove dead enemies (only after death animation completes) and their corresponding sound timers
-    size_t writeIndex = 0;
-    for (size_t i = 0; i < m_enemies.size(); ++i) {
-        if (!m_enemies[i]->shouldBeRemoved()) {
-            if (writeIndex != i) {
-                m_enemies[writeIndex] = std::move(m_enemies[i]);
-                m_enemyNoiseTimers[writeIndex] = m_enemyNoiseTimers[i];
-                m_enemyDeathSoundPlayed[writeIndex] = m_enemyDeathSoundPlayed[i];
-            }
-            writeIndex++;
+}
+
+void EnemyManager::removeFinishedEnemies() {
+    //only once the death animation is over. walking backwards means whatever gets swapped in was already checked
+    for (size_t i = m_enemies.size(); i-- > 0;) {
+        if ((m_enemies.flags[i] & FLAG_DYING) && m_enemies.deathTimer[i] >= Enemy::DEATH_ANIMATION_DURATION) {
+            m_enemies.swapRemove(i);
         }
     }
-    m_enemies.resize(writeIndex);
-    m_enemyNoiseTimers.resize(writeIndex);
-    m_enemyDeathSoundPlayed.resize(writeIndex);
+}
+
+void EnemyManager::update(float deltaTime, const glm::vec3& cameraPosition, Map* map,
+                          AudioManager* audioManager) {
+    updateAutoSpawn(deltaTime, cameraPosition, map, 33.0f);
+    removeFinishedEnemies();
     
     if (!m_enemyNoiseSoundsLoaded) {
         loadEnemyNoiseSounds();
     }
+    if (!m_enemyDeathSoundsLoaded) {
+        loadEnemyDeathSounds();
+    }
     
-    m_enemyNoiseTimers.resize(m_enemies.size(), 0.0f);
-    m_enemyDeathSoundPlayed.resize(m_enemies.size(), false);
-    
-    const float noiseInterval = 5.0f;
+    TickParams params{deltaTime, cameraPosition, map, &m_flowField, false};
+    rebuildEnemyGrid();
+    updateFlowField(map, cameraPosition);
+    assignLodTiers(params);
+    applySeparation();
     
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
+    simulate(params);
+    flushAudioEvents(audioManager);
+}
+
+void EnemyManager::updateWithFlashlight(float deltaTime, const glm::vec3& cameraPosition, Map* map,
+                                       bool flashlightOn, const glm::vec3& flashlightPos,
+                                       const glm::vec3& flashlightDir, float flashlightConeAngle,
+                                       AudioManager* audioManager) {
+    updateAutoSpawn(deltaTime, cameraPosition, map, 30.0f);
+    removeFinishedEnemies();
     
+    if (!m_enemyHitSoundsLoaded) {
+        loadEnemyHitSounds();
+    }
+    if (!m_enemyNoiseSoundsLoaded) {
+        loadEnemyNoiseSounds();
+    }
     if (!m_enemyDeathSoundsLoaded) {
         loadEnemyDeathSounds();
     }
     
-    for (size_t i = 0; i < m_enemies.size(); ++i) {
-        auto& enemy = m_enemies[i];
-        
-        if (enemy->isDying() && !m_enemyDeathSoundPlayed[i] && audioManager != nullptr && !m_enemyDeathSounds.empty()) {
-            std::uniform_int_distribution<size_t> deathDist(0, m_enemyDeathSounds.size() - 1);
-            
-            size_t randomIndex1 = deathDist(gen);
-            QString selectedSound1 = m_enemyDeathSounds[randomIndex1];
-            audioManager->playSound(selectedSound1.toUtf8().constData());
-            
-            if (m_enemyDeathSounds.size() > 1) {
-                size_t randomIndex2 = deathDist(gen);
-                while (randomIndex2 == randomIndex1 && m_enemyDeathSounds.size() > 1) {
-                    randomIndex2 = deathDist(gen);
+    TickParams params{deltaTime, cameraPosition, map, &m_flowField, true};
+    rebuildEnemyGrid();
+    updateFlowField(map, cameraPosition);
+    updateFlashlightVisibility(map, flashlightOn, flashlightPos, flashlightDir, flashlightConeAngle);
+    assignLodTiers(params);
+    applySeparation();
+    
+    simulate(params);
+    flushAudioEvents(audioManager);
+}
+
+void EnemyManager::setViewer(const glm::mat4& viewProjection) {
+    m_viewProjection = viewProjection;
+    m_hasViewer = true;
+}
+
+void EnemyManager::assignLodTiers(const TickParams& params) {
+    m_lodTick++;
+    ParallelFor::run(m_enemies.size(), ENEMIES_PER_JOB, [this, &params](size_t begin, size_t end) {
+        const float nearDistanceSq = LOD_NEAR_DISTANCE * LOD_NEAR_DISTANCE;
+        for (size_t i = begin; i < end; ++i) {
+            uint8_t& flags = m_enemies.flags[i];
+            const glm::vec3& position = m_enemies.position[i];
+            //dying ones stay near so the death animation doesn't stutter, lit ones so the damage is smooth
+            uint8_t tier = LOD_NEAR;
+            bool lit = params.flashlightPass && m_litByFlashlight[i] != 0;
+            glm::vec3 offset = position - params.target;
+            if (m_lodEnabled && !(flags & FLAG_DYING) && !lit && glm::dot(offset, offset) >= nearDistanceSq) {
+                bool onScreen = !m_hasViewer;
+                if (m_hasViewer) {
+                    float height = Enemy::BASE_ENEMY_HEIGHT * m_enemies.sizeMultiplier[i];
+                    glm::vec4 clip = m_viewProjection * glm::vec4(position.x, position.y + height * 0.5f, position.z, 1.0f);
+                    //a bit of margin so they're already at full rate when they walk into view
+                    float limit = clip.w * 1.2f;
+                    onScreen = clip.w > 0.0f && std::abs(clip.x) <= limit && std::abs(clip.y) <= limit;
                 }
-                QString selectedSound2 = m_enemyDeathSounds[randomIndex2];
-                audioManager->playSound(selectedSound2.toUtf8().constData());
+                tier = onScreen ? LOD_FAR : LOD_HIDDEN;
             }
             
-            m_enemyDeathSoundPlayed[i] = true;
+            uint32_t interval = tier == LOD_NEAR ? 1 : (tier == LOD_FAR ? LOD_FAR_INTERVAL : LOD_HIDDEN_INTERVAL);
+            m_enemies.lodTier[i] = tier;
+            if (((m_lodTick + m_enemies.lodPhase[i]) & (interval - 1)) == 0) {
+                flags |= FLAG_LOD_DUE;
+            } else {
+                flags &= ~FLAG_LOD_DUE;
+            }
         }
+    });
+    
+    m_lodStats.nearCount = 0;
+    m_lodStats.farCount = 0;
+    m_lodStats.hiddenCount = 0;
+    m_lodStats.updatedCount = 0;
+    for (size_t i = 0; i < m_enemies.size(); ++i) {
+        uint8_t tier = m_enemies.lodTier[i];
+        m_lodStats.nearCount += tier == LOD_NEAR;
+        m_lodStats.farCount += tier == LOD_FAR;
+        m_lodStats.hiddenCount += tier == LOD_HIDDEN;
+        m_lodStats.updatedCount += (m_enemies.flags[i] & FLAG_LOD_DUE) != 0;
+    }
+}
+
+void EnemyManager::simulate(const TickParams& params) {
+    m_soundRequests.assign(m_enemies.size(), 0);
+    auto start = std::chrono::steady_clock::now();
+    //every enemy only writes its own slots, the map / field / grid are only read while this runs
+    ParallelFor::run(m_enemies.size(), ENEMIES_PER_JOB, [this, &params](size_t begin, size_t end) {
+        simulateRange(params, begin, end);
+    });
+    m_lodStats.kernelMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    
+    int skipped = static_cast<int>(m_enemies.size()) - m_lodStats.updatedCount;
+    m_lodStats.savedMs = m_lodStats.updatedCount > 0 ? m_lodStats.kernelMs / m_lodStats.updatedCount * skipped : 0.0f;
+    m_lodStats.totalSavedMs += m_lodStats.savedMs;
+}
+
+void EnemyManager::simulateRange(const TickParams& params, size_t begin, size_t end) {
+    const float noiseInterval = 5.0f;
+    const float hitSoundInterval = 0.1f;
+    const float damagePerSecond = 50.0f;
+    const bool hasDeathSounds = !m_enemyDeathSounds.empty();
+    const bool hasNoiseSounds = !m_enemyNoiseSounds.empty();
+    const bool hasHitSounds = !m_enemyHitSounds.empty();
+    
+    for (size_t i = begin; i < end; ++i) {
+        uint8_t& flags = m_enemies.flags[i];
+        m_enemies.previousPosition[i] = m_enemies.position[i];
         
-        if (enemy->isDying()) {
-            enemy->update(deltaTime, cameraPosition, map);
-        } else {
-            enemy->update(deltaTime, cameraPosition, map);
+        //not its turn, it catches up on the whole backlog of dt when it is
+        if (!(flags & FLAG_LOD_DUE)) {
+            m_enemies.pendingDeltaTime[i] += params.deltaTime;
+            continue;
         }
+        const float dt = params.deltaTime + m_enemies.pendingDeltaTime[i];
+        m_enemies.pendingDeltaTime[i] = 0.0f;
         
-        if (enemy->isAlive() && !enemy->isDying()) {
-            m_enemyNoiseTimers[i] += deltaTime;
-            
-            glm::vec3 enemyPos = enemy->getPosition();
-            float distanceToPlayer = glm::distance(enemyPos, cameraPosition);
-            
-            if (m_enemyNoiseTimers[i] >= noiseInterval && audioManager != nullptr && !m_enemyNoiseSounds.empty() && distanceToPlayer <= 25.0f) {
-                std::uniform_int_distribution<size_t> noiseDist(0, m_enemyNoiseSounds.size() - 1);
-                size_t randomIndex = noiseDist(gen);
-                QString selectedNoise = m_enemyNoiseSounds[randomIndex];
-                
-                audioManager->playSound(selectedNoise.toUtf8().constData());
-                m_enemyNoiseTimers[i] = 0.0f;
+        if (flags & FLAG_DYING) {
+            m_enemies.deathTimer[i] += dt;
+            flags &= ~FLAG_ALIVE;
+            if (!(flags & FLAG_DEATH_SOUND_PLAYED) && hasDeathSounds) {
+                m_soundRequests[i] |= 1 << static_cast<int>(EnemySound::Death);
+                flags |= FLAG_DEATH_SOUND_PLAYED;
             }
+            continue;
         }
-    }
-}
-
-void EnemyManager::updateWithFlashlight(float deltaTime, const glm::vec3& cameraPosition, Map* map,
-                                       bool flashlightOn, const glm::vec3& flashlightPos,
-                                       const glm::vec3& flashlightDir, float flashlightConeAngle,
-                                       AudioManager* audioManager) {
-    if (m_autoSpawnEnabled) {
-        bool isInMountains = false;
-        if (map != nullptr) {
-            int playerX = static_cast<int>(std::floor(cameraPosition.x));
-            int playerZ = static_cast<int>(std::floor(cameraPosition.z));
-            BiomeType currentBiome = map->getBiomeAt(playerX, playerZ);
-            isInMountains = (currentBiome == BIOME_MOUNTAINS);
+        if (!(flags & FLAG_ALIVE) || params.map == nullptr) {
+            continue;
         }
         
-        float spawnRateMultiplier = isInMountains ? 2.0f : 1.0f;
-        int aliveEnemyCount = 0;
-        for (const auto& enemy : m_enemies) {
-            if (enemy->isAlive() && !enemy->isDying()) {
-                aliveEnemyCount++;
+        m_enemies.timeSinceLastDamage[i] += dt;
+        
+        bool lit = false;
+        if (params.flashlightPass) {
+            lit = m_litByFlashlight[i] != 0;
+            if (lit) {
+                flags |= FLAG_ILLUMINATED;
+                m_enemies.illuminationTime[i] += dt;
+            } else {
+                flags &= ~FLAG_ILLUMINATED;
+                m_enemies.illuminationTime[i] = 0.0f;
             }
         }
         
-        if (aliveEnemyCount < 15) {
-            m_spawnTimer += deltaTime * spawnRateMultiplier;
-            
-            if (m_spawnTimer >= m_currentSpawnInterval) {
-                static std::random_device rd;
-                static std::mt19937 gen(rd());
-                std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * M_PI);
-                std::uniform_real_distribution<float> heightOffset(-2.0f, 2.0f);
-                std::uniform_real_distribution<float> intervalVariation(0.9f, 1.1f);
-                
-                float angle = angleDist(gen);
-                const float SPAWN_RADIUS = 30.0f;
-                const float SPAWN_HEIGHT_OFFSET = 20.0f;
-                const float SPAWN_HEIGHT = cameraPosition.y + SPAWN_HEIGHT_OFFSET;
-                
-                float x = cameraPosition.x + SPAWN_RADIUS * cosf(angle);
-                float z = cameraPosition.z + SPAWN_RADIUS * sinf(angle);
-                float y = SPAWN_HEIGHT + heightOffset(gen);
-                
-                glm::vec3 spawnPos = glm::vec3(x, y, z);
-                spawnEnemy(spawnPos);
-                m_spawnTimer = 0.0f;
-                m_currentSpawnInterval = m_baseSpawnInterval * intervalVariation(gen);
-                std::cout << "[Enemy Spawn] Auto-spawned enemy. Next spawn delay: " << m_currentSpawnInterval << "s" << std::endl;
+        if (lit) {
+            //frozen in the beam and burning
+            m_enemies.velocity[i].x = 0.0f;
+            m_enemies.velocity[i].z = 0.0f;
+            m_enemies.health[i] -= damagePerSecond * dt;
+            if (m_enemies.timeSinceLastDamage[i] >= Enemy::DAMAGE_FLASH_TIME) {
+                m_enemies.timeSinceLastDamage[i] = 0.0f;
+            }
+            if (m_enemies.health[i] <= 0.0f) {
+                m_enemies.health[i] = 0.0f;
+                flags = (flags & ~FLAG_ALIVE) | FLAG_DYING;
+                m_enemies.deathTimer[i] = 0.0f;
+                m_enemies.deathStartPosition[i] = m_enemies.position[i];
+                continue;
+            }
+        } else {
+            if (m_enemies.lodTier[i] == LOD_HIDDEN) {
+                moveEnemyCheap(params, i, dt);
+            } else {
+                moveEnemy(params, i, dt);
+            }
+            if (flags & FLAG_DYING) {
+                continue;
             }
         }
-    }
-    
-    // Remove dead enemies (only after death animation completes) and their corresponding sound timers
-    size_t writeIndex = 0;
-    for (size_t i = 0; i < m_enemies.size(); ++i) {
-        if (!m_enemies[i]->shouldBeRemoved()) {
-            if (writeIndex != i) {
-                m_enemies[writeIndex] = std::move(m_enemies[i]);
-                m_enemySoundTimers[writeIndex] = m_enemySoundTimers[i];
-                m_enemyNoiseTimers[writeIndex] = m_enemyNoiseTimers[i];
-                m_enemyDeathSoundPlayed[writeIndex] = m_enemyDeathSoundPlayed[i];
+        
+        m_enemies.noiseTimer[i] += dt;
+        float distanceToPlayer = glm::distance(m_enemies.position[i], params.target);
+        if (m_enemies.noiseTimer[i] >= noiseInterval && hasNoiseSounds && distanceToPlayer <= 25.0f) {
+            m_soundRequests[i] |= 1 << static_cast<int>(EnemySound::Noise);
+            m_enemies.noiseTimer[i] = 0.0f;
+        }
+        
+        if (params.flashlightPass) {
+            m_enemies.hitSoundTimer[i] += dt;
+            bool isTakingDamage = lit && m_enemies.timeSinceLastDamage[i] < Enemy::DAMAGE_FLASH_TIME;
+            if (!isTakingDamage) {
+                m_enemies.hitSoundTimer[i] = 0.0f;
+            } else if (m_enemies.hitSoundTimer[i] >= hitSoundInterval && hasHitSounds) {
+                m_soundRequests[i] |= 1 << static_cast<int>(EnemySound::Hit);
+                m_enemies.hitSoundTimer[i] = 0.0f;
             }
-            writeIndex++;
         }
     }
-    m_enemies.resize(writeIndex);
-    m_enemySoundTimers.resize(writeIndex);
-    m_enemyNoiseTimers.resize(writeIndex);
-    m_enemyDeathSoundPlayed.resize(writeIndex);
+}
+
+void EnemyManager::moveEnemy(const TickParams& params, size_t i, float deltaTime) {
+    const float dt = deltaTime;
+    const float size = m_enemies.sizeMultiplier[i];
+    uint8_t& flags = m_enemies.flags[i];
+    glm::vec3& position = m_enemies.position[i];
+    glm::vec3& velocity = m_enemies.velocity[i];
+    bool onGround = (flags & FLAG_ON_GROUND) != 0;
+    
+    m_enemies.jumpTimer[i] += dt;
+    
+    if (!onGround) {
+        velocity.y -= Enemy::GRAVITY * dt;
+    }
     
-    if (!m_enemyHitSoundsLoaded) {
-        loadEnemyHitSounds();
+    glm::vec3 direction = params.target - position;
+    direction.y = 0.0f;
+    float distance = glm::length(direction);
+    
+    //the flow field walks around cliffs, for the last couple of blocks it's quicker to just go straight
+    FlowField::Step step;
+    if (params.flowField != nullptr && distance > Enemy::FLOW_FIELD_MIN_DISTANCE) {
+        step = params.flowField->sample(position);
+    }
+    bool followingField = step.direction != glm::vec2(0.0f);
+    
+    float moveSpeed = Enemy::BASE_MOVE_SPEED / size;
+    if (followingField) {
+        velocity.x = step.direction.x * moveSpeed;
+        velocity.z = step.direction.y * moveSpeed;
+    } else if (distance > 0.1f) {
+        direction = glm::normalize(direction);
+        velocity.x = direction.x * moveSpeed;
+        velocity.z = direction.z * moveSpeed;
+    } else {
+        velocity.x = 0.0f;
+        velocity.z = 0.0f;
+    }
+    velocity.x += m_enemies.separation[i].x;
+    velocity.z += m_enemies.separation[i].z;
+    
+    //on the field they only jump to get up a step, off it they keep hopping on the cooldown
+    float& jumpTimer = m_enemies.jumpTimer[i];
+    bool wantsJump = followingField ? (step.climb && jumpTimer >= Enemy::CLIMB_JUMP_COOLDOWN)
+                                    : (jumpTimer >= Enemy::JUMP_COOLDOWN);
+    if (onGround && wantsJump) {
+        velocity.y = Enemy::BASE_JUMP_SPEED * size;
+        onGround = false;
+        jumpTimer = 0.0f;
     }
     
-    if (!m_enemyNoiseSoundsLoaded) {
-        loadEnemyNoiseSounds();
+    float halfWidth = Enemy::BASE_ENEMY_WIDTH * size * 0.5f;
+    glm::vec3 boxMin(position.x - halfWidth, position.y, position.z - halfWidth);
+    glm::vec3 boxMax(position.x + halfWidth, position.y + Enemy::BASE_ENEMY_HEIGHT * size, position.z + halfWidth);
+    SweepResult sweep = VoxelCollision::sweep(params.map, boxMin, boxMax, velocity * dt);
+    if (sweep.hit.x) {
+        velocity.x = 0.0f;
+    }
+    if (sweep.hit.y) {
+        velocity.y = 0.0f;
+    }
+    if (sweep.hit.z) {
+        velocity.z = 0.0f;
     }
     
-    if (!m_enemyDeathSoundsLoaded) {
-        loadEnemyDeathSounds();
+    //re-checked every tick so enemies walking off a ledge start falling
+    onGround = velocity.y <= 0.0f &&
+               VoxelCollision::isSupported(params.map, boxMin + sweep.delta, boxMax + sweep.delta, 0.1f);
+    if (onGround) {
+        velocity.y = 0.0f;
+        flags |= FLAG_ON_GROUND;
+    } else {
+        flags &= ~FLAG_ON_GROUND;
+    }
+    
+    position += sweep.delta;
+    
+    if (position.y < -100.0f) {
+        flags = (flags & ~FLAG_ALIVE) | FLAG_DYING;
+        m_enemies.deathTimer[i] = 0.0f;
+        m_enemies.deathStartPosition[i] = position;
+    }
+}
+
+void EnemyManager::moveEnemyCheap(const TickParams& params, size_t i, float deltaTime) {
+    //nobody is looking: follow the field with no collision, fall under gravity and land on top of the columns
+    glm::vec3& position = m_enemies.position[i];
+    float halfWidth = Enemy::BASE_ENEMY_WIDTH * m_enemies.sizeMultiplier[i] * 0.5f;
+    float ground = 0.0f;
+    if (!footprintGround(params.map, position, halfWidth, ground)) {
+        //no heightmap here (builder map or the chunk isn't in), the real thing knows what to do
+        moveEnemy(params, i, deltaTime);
+        return;
     }
     
-    m_enemySoundTimers.resize(m_enemies.size(), 0.0f);
-    m_enemyNoiseTimers.resize(m_enemies.size(), 0.0f);
-    m_enemyDeathSoundPlayed.resize(m_enemies.size(), false);
+    glm::vec3& velocity = m_enemies.velocity[i];
+    uint8_t& flags = m_enemies.flags[i];
+    glm::vec2 direction(0.0f);
+    if (params.flowField != nullptr) {
+        direction = params.flowField->sample(position).direction;
+    }
+    glm::vec2 toTarget(params.target.x - position.x, params.target.z - position.z);
+    if (direction == glm::vec2(0.0f) && glm::length(toTarget) > 0.1f) {
+        direction = glm::normalize(toTarget);
+    }
+    
+    float moveSpeed = Enemy::BASE_MOVE_SPEED / m_enemies.sizeMultiplier[i];
+    velocity.x = direction.x * moveSpeed;
+    velocity.z = direction.y * moveSpeed;
+    velocity.y -= Enemy::GRAVITY * deltaTime;
+    glm::vec3 next = position + velocity * deltaTime;
+    
+    //ground under where it ends up, a few ticks of dt can carry it onto a higher column. if those columns
+    //aren't loaded it holds still sideways rather than walk out over nothing
+    float nextGround = 0.0f;
+    if (footprintGround(params.map, next, halfWidth, nextGround)) {
+        ground = nextGround;
+    } else {
+        next.x = position.x;
+        next.z = position.z;
+    }
+    position = next;
+    
+    if (position.y <= ground) {
+        position.y = ground;
+        velocity.y = 0.0f;
+        flags |= FLAG_ON_GROUND;
+    } else {
+        flags &= ~FLAG_ON_GROUND;
+    }
     
-    const float soundInterval = 0.1f;
+    //same as moveEnemy, shouldn't happen with the snap above but nothing may fall forever
+    if (position.y < -100.0f) {
+        flags = (flags & ~FLAG_ALIVE) | FLAG_DYING;
+        m_enemies.deathTimer[i] = 0.0f;
+        m_enemies.deathStartPosition[i] = position;
+    }
+}
+
+bool EnemyManager::footprintGround(const Map* map, const glm::vec3& position, float halfWidth, float& ground) const {
+    //top face of the highest column the box stands over, so it never ends up inside a neighbour's surface block
+    int minX = static_cast<int>(std::floor(position.x - halfWidth));
+    int maxX = static_cast<int>(std::floor(position.x + halfWidth));
+    int minZ = static_cast<int>(std::floor(position.z - halfWidth));
+    int maxZ = static_cast<int>(std::floor(position.z + halfWidth));
+    const Chunk* chunk = nullptr;
+    bool found = false;
+    for (int z = minZ; z <= maxZ; z++) {
+        for (int x = minX; x <= maxX; x++) {
+            int height = 0;
+            if (!map->getColumnHeight(x, z, height, chunk)) {
+                return false;
+            }
+            float top = static_cast<float>(height) + 1.0f;
+            ground = found ? std::max(ground, top) : top;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void EnemyManager::flushAudioEvents(AudioManager* audioManager) {
+    //gathered in index order after the workers are done, so sound choice never races on the rng
+    m_audioEvents.clear();
+    for (uint8_t requests : m_soundRequests) {
+        for (EnemySound sound : {EnemySound::Death, EnemySound::Noise, EnemySound::Hit}) {
+            if (requests & (1 << static_cast<int>(sound))) {
+                m_audioEvents.push_back(sound);
+            }
+        }
+    }
+    if (audioManager == nullptr) {
+        return;
+    }
     
     static std::random_device rd;
     static std::mt19937 gen(rd());
     
-    const float noiseInterval = 5.0f;
-    
-    for (size_t i = 0; i < m_enemies.size(); ++i) {
-        auto& enemy = m_enemies[i];
-        
-        if (enemy->isDying() && !m_enemyDeathSoundPlayed[i] && audioManager != nullptr && !m_enemyDeathSounds.empty()) {
+    for (EnemySound sound : m_audioEvents) {
+        if (sound == EnemySound::Death) {
             std::uniform_int_distribution<size_t> deathDist(0, m_enemyDeathSounds.size() - 1);
             
             size_t randomIndex1 = deathDist(gen);
-            QString selectedSound1 = m_enemyDeathSounds[randomIndex1];
-            audioManager->playSound(selectedSound1.toUtf8().constData());
+            audioManager->playSound(m_enemyDeathSounds[randomIndex1].toUtf8().constData());
             
             if (m_enemyDeathSounds.size() > 1) {
                 size_t randomIndex2 = deathDist(gen);
-                while (randomIndex2 == randomIndex1 && m_enemyDeathSounds.size() > 1) {
+                while (randomIndex2 == randomIndex1) {
                     randomIndex2 = deathDist(gen);
                 }
-                QString selectedSound2 = m_enemyDeathSounds[randomIndex2];
-                audioManager->playSound(selectedSound2.toUtf8().constData());
-            }
-            
-            m_enemyDeathSoundPlayed[i] = true;
-        }
-        
-        enemy->updateWithFlashlight(deltaTime, cameraPosition, map, flashlightOn, 
-                                    flashlightPos, flashlightDir, flashlightConeAngle);
-        
-        m_enemySoundTimers[i] += deltaTime;
-        
-        if (enemy->isAlive() && !enemy->isDying()) {
-            m_enemyNoiseTimers[i] += deltaTime;
-            
-            glm::vec3 enemyPos = enemy->getPosition();
-            float distanceToPlayer = glm::distance(enemyPos, cameraPosition);
-            
-            if (m_enemyNoiseTimers[i] >= noiseInterval && audioManager != nullptr && !m_enemyNoiseSounds.empty() && distanceToPlayer <= 25.0f) {
-                std::uniform_int_distribution<size_t> noiseDist(0, m_enemyNoiseSounds.size() - 1);
-                size_t randomIndex = noiseDist(gen);
-                QString selectedNoise = m_enemyNoiseSounds[randomIndex];
-                
-                audioManager->playSound(selectedNoise.toUtf8().constData());
-                m_enemyNoiseTimers[i] = 0.0f;
-            }
-        }
-        
-        bool isTakingDamage = enemy->isIlluminated() && enemy->isRecentlyDamaged();
-        
-        if (isTakingDamage && audioManager != nullptr && !m_enemyHitSounds.empty()) {
-            if (m_enemySoundTimers[i] >= soundInterval) {
-                std::uniform_int_distribution<size_t> soundDist(0, m_enemyHitSounds.size() - 1);
-                size_t randomIndex = soundDist(gen);
-                QString selectedSound = m_enemyHitSounds[randomIndex];
-                
-                audioManager->playSound(selectedSound.toUtf8().constData());
-                m_enemySoundTimers[i] = 0.0f;
+                audioManager->playSound(m_enemyDeathSounds[randomIndex2].toUtf8().constData());
             }
+        } else if (sound == EnemySound::Noise) {
+            std::uniform_int_distribution<size_t> noiseDist(0, m_enemyNoiseSounds.size() - 1);
+            audioManager->playSound(m_enemyNoiseSounds[noiseDist(gen)].toUtf8().constData());
         } else {
-            m_enemySoundTimers[i] = 0.0f;
+            std::uniform_int_distribution<size_t> soundDist(0, m_enemyHitSounds.size() - 1);
+            audioManager->playSound(m_enemyHitSounds[soundDist(gen)].toUtf8().constData());
         }
     }
 }
 
 void EnemyManager::spawnEnemy(const glm::vec3& position) {
-    float sizeMultiplier = generateRandomSize();
-    m_enemies.push_back(std::make_unique<Enemy>(position, sizeMultiplier));
-    m_enemySoundTimers.push_back(0.0f);
-    m_enemyDeathSoundPlayed.push_back(false);
     static std::random_device rd;
     static std::mt19937 gen(rd());
     std::uniform_real_distribution<float> offsetDist(0.0f, 5.0f);
-    m_enemyNoiseTimers.push_back(offsetDist(gen));
+    m_enemies.push(position, generateRandomSize(), offsetDist(gen), m_nextLodPhase++);
+    m_aliveEnemyCount++;
 }
 
-void EnemyManager::spawnEnemiesOnRing(const glm::vec3& cameraPosition, int count) {
+void EnemyManager::spawnEnemiesOnRing(const glm::vec3& cameraPosition, const Map* map, int count) {
     static std::random_device rd;
     static std::mt19937 gen(rd());
     std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * M_PI);
@@ -328,6 +580,7 @@ void EnemyManager::spawnEnemiesOnRing(const glm::vec3& cameraPosition, int count
         float x = cameraPosition.x + SPAWN_RADIUS * cosf(angle);
         float z = cameraPosition.z + SPAWN_RADIUS * sinf(angle);
         float y = SPAWN_HEIGHT + heightOffset(gen);
+        findSpawnHeight(map, x, z, y);
         
         glm::vec3 spawnPos = glm::vec3(x, y, z);
         spawnEnemy(spawnPos);
@@ -335,10 +588,34 @@ void EnemyManager::spawnEnemiesOnRing(const glm::vec3& cameraPosition, int count
     std::cout << "[Enemy Spawn] Spawned " << count << " enemies from cube collection. Current auto-spawn delay: " << m_currentSpawnInterval << "s" << std::endl;
 }
 
+bool EnemyManager::findSpawnHeight(const Map* map, float x, float z, float& y) const {
+    //stand on the highest column the widest enemy could overlap, then there's nothing to fall through
+    if (map == nullptr) {
+        return false;
+    }
+    const float halfWidth = Enemy::BASE_ENEMY_WIDTH * MAX_SIZE_MULTIPLIER * 0.5f;
+    const Chunk* chunk = nullptr;
+    bool found = false;
+    int highest = 0;
+    for (int cz = static_cast<int>(std::floor(z - halfWidth)); cz <= static_cast<int>(std::floor(z + halfWidth)); cz++) {
+        for (int cx = static_cast<int>(std::floor(x - halfWidth)); cx <= static_cast<int>(std::floor(x + halfWidth)); cx++) {
+            int height = 0;
+            if (map->getColumnHeight(cx, cz, height, chunk)) {
+                highest = found ? std::max(highest, height) : height;
+                found = true;
+            }
+        }
+    }
+    if (found) {
+        y = static_cast<float>(highest) + 1.0f + VoxelCollision::SKIN;
+    }
+    return found;
+}
+
 float EnemyManager::generateRandomSize() const {
     static std::random_device rd;
     static std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dis(0.75f, 1.5f);
+    std::uniform_real_distribution<float> dis(0.75f, MAX_SIZE_MULTIPLIER);
     return dis(gen);
 }
 
@@ -461,16 +738,20 @@ void EnemyManager::loadEnemyDeathSounds() {
 
 void EnemyManager::clear() {
     m_enemies.clear();
-    m_enemySoundTimers.clear();
-    m_enemyNoiseTimers.clear();
-    m_enemyDeathSoundPlayed.clear();
+    m_enemyGrid.clear();
+    m_enemyGrid.build();
+    m_aliveEnemyCount = 0;
+    m_soundRequests.clear();
     m_spawnTimer = 0.0f;
 }
 
 void EnemyManager::killAllEnemies() {
-    for (auto& enemy : m_enemies) {
-        if (enemy->isAlive() && !enemy->isDying()) {
-            enemy->setAlive(false);
+    for (size_t i = 0; i < m_enemies.size(); ++i) {
+        uint8_t& flags = m_enemies.flags[i];
+        if ((flags & FLAG_ALIVE) && !(flags & FLAG_DYING)) {
+            flags = (flags & ~FLAG_ALIVE) | FLAG_DYING;
+            m_enemies.deathTimer[i] = 0.0f;
+            m_enemies.deathStartPosition[i] = m_enemies.position[i];
         }
     }
 }
@@ -478,10 +759,123 @@ void EnemyManager::killAllEnemies() {
 void EnemyManager::render() {
 }
 
-const Enemy* EnemyManager::getEnemy(int index) const {
-    if (index >= 0 && index < static_cast<int>(m_enemies.size())) {
-        return m_enemies[index].get();
+void EnemyManager::updateFlashlightVisibility(Map* map, bool flashlightOn, const glm::vec3& flashlightPos,
+                                              const glm::vec3& flashlightDir, float flashlightConeAngle) {
+    m_litByFlashlight.assign(m_enemies.size(), 0);
+    if (!flashlightOn || map == nullptr) {
+        return;
+    }
+    
+    m_flashlightRays.clear();
+    m_flashlightRayOwners.clear();
+    m_queryScratch.clear();
+    m_enemyGrid.queryCone(flashlightPos, flashlightDir, flashlightConeAngle, FLASHLIGHT_RANGE, m_queryScratch);
+    for (int id : m_queryScratch) {
+        size_t i = static_cast<size_t>(id);
+        glm::vec3 center = m_enemies.position[i];
+        center.y += Enemy::BASE_ENEMY_HEIGHT * m_enemies.sizeMultiplier[i] * 0.5f;
+        MapRay ray;
+        ray.origin = flashlightPos;
+        ray.direction = center - flashlightPos;
+        ray.maxDistance = glm::length(ray.direction);
+        if (ray.maxDistance < 0.001f) {
+            m_litByFlashlight[i] = 1;
+            continue;
+        }
+        m_flashlightRays.push_back(ray);
+        m_flashlightRayOwners.push_back(i);
+    }
+    
+    map->raycastBatch(m_flashlightRays, m_flashlightHits);
+    for (size_t r = 0; r < m_flashlightRays.size(); ++r) {
+        m_litByFlashlight[m_flashlightRayOwners[r]] = m_flashlightHits[r].hit ? 0 : 1;
     }
-    return nullptr;
 }
 
+void EnemyManager::rebuildEnemyGrid() {
+    m_enemyGrid.clear();
+    m_aliveEnemyCount = 0;
+    for (size_t i = 0; i < m_enemies.size(); ++i) {
+        if ((m_enemies.flags[i] & (FLAG_ALIVE | FLAG_DYING)) == FLAG_ALIVE) {
+            m_enemyGrid.insert(static_cast<int>(i), m_enemies.position[i]);
+            m_aliveEnemyCount++;
+        }
+    }
+    m_enemyGrid.build();
+}
+
+void EnemyManager::applySeparation() {
+    //neighbours closer than SEPARATION_RADIUS push each other apart on xz, harder the more they overlap
+    const float SEPARATION_RADIUS = 1.5f;
+    const float SEPARATION_SPEED = 2.5f;
+    
+    //ParallelFor hands out ranges starting at multiples of the grain (or the whole thing inline), so begin / grain
+    //is a job index nobody else has this tick. the lists keep their capacity between ticks
+    size_t jobs = (m_enemies.size() + ENEMIES_PER_JOB - 1) / ENEMIES_PER_JOB;
+    if (m_separationScratch.size() < jobs) {
+        m_separationScratch.resize(jobs);
+    }
+    ParallelFor::run(m_enemies.size(), ENEMIES_PER_JOB, [this, SEPARATION_RADIUS, SEPARATION_SPEED](size_t begin, size_t end) {
+        std::vector<int>& neighbours = m_separationScratch[begin / ENEMIES_PER_JOB];
+        for (size_t i = begin; i < end; ++i) {
+            //hidden ones walk through each other anyway, and nobody needs it on a tick they sit out
+            if ((m_enemies.flags[i] & (FLAG_ALIVE | FLAG_DYING | FLAG_LOD_DUE)) != (FLAG_ALIVE | FLAG_LOD_DUE) ||
+                m_enemies.lodTier[i] == LOD_HIDDEN) {
+                continue;
+            }
+            
+            glm::vec3 position = m_enemies.position[i];
+            neighbours.clear();
+            m_enemyGrid.queryRadius(position, SEPARATION_RADIUS, neighbours);
+            
+            glm::vec3 push(0.0f);
+            for (int other : neighbours) {
+                if (other == static_cast<int>(i)) {
+                    continue;
+                }
+                glm::vec3 offset = position - m_enemies.position[other];
+                offset.y = 0.0f;
+                float dist = glm::length(offset);
+                if (dist < 0.0001f) {
+                    //stacked exactly (spawned on the same spot), split them by index so they dont stay stuck
+                    push.x += (static_cast<int>(i) < other) ? 1.0f : -1.0f;
+                    continue;
+                }
+                push += offset / dist * (1.0f - dist / SEPARATION_RADIUS);
+            }
+            m_enemies.separation[i] = push * SEPARATION_SPEED;
+        }
+    });
+}
+
+void EnemyManager::updateFlowField(const Map* map, const glm::vec3& cameraPosition) {
+    //revision counters only mean something within one map
+    if (map != m_flowFieldMap) {
+        m_flowField.clear();
+        m_flowFieldMap = map;
+    }
+    m_flowField.update(map, cameraPosition);
+}
+
+void EnemyManager::queryEnemiesInRadius(const glm::vec3& center, float radius, std::vector<int>& out) const {
+    m_enemyGrid.queryRadius(center, radius, out);
+}
+
+void EnemyManager::copyEnemies(std::vector<Enemy>& out) const {
+    out.resize(m_enemies.size());
+    for (size_t i = 0; i < m_enemies.size(); ++i) {
+        Enemy& enemy = out[i];
+        uint8_t flags = m_enemies.flags[i];
+        enemy.m_position = m_enemies.position[i];
+        enemy.m_previousPosition = m_enemies.previousPosition[i];
+        enemy.m_alive = (flags & FLAG_ALIVE) != 0;
+        enemy.m_health = m_enemies.health[i];
+        enemy.m_isIlluminated = (flags & FLAG_ILLUMINATED) != 0;
+        enemy.m_illuminationTime = m_enemies.illuminationTime[i];
+        enemy.m_timeSinceLastDamage = m_enemies.timeSinceLastDamage[i];
+        enemy.m_isDying = (flags & FLAG_DYING) != 0;
+        enemy.m_deathTimer = m_enemies.deathTimer[i];
+        enemy.m_deathStartPosition = m_enemies.deathStartPosition[i];
+        enemy.m_sizeMultiplier = m_enemies.sizeMultiplier[i];
+    }
+}
@@ -1,17 +1,31 @@
 #pragma once
 
 #include "enemy.h"
+#include "map/Map.h"
+#include "map/FlowField.h"
+#include "utils/spatialhash.h"
+#include <cstdint>
 #include <vector>
-#include <memory>
 #include <QElapsedTimer>
 #include <QString>
 #include <glm/glm.hpp>
 
-class Map;
 class AudioManager;
 
 class EnemyManager {
 public:
+    //near enemies update every tick, far on-screen ones every FAR_INTERVAL ticks and far off-screen ones
+    //every HIDDEN_INTERVAL ticks with a cheap walk + snap to the surface. skipped ticks pile up their dt
+    struct LodStats {
+        int nearCount = 0;
+        int farCount = 0;
+        int hiddenCount = 0;
+        int updatedCount = 0;       //enemies whose turn it was this tick
+        float kernelMs = 0.0f;      //movement / collision / illumination for this tick
+        float savedMs = 0.0f;       //skipped enemies * this tick's cost per updated enemy, an estimate
+        double totalSavedMs = 0.0;
+    };
+    
     EnemyManager();
     
     void update(float deltaTime, const glm::vec3& cameraPosition, Map* map, AudioManager* audioManager);
@@ -21,12 +35,28 @@ public:
                               AudioManager* audioManager);
     void render();
     void spawnEnemy(const glm::vec3& position);
-    void spawnEnemiesOnRing(const glm::vec3& cameraPosition, int count);
+    //map can be null, with one loaded they're put straight onto the ground instead of dropped from above
+    void spawnEnemiesOnRing(const glm::vec3& cameraPosition, const Map* map, int count);
     void clear();
     void killAllEnemies();
     
     int getEnemyCount() const { return static_cast<int>(m_enemies.size()); }
-    const Enemy* getEnemy(int index) const;
+    glm::vec3 getEnemyPosition(int index) const { return m_enemies.position[index]; }
+    bool isEnemyAlive(int index) const { return (m_enemies.flags[index] & FLAG_ALIVE) != 0; }
+    //value copies for the render snapshot, reuses out's storage
+    void copyEnemies(std::vector<Enemy>& out) const;
+    //indices of living enemies near center. the grid is rebuilt once per update from where
+    //enemies were at the start of it, so callers after update() should pad the radius and test exactly
+    void queryEnemiesInRadius(const glm::vec3& center, float radius, std::vector<int>& out) const;
+    
+    const FlowField::Stats& getFlowFieldStats() const { return m_flowField.getStats(); }
+    const LodStats& getLodStats() const { return m_lodStats; }
+    //view-projection of whoever is watching, enemies outside it (and far away) count as hidden
+    void setViewer(const glm::mat4& viewProjection);
+    //off = everyone gets the full update every tick, for comparing
+    void setLodEnabled(bool enabled) { m_lodEnabled = enabled; }
+    
+    static constexpr int MAX_ALIVE_ENEMIES = 256;
     
     void setSpawnDelay(float delay) { 
         m_baseSpawnInterval = delay;
@@ -42,7 +72,59 @@ public:
     bool isAutoSpawnEnabled() const { return m_autoSpawnEnabled; }
     
 private:
-    std::vector<std::unique_ptr<Enemy>> m_enemies;
+    enum EnemyFlags : uint8_t {
+        FLAG_ALIVE = 1 << 0,
+        FLAG_DYING = 1 << 1,
+        FLAG_ON_GROUND = 1 << 2,
+        FLAG_ILLUMINATED = 1 << 3,
+        FLAG_DEATH_SOUND_PLAYED = 1 << 4,
+        FLAG_LOD_DUE = 1 << 5,      //its turn this tick, set by assignLodTiers
+    };
+    
+    enum LodTier : uint8_t {
+        LOD_NEAR,
+        LOD_FAR,
+        LOD_HIDDEN,
+    };
+    
+    //enemy i is index i in every array. removing one moves the last enemy into its slot, order means nothing
+    struct EnemyArrays {
+        std::vector<glm::vec3> position;
+        std::vector<glm::vec3> previousPosition;
+        std::vector<glm::vec3> velocity;
+        std::vector<glm::vec3> separation;
+        std::vector<glm::vec3> deathStartPosition;
+        std::vector<float> health;
+        std::vector<float> sizeMultiplier;
+        std::vector<float> illuminationTime;
+        std::vector<float> timeSinceLastDamage;
+        std::vector<float> deathTimer;
+        std::vector<float> jumpTimer;
+        std::vector<float> noiseTimer;
+        std::vector<float> hitSoundTimer;
+        std::vector<float> pendingDeltaTime;    //time from ticks skipped by the lod schedule
+        std::vector<uint8_t> lodTier;
+        std::vector<uint8_t> lodPhase;          //staggers who goes on which tick
+        std::vector<uint8_t> flags;
+        
+        size_t size() const { return position.size(); }
+        void push(const glm::vec3& pos, float size, float noiseTimerOffset, uint8_t phase);
+        void swapRemove(size_t i);
+        void clear();
+    };
+    
+    enum class EnemySound : uint8_t { Death, Noise, Hit };
+    
+    //what one tick hands every worker, read only while the kernels run
+    struct TickParams {
+        float deltaTime;
+        glm::vec3 target;
+        const Map* map;
+        const FlowField* flowField;
+        bool flashlightPass;    //illumination comes from m_litByFlashlight, otherwise it is left alone
+    };
+    
+    EnemyArrays m_enemies;
     float m_spawnTimer;
     float m_spawnInterval;
     float m_baseSpawnInterval;
@@ -54,9 +136,41 @@ private:
     std::vector<QString> m_enemyHitSounds;
     std::vector<QString> m_enemyNoiseSounds;
     std::vector<QString> m_enemyDeathSounds;
-    std::vector<float> m_enemySoundTimers;
-    std::vector<float> m_enemyNoiseTimers;
-    std::vector<bool> m_enemyDeathSoundPlayed;
+    //kernels mark sounds per enemy (bit per EnemySound), the tick's thread turns them into events and plays them
+    std::vector<uint8_t> m_soundRequests;
+    std::vector<EnemySound> m_audioEvents;
+    
+    //flashlight line of sight, one ray per enemy in the cone, reused every tick
+    std::vector<MapRay> m_flashlightRays;
+    std::vector<RaycastHit> m_flashlightHits;
+    std::vector<size_t> m_flashlightRayOwners;
+    std::vector<char> m_litByFlashlight;
+    
+    //broad phase over living enemies (4 unit cells), ids are indices into m_enemies, rebuilt after removal
+    SpatialHash m_enemyGrid;
+    std::vector<int> m_queryScratch;
+    //neighbour lists for applySeparation, one per ENEMIES_PER_JOB job so the workers never share or allocate
+    std::vector<std::vector<int>> m_separationScratch;
+    int m_aliveEnemyCount;
+    //nothing past the far plane at max view distance can be seen lit anyway
+    static constexpr float FLASHLIGHT_RANGE = 128.0f;
+    static constexpr size_t ENEMIES_PER_JOB = 256;
+    static constexpr float MAX_SIZE_MULTIPLIER = 1.5f;
+    
+    //ai level of detail, intervals are powers of two so the round robin is a mask
+    static constexpr float LOD_NEAR_DISTANCE = 20.0f;
+    static constexpr uint32_t LOD_FAR_INTERVAL = 4;
+    static constexpr uint32_t LOD_HIDDEN_INTERVAL = 8;
+    bool m_lodEnabled;
+    bool m_hasViewer;
+    glm::mat4 m_viewProjection;
+    uint32_t m_lodTick;
+    uint8_t m_nextLodPhase;
+    LodStats m_lodStats;
+    
+    //everyone chases the player along the same field
+    FlowField m_flowField;
+    const Map* m_flowFieldMap;
     bool m_enemyHitSoundsLoaded;
     bool m_enemyNoiseSoundsLoaded;
     bool m_enemyDeathSoundsLoaded;
@@ -65,5 +179,22 @@ private:
     void loadEnemyNoiseSounds();
     void loadEnemyDeathSounds();
     float generateRandomSize() const;
+    //y that puts an enemy at (x, z) on the surface, leaves y alone and returns false without height data
+    bool findSpawnHeight(const Map* map, float x, float z, float& y) const;
+    void updateAutoSpawn(float deltaTime, const glm::vec3& cameraPosition, Map* map, float spawnRadius);
+    void removeFinishedEnemies();
+    void simulate(const TickParams& params);
+    void simulateRange(const TickParams& params, size_t begin, size_t end);
+    void assignLodTiers(const TickParams& params);
+    void moveEnemy(const TickParams& params, size_t i, float deltaTime);
+    void moveEnemyCheap(const TickParams& params, size_t i, float deltaTime);
+    //top of the highest column under an xz box of halfWidth around position, false if one of them isn't loaded
+    bool footprintGround(const Map* map, const glm::vec3& position, float halfWidth, float& ground) const;
+    void flushAudioEvents(AudioManager* audioManager);
+    void rebuildEnemyGrid();
+    void applySeparation();
+    void updateFlowField(const Map* map, const glm::vec3& cameraPosition);
+    void updateFlashlightVisibility(Map* map, bool flashlightOn, const glm::vec3& flashlightPos,
+                                    const glm::vec3& flashlightDir, float flashlightConeAngle);
 };
 
@@ -1,8 +1,8 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
-#include <memory>
 
 struct Segment {
     glm::vec3 start;
@@ -13,84 +13,66 @@ struct Segment {
     int order;
     bool isStraight;
     bool isLateral;
-    
-    Segment(glm::vec3 start, glm::vec3 direction, float length, float radius, int order, bool isStraight, bool isLateral)
-        : start(start), direction(glm::normalize(direction)), length(length), radius(radius), order(order), isStraight(isStraight), isLateral(isLateral)
+    uint32_t parent;    //segment this one grows out of, AxialTree::NO_INDEX for the first
+    uint32_t branch;    //branch it's part of
+
+    Segment(glm::vec3 start, glm::vec3 direction, float length, float radius, int order, bool isStraight, bool isLateral,
+            uint32_t parent, uint32_t branch)
+        : start(start), direction(glm::normalize(direction)), length(length), radius(radius), order(order),
+          isStraight(isStraight), isLateral(isLateral), parent(parent), branch(branch)
     {
         end = start + this->direction * length;
     }
 };
 
-struct Node {
-    glm::vec3 position;
+//one axis: a run of segments that follow on from each other, sitting back to back in AxialTree::segments
+struct Branch {
+    uint32_t firstSegment;
+    uint32_t segmentCount;
+    uint32_t parentSegment;     //where it comes off its parent, NO_INDEX for the trunk
+    uint32_t parentBranch;
     int order;
-    std::vector<std::shared_ptr<Segment>> outgoingSegments;
-    std::shared_ptr<Segment> straightSegment;
-    
-    Node(glm::vec3 pos, int ord) : position(pos), order(ord) {}
 };
 
-class Axis {
+//a whole tree as two flat arrays linked by index, built front to back in one pass. segments come out in the
+//order they were added, a branch's segments are contiguous. clear() keeps the storage, so a tree that gets
+//regenerated into (or a generator reusing one) stops allocating once it has seen its biggest tree
+class AxialTree {
 public:
-    std::vector<std::shared_ptr<Segment>> segments;
-    int order;
-    std::shared_ptr<Node> rootNode;
-    
-    Axis(int ord) : order(ord) {}
-    
-    void addSegment(std::shared_ptr<Segment> segment) {
-        segments.push_back(segment);
-    }
-    
-    std::shared_ptr<Node> getTerminalNode() {
-        if (segments.empty()) return rootNode;
-        return std::make_shared<Node>(segments.back()->end, order);
-    }
-};
+    static constexpr uint32_t NO_INDEX = 0xffffffffu;
 
-class Branch {
-public:
-    std::shared_ptr<Axis> mainAxis;
-    std::vector<std::shared_ptr<Branch>> subBranches;
-    int order;
-    
-    Branch(int ord) : order(ord) {
-        mainAxis = std::make_shared<Axis>(ord);
-    }
-};
+    std::vector<Segment> segments;
+    std::vector<Branch> branches;
 
-class AxialTree {
-public:
-    std::shared_ptr<Branch> rootBranch;
-    std::vector<std::shared_ptr<Segment>> allSegments;
-    
-    AxialTree() {
-        rootBranch = std::make_shared<Branch>(0);
-        rootBranch->mainAxis->rootNode = std::make_shared<Node>(glm::vec3(0.0f), 0);
+    void clear() {
+        segments.clear();
+        branches.clear();
     }
-    
-    void collectAllSegments() {
-        allSegments.clear();
-        collectSegmentsFromBranch(rootBranch);
+
+    void reserve(size_t segmentCount, size_t branchCount) {
+        segments.reserve(segmentCount);
+        branches.reserve(branchCount);
     }
-    
-private:
-    void collectSegmentsFromBranch(std::shared_ptr<Branch> branch) {
-        if (!branch || !branch->mainAxis) return;
-        
-        for (auto& segment : branch->mainAxis->segments) {
-            allSegments.push_back(segment);
-        }
-        
-        if (branch->mainAxis->rootNode) {
-            for (auto& lateralSegment : branch->mainAxis->rootNode->outgoingSegments) {
-                allSegments.push_back(lateralSegment);
-            }
-        }
-        
-        for (auto& subBranch : branch->subBranches) {
-            collectSegmentsFromBranch(subBranch);
+
+    bool empty() const { return segments.empty(); }
+
+    //adds a segment growing out of parent (NO_INDEX for the base of the trunk) and returns its index. one that isn't
+    //lateral carries on parent's branch if parent is the newest segment, laterals (or a gap) start a new branch off it
+    uint32_t addSegment(uint32_t parent, glm::vec3 start, glm::vec3 direction, float length, float radius, int order,
+                        bool isStraight, bool isLateral) {
+        uint32_t index = static_cast<uint32_t>(segments.size());
+        if (parent == NO_INDEX || isLateral || parent + 1 != index) {
+            Branch branch;
+            branch.firstSegment = index;
+            branch.segmentCount = 0;
+            branch.parentSegment = parent;
+            branch.parentBranch = parent == NO_INDEX ? NO_INDEX : segments[parent].branch;
+            branch.order = order;
+            branches.push_back(branch);
         }
+        uint32_t branch = static_cast<uint32_t>(branches.size() - 1);
+        branches[branch].segmentCount++;
+        segments.emplace_back(start, direction, length, radius, order, isStraight, isLateral, parent, branch);
+        return index;
     }
 };
-
@@ -5,6 +5,7 @@
 #include <glm/gtx/rotate_vector.hpp>
 #include <cmath>
 #include <iostream>
+#include <random>
 #include <QTimer>
 
 LSystemWidget::LSystemWidget(QWidget *parent)
@@ -16,6 +17,10 @@ LSystemWidget::LSystemWidget(QWidget *parent)
     , m_modelLoc(0)
     , m_cylinderNumVertices(0)
     , m_hasTree(false)
+    , m_treeMeshDirty(false)
+    , m_treeVAO(0)
+    , m_treeVBO(0)
+    , m_treeEBO(0)
     , m_zoom(1.0f)
     , m_rotationAngle(0.0f)
     , m_rotationTimer(nullptr)
@@ -32,6 +37,11 @@ LSystemWidget::~LSystemWidget()
     }
     makeCurrent();
     m_shapeFactory.destroyShapes();
+    if (m_treeVAO != 0) {
+        glDeleteVertexArrays(1, &m_treeVAO);
+        glDeleteBuffers(1, &m_treeVBO);
+        glDeleteBuffers(1, &m_treeEBO);
+    }
     if (m_shaderProgram != 0) {
         glDeleteProgram(m_shaderProgram);
     }
@@ -95,7 +105,13 @@ void LSystemWidget::setupCylinder()
 
 void LSystemWidget::generateTree(const TreeParameters& params)
 {
-    m_tree = TreeGenerator::generateTree(params);
+    //a fresh tree every time generate is pressed
+    TreeGenerator::generateTree(params, std::random_device{}(), m_tree);
+    //16 sides on the trunk like TreePiece, nothing gets dropped in the preview
+    TreeMesher::Options options;
+    options.maxSides = 16;
+    TreeMesher::build(m_tree, options, m_treeMesh);
+    m_treeMeshDirty = true;
     m_hasTree = true;
     update();
 }
@@ -115,74 +131,64 @@ void LSystemWidget::updateRotation()
     update();
 }
 
-glm::mat4 LSystemWidget::getCylinderTransform(const Segment& segment)
+void LSystemWidget::uploadTreeMesh()
 {
-    glm::vec3 start = segment.start;
-    glm::vec3 end = segment.end;
-    glm::vec3 direction = segment.direction;
-    float length = segment.length;
-    float radius = segment.radius;
-    
-    glm::vec3 center = (start + end) * 0.5f;
-    glm::vec3 defaultUp = glm::vec3(0.0f, 1.0f, 0.0f);
-    
-    glm::vec3 axis = glm::normalize(direction);
-    
-    glm::vec3 right;
-    if (glm::abs(glm::dot(axis, defaultUp)) > 0.99f) {
-        right = glm::vec3(1.0f, 0.0f, 0.0f);
+    if (m_treeVAO == 0) {
+        glGenVertexArrays(1, &m_treeVAO);
+        glGenBuffers(1, &m_treeVBO);
+        glGenBuffers(1, &m_treeEBO);
+
+        glBindVertexArray(m_treeVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_treeVBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_treeEBO);
+        //phong only reads position and normal out of the 14 floats
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(3 * sizeof(float)));
     } else {
-        right = glm::normalize(glm::cross(axis, defaultUp));
-    }
-    glm::vec3 up = glm::normalize(glm::cross(right, axis));
-    
-    glm::vec3 defaultY = glm::vec3(0.0f, 1.0f, 0.0f);
-    glm::vec3 rotationAxis = glm::cross(defaultY, axis);
-    float rotationAngle = std::acos(glm::clamp(glm::dot(defaultY, axis), -1.0f, 1.0f));
-    
-    glm::mat4 rotation = glm::mat4(1.0f);
-    if (glm::length(rotationAxis) > 0.001f) {
-        rotation = glm::rotate(glm::mat4(1.0f), rotationAngle, glm::normalize(rotationAxis));
-    } else if (glm::dot(defaultY, axis) < -0.99f) {
-        rotation = glm::rotate(glm::mat4(1.0f), 3.14159265359f, glm::vec3(1.0f, 0.0f, 0.0f));
+        glBindVertexArray(m_treeVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_treeVBO);
     }
-    
-    glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(radius * 2.0f, length, radius * 2.0f));
-    glm::mat4 translation = glm::translate(glm::mat4(1.0f), center);
-    
-    return translation * rotation * scale;
+    glBufferData(GL_ARRAY_BUFFER, m_treeMesh.vertexData.size() * sizeof(float),
+                 m_treeMesh.vertexData.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_treeMesh.indices.size() * sizeof(uint32_t),
+                 m_treeMesh.indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_treeMeshDirty = false;
 }
 
 void LSystemWidget::renderTree()
 {
-    if (!m_hasTree || m_tree.allSegments.empty()) {
+    if (!m_hasTree || m_tree.empty()) {
         return;
     }
-    
-    for (const auto& segment : m_tree.allSegments) {
-        glm::mat4 model = getCylinderTransform(*segment);
-        
-        glUniformMatrix4fv(m_modelLoc, 1, GL_FALSE, &model[0][0]);
-        
-        GLint mat_cAmbientLoc = glGetUniformLocation(m_shaderProgram, "material.cAmbient");
-        GLint mat_cDiffuseLoc = glGetUniformLocation(m_shaderProgram, "material.cDiffuse");
-        GLint mat_cSpecularLoc = glGetUniformLocation(m_shaderProgram, "material.cSpecular");
-        GLint mat_shinyLoc = glGetUniformLocation(m_shaderProgram, "material.shininess");
-        
-        glm::vec4 cAmbient(0.15f, 0.1f, 0.05f, 1.0f);
-        glm::vec4 cDiffuse(0.3f, 0.2f, 0.1f, 1.0f);
-        glm::vec4 cSpecular(0.2f, 0.2f, 0.2f, 1.0f);
-        float shininess = 16.0f;
-        
-        glUniform4fv(mat_cAmbientLoc, 1, &cAmbient[0]);
-        glUniform4fv(mat_cDiffuseLoc, 1, &cDiffuse[0]);
-        glUniform4fv(mat_cSpecularLoc, 1, &cSpecular[0]);
-        glUniform1f(mat_shinyLoc, shininess);
-        
-        glBindVertexArray(m_cylinderVAO);
-        glDrawArrays(GL_TRIANGLES, 0, m_cylinderNumVertices);
-        glBindVertexArray(0);
+    if (m_treeMeshDirty) {
+        uploadTreeMesh();
     }
+
+    glm::mat4 model = glm::mat4(1.0f);
+    glUniformMatrix4fv(m_modelLoc, 1, GL_FALSE, &model[0][0]);
+
+    GLint mat_cAmbientLoc = glGetUniformLocation(m_shaderProgram, "material.cAmbient");
+    GLint mat_cDiffuseLoc = glGetUniformLocation(m_shaderProgram, "material.cDiffuse");
+    GLint mat_cSpecularLoc = glGetUniformLocation(m_shaderProgram, "material.cSpecular");
+    GLint mat_shinyLoc = glGetUniformLocation(m_shaderProgram, "material.shininess");
+
+    glm::vec4 cAmbient(0.15f, 0.1f, 0.05f, 1.0f);
+    glm::vec4 cDiffuse(0.3f, 0.2f, 0.1f, 1.0f);
+    glm::vec4 cSpecular(0.2f, 0.2f, 0.2f, 1.0f);
+    float shininess = 16.0f;
+
+    glUniform4fv(mat_cAmbientLoc, 1, &cAmbient[0]);
+    glUniform4fv(mat_cDiffuseLoc, 1, &cDiffuse[0]);
+    glUniform4fv(mat_cSpecularLoc, 1, &cSpecular[0]);
+    glUniform1f(mat_shinyLoc, shininess);
+
+    glBindVertexArray(m_treeVAO);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_treeMesh.indices.size()), GL_UNSIGNED_INT, (void*)0);
+    glBindVertexArray(0);
 }
 
 void LSystemWidget::paintGL()
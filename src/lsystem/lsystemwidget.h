@@ -10,6 +10,7 @@
 #include "utils/shapefactory.h"
 #include "axialtree.h"
 #include "treegenerator.h"
+#include "treemesher.h"
 
 class LSystemWidget : public QOpenGLWidget
 {
@@ -39,13 +40,19 @@ private:
     
     AxialTree m_tree;
     bool m_hasTree;
+    //the whole tree as one tube mesh, uploaded on the next paint after it changes
+    TreeMesh m_treeMesh;
+    bool m_treeMeshDirty;
+    GLuint m_treeVAO;
+    GLuint m_treeVBO;
+    GLuint m_treeEBO;
     float m_zoom;
     float m_rotationAngle;
     QTimer *m_rotationTimer;
     
     void setupCylinder();
+    void uploadTreeMesh();
     void renderTree();
-    glm::mat4 getCylinderTransform(const Segment& segment);
     void updateRotation();
 };
 
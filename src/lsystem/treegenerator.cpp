@@ -2,47 +2,59 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <cmath>
-#include <random>
-
-static std::random_device rd;
-static std::mt19937 gen(rd());
-static std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
-static std::uniform_real_distribution<float> angleDis(0.0f, 360.0f);
 
 glm::vec3 rotateVector(glm::vec3 vec, glm::vec3 axis, float angle) {
     glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), angle, glm::normalize(axis));
     return glm::vec3(rotation * glm::vec4(vec, 1.0f));
 }
 
-AxialTree TreeGenerator::generateTree(const TreeParameters& params) {
+AxialTree TreeGenerator::generateTree(const TreeParameters& params, uint64_t seed) {
+    AxialTree tree;
+    generateTree(params, seed, tree);
+    return tree;
+}
+
+void TreeGenerator::generateTree(const TreeParameters& params, uint64_t seed, AxialTree& tree) {
+    tree.clear();
+    FastRandom random(seed);
+    //every lateral ends up with 2^depth - 1 segments under it counting itself, each its own branch
+    int depth = glm::clamp(params.branchDepth, 0, 16);
+    size_t laterals = static_cast<size_t>(glm::max(params.numBranchLayers, 0)) * static_cast<size_t>(glm::max(params.branchesPerLayer, 0));
+    size_t lateralSegments = laterals * ((size_t(1) << depth) - 1 + (depth == 0 ? 1 : 0));
+    tree.reserve(static_cast<size_t>(glm::max(params.numBranchLayers, 0)) + 1 + lateralSegments, lateralSegments + 1);
+    
     switch (params.treeType) {
         case TreeType::DEAD_PINE:
-            return generateDeadPine(params);
+            generateDeadPine(params, tree, random);
+            break;
         case TreeType::DEAD_OAK:
-            return generateDeadOak(params);
+            generateDeadOak(params, tree, random);
+            break;
         case TreeType::DEAD_BIRCH:
-            return generateDeadBirch(params);
+            generateDeadBirch(params, tree, random);
+            break;
         default:
-            return generateDeadPine(params);
+            generateDeadPine(params, tree, random);
+            break;
     }
 }
 
-AxialTree TreeGenerator::generateDeadPine(const TreeParameters& params) {
-    AxialTree tree;
-    
+void TreeGenerator::generateDeadPine(const TreeParameters& params, AxialTree& tree, FastRandom& random) {
     glm::vec3 trunkStart(0.0f, 0.0f, 0.0f);
     glm::vec3 trunkDirection(0.0f, 1.0f, 0.0f);
     
     int trunkSegments = params.numBranchLayers + 1;
     float segmentLength = params.trunkLength / trunkSegments;
     
+    uint32_t trunkSegment = AxialTree::NO_INDEX;
     for (int i = 0; i < trunkSegments; ++i) {
         float heightRatio = static_cast<float>(i) / static_cast<float>(trunkSegments);
         float radiusReduction = 1.0f - (heightRatio * 0.8f);
         float currentRadius = params.trunkRadius * radiusReduction;
         currentRadius = glm::max(0.01f, currentRadius);
         
-        auto trunkSegment = std::make_shared<Segment>(
+        trunkSegment = tree.addSegment(
+            trunkSegment,
             trunkStart,
             trunkDirection,
             segmentLength,
@@ -52,8 +64,7 @@ AxialTree TreeGenerator::generateDeadPine(const TreeParameters& params) {
             false
         );
         
-        tree.rootBranch->mainAxis->addSegment(trunkSegment);
-        trunkStart = trunkSegment->end;
+        trunkStart = tree.segments[trunkSegment].end;
     }
     
     if (params.numBranchLayers > 0 && params.branchesPerLayer > 0) {
@@ -79,7 +90,9 @@ AxialTree TreeGenerator::generateDeadPine(const TreeParameters& params) {
                 
                 float branchRadius = params.trunkRadius * 0.5f;
                 
-                auto branchSegment = std::make_shared<Segment>(
+                //the trunk went in first, segment layer - 1 ends at this layer
+                uint32_t branchSegment = tree.addSegment(
+                    static_cast<uint32_t>(layer - 1),
                     branchPoint,
                     branchDir,
                     branchLength,
@@ -89,29 +102,22 @@ AxialTree TreeGenerator::generateDeadPine(const TreeParameters& params) {
                     true
                 );
                 
-                tree.rootBranch->mainAxis->addSegment(branchSegment);
-                
                 if (params.branchDepth > 0) {
                     generateSubBranches(
-                        branchPoint + branchDir * branchLength,
-                        branchDir,
+                        tree,
+                        random,
+                        branchSegment,
                         params,
                         1,
-                        heightRatio,
-                        tree.rootBranch
+                        heightRatio
                     );
                 }
             }
         }
     }
-    
-    tree.collectAllSegments();
-    return tree;
 }
 
-AxialTree TreeGenerator::generateDeadOak(const TreeParameters& params) {
-    AxialTree tree;
-    
+void TreeGenerator::generateDeadOak(const TreeParameters& params, AxialTree& tree, FastRandom& random) {
     glm::vec3 trunkStart(0.0f, 0.0f, 0.0f);
     glm::vec3 trunkDirection(0.0f, 1.0f, 0.0f);
     glm::vec3 currentTrunkDir = trunkDirection;
@@ -119,13 +125,17 @@ AxialTree TreeGenerator::generateDeadOak(const TreeParameters& params) {
     if (params.numBranchLayers > 0 && params.branchesPerLayer > 0) {
         float sectionLength = params.trunkLength / (params.numBranchLayers + 1);
         
+        //whole trunk first so it stays one run of segments, the layers' branches go on after it.
+        //segment layer - 1 ends where that layer branches
+        uint32_t trunkSegment = AxialTree::NO_INDEX;
         for (int layer = 1; layer <= params.numBranchLayers; ++layer) {
             float heightRatio = static_cast<float>(layer - 1) / static_cast<float>(params.numBranchLayers);
             float radiusReduction = 1.0f - (heightRatio * 0.7f);
             float currentRadius = params.trunkRadius * radiusReduction;
             currentRadius = glm::max(0.01f, currentRadius);
             
-            auto trunkSegment = std::make_shared<Segment>(
+            trunkSegment = tree.addSegment(
+                trunkSegment,
                 trunkStart,
                 currentTrunkDir,
                 sectionLength,
@@ -135,8 +145,48 @@ AxialTree TreeGenerator::generateDeadOak(const TreeParameters& params) {
                 false
             );
             
-            tree.rootBranch->mainAxis->addSegment(trunkSegment);
-            trunkStart = trunkSegment->end;
+            trunkStart = tree.segments[trunkSegment].end;
+            
+            if (layer < params.numBranchLayers) {
+                float trunkConeAngle = 3.0f + random.range(-1.0f, 1.0f) * 8.0f;
+                float trunkAzimuthAngle = random.range(0.0f, 360.0f);
+                float trunkConeRad = glm::radians(trunkConeAngle);
+                float trunkAzimuthRad = glm::radians(trunkAzimuthAngle);
+                
+                //normalized after the check, the first bend is off a straight up trunk and a zero cross normalizes to nan
+                glm::vec3 trunkPerpAxis = glm::cross(currentTrunkDir, glm::vec3(0.0f, 1.0f, 0.0f));
+                if (glm::length(trunkPerpAxis) < 0.001f) {
+                    trunkPerpAxis = glm::vec3(1.0f, 0.0f, 0.0f);
+                }
+                trunkPerpAxis = glm::normalize(trunkPerpAxis);
+                
+                //tip it over by the cone angle, then spin that around the way it was going so the bend
+                //can lean any way but never by more than the cone angle
+                glm::vec3 previousTrunkDir = currentTrunkDir;
+                currentTrunkDir = rotateVector(currentTrunkDir, trunkPerpAxis, trunkConeRad);
+                currentTrunkDir = rotateVector(currentTrunkDir, previousTrunkDir, trunkAzimuthRad);
+                currentTrunkDir = glm::normalize(currentTrunkDir);
+            }
+        }
+        
+        float finalHeightRatio = static_cast<float>(params.numBranchLayers) / static_cast<float>(params.numBranchLayers + 1);
+        float finalRadius = params.trunkRadius * (1.0f - (finalHeightRatio * 0.7f));
+        finalRadius = glm::max(0.01f, finalRadius);
+        
+        tree.addSegment(
+            trunkSegment,
+            trunkStart,
+            currentTrunkDir,
+            sectionLength,
+            finalRadius,
+            0,
+            true,
+            false
+        );
+        
+        for (int layer = 1; layer <= params.numBranchLayers; ++layer) {
+            uint32_t layerSegment = static_cast<uint32_t>(layer - 1);
+            glm::vec3 branchPoint = tree.segments[layerSegment].end;
             
             float branchHeightRatio = static_cast<float>(layer) / static_cast<float>(params.numBranchLayers + 1);
             float lengthReduction = 1.0f - (branchHeightRatio * 0.85f);
@@ -144,11 +194,11 @@ AxialTree TreeGenerator::generateDeadOak(const TreeParameters& params) {
             
             for (int b = 0; b < params.branchesPerLayer; ++b) {
                 float baseAngle = (360.0f / params.branchesPerLayer) * b;
-                float angleVariation = dis(gen) * 25.0f;
+                float angleVariation = random.range(-1.0f, 1.0f) * 25.0f;
                 float angle = baseAngle + angleVariation;
                 float angleRad = glm::radians(angle);
                 
-                float verticalAngle = 30.0f + dis(gen) * 20.0f;
+                float verticalAngle = 30.0f + random.range(-1.0f, 1.0f) * 20.0f;
                 float verticalRad = glm::radians(verticalAngle);
                 
                 glm::vec3 branchDir(
@@ -160,8 +210,9 @@ AxialTree TreeGenerator::generateDeadOak(const TreeParameters& params) {
                 
                 float branchRadius = params.trunkRadius * 0.6f;
                 
-                auto branchSegment = std::make_shared<Segment>(
-                    trunkStart,
+                uint32_t branchSegment = tree.addSegment(
+                    layerSegment,
+                    branchPoint,
                     branchDir,
                     branchLength,
                     branchRadius,
@@ -170,53 +221,18 @@ AxialTree TreeGenerator::generateDeadOak(const TreeParameters& params) {
                     true
                 );
                 
-                tree.rootBranch->mainAxis->addSegment(branchSegment);
-                
                 if (params.branchDepth > 0) {
                     generateOakSubBranches(
-                        trunkStart + branchDir * branchLength,
-                        branchDir,
+                        tree,
+                        random,
+                        branchSegment,
                         params,
                         1,
-                        branchHeightRatio,
-                        tree.rootBranch
+                        branchHeightRatio
                     );
                 }
             }
-            
-            if (layer < params.numBranchLayers) {
-                float trunkConeAngle = 3.0f + dis(gen) * 8.0f;
-                float trunkAzimuthAngle = angleDis(gen);
-                float trunkConeRad = glm::radians(trunkConeAngle);
-                float trunkAzimuthRad = glm::radians(trunkAzimuthAngle);
-                
-                glm::vec3 trunkPerpAxis = glm::normalize(glm::cross(currentTrunkDir, glm::vec3(0.0f, 1.0f, 0.0f)));
-                if (glm::length(trunkPerpAxis) < 0.001f) {
-                    trunkPerpAxis = glm::vec3(1.0f, 0.0f, 0.0f);
-                }
-                
-                currentTrunkDir = rotateVector(currentTrunkDir, trunkPerpAxis, trunkConeRad);
-                glm::vec3 trunkUpAxis = glm::normalize(glm::cross(trunkPerpAxis, currentTrunkDir));
-                currentTrunkDir = rotateVector(currentTrunkDir, trunkUpAxis, trunkAzimuthRad);
-                currentTrunkDir = glm::normalize(currentTrunkDir);
-            }
         }
-        
-        float finalHeightRatio = static_cast<float>(params.numBranchLayers) / static_cast<float>(params.numBranchLayers + 1);
-        float finalRadius = params.trunkRadius * (1.0f - (finalHeightRatio * 0.7f));
-        finalRadius = glm::max(0.01f, finalRadius);
-        
-        auto finalTrunkSegment = std::make_shared<Segment>(
-            trunkStart,
-            currentTrunkDir,
-            sectionLength,
-            finalRadius,
-            0,
-            true,
-            false
-        );
-        
-        tree.rootBranch->mainAxis->addSegment(finalTrunkSegment);
     } else {
         int trunkSegments = params.numBranchLayers + 1;
         if (trunkSegments == 0) {
@@ -224,13 +240,15 @@ AxialTree TreeGenerator::generateDeadOak(const TreeParameters& params) {
         }
         float segmentLength = params.trunkLength / trunkSegments;
         
+        uint32_t trunkSegment = AxialTree::NO_INDEX;
         for (int i = 0; i < trunkSegments; ++i) {
             float heightRatio = static_cast<float>(i) / static_cast<float>(trunkSegments);
             float radiusReduction = 1.0f - (heightRatio * 0.7f);
             float currentRadius = params.trunkRadius * radiusReduction;
             currentRadius = glm::max(0.01f, currentRadius);
             
-            auto trunkSegment = std::make_shared<Segment>(
+            trunkSegment = tree.addSegment(
+                trunkSegment,
                 trunkStart,
                 trunkDirection,
                 segmentLength,
@@ -240,31 +258,27 @@ AxialTree TreeGenerator::generateDeadOak(const TreeParameters& params) {
                 false
             );
             
-            tree.rootBranch->mainAxis->addSegment(trunkSegment);
-            trunkStart = trunkSegment->end;
+            trunkStart = tree.segments[trunkSegment].end;
         }
     }
-    
-    tree.collectAllSegments();
-    return tree;
 }
 
-AxialTree TreeGenerator::generateDeadBirch(const TreeParameters& params) {
-    AxialTree tree;
-    
+void TreeGenerator::generateDeadBirch(const TreeParameters& params, AxialTree& tree, FastRandom& random) {
     glm::vec3 trunkStart(0.0f, 0.0f, 0.0f);
     glm::vec3 trunkDirection(0.0f, 1.0f, 0.0f);
     
     int trunkSegments = params.numBranchLayers + 1;
     float segmentLength = params.trunkLength / trunkSegments;
     
+    uint32_t trunkSegment = AxialTree::NO_INDEX;
     for (int i = 0; i < trunkSegments; ++i) {
         float heightRatio = static_cast<float>(i) / static_cast<float>(trunkSegments);
         float radiusReduction = 1.0f - (heightRatio * 0.9f);
         float currentRadius = params.trunkRadius * radiusReduction * 0.7f;
         currentRadius = glm::max(0.01f, currentRadius);
         
-        auto trunkSegment = std::make_shared<Segment>(
+        trunkSegment = tree.addSegment(
+            trunkSegment,
             trunkStart,
             trunkDirection,
             segmentLength,
@@ -274,8 +288,7 @@ AxialTree TreeGenerator::generateDeadBirch(const TreeParameters& params) {
             false
         );
         
-        tree.rootBranch->mainAxis->addSegment(trunkSegment);
-        trunkStart = trunkSegment->end;
+        trunkStart = tree.segments[trunkSegment].end;
     }
     
     if (params.numBranchLayers > 0 && params.branchesPerLayer > 0) {
@@ -293,7 +306,7 @@ AxialTree TreeGenerator::generateDeadBirch(const TreeParameters& params) {
                 float angle = (360.0f / params.branchesPerLayer) * b;
                 float angleRad = glm::radians(angle);
                 
-                float verticalAngle = 10.0f + dis(gen) * 15.0f;
+                float verticalAngle = 10.0f + random.range(-1.0f, 1.0f) * 15.0f;
                 float verticalRad = glm::radians(verticalAngle);
                 
                 glm::vec3 branchDir(
@@ -305,7 +318,8 @@ AxialTree TreeGenerator::generateDeadBirch(const TreeParameters& params) {
                 
                 float branchRadius = params.trunkRadius * 0.4f;
                 
-                auto branchSegment = std::make_shared<Segment>(
+                uint32_t branchSegment = tree.addSegment(
+                    static_cast<uint32_t>(layer - 1),
                     branchPoint,
                     branchDir,
                     branchLength,
@@ -315,35 +329,33 @@ AxialTree TreeGenerator::generateDeadBirch(const TreeParameters& params) {
                     true
                 );
                 
-                tree.rootBranch->mainAxis->addSegment(branchSegment);
-                
                 if (params.branchDepth > 0) {
                     generateSubBranches(
-                        branchPoint + branchDir * branchLength,
-                        branchDir,
+                        tree,
+                        random,
+                        branchSegment,
                         params,
                         1,
-                        heightRatio,
-                        tree.rootBranch
+                        heightRatio
                     );
                 }
             }
         }
     }
-    
-    tree.collectAllSegments();
-    return tree;
 }
 
-void TreeGenerator::generateSubBranches(glm::vec3 startPos,
-                                         glm::vec3 parentDir,
+void TreeGenerator::generateSubBranches(AxialTree& tree,
+                                         FastRandom& random,
+                                         uint32_t parentSegment,
                                          const TreeParameters& params,
                                          int currentDepth,
-                                         float heightRatio,
-                                         std::shared_ptr<Branch> parentBranch) {
+                                         float heightRatio) {
     if (currentDepth >= params.branchDepth) {
         return;
     }
+    //copies, adding segments can move the array
+    glm::vec3 startPos = tree.segments[parentSegment].end;
+    glm::vec3 parentDir = tree.segments[parentSegment].direction;
     
     float heightReduction = 1.0f - (heightRatio * 0.9f);
     float depthReduction = std::pow(0.7f, currentDepth);
@@ -356,24 +368,26 @@ void TreeGenerator::generateSubBranches(glm::vec3 startPos,
     }
     
     for (int b = 0; b < numSubBranches; ++b) {
-        float coneAngle = params.subBranchAngle * (0.3f + dis(gen) * 0.4f);
-        float azimuthAngle = angleDis(gen);
+        float coneAngle = params.subBranchAngle * (0.3f + random.range(-1.0f, 1.0f) * 0.4f);
+        float azimuthAngle = random.range(0.0f, 360.0f);
         
-        glm::vec3 perpAxis = glm::normalize(glm::cross(parentDir, glm::vec3(0.0f, 1.0f, 0.0f)));
+        glm::vec3 perpAxis = glm::cross(parentDir, glm::vec3(0.0f, 1.0f, 0.0f));
         if (glm::length(perpAxis) < 0.001f) {
             perpAxis = glm::vec3(1.0f, 0.0f, 0.0f);
         }
+        perpAxis = glm::normalize(perpAxis);
         
         glm::vec3 branchDir = rotateVector(parentDir, perpAxis, glm::radians(coneAngle));
         
-        float tiltAngle = dis(gen) * 15.0f;
+        float tiltAngle = random.range(-1.0f, 1.0f) * 15.0f;
         branchDir = rotateVector(branchDir, parentDir, glm::radians(tiltAngle));
         branchDir = glm::normalize(branchDir);
         
         branchDir.y *= 0.2f;
         branchDir = glm::normalize(branchDir);
         
-        auto branchSegment = std::make_shared<Segment>(
+        uint32_t branchSegment = tree.addSegment(
+            parentSegment,
             startPos,
             branchDir,
             branchLength,
@@ -383,28 +397,29 @@ void TreeGenerator::generateSubBranches(glm::vec3 startPos,
             true
         );
         
-        parentBranch->mainAxis->addSegment(branchSegment);
-        
         generateSubBranches(
-            startPos + branchDir * branchLength,
-            branchDir,
+            tree,
+            random,
+            branchSegment,
             params,
             currentDepth + 1,
-            heightRatio,
-            parentBranch
+            heightRatio
         );
     }
 }
 
-void TreeGenerator::generateOakSubBranches(glm::vec3 startPos,
-                                         glm::vec3 parentDir,
+void TreeGenerator::generateOakSubBranches(AxialTree& tree,
+                                         FastRandom& random,
+                                         uint32_t parentSegment,
                                          const TreeParameters& params,
                                          int currentDepth,
-                                         float heightRatio,
-                                         std::shared_ptr<Branch> parentBranch) {
+                                         float heightRatio) {
     if (currentDepth >= params.branchDepth) {
         return;
     }
+    //copies, adding segments can move the array
+    glm::vec3 startPos = tree.segments[parentSegment].end;
+    glm::vec3 parentDir = tree.segments[parentSegment].direction;
     
     float heightReduction = 1.0f - (heightRatio * 0.85f);
     float depthReduction = std::pow(0.7f, currentDepth);
@@ -418,29 +433,32 @@ void TreeGenerator::generateOakSubBranches(glm::vec3 startPos,
     float upwardAngleRad = glm::radians(upwardAngle);
     
     for (int b = 0; b < numSubBranches; ++b) {
-        float coneAngle = params.subBranchAngle * (0.3f + dis(gen) * 0.4f);
+        float coneAngle = params.subBranchAngle * (0.3f + random.range(-1.0f, 1.0f) * 0.4f);
         
-        glm::vec3 perpAxis = glm::normalize(glm::cross(parentDir, glm::vec3(0.0f, 1.0f, 0.0f)));
+        glm::vec3 perpAxis = glm::cross(parentDir, glm::vec3(0.0f, 1.0f, 0.0f));
         if (glm::length(perpAxis) < 0.001f) {
             perpAxis = glm::vec3(1.0f, 0.0f, 0.0f);
         }
+        perpAxis = glm::normalize(perpAxis);
         
         glm::vec3 branchDir = rotateVector(parentDir, perpAxis, glm::radians(coneAngle));
         
-        float tiltAngle = dis(gen) * 15.0f;
+        float tiltAngle = random.range(-1.0f, 1.0f) * 15.0f;
         branchDir = rotateVector(branchDir, parentDir, glm::radians(tiltAngle));
         branchDir = glm::normalize(branchDir);
         
         glm::vec3 upVector(0.0f, 1.0f, 0.0f);
-        glm::vec3 rightVector = glm::normalize(glm::cross(branchDir, upVector));
+        glm::vec3 rightVector = glm::cross(branchDir, upVector);
         if (glm::length(rightVector) < 0.001f) {
             rightVector = glm::vec3(1.0f, 0.0f, 0.0f);
         }
+        rightVector = glm::normalize(rightVector);
         
         glm::mat4 upwardRotation = glm::rotate(glm::mat4(1.0f), upwardAngleRad, rightVector);
         branchDir = glm::normalize(glm::vec3(upwardRotation * glm::vec4(branchDir, 0.0f)));
         
-        auto branchSegment = std::make_shared<Segment>(
+        uint32_t branchSegment = tree.addSegment(
+            parentSegment,
             startPos,
             branchDir,
             branchLength,
@@ -450,15 +468,13 @@ void TreeGenerator::generateOakSubBranches(glm::vec3 startPos,
             true
         );
         
-        parentBranch->mainAxis->addSegment(branchSegment);
-        
         generateOakSubBranches(
-            startPos + branchDir * branchLength,
-            branchDir,
+            tree,
+            random,
+            branchSegment,
             params,
             currentDepth + 1,
-            heightRatio,
-            parentBranch
+            heightRatio
         );
     }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "axialtree.h"
+#include "utils/fastrandom.h"
 #include <glm/glm.hpp>
 
 enum class TreeType {
@@ -23,24 +24,29 @@ struct TreeParameters {
 
 class TreeGenerator {
 public:
-    static AxialTree generateTree(const TreeParameters& params);
+    //everything random comes from seed, so the same params and seed always give the same tree. no shared state,
+    //any number of threads can generate at once
+    static AxialTree generateTree(const TreeParameters& params, uint64_t seed);
+    //same, into tree, which is cleared first. reuses its storage, for generating lots of trees in a row
+    static void generateTree(const TreeParameters& params, uint64_t seed, AxialTree& tree);
     
 private:
-    static AxialTree generateDeadPine(const TreeParameters& params);
-    static AxialTree generateDeadOak(const TreeParameters& params);
-    static AxialTree generateDeadBirch(const TreeParameters& params);
+    static void generateDeadPine(const TreeParameters& params, AxialTree& tree, FastRandom& random);
+    static void generateDeadOak(const TreeParameters& params, AxialTree& tree, FastRandom& random);
+    static void generateDeadBirch(const TreeParameters& params, AxialTree& tree, FastRandom& random);
     
-    static void generateSubBranches(glm::vec3 startPos,
-                                    glm::vec3 parentDir,
+    //branches off the end of parentSegment, in its direction
+    static void generateSubBranches(AxialTree& tree,
+                                    FastRandom& random,
+                                    uint32_t parentSegment,
                                     const TreeParameters& params,
                                     int currentDepth,
-                                    float heightRatio,
-                                    std::shared_ptr<Branch> parentBranch);
+                                    float heightRatio);
     
-    static void generateOakSubBranches(glm::vec3 startPos,
-                                      glm::vec3 parentDir,
+    static void generateOakSubBranches(AxialTree& tree,
+                                      FastRandom& random,
+                                      uint32_t parentSegment,
                                       const TreeParameters& params,
                                       int currentDepth,
-                                      float heightRatio,
-                                      std::shared_ptr<Branch> parentBranch);
+                                      float heightRatio);
 };
@@ -0,0 +1,117 @@
+#include "treemesher.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void TreeMesher::build(const AxialTree& tree, const Options& options, TreeMesh& mesh) {
+    mesh.vertexData.clear();
+    mesh.indices.clear();
+    mesh.vertexCount = 0;
+    if (tree.empty()) {
+        return;
+    }
+    float trunkRadius = std::max(tree.segments[0].radius, 0.0001f);
+
+    for (const Branch& branch : tree.branches) {
+        if (branch.order > options.maxOrder || branch.segmentCount == 0) {
+            continue;
+        }
+        uint32_t last = branch.firstSegment + branch.segmentCount - 1;
+        const Segment& first = tree.segments[branch.firstSegment];
+
+        //the ring frame gets carried along the branch so the seam doesn't twist at the bends
+        glm::vec3 reference = std::abs(first.direction.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 normal = glm::normalize(glm::cross(first.direction, reference));
+        float v = 0.0f;
+        Ring previous = addRing(mesh, first.start, first.direction, normal, first.radius,
+                                sidesFor(first.radius, trunkRadius, options), v);
+
+        for (uint32_t i = branch.firstSegment; i <= last; i++) {
+            const Segment& segment = tree.segments[i];
+            //a joint's ring sits halfway between the two directions and takes the next segment's radius
+            glm::vec3 axis = segment.direction;
+            float radius = segment.radius * options.tipRadiusScale;
+            if (i < last) {
+                const Segment& next = tree.segments[i + 1];
+                glm::vec3 halfway = segment.direction + next.direction;
+                axis = glm::length(halfway) > 0.001f ? glm::normalize(halfway) : segment.direction;
+                radius = next.radius;
+            }
+            glm::vec3 projected = normal - axis * glm::dot(normal, axis);
+            if (glm::length(projected) > 0.001f) {
+                normal = glm::normalize(projected);
+            } else {
+                reference = std::abs(axis.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                normal = glm::normalize(glm::cross(axis, reference));
+            }
+
+            //same texture density as TreePiece, one repeat around and one per circumference along
+            v += segment.length / (2.0f * static_cast<float>(M_PI) * std::max(segment.radius, 0.01f));
+            Ring ring = addRing(mesh, segment.end, axis, normal, radius, sidesFor(radius, trunkRadius, options), v);
+            stitch(mesh, previous, ring);
+            previous = ring;
+        }
+
+        //tip closes on a point just past the last ring
+        const Segment& tipSegment = tree.segments[last];
+        float tipRadius = tipSegment.radius * options.tipRadiusScale;
+        glm::vec3 apex = tipSegment.end + tipSegment.direction * tipRadius;
+        glm::vec3 tangent = normal;
+        glm::vec3 bitangent = glm::cross(tipSegment.direction, normal);
+        uint32_t apexIndex = static_cast<uint32_t>(mesh.vertexCount);
+        mesh.vertexData.insert(mesh.vertexData.end(), {apex.x, apex.y, apex.z,
+                                                       tipSegment.direction.x, tipSegment.direction.y, tipSegment.direction.z,
+                                                       tangent.x, tangent.y, tangent.z, bitangent.x, bitangent.y, bitangent.z,
+                                                       0.5f, v + tipRadius / (2.0f * static_cast<float>(M_PI) * std::max(tipSegment.radius, 0.01f))});
+        mesh.vertexCount++;
+        for (int s = 0; s < previous.sides; s++) {
+            mesh.indices.insert(mesh.indices.end(), {previous.firstVertex + s, previous.firstVertex + s + 1, apexIndex});
+        }
+    }
+}
+
+int TreeMesher::sidesFor(float radius, float trunkRadius, const Options& options) {
+    float sides = static_cast<float>(options.maxSides) * std::sqrt(std::max(radius, 0.0f) / trunkRadius);
+    return std::clamp(static_cast<int>(std::lround(sides)), options.minSides, options.maxSides);
+}
+
+TreeMesher::Ring TreeMesher::addRing(TreeMesh& mesh, glm::vec3 center, glm::vec3 axis, glm::vec3 normal, float radius,
+                                     int sides, float v) {
+    Ring ring;
+    ring.firstVertex = static_cast<uint32_t>(mesh.vertexCount);
+    ring.sides = sides;
+    glm::vec3 binormal = glm::cross(axis, normal);
+    //sides + 1 vertices, the first one again at the end with u = 1 so the texture doesn't wrap backwards over the seam
+    for (int s = 0; s <= sides; s++) {
+        float theta = 2.0f * static_cast<float>(M_PI) * static_cast<float>(s) / static_cast<float>(sides);
+        glm::vec3 radial = std::cos(theta) * normal + std::sin(theta) * binormal;
+        glm::vec3 tangent = -std::sin(theta) * normal + std::cos(theta) * binormal;
+        glm::vec3 pos = center + radial * radius;
+        float u = static_cast<float>(s) / static_cast<float>(sides);
+        mesh.vertexData.insert(mesh.vertexData.end(), {pos.x, pos.y, pos.z, radial.x, radial.y, radial.z,
+                                                       tangent.x, tangent.y, tangent.z, axis.x, axis.y, axis.z, u, v});
+    }
+    mesh.vertexCount += sides + 1;
+    return ring;
+}
+
+void TreeMesher::stitch(TreeMesh& mesh, Ring bottom, Ring top) {
+    //walks both rings around at once, always stepping whichever one is behind, so rings with different side
+    //counts still close up. counter clockwise seen from outside
+    int b = 0;
+    int t = 0;
+    while (b < bottom.sides || t < top.sides) {
+        //b + 1 over bottom.sides against t + 1 over top.sides, cross multiplied
+        bool stepBottom = t == top.sides || (b < bottom.sides && (b + 1) * top.sides <= (t + 1) * bottom.sides);
+        if (stepBottom) {
+            mesh.indices.insert(mesh.indices.end(), {bottom.firstVertex + b, bottom.firstVertex + b + 1, top.firstVertex + t});
+            b++;
+        } else {
+            mesh.indices.insert(mesh.indices.end(), {bottom.firstVertex + b, top.firstVertex + t + 1, top.firstVertex + t});
+            t++;
+        }
+    }
+}
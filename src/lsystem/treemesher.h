@@ -0,0 +1,41 @@
+#pragma once
+
+#include "axialtree.h"
+#include <cstdint>
+#include <vector>
+
+//14 floats per vertex like TreePiece (pos, normal, tangent, bitangent, uv) and the triangles as indices into them
+struct TreeMesh {
+    std::vector<float> vertexData;
+    std::vector<uint32_t> indices;
+    int vertexCount = 0;
+};
+
+//turns an AxialTree into one continuous tube per branch. every node gets a single ring of vertices that both
+//segments meeting there share, the radius tapers segment to segment and only the tips get closed, so there's
+//none of the doubled up rings and buried caps a cylinder per segment leaves at every joint
+class TreeMesher {
+public:
+    struct Options {
+        //sides per ring scale with the square root of the ring's radius over the trunk's, clamped to these
+        int minSides = 4;
+        int maxSides = 12;
+        //branches past this order are left out
+        int maxOrder = 1 << 30;
+        //a branch's last ring is this much of its last segment's radius, the tip closes on a point past it
+        float tipRadiusScale = 0.4f;
+    };
+
+    //replaces whatever is in mesh
+    static void build(const AxialTree& tree, const Options& options, TreeMesh& mesh);
+
+private:
+    struct Ring {
+        uint32_t firstVertex;
+        int sides;
+    };
+
+    static int sidesFor(float radius, float trunkRadius, const Options& options);
+    static Ring addRing(TreeMesh& mesh, glm::vec3 center, glm::vec3 axis, glm::vec3 normal, float radius, int sides, float v);
+    static void stitch(TreeMesh& mesh, Ring bottom, Ring top);
+};
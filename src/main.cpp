@@ -1,4 +1,5 @@
 #include "mainwindow.h"
+#include "benchmark/benchmark.h"
 
 #include <QApplication>
 #include <QScreen>
@@ -6,6 +7,13 @@
 #include <QSettings>
 
 int main(int argc, char *argv[]) {
+    BenchmarkOptions benchmarkOptions;
+    bool benchmarkArgsOk = true;
+    bool runBenchmark = Benchmark::parseArguments(argc, argv, benchmarkOptions, benchmarkArgsOk);
+    if (runBenchmark && !benchmarkArgsOk) {
+        return 1;
+    }
+
     QApplication a(argc, argv);
 
     QCoreApplication::setApplicationName("Project 5: Realtime");
@@ -17,6 +25,10 @@ int main(int argc, char *argv[]) {
     fmt.setProfile(QSurfaceFormat::CoreProfile);
     QSurfaceFormat::setDefaultFormat(fmt);
 
+    if (runBenchmark) {
+        return Benchmark::run(benchmarkOptions);
+    }
+
     MainWindow w;
     w.initialize();
     w.resize(900, 550);
@@ -473,6 +473,14 @@ void MainWindow::initialize() {
     chunkPosLabel = new QLabel();
     chunkPosLabel->setText("Chunk: (0, 0)");
     chunkPosLabel->setWordWrap(true);
+    
+    renderScaleLabel = new QLabel();
+    renderScaleLabel->setText("Render Scale: 100%");
+    renderScaleLabel->setWordWrap(true);
+    
+    frameRateLabel = new QLabel();
+    frameRateLabel->setText("Sim: 0 Hz, Render: 0 fps");
+    frameRateLabel->setWordWrap(true);
 
     // Create camera controls
     QLabel *cameraControls_label = new QLabel();
@@ -491,6 +499,10 @@ void MainWindow::initialize() {
     motionBlurCheckbox->setText(QStringLiteral("Motion Blur"));
     motionBlurCheckbox->setChecked(false);
     
+    dynamicResolutionCheckbox = new QCheckBox();
+    dynamicResolutionCheckbox->setText(QStringLiteral("Dynamic Resolution"));
+    dynamicResolutionCheckbox->setChecked(false);
+    
     depthVisualizationCheckbox = new QCheckBox();
     depthVisualizationCheckbox->setText(QStringLiteral("Visualize Depth"));
     depthVisualizationCheckbox->setChecked(false);
@@ -521,6 +533,27 @@ void MainWindow::initialize() {
     motionBlurSamplesBox->setValue(3);
     motionBlurSamplesBox->setFixedWidth(70);
     
+    QLabel *viewDistance_label = new QLabel();
+    viewDistance_label->setText("View Distance:");
+    
+    viewDistanceSlider = new QSlider(Qt::Orientation::Horizontal);
+    viewDistanceSlider->setTickInterval(1);
+    viewDistanceSlider->setMinimum(ViewDistanceController::MIN_VIEW_DISTANCE);
+    viewDistanceSlider->setMaximum(ViewDistanceController::MAX_VIEW_DISTANCE);
+    viewDistanceSlider->setValue(settings.viewDistance);
+    viewDistanceSlider->setMaximumWidth(160);
+
+    viewDistanceBox = new QSpinBox();
+    viewDistanceBox->setMinimum(ViewDistanceController::MIN_VIEW_DISTANCE);
+    viewDistanceBox->setMaximum(ViewDistanceController::MAX_VIEW_DISTANCE);
+    viewDistanceBox->setSingleStep(1);
+    viewDistanceBox->setValue(settings.viewDistance);
+    viewDistanceBox->setFixedWidth(70);
+    
+    autoViewDistanceCheckbox = new QCheckBox();
+    autoViewDistanceCheckbox->setText(QStringLiteral("Auto View Distance"));
+    autoViewDistanceCheckbox->setChecked(false);
+    
     QLabel *movementSpeed_label = new QLabel();
     movementSpeed_label->setText("Movement Speed:");
     
@@ -619,6 +652,8 @@ void MainWindow::initialize() {
     playPathButton = new QPushButton("Play Path");
     stopPathButton = new QPushButton("Stop Path");
     clearPathButton = new QPushButton("Clear Path");
+    savePathButton = new QPushButton("Save Path");
+    loadPathButton = new QPushButton("Load Path");
     
     stopPathButton->setEnabled(false);
     
@@ -756,12 +791,15 @@ void MainWindow::initialize() {
     vLayout->addWidget(telemetry_label);
     vLayout->addWidget(cameraPosLabel);
     vLayout->addWidget(chunkPosLabel);
+    vLayout->addWidget(renderScaleLabel);
+    vLayout->addWidget(frameRateLabel);
     
     // Add camera controls
     vLayout->addWidget(cameraControls_label);
     vLayout->addWidget(flyingModeCheckbox);
     vLayout->addWidget(fpsModeCheckbox);
     vLayout->addWidget(motionBlurCheckbox);
+    vLayout->addWidget(dynamicResolutionCheckbox);
     vLayout->addWidget(depthVisualizationCheckbox);
     
     QGroupBox *gbufferVizLayout = new QGroupBox();
@@ -779,6 +817,15 @@ void MainWindow::initialize() {
     motionBlurSamplesLayout->setLayout(motionBlurSamplesLayout_inner);
     vLayout->addWidget(motionBlurSamplesLayout);
     
+    QGroupBox *viewDistanceLayout = new QGroupBox();
+    QHBoxLayout *viewDistanceLayout_inner = new QHBoxLayout();
+    viewDistanceLayout_inner->addWidget(viewDistance_label);
+    viewDistanceLayout_inner->addWidget(viewDistanceSlider);
+    viewDistanceLayout_inner->addWidget(viewDistanceBox);
+    viewDistanceLayout->setLayout(viewDistanceLayout_inner);
+    vLayout->addWidget(viewDistanceLayout);
+    vLayout->addWidget(autoViewDistanceCheckbox);
+    
     QGroupBox *movementSpeedLayout = new QGroupBox();
     QHBoxLayout *movementLayout = new QHBoxLayout();
     movementLayout->addWidget(movementSpeed_label);
@@ -833,6 +880,8 @@ void MainWindow::initialize() {
     pathLayout->addWidget(playPathButton);
     pathLayout->addWidget(stopPathButton);
     pathLayout->addWidget(clearPathButton);
+    pathLayout->addWidget(savePathButton);
+    pathLayout->addWidget(loadPathButton);
     cameraPathLayout->setLayout(pathLayout);
     vLayout->addWidget(cameraPathLayout);
     
@@ -993,6 +1042,10 @@ void MainWindow::initialize() {
     fogWispsCheckbox->setChecked(true);
     particleLayout->addWidget(fogWispsCheckbox);
     
+    gpuParticlesCheckbox = new QCheckBox("Simulate Fog/Dust on GPU");
+    gpuParticlesCheckbox->setChecked(false);
+    particleLayout->addWidget(gpuParticlesCheckbox);
+    
     QLabel *dirtSpawnRate_label = new QLabel("Dirt Spawn Rate (per second):");
     dirtSpawnRateSlider = new QSlider(Qt::Horizontal);
     dirtSpawnRateSlider->setMinimum(1);
@@ -1034,12 +1087,12 @@ void MainWindow::initialize() {
     QLabel *maxParticles_label = new QLabel("Max Particles:");
     maxParticlesSlider = new QSlider(Qt::Horizontal);
     maxParticlesSlider->setMinimum(50);
-    maxParticlesSlider->setMaximum(1000);
+    maxParticlesSlider->setMaximum(100000);
     maxParticlesSlider->setValue(200);
     maxParticlesSlider->setMaximumWidth(160);
     maxParticlesBox = new QSpinBox();
     maxParticlesBox->setMinimum(50);
-    maxParticlesBox->setMaximum(1000);
+    maxParticlesBox->setMaximum(100000);
     maxParticlesBox->setSingleStep(50);
     maxParticlesBox->setValue(200);
     maxParticlesBox->setFixedWidth(70);
@@ -1066,7 +1119,7 @@ void MainWindow::initialize() {
     onValChangeFarBox(50.f);
     
     // Initialize enemy spawn delay
-    realtime->getEnemyManager().setSpawnDelay(10.0f);
+    realtime->setEnemySpawnDelay(10.0f);
 }
 
 void MainWindow::finish() {
@@ -1084,15 +1137,22 @@ void MainWindow::connectUIElements() {
     connectExtraCredit();
     
     connect(realtime, &Realtime::telemetryUpdate, this, &MainWindow::onTelemetryUpdate);
+    connect(realtime, &Realtime::renderScaleChanged, this, &MainWindow::onRenderScaleChanged);
+    connect(realtime, &Realtime::frameRatesChanged, this, &MainWindow::onFrameRatesChanged);
     
     // Connect camera controls
     connect(flyingModeCheckbox, &QCheckBox::clicked, this, &MainWindow::onFlyingModeChanged);
     connect(fpsModeCheckbox, &QCheckBox::clicked, this, &MainWindow::onFpsModeChanged);
     connect(motionBlurCheckbox, &QCheckBox::clicked, this, &MainWindow::onMotionBlurChanged);
+    connect(dynamicResolutionCheckbox, &QCheckBox::clicked, this, &MainWindow::onDynamicResolutionChanged);
     connect(depthVisualizationCheckbox, &QCheckBox::clicked, this, &MainWindow::onDepthVisualizationChanged);
     connect(gbufferVizComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::onGBufferVizChanged);
     connect(motionBlurSamplesSlider, &QSlider::valueChanged, this, &MainWindow::onMotionBlurSamplesChanged);
     connect(motionBlurSamplesBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &MainWindow::onMotionBlurSamplesBoxChanged);
+    connect(viewDistanceSlider, &QSlider::valueChanged, this, &MainWindow::onViewDistanceChanged);
+    connect(viewDistanceBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &MainWindow::onViewDistanceBoxChanged);
+    connect(autoViewDistanceCheckbox, &QCheckBox::clicked, this, &MainWindow::onAutoViewDistanceChanged);
+    connect(realtime, &Realtime::viewDistanceChanged, this, &MainWindow::onRealtimeViewDistanceChanged);
     connect(movementSpeedSlider, &QSlider::valueChanged, this, &MainWindow::onMovementSpeedChanged);
     connect(movementSpeedBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &MainWindow::onMovementSpeedBoxChanged);
     connect(jumpHeightSlider, &QSlider::valueChanged, this, &MainWindow::onJumpHeightChanged);
@@ -1109,6 +1169,8 @@ void MainWindow::connectUIElements() {
     connect(playPathButton, &QPushButton::clicked, this, &MainWindow::onPlayPath);
     connect(stopPathButton, &QPushButton::clicked, this, &MainWindow::onStopPath);
     connect(clearPathButton, &QPushButton::clicked, this, &MainWindow::onClearPath);
+    connect(savePathButton, &QPushButton::clicked, this, &MainWindow::onSavePath);
+    connect(loadPathButton, &QPushButton::clicked, this, &MainWindow::onLoadPath);
     connect(realtime, &Realtime::pathPlaybackFinished, this, &MainWindow::onStopPath);
     connect(realtime, &Realtime::fpsModeToggled, this, [this](bool enabled) {
         fpsModeCheckbox->blockSignals(true);
@@ -1161,6 +1223,7 @@ void MainWindow::connectUIElements() {
     connect(particlesEnabledCheckbox, &QCheckBox::clicked, this, &MainWindow::onParticlesEnabledChanged);
     connect(dirtParticlesCheckbox, &QCheckBox::clicked, this, &MainWindow::onDirtParticlesChanged);
     connect(fogWispsCheckbox, &QCheckBox::clicked, this, &MainWindow::onFogWispsChanged);
+    connect(gpuParticlesCheckbox, &QCheckBox::clicked, this, &MainWindow::onGpuParticlesChanged);
     connect(dirtSpawnRateSlider, &QSlider::valueChanged, this, &MainWindow::onDirtSpawnRateChanged);
     connect(dirtSpawnRateBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &MainWindow::onDirtSpawnRateBoxChanged);
     connect(fogWispIntervalSlider, &QSlider::valueChanged, this, &MainWindow::onFogWispIntervalChanged);
@@ -1323,6 +1386,20 @@ void MainWindow::onTelemetryUpdate(float x, float y, float z, int chunkX, int ch
     chunkPosLabel->setText(chunkText);
 }
 
+void MainWindow::onRenderScaleChanged(float scale, float gpuFrameMs) {
+    QString scaleText = QString("Render Scale: %1% (GPU %2 ms)")
+                        .arg(static_cast<int>(scale * 100.0f + 0.5f))
+                        .arg(gpuFrameMs, 0, 'f', 2);
+    renderScaleLabel->setText(scaleText);
+}
+
+void MainWindow::onFrameRatesChanged(float simHz, float renderHz) {
+    QString rateText = QString("Sim: %1 Hz, Render: %2 fps")
+                       .arg(simHz, 0, 'f', 1)
+                       .arg(renderHz, 0, 'f', 1);
+    frameRateLabel->setText(rateText);
+}
+
 void MainWindow::onFlyingModeChanged() {
     bool flying = flyingModeCheckbox->isChecked();
     realtime->setFlyingMode(flying);
@@ -1338,6 +1415,11 @@ void MainWindow::onMotionBlurChanged() {
     realtime->setMotionBlurEnabled(enabled);
 }
 
+void MainWindow::onDynamicResolutionChanged() {
+    bool enabled = dynamicResolutionCheckbox->isChecked();
+    realtime->setDynamicResolutionEnabled(enabled);
+}
+
 void MainWindow::onMotionBlurSamplesChanged(int value) {
     motionBlurSamplesBox->blockSignals(true);
     motionBlurSamplesBox->setValue(value);
@@ -1352,6 +1434,43 @@ void MainWindow::onMotionBlurSamplesBoxChanged(int value) {
     realtime->setMotionBlurSamples(value);
 }
 
+void MainWindow::onViewDistanceChanged(int value) {
+    viewDistanceBox->blockSignals(true);
+    viewDistanceBox->setValue(value);
+    viewDistanceBox->blockSignals(false);
+    realtime->setViewDistance(value);
+    onRealtimeViewDistanceChanged(value);
+}
+
+void MainWindow::onViewDistanceBoxChanged(int value) {
+    viewDistanceSlider->blockSignals(true);
+    viewDistanceSlider->setValue(value);
+    viewDistanceSlider->blockSignals(false);
+    realtime->setViewDistance(value);
+    onRealtimeViewDistanceChanged(value);
+}
+
+void MainWindow::onAutoViewDistanceChanged() {
+    bool enabled = autoViewDistanceCheckbox->isChecked();
+    realtime->setAutoViewDistance(enabled);
+}
+
+void MainWindow::onRealtimeViewDistanceChanged(int chunks) {
+    //keep the sliders in sync when auto mode moves the distance, far plane is derived from it
+    viewDistanceSlider->blockSignals(true);
+    viewDistanceSlider->setValue(chunks);
+    viewDistanceSlider->blockSignals(false);
+    viewDistanceBox->blockSignals(true);
+    viewDistanceBox->setValue(chunks);
+    viewDistanceBox->blockSignals(false);
+    farBox->blockSignals(true);
+    farBox->setValue(settings.farPlane);
+    farBox->blockSignals(false);
+    farSlider->blockSignals(true);
+    farSlider->setValue(int(settings.farPlane*100.f));
+    farSlider->blockSignals(false);
+}
+
 void MainWindow::onMovementSpeedChanged(int value) {
     double multiplier = value / 100.0;
     movementSpeedBox->blockSignals(true);
@@ -1460,6 +1579,39 @@ void MainWindow::onClearPath() {
     stopPathButton->setEnabled(false);
 }
 
+//path files are what the --benchmark mode flies through
+void MainWindow::onSavePath() {
+    if (realtime->getPathWaypointCount() < 2) {
+        std::cout << "Need at least 2 waypoints to save a path." << std::endl;
+        return;
+    }
+    QString filePath = QFileDialog::getSaveFileName(this, tr("Save Camera Path"),
+                                                    QDir::currentPath()
+                                                        .append(QDir::separator())
+                                                        .append("scenefiles")
+                                                        .append(QDir::separator())
+                                                        .append("paths"), tr("Path Files (*.json)"));
+    if (!filePath.isNull() && realtime->saveCameraPath(filePath.toStdString())) {
+        std::cout << "Saved camera path to: \"" << filePath.toStdString() << "\"." << std::endl;
+    }
+}
+
+void MainWindow::onLoadPath() {
+    QString filePath = QFileDialog::getOpenFileName(this, tr("Load Camera Path"),
+                                                    QDir::currentPath()
+                                                        .append(QDir::separator())
+                                                        .append("scenefiles")
+                                                        .append(QDir::separator())
+                                                        .append("paths"), tr("Path Files (*.json)"));
+    if (filePath.isNull() || !realtime->loadCameraPath(filePath.toStdString())) {
+        return;
+    }
+    onStopPath();
+    double duration = realtime->getPathDuration();
+    pathDurationBox->setValue(duration);
+    std::cout << "Loaded camera path: \"" << filePath.toStdString() << "\"." << std::endl;
+}
+
 void MainWindow::onPathDurationChanged(int value) {
     double duration = static_cast<double>(value);
     pathDurationBox->blockSignals(true);
@@ -1509,7 +1661,7 @@ void MainWindow::onGBufferVizChanged(int index) {
 
 void MainWindow::onEnemyAutoSpawnChanged(int state) {
     bool enabled = (state == Qt::Checked);
-    realtime->getEnemyManager().setAutoSpawnEnabled(enabled);
+    realtime->setEnemyAutoSpawnEnabled(enabled);
 }
 
 void MainWindow::onEnemySpawnDelayChanged(int value) {
@@ -1517,19 +1669,19 @@ void MainWindow::onEnemySpawnDelayChanged(int value) {
     enemySpawnDelayBox->blockSignals(true);
     enemySpawnDelayBox->setValue(delay);
     enemySpawnDelayBox->blockSignals(false);
-    realtime->getEnemyManager().setSpawnDelay(delay);
+    realtime->setEnemySpawnDelay(delay);
 }
 
 void MainWindow::onEnemySpawnDelayBoxChanged(double value) {
     enemySpawnDelaySlider->blockSignals(true);
     enemySpawnDelaySlider->setValue(static_cast<int>(value));
     enemySpawnDelaySlider->blockSignals(false);
-    realtime->getEnemyManager().setSpawnDelay(value);
+    realtime->setEnemySpawnDelay(value);
 }
 
 void MainWindow::onEnemyManualSpawn() {
     glm::vec3 cameraPos = realtime->getCamera().getPosition();
-    realtime->getEnemyManager().spawnEnemy(cameraPos + glm::vec3(0.0f, 50.0f, 0.0f));
+    realtime->spawnEnemy(cameraPos + glm::vec3(0.0f, 50.0f, 0.0f));
 }
 
 void MainWindow::onFogChanged() {
@@ -1701,6 +1853,10 @@ void MainWindow::onFogWispsChanged() {
     realtime->setFogWispsEnabled(fogWispsCheckbox->isChecked());
 }
 
+void MainWindow::onGpuParticlesChanged() {
+    realtime->setGpuParticlesEnabled(gpuParticlesCheckbox->isChecked());
+}
+
 void MainWindow::onDirtSpawnRateChanged(int value) {
     double doubleValue = static_cast<double>(value);
     dirtSpawnRateBox->blockSignals(true);
@@ -62,15 +62,21 @@ private:
     // Telemetry labels
     QLabel *cameraPosLabel;
     QLabel *chunkPosLabel;
+    QLabel *renderScaleLabel;
+    QLabel *frameRateLabel;
 
     // Camera controls
     QCheckBox *flyingModeCheckbox;
     QCheckBox *fpsModeCheckbox;
     QCheckBox *motionBlurCheckbox;
+    QCheckBox *dynamicResolutionCheckbox;
     QCheckBox *depthVisualizationCheckbox;
     QComboBox *gbufferVizComboBox;
     QSlider *motionBlurSamplesSlider;
     QSpinBox *motionBlurSamplesBox;
+    QSlider *viewDistanceSlider;
+    QSpinBox *viewDistanceBox;
+    QCheckBox *autoViewDistanceCheckbox;
     QSlider *movementSpeedSlider;
     QDoubleSpinBox *movementSpeedBox;
     QSlider *jumpHeightSlider;
@@ -87,6 +93,8 @@ private:
     QPushButton *playPathButton;
     QPushButton *stopPathButton;
     QPushButton *clearPathButton;
+    QPushButton *savePathButton;
+    QPushButton *loadPathButton;
     QSlider *pathDurationSlider;
     QDoubleSpinBox *pathDurationBox;
     
@@ -125,6 +133,7 @@ private:
     QCheckBox *particlesEnabledCheckbox;
     QCheckBox *dirtParticlesCheckbox;
     QCheckBox *fogWispsCheckbox;
+    QCheckBox *gpuParticlesCheckbox;
     QSlider *dirtSpawnRateSlider;
     QDoubleSpinBox *dirtSpawnRateBox;
     QSlider *fogWispIntervalSlider;
@@ -148,15 +157,22 @@ private slots:
 
     //telemetry updates
     void onTelemetryUpdate(float x, float y, float z, int chunkX, int chunkZ);
+    void onRenderScaleChanged(float scale, float gpuFrameMs);
+    void onFrameRatesChanged(float simHz, float renderHz);
 
     //camera controls
     void onFlyingModeChanged();
     void onFpsModeChanged();
     void onMotionBlurChanged();
+    void onDynamicResolutionChanged();
     void onDepthVisualizationChanged();
     void onGBufferVizChanged(int index);
     void onMotionBlurSamplesChanged(int value);
     void onMotionBlurSamplesBoxChanged(int value);
+    void onViewDistanceChanged(int value);
+    void onViewDistanceBoxChanged(int value);
+    void onAutoViewDistanceChanged();
+    void onRealtimeViewDistanceChanged(int chunks);
     void onMovementSpeedChanged(int value);
     void onMovementSpeedBoxChanged(double value);
     void onJumpHeightChanged(int value);
@@ -172,6 +188,8 @@ private slots:
     void onPlayPath();
     void onStopPath();
     void onClearPath();
+    void onSavePath();
+    void onLoadPath();
     void onPathDurationChanged(int value);
     void onPathDurationBoxChanged(double value);
     
@@ -206,6 +224,7 @@ private slots:
     void onParticlesEnabledChanged();
     void onDirtParticlesChanged();
     void onFogWispsChanged();
+    void onGpuParticlesChanged();
     void onDirtSpawnRateChanged(int value);
     void onDirtSpawnRateBoxChanged(double value);
     void onFogWispIntervalChanged(int value);
@@ -1,4 +1,6 @@
 #include "Chunk.h"
+#include "treearchetypes.h"
+#include <algorithm>
 
 Chunk::Chunk(int chunkX, int chunkZ, int chunkSize)
     : m_chunkX(chunkX)
@@ -15,9 +17,58 @@ Chunk::~Chunk() {
 
 void Chunk::addBlock(int worldX, int worldY, int worldZ, BiomeType biome) {
     m_blocks.push_back(std::make_tuple(worldX, worldY, worldZ, biome));
+    
+    int localX = worldX - m_chunkX * m_chunkSize;
+    int localZ = worldZ - m_chunkZ * m_chunkSize;
+    if (localX < 0 || localX >= m_chunkSize || localZ < 0 || localZ >= m_chunkSize) {
+        return;
+    }
+    if (m_columnY.empty()) {
+        m_columnY.assign(static_cast<size_t>(m_chunkSize) * m_chunkSize, EMPTY_COLUMN);
+        m_surfaceY.assign(static_cast<size_t>(m_chunkSize) * m_chunkSize, EMPTY_COLUMN);
+    }
+    int column = localZ * m_chunkSize + localX;
+    int& columnY = m_columnY[column];
+    if (columnY == EMPTY_COLUMN) {
+        columnY = worldY;
+    } else if (columnY != worldY) {
+        m_stackedBlocks.push_back(std::make_tuple(worldX, worldY, worldZ));
+    }
+    m_surfaceY[column] = std::max(m_surfaceY[column], worldY);
 }
 
-void Chunk::addTree(const Tree& tree) {
+bool Chunk::hasBlock(int worldX, int worldY, int worldZ) const {
+    int localX = worldX - m_chunkX * m_chunkSize;
+    int localZ = worldZ - m_chunkZ * m_chunkSize;
+    if (m_columnY.empty() || localX < 0 || localX >= m_chunkSize || localZ < 0 || localZ >= m_chunkSize) {
+        return false;
+    }
+    if (m_columnY[localZ * m_chunkSize + localX] == worldY) {
+        return true;
+    }
+    for (const auto& block : m_stackedBlocks) {
+        if (block == std::make_tuple(worldX, worldY, worldZ)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Chunk::getSurfaceHeight(int worldX, int worldZ, int& height) const {
+    int localX = worldX - m_chunkX * m_chunkSize;
+    int localZ = worldZ - m_chunkZ * m_chunkSize;
+    if (m_surfaceY.empty() || localX < 0 || localX >= m_chunkSize || localZ < 0 || localZ >= m_chunkSize) {
+        return false;
+    }
+    int surfaceY = m_surfaceY[localZ * m_chunkSize + localX];
+    if (surfaceY == EMPTY_COLUMN) {
+        return false;
+    }
+    height = surfaceY;
+    return true;
+}
+
+void Chunk::addTree(const TreeInstance& tree) {
     m_trees.push_back(tree);
 }
 
@@ -25,9 +76,30 @@ void Chunk::addCompletionCube(const CompletionCube& completionCube) {
     m_completionCubes.push_back(completionCube);
 }
 
+void Chunk::buildTrunkColliders() {
+    std::vector<TrunkCollider> trunks;
+    const std::vector<TreeArchetype>& archetypes = TreeArchetypes::get();
+    trunks.reserve(m_trees.size());
+    for (const TreeInstance& tree : m_trees) {
+        //just the trunk, branches are too high up and too thin to walk into
+        const TreeArchetype& archetype = archetypes[tree.archetype];
+        TrunkCollider trunk;
+        trunk.center = glm::vec2(tree.position.x, tree.position.z);
+        trunk.radius = std::min(archetype.trunkRadius * tree.scale, TrunkColliders::MAX_RADIUS);
+        trunk.minY = tree.position.y;
+        trunk.maxY = tree.position.y + archetype.trunkHeight * tree.scale;
+        trunks.push_back(trunk);
+    }
+    m_trunkColliders.build(m_chunkX * m_chunkSize, m_chunkZ * m_chunkSize, m_chunkSize, std::move(trunks));
+}
+
 void Chunk::clear() {
     m_blocks.clear();
+    m_columnY.clear();
+    m_stackedBlocks.clear();
+    m_surfaceY.clear();
     m_trees.clear();
+    m_trunkColliders.clear();
     m_completionCubes.clear();
     m_populated = false;
 }
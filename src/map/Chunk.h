@@ -2,9 +2,11 @@
 
 #include <vector>
 #include <tuple>
+#include <climits>
 #include "mapproperties.h"
 #include "Tree.h"
 #include "CompletionCube.h"
+#include "TrunkColliders.h"
 
 class Chunk {
 public:
@@ -19,12 +21,19 @@ public:
     void setPopulated(bool populated) { m_populated = populated; }
     
     const std::vector<std::tuple<int, int, int, BiomeType>>& getBlocks() const { return m_blocks; }
-    const std::vector<Tree>& getTrees() const { return m_trees; }
+    // O(1) for blocks inside this chunk's footprint, anything outside it is never found
+    bool hasBlock(int worldX, int worldY, int worldZ) const;
+    // y of the highest block in the column in O(1), false if the column is empty or outside this chunk
+    bool getSurfaceHeight(int worldX, int worldZ, int& height) const;
+    const std::vector<TreeInstance>& getTrees() const { return m_trees; }
+    const TrunkColliders& getTrunkColliders() const { return m_trunkColliders; }
     const std::vector<CompletionCube>& getCompletionCubes() const { return m_completionCubes; }
     std::vector<CompletionCube>& getCompletionCubesMutable() { return m_completionCubes; }
     
     void addBlock(int worldX, int worldY, int worldZ, BiomeType biome);
-    void addTree(const Tree& tree);
+    void addTree(const TreeInstance& tree);
+    // Rebuilds the trunk collider grid from the trees, once they've all been added
+    void buildTrunkColliders();
     void addCompletionCube(const CompletionCube& completionCube);
     void clear();
 
@@ -34,8 +43,17 @@ private:
     int m_chunkSize;
     bool m_populated;
     
+    static constexpr int EMPTY_COLUMN = INT_MIN;
+    
     std::vector<std::tuple<int, int, int, BiomeType>> m_blocks;
-    std::vector<Tree> m_trees;
+    // y of the block in each column (z * chunkSize + x), the generator only ever puts one block per column.
+    // a second block landing in an already used column goes to m_stackedBlocks and gets scanned
+    std::vector<int> m_columnY;
+    std::vector<std::tuple<int, int, int>> m_stackedBlocks;
+    // highest block per column, same layout as m_columnY, kept up to date by addBlock
+    std::vector<int> m_surfaceY;
+    std::vector<TreeInstance> m_trees;
+    TrunkColliders m_trunkColliders;
     std::vector<CompletionCube> m_completionCubes;
 };
 
@@ -0,0 +1,175 @@
+#include "FlowField.h"
+#include "Map.h"
+#include <chrono>
+#include <cmath>
+
+namespace {
+    //straight neighbours first so ties prefer them, opposite directions sit in pairs (n ^ 1 flips one)
+    const int NEIGHBOUR_X[8] = {1, -1, 0, 0, 1, -1, 1, -1};
+    const int NEIGHBOUR_Z[8] = {0, 0, 1, -1, 1, -1, -1, 1};
+}
+
+FlowField::FlowField()
+    : m_originX(0)
+    , m_originZ(0)
+    , m_targetX(0)
+    , m_targetZ(0)
+    , m_chunkRevision(-1)
+    , m_valid(false)
+{
+    m_heights.assign(SIZE * SIZE, NO_GROUND);
+    m_scratchHeights.assign(SIZE * SIZE, NO_GROUND);
+    m_distance.assign(SIZE * SIZE, UNREACHED);
+    m_step.assign(SIZE * SIZE, NO_STEP);
+    m_queue.reserve(SIZE * SIZE);
+}
+
+void FlowField::clear() {
+    m_valid = false;
+    m_chunkRevision = -1;
+}
+
+void FlowField::update(const Map* map, const glm::vec3& target) {
+    if (map == nullptr) {
+        clear();
+        return;
+    }
+
+    int targetX = static_cast<int>(std::floor(target.x));
+    int targetZ = static_cast<int>(std::floor(target.z));
+    int revision = map->getChunkRevision();
+    if (m_valid && targetX == m_targetX && targetZ == m_targetZ && revision == m_chunkRevision) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    //new chunks can show up anywhere in the window, only a pure slide can reuse what was read
+    bool keepOverlap = m_valid && revision == m_chunkRevision;
+    bool targetMoved = !m_valid || targetX != m_targetX || targetZ != m_targetZ;
+    bool heightsChanged = refreshHeights(map, targetX - RADIUS, targetZ - RADIUS, keepOverlap);
+    m_chunkRevision = revision;
+    //most chunk changes happen at the edge of the view distance, well outside the window. a moved target
+    //changes every distance though, so that one always searches the whole window again
+    if (!targetMoved && !heightsChanged) {
+        m_stats.unchanged++;
+        return;
+    }
+    m_targetX = targetX;
+    m_targetZ = targetZ;
+    search();
+    m_valid = true;
+
+    float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_stats.builds++;
+    m_stats.lastMs = ms;
+    m_stats.maxMs = std::max(m_stats.maxMs, ms);
+    m_stats.totalMs += ms;
+}
+
+bool FlowField::refreshHeights(const Map* map, int originX, int originZ, bool keepOverlap) {
+    int shiftX = originX - m_originX;
+    int shiftZ = originZ - m_originZ;
+    bool changed = !m_valid || shiftX != 0 || shiftZ != 0;
+    const Chunk* chunk = nullptr;
+
+    //row major so consecutive reads stay in one chunk and hit the cached pointer
+    for (int localZ = 0; localZ < SIZE; localZ++) {
+        int oldZ = localZ + shiftZ;
+        bool rowOverlaps = keepOverlap && oldZ >= 0 && oldZ < SIZE;
+        for (int localX = 0; localX < SIZE; localX++) {
+            int oldX = localX + shiftX;
+            int& height = m_scratchHeights[index(localX, localZ)];
+            if (rowOverlaps && oldX >= 0 && oldX < SIZE) {
+                height = m_heights[index(oldX, oldZ)];
+            } else if (!map->getColumnHeight(originX + localX, originZ + localZ, height, chunk)) {
+                height = NO_GROUND;
+            }
+            changed = changed || height != m_heights[index(localX, localZ)];
+        }
+    }
+
+    m_heights.swap(m_scratchHeights);
+    m_originX = originX;
+    m_originZ = originZ;
+    return changed;
+}
+
+bool FlowField::canStep(int fromIndex, int toIndex) const {
+    int fromHeight = m_heights[fromIndex];
+    int toHeight = m_heights[toIndex];
+    return fromHeight != NO_GROUND && toHeight != NO_GROUND && toHeight - fromHeight <= MAX_STEP_UP;
+}
+
+void FlowField::search() {
+    std::fill(m_distance.begin(), m_distance.end(), UNREACHED);
+    std::fill(m_step.begin(), m_step.end(), NO_STEP);
+    m_queue.clear();
+
+    int targetIndex = index(RADIUS, RADIUS);
+    if (m_heights[targetIndex] == NO_GROUND) {
+        return;
+    }
+    m_distance[targetIndex] = 0;
+    m_queue.push_back(targetIndex);
+
+    //bfs outward from the target, edges are checked in the direction an enemy would walk them (neighbour -> current)
+    for (size_t head = 0; head < m_queue.size(); head++) {
+        int current = m_queue[head];
+        int currentX = current % SIZE;
+        int currentZ = current / SIZE;
+
+        for (int n = 0; n < 8; n++) {
+            int neighbourX = currentX + NEIGHBOUR_X[n];
+            int neighbourZ = currentZ + NEIGHBOUR_Z[n];
+            if (neighbourX < 0 || neighbourX >= SIZE || neighbourZ < 0 || neighbourZ >= SIZE) {
+                continue;
+            }
+            int neighbour = index(neighbourX, neighbourZ);
+            if (m_distance[neighbour] != UNREACHED || !canStep(neighbour, current)) {
+                continue;
+            }
+            //diagonals only if both cells beside the corner are walkable too, otherwise they cut through a wall
+            if (n >= 4 && (!canStep(neighbour, index(currentX, neighbourZ)) ||
+                           !canStep(neighbour, index(neighbourX, currentZ)))) {
+                continue;
+            }
+
+            m_distance[neighbour] = static_cast<uint16_t>(m_distance[current] + 1);
+            //walking back the way the search came, the reverse of neighbour n is n ^ 1
+            m_step[neighbour] = static_cast<uint8_t>(n ^ 1);
+            m_queue.push_back(neighbour);
+        }
+    }
+}
+
+FlowField::Step FlowField::sample(const glm::vec3& position) const {
+    Step result;
+    if (!m_valid) {
+        return result;
+    }
+
+    int localX = static_cast<int>(std::floor(position.x)) - m_originX;
+    int localZ = static_cast<int>(std::floor(position.z)) - m_originZ;
+    if (localX < 0 || localX >= SIZE || localZ < 0 || localZ >= SIZE) {
+        return result;
+    }
+    int current = index(localX, localZ);
+    uint8_t step = m_step[current];
+    if (step == NO_STEP) {
+        return result;
+    }
+
+    int nextX = localX + NEIGHBOUR_X[step];
+    int nextZ = localZ + NEIGHBOUR_Z[step];
+    //aim at the middle of the next cell so enemies dont slide along cell edges
+    glm::vec2 nextCenter(static_cast<float>(m_originX + nextX) + 0.5f, static_cast<float>(m_originZ + nextZ) + 0.5f);
+    glm::vec2 toNext = nextCenter - glm::vec2(position.x, position.z);
+    float length = glm::length(toNext);
+    if (length < 1e-4f) {
+        return result;
+    }
+    result.direction = toNext / length;
+    result.climb = m_heights[index(nextX, nextZ)] > m_heights[current];
+    return result;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+class Map;
+
+//one shared path toward the player for every enemy: a bfs over surface heights in a square window
+//around the target cell, each cell keeps the neighbour that is one step closer. enemies just look up
+//their cell, so following it is O(1) no matter how many of them there are
+class FlowField {
+public:
+    static constexpr int RADIUS = 48;          //cells each side of the target, spawn ring is ~33 out
+    static constexpr int MAX_STEP_UP = 1;      //blocks an enemy can jump up onto, drops are always fine
+
+    struct Step {
+        glm::vec2 direction = glm::vec2(0.0f);   //unit xz toward the next cell, zero = no path (steer straight)
+        bool climb = false;                      //next cell is higher, jump
+    };
+
+    struct Stats {
+        int builds = 0;
+        int unchanged = 0;      //chunk changes that left the window's heights as they were, no search needed
+        float lastMs = 0.0f;
+        float maxMs = 0.0f;
+        double totalMs = 0.0;
+    };
+
+    FlowField();
+
+    //rebuilds when the target moves to another cell. after chunks were loaded/unloaded it re-reads the window and
+    //only searches again if a height in it actually changed, otherwise does nothing
+    void update(const Map* map, const glm::vec3& target);
+    void clear();
+
+    Step sample(const glm::vec3& position) const;
+    const Stats& getStats() const { return m_stats; }
+
+private:
+    static constexpr int SIZE = RADIUS * 2 + 1;
+    static constexpr int NO_GROUND = INT_MIN;
+    static constexpr uint16_t UNREACHED = 0xFFFF;
+    static constexpr uint8_t NO_STEP = 0xFF;
+
+    int index(int localX, int localZ) const { return localZ * SIZE + localX; }
+    //heights for the window at origin, cells that were already read for the old origin are moved instead of re-read.
+    //false if the window stayed put and every height came back the same
+    bool refreshHeights(const Map* map, int originX, int originZ, bool keepOverlap);
+    void search();
+    bool canStep(int fromIndex, int toIndex) const;
+
+    int m_originX;          //world cell at local (0, 0)
+    int m_originZ;
+    int m_targetX;
+    int m_targetZ;
+    int m_chunkRevision;
+    bool m_valid;
+
+    std::vector<int> m_heights;
+    std::vector<int> m_scratchHeights;
+    std::vector<uint16_t> m_distance;
+    std::vector<uint8_t> m_step;        //index into the neighbour table, NO_STEP at the target / unreachable
+    std::vector<int> m_queue;
+
+    Stats m_stats;
+};
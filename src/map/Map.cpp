@@ -1,7 +1,9 @@
 #include "Map.h"
 #include "Chunk.h"
 #include "Tree.h"
+#include "treearchetypes.h"
 #include "CompletionCube.h"
+#include "utils/profiler.h"
 #include <algorithm>
 #include <cmath>
 #include <unordered_map>
@@ -11,6 +13,9 @@
 #include <iostream>
 #include <glm/gtc/noise.hpp>
 #include <random>
+#include <chrono>
+#include <memory>
+#include <mutex>
 
 Map::Map() 
     : m_width(0)
@@ -22,6 +27,9 @@ Map::Map()
     , m_chunkSize(16)
     , m_endlessMode(true)
     , m_initializedFromBuilder(false)
+    , m_generationTimeMs(0.0f)
+    , m_generatedChunkCount(0)
+    , m_chunkRevision(0)
 {
     // Initialize with default noise parameters
     m_noiseParams = MapBuilderParams();
@@ -59,6 +67,7 @@ void Map::clearChunks() {
         delete pair.second;
     }
     m_chunks.clear();
+    m_chunkRevision++;
 }
 
 void Map::initializeFromBuilder(const MapBuilder& builder) {
@@ -82,22 +91,37 @@ void Map::initializeFromBuilder(const MapBuilder& builder) {
         throw std::runtime_error("Map data size mismatch");
     }
     
-    // Store noise parameters from builder
-    m_noiseParams = builder.getParams();
-    
-    m_blocks.clear();
-    m_blockExists.clear();
-    clearChunks();
-    m_blockCount = 0;
-    
-    m_initializedFromBuilder = true;
-    m_endlessMode = false; // Disable endless mode when using builder data
-    
-    populateBlocks(builder);
-    populateChunks();
+    //build the whole thing into a scratch map first so the sim only waits for the swap, not the regeneration.
+    //this map is only ever written from the gui thread so reading its collected cubes without the lock is fine
+    Map staging;
+    staging.m_noiseParams = builder.getParams();
+    staging.m_initializedFromBuilder = true;
+    staging.m_endlessMode = false; // Disable endless mode when using builder data
+    std::copy(std::begin(m_collectedCompletionCubes), std::end(m_collectedCompletionCubes), staging.m_collectedCompletionCubes);
+    staging.populateBlocks(builder);
+    staging.populateChunks();
+    
+    {
+        std::unique_lock<std::shared_mutex> lock(m_chunkMutex);
+        m_noiseParams = staging.m_noiseParams;
+        m_blocks.swap(staging.m_blocks);
+        m_blockExists.swap(staging.m_blockExists);
+        m_chunks.swap(staging.m_chunks);
+        m_width = staging.m_width;
+        m_depth = staging.m_depth;
+        m_maxHeight = staging.m_maxHeight;
+        m_blockCount = staging.m_blockCount;
+        m_centerX = staging.m_centerX;
+        m_centerZ = staging.m_centerZ;
+        m_initializedFromBuilder = true;
+        m_endlessMode = false;
+        m_chunkRevision++;
+    }
+    //the old chunks went into staging and get deleted with it, after the lock is gone
 }
 
 void Map::setNoiseParams(const MapBuilderParams& params) {
+    std::unique_lock<std::shared_mutex> lock(m_chunkMutex);
     m_noiseParams = params;
     m_endlessMode = true;
     m_initializedFromBuilder = false;
@@ -251,17 +275,7 @@ bool Map::hasBlock(int x, int y, int z) const {
             return false;
         }
         
-        // Check if block exists in chunk
-        const auto& chunkBlocks = it->second->getBlocks();
-        for (const auto& block : chunkBlocks) {
-            int bx, by, bz;
-            BiomeType biome;
-            std::tie(bx, by, bz, biome) = block;
-            if (bx == x && by == y && bz == z) {
-                return true;
-            }
-        }
-        return false;
+        return it->second->hasBlock(x, y, z);
     }
     
     // Original logic for builder mode
@@ -303,6 +317,166 @@ bool Map::hasBlock(int x, int y, int z) const {
     return m_blockExists[arrayZSize][arrayIndexSize];
 }
 
+const Chunk* Map::findChunkCached(int x, int z, const Chunk*& chunk) const {
+    int chunkX = static_cast<int>(std::floor(static_cast<float>(x) / static_cast<float>(m_chunkSize)));
+    int chunkZ = static_cast<int>(std::floor(static_cast<float>(z) / static_cast<float>(m_chunkSize)));
+    if (chunk != nullptr && chunk->getChunkX() == chunkX && chunk->getChunkZ() == chunkZ) {
+        return chunk;
+    }
+    
+    chunk = nullptr;
+    int chunkKey;
+    try {
+        chunkKey = getChunkKey(chunkX, chunkZ);
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+    auto it = m_chunks.find(chunkKey);
+    if (it == m_chunks.end() || it->second == nullptr || !it->second->isPopulated()) {
+        return nullptr;
+    }
+    chunk = it->second;
+    return chunk;
+}
+
+bool Map::hasBlockCached(int x, int y, int z, const Chunk*& chunk) const {
+    if (!m_endlessMode || m_chunkSize <= 0) {
+        return hasBlock(x, y, z);
+    }
+    const Chunk* found = findChunkCached(x, z, chunk);
+    return found != nullptr && found->hasBlock(x, y, z);
+}
+
+bool Map::getColumnHeight(int x, int z, int& height, const Chunk*& chunk) const {
+    if (!m_endlessMode || m_chunkSize <= 0) {
+        return false;
+    }
+    const Chunk* found = findChunkCached(x, z, chunk);
+    return found != nullptr && found->getSurfaceHeight(x, z, height);
+}
+
+bool Map::getSurfaceHeight(int x, int z, int& height) const {
+    const Chunk* chunk = nullptr;
+    return getColumnHeight(x, z, height, chunk);
+}
+
+bool Map::getSurfaceHeight(float x, float z, float& groundY) const {
+    //column centres sit at +0.5, so the four around (x, z) start at floor(x - 0.5)
+    float fx = x - 0.5f;
+    float fz = z - 0.5f;
+    int x0 = static_cast<int>(std::floor(fx));
+    int z0 = static_cast<int>(std::floor(fz));
+    float tx = fx - static_cast<float>(x0);
+    float tz = fz - static_cast<float>(z0);
+    
+    const Chunk* chunk = nullptr;
+    float tops[4];
+    bool found[4];
+    int foundCount = 0;
+    for (int i = 0; i < 4; i++) {
+        int height = 0;
+        found[i] = getColumnHeight(x0 + (i & 1), z0 + (i >> 1), height, chunk);
+        tops[i] = static_cast<float>(height) + 1.0f;
+        foundCount += found[i];
+    }
+    if (foundCount == 0) {
+        return false;
+    }
+    //holes take the height of the column nearest the point that does exist
+    if (foundCount < 4) {
+        int nearest = (tx >= 0.5f ? 1 : 0) + (tz >= 0.5f ? 2 : 0);
+        if (!found[nearest]) {
+            for (int i = 0; i < 4; i++) {
+                if (found[i]) {
+                    nearest = i;
+                    break;
+                }
+            }
+        }
+        for (int i = 0; i < 4; i++) {
+            if (!found[i]) {
+                tops[i] = tops[nearest];
+            }
+        }
+    }
+    float rowZ0 = tops[0] + (tops[1] - tops[0]) * tx;
+    float rowZ1 = tops[2] + (tops[3] - tops[2]) * tx;
+    groundY = rowZ0 + (rowZ1 - rowZ0) * tz;
+    return true;
+}
+
+RaycastHit Map::traceRay(const MapRay& ray, const Chunk*& chunk) const {
+    RaycastHit result;
+    float length = glm::length(ray.direction);
+    if (length < 1e-6f || !(ray.maxDistance > 0.0f)) {
+        return result;
+    }
+    glm::vec3 dir = ray.direction / length;
+    
+    glm::ivec3 cell(static_cast<int>(std::floor(ray.origin.x)),
+                    static_cast<int>(std::floor(ray.origin.y)),
+                    static_cast<int>(std::floor(ray.origin.z)));
+    
+    //tMax = distance to the next cell boundary on each axis, tDelta = distance between boundaries
+    glm::ivec3 step(0);
+    glm::vec3 tMax(std::numeric_limits<float>::infinity());
+    glm::vec3 tDelta(std::numeric_limits<float>::infinity());
+    for (int axis = 0; axis < 3; axis++) {
+        if (dir[axis] > 0.0f) {
+            step[axis] = 1;
+            tDelta[axis] = 1.0f / dir[axis];
+            tMax[axis] = (static_cast<float>(cell[axis] + 1) - ray.origin[axis]) * tDelta[axis];
+        } else if (dir[axis] < 0.0f) {
+            step[axis] = -1;
+            tDelta[axis] = -1.0f / dir[axis];
+            tMax[axis] = (ray.origin[axis] - static_cast<float>(cell[axis])) * tDelta[axis];
+        }
+    }
+    
+    if (hasBlockCached(cell.x, cell.y, cell.z, chunk)) {
+        result.hit = true;
+        result.block = cell;
+        return result;
+    }
+    
+    while (true) {
+        int axis = (tMax.x < tMax.y) ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+        float t = tMax[axis];
+        if (t > ray.maxDistance) {
+            break;
+        }
+        cell[axis] += step[axis];
+        tMax[axis] += tDelta[axis];
+        
+        if (hasBlockCached(cell.x, cell.y, cell.z, chunk)) {
+            result.hit = true;
+            result.block = cell;
+            result.normal[axis] = -step[axis];
+            result.distance = t;
+            break;
+        }
+    }
+    return result;
+}
+
+RaycastHit Map::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+    const Chunk* chunk = nullptr;
+    MapRay ray;
+    ray.origin = origin;
+    ray.direction = direction;
+    ray.maxDistance = maxDistance;
+    return traceRay(ray, chunk);
+}
+
+void Map::raycastBatch(const std::vector<MapRay>& rays, std::vector<RaycastHit>& hits) const {
+    hits.resize(rays.size());
+    //the chunk cache carries over between rays, so a fan of rays from one origin mostly skips the chunk lookup
+    const Chunk* chunk = nullptr;
+    for (size_t i = 0; i < rays.size(); i++) {
+        hits[i] = traceRay(rays[i], chunk);
+    }
+}
+
 BiomeType Map::getBiomeAt(int x, int z) const {
     // In endless mode, check chunks or generate biome from noise
     if (m_endlessMode) {
@@ -621,19 +795,15 @@ void Map::populateChunks() {
             float treeBaseY = static_cast<float>(blockY) + 0.5f;
             glm::vec3 basePos(static_cast<float>(x), treeBaseY, static_cast<float>(z));
             
-            //TEMPORARY single cylinder tree - tall stump for smoke effect
-            Tree tree(basePos);
-            float treeHeight = 25.0f; // Much taller
-            float treeRadius = 0.5f;
-            glm::vec3 treeCenter = basePos + glm::vec3(0.0f, treeHeight / 2.0f, 0.0f);
-            TreePieceData trunk(treeCenter, glm::vec3(0.0f), glm::vec3(treeRadius * 2.0f, 1.0f, treeRadius * 2.0f));
-            tree.addPiece(trunk);
-            
-            it->second->addTree(tree);
+            it->second->addTree(TreeArchetypes::place(basePos, static_cast<uint32_t>(m_noiseParams.seed)));
             chunkTreePositions[chunkKeyPair].push_back({x, z});
         }
     }
     
+    for (auto& chunkPair : m_chunks) {
+        chunkPair.second->buildTrunkColliders();
+    }
+    
     int totalTrees = 0;
     for (const auto& chunkPair : m_chunks) {
         totalTrees += chunkPair.second->getTrees().size();
@@ -806,6 +976,7 @@ float Map::sampleBiomeNoise(float x, float y) const {
 }
 
 void Map::generateChunk(int chunkX, int chunkZ) {
+    PROFILE_SCOPE("Map generateChunk");
     int chunkKey;
     try {
         chunkKey = getChunkKey(chunkX, chunkZ);
@@ -818,29 +989,24 @@ void Map::generateChunk(int chunkX, int chunkZ) {
         return;
     }
     
-    Chunk* chunk = nullptr;
-    if (it == m_chunks.end()) {
-        try {
-            chunk = new Chunk(chunkX, chunkZ, m_chunkSize);
-            m_chunks[chunkKey] = chunk;
-        } catch (const std::bad_alloc&) {
-            return;
-        } catch (const std::exception&) {
-            return;
-        }
-    } else {
-        chunk = it->second;
-        chunk->clear();
-    }
-    
-    if (chunk == nullptr) {
+    //filled off to the side and swapped in at the end so other threads never see a half built chunk
+    std::unique_ptr<Chunk> chunk;
+    try {
+        chunk = std::make_unique<Chunk>(chunkX, chunkZ, m_chunkSize);
+    } catch (const std::bad_alloc&) {
+        return;
+    } catch (const std::exception&) {
         return;
     }
     
+    auto generationStart = std::chrono::steady_clock::now();
+    
     int chunkStartX = chunkX * m_chunkSize;
     int chunkStartZ = chunkZ * m_chunkSize;
     
     int maxDimension = 200;
+    // biome of each column's surface block, read back below when placing cubes and trees
+    std::vector<BiomeType> columnBiomes(static_cast<size_t>(m_chunkSize) * m_chunkSize, BIOME_FIELD);
     
     for (int localZ = 0; localZ < m_chunkSize; localZ++) {
         for (int localX = 0; localX < m_chunkSize; localX++) {
@@ -920,17 +1086,7 @@ void Map::generateChunk(int chunkX, int chunkZ) {
             } catch (const std::exception&) {
                 continue;
             }
-        }
-    }
-    
-    std::map<std::pair<int, int>, std::pair<int, BiomeType>> terrainData;
-    for (const auto& block : chunk->getBlocks()) {
-        int bx, by, bz;
-        BiomeType bbiome;
-        std::tie(bx, by, bz, bbiome) = block;
-        auto key = std::make_pair(bx, bz);
-        if (terrainData.find(key) == terrainData.end() || by > terrainData[key].first) {
-            terrainData[key] = std::make_pair(by, bbiome);
+            columnBiomes[localZ * m_chunkSize + localX] = biome;
         }
     }
     
@@ -943,11 +1099,17 @@ void Map::generateChunk(int chunkX, int chunkZ) {
     int treesGenerated = 0;
     bool completionCubeSpawned[3] = {false, false, false}; // Track if completion cube spawned for each biome type
     
-    for (const auto& terrain : terrainData) {
-        int x = terrain.first.first;
-        int z = terrain.first.second;
-        int blockY = terrain.second.first;
-        BiomeType biome = terrain.second.second;
+    // x major like the sorted column map this used to build, so the same seed still places the same things
+    for (int column = 0; column < m_chunkSize * m_chunkSize; column++) {
+        int localX = column / m_chunkSize;
+        int localZ = column % m_chunkSize;
+        int x = chunkStartX + localX;
+        int z = chunkStartZ + localZ;
+        int blockY;
+        if (!chunk->getSurfaceHeight(x, z, blockY)) {
+            continue;
+        }
+        BiomeType biome = columnBiomes[localZ * m_chunkSize + localX];
         
         // Spawn completion cube (very low chance: 0.5%) - only if not already collected
         if (!hasCompletionCubeBeenCollected(biome) && !completionCubeSpawned[biome] && completionCubeDist(gen) < 0.0005f) { // 0.05% spawn rate (extremely rare)
@@ -981,22 +1143,33 @@ void Map::generateChunk(int chunkX, int chunkZ) {
             float treeBaseY = static_cast<float>(blockY) + 0.5f;
             glm::vec3 basePos(static_cast<float>(x), treeBaseY, static_cast<float>(z));
             
-            // Simple single cylinder tree
-            Tree tree(basePos);
-            float treeHeight = 25.0f;
-            float treeRadius = 0.5f;
-            glm::vec3 treeCenter = basePos + glm::vec3(0.0f, treeHeight / 2.0f, 0.0f);
-            TreePieceData trunk(treeCenter, glm::vec3(0.0f), glm::vec3(treeRadius * 2.0f, 1.0f, treeRadius * 2.0f));
-            tree.addPiece(trunk);
-            
-            chunk->addTree(tree);
+            // one of the baked l-system trees, picked and turned by where it stands
+            chunk->addTree(TreeArchetypes::place(basePos, static_cast<uint32_t>(m_noiseParams.seed)));
             treePositions.push_back({x, z});
             treesGenerated++;
         }
     }
     
     
+    chunk->buildTrunkColliders();
     chunk->setPopulated(true);
+    
+    {
+        std::unique_lock<std::shared_mutex> lock(m_chunkMutex);
+        Chunk*& slot = m_chunks[chunkKey];
+        delete slot;
+        slot = chunk.release();
+        m_chunkRevision++;
+    }
+    
+    m_generationTimeMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - generationStart).count();
+    m_generatedChunkCount++;
+}
+
+float Map::takeGenerationTime() {
+    float ms = m_generationTimeMs;
+    m_generationTimeMs = 0.0f;
+    return ms;
 }
 
 bool Map::hasCompletionCubeBeenCollected(BiomeType biome) const {
@@ -1012,7 +1185,23 @@ void Map::markCompletionCubeCollected(BiomeType biome) {
     }
 }
 
+void Map::removeCompletionCubes(BiomeType biome) {
+    markCompletionCubeCollected(biome);
+    
+    std::unique_lock<std::shared_mutex> lock(m_chunkMutex);
+    for (auto& pair : m_chunks) {
+        if (pair.second == nullptr || !pair.second->isPopulated()) {
+            continue;
+        }
+        auto& cubes = pair.second->getCompletionCubesMutable();
+        cubes.erase(std::remove_if(cubes.begin(), cubes.end(),
+                                   [biome](const CompletionCube& cube) { return cube.getBiome() == biome; }),
+                    cubes.end());
+    }
+}
+
 void Map::unloadDistantChunks(const glm::vec3& cameraPos, int keepDistance) {
+    PROFILE_SCOPE("Map unloadDistantChunks");
     if (m_chunkSize <= 0 || keepDistance < 0) {
         return;
     }
@@ -1050,6 +1239,11 @@ void Map::unloadDistantChunks(const glm::vec3& cameraPos, int keepDistance) {
         }
     }
     
+    if (chunksToRemove.empty()) {
+        return;
+    }
+    
+    std::unique_lock<std::shared_mutex> lock(m_chunkMutex);
     for (int key : chunksToRemove) {
         auto it = m_chunks.find(key);
         if (it != m_chunks.end()) {
@@ -1057,6 +1251,7 @@ void Map::unloadDistantChunks(const glm::vec3& cameraPos, int keepDistance) {
             m_chunks.erase(it);
         }
     }
+    m_chunkRevision++;
 }
 
 std::vector<std::tuple<int, int, int, BiomeType>> Map::getBlocksInRenderDistance(
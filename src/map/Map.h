@@ -1,13 +1,28 @@
 #pragma once
 
+#include <cmath>
 #include <vector>
 #include <tuple>
 #include <unordered_map>
+#include <shared_mutex>
 #include <glm/glm.hpp>
 #include "mapproperties.h"
 #include "mapbuilder.h"
 #include "Chunk.h"
 
+struct MapRay {
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);   //doesnt need to be normalized
+    float maxDistance = 0.0f;
+};
+
+struct RaycastHit {
+    bool hit = false;
+    glm::ivec3 block = glm::ivec3(0);
+    glm::ivec3 normal = glm::ivec3(0);   //face the ray came in through, zero if it started inside the block
+    float distance = 0.0f;               //along the normalized direction
+};
+
 class Map {
 public:
     Map();
@@ -27,6 +42,11 @@ public:
     bool hasBlock(int x, int y, int z) const;
     BiomeType getBiomeAt(int x, int z) const;
     
+    // First block along the ray (Amanatides-Woo voxel walk), visits every cell the ray touches exactly once
+    RaycastHit raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+    // Same for many rays, hits is resized to match. Rays fired from the same spot share chunk lookups
+    void raycastBatch(const std::vector<MapRay>& rays, std::vector<RaycastHit>& hits) const;
+    
     std::vector<std::tuple<int, int, int, BiomeType>> getBlocksToRender() const;
     std::vector<std::tuple<int, int, int, BiomeType>> getBlocksInRenderDistance(
         const glm::vec3& cameraPos, int renderDistance);
@@ -40,11 +60,37 @@ public:
     
     const std::unordered_map<int, Chunk*>& getChunks() const { return m_chunks; }
     
+    // The gui thread is the only one that adds/removes chunks and takes this exclusively when it does,
+    // other threads (the simulation) hold it shared for as long as they read blocks/chunks
+    std::shared_mutex& getChunkMutex() const { return m_chunkMutex; }
+    
     void ensureChunkGenerated(int chunkX, int chunkZ);
     
+    // Time spent generating chunks since the last call (ms), resets the counter
+    float takeGenerationTime();
+    // Total chunks generated since the map was created (unloaded + regenerated ones count again)
+    int getGeneratedChunkCount() const { return m_generatedChunkCount; }
+    // Bumped whenever a chunk is added or removed, for caches built from chunk data
+    int getChunkRevision() const { return m_chunkRevision; }
+    // Top block of a resident column in O(1), false if that chunk isn't loaded.
+    // chunk is a lookup cache the caller keeps between calls (start it at nullptr)
+    bool getColumnHeight(int x, int z, int& height, const Chunk*& chunk) const;
+    // Same for a one-off lookup: y of the highest block in column (x, z)
+    bool getSurfaceHeight(int x, int z, int& height) const;
+    // Walkable ground under a point: the top face of the surface blocks, bilinear between the four
+    // nearest column centres so it slopes smoothly over steps. Missing columns borrow the nearest one,
+    // false if none of the four are loaded
+    bool getSurfaceHeight(float x, float z, float& groundY) const;
+    // Tree trunks whose collider cells overlap [min, max] on xz, from the chunks around that rect.
+    // Callers hold the chunk lock like for any other chunk read
+    template <typename Visit>
+    void forEachTrunk(const glm::vec2& min, const glm::vec2& max, Visit&& visit) const;
+    
     // Biome orb collection tracking
     bool hasCompletionCubeBeenCollected(BiomeType biome) const;
     void markCompletionCubeCollected(BiomeType biome);
+    // Marks the biome collected and drops its cubes from every loaded chunk
+    void removeCompletionCubes(BiomeType biome);
 
 private:
     void populateBlocks(const MapBuilder& builder);
@@ -57,6 +103,11 @@ private:
     // Chunk management
     void unloadDistantChunks(const glm::vec3& cameraPos, int keepDistance);
     
+    // hasBlock that keeps the chunk it last looked in, a ray spends many cells in one chunk
+    bool hasBlockCached(int x, int y, int z, const Chunk*& chunk) const;
+    const Chunk* findChunkCached(int x, int z, const Chunk*& chunk) const;
+    RaycastHit traceRay(const MapRay& ray, const Chunk*& chunk) const;
+    
     std::vector<std::vector<BiomeType>> m_blocks;
     std::vector<std::vector<bool>> m_blockExists;
     
@@ -70,11 +121,15 @@ private:
     
     int m_chunkSize;
     std::unordered_map<int, Chunk*> m_chunks;
+    mutable std::shared_mutex m_chunkMutex;
     
     // Noise parameters for procedural generation
     MapBuilderParams m_noiseParams;
     bool m_endlessMode;
     bool m_initializedFromBuilder;
+    float m_generationTimeMs;
+    int m_generatedChunkCount;
+    int m_chunkRevision;
     
     int getChunkKey(int chunkX, int chunkZ) const;
     void populateChunks();
@@ -84,3 +139,24 @@ private:
     bool m_collectedCompletionCubes[3]; // Indexed by BiomeType
 };
 
+template <typename Visit>
+void Map::forEachTrunk(const glm::vec2& min, const glm::vec2& max, Visit&& visit) const {
+    if (m_chunkSize <= 0) {
+        return;
+    }
+    //a trunk near a chunk edge can stick over into the next one
+    float size = static_cast<float>(m_chunkSize);
+    int minChunkX = static_cast<int>(std::floor((min.x - TrunkColliders::MAX_RADIUS) / size));
+    int maxChunkX = static_cast<int>(std::floor((max.x + TrunkColliders::MAX_RADIUS) / size));
+    int minChunkZ = static_cast<int>(std::floor((min.y - TrunkColliders::MAX_RADIUS) / size));
+    int maxChunkZ = static_cast<int>(std::floor((max.y + TrunkColliders::MAX_RADIUS) / size));
+    for (int chunkZ = minChunkZ; chunkZ <= maxChunkZ; chunkZ++) {
+        for (int chunkX = minChunkX; chunkX <= maxChunkX; chunkX++) {
+            auto it = m_chunks.find(chunkX * 10000 + chunkZ);
+            if (it == m_chunks.end() || it->second == nullptr || !it->second->isPopulated()) {
+                continue;
+            }
+            it->second->getTrunkColliders().forEachInRect(min, max, visit);
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
 
 struct TreePieceData {
@@ -28,5 +29,11 @@ private:
     glm::vec3 basePosition;
 };
 
-
-
+//a tree placed in a chunk, all it keeps is which TreeArchetypes mesh it is and how that's placed.
+//position is the base of the trunk, yaw turns it about y (radians), scale is uniform
+struct TreeInstance {
+    glm::vec3 position;
+    float yaw;
+    float scale;
+    uint16_t archetype;
+};
@@ -0,0 +1,41 @@
+#include "TrunkColliders.h"
+#include <cmath>
+
+void TrunkColliders::build(int originX, int originZ, int chunkSize, std::vector<TrunkCollider> trunks) {
+    m_originX = originX;
+    m_originZ = originZ;
+    m_cellsPerSide = std::max(1, (chunkSize + CELL_SIZE - 1) / CELL_SIZE);
+    m_trunks = std::move(trunks);
+
+    //counting sort: count per cell, prefix sum, then fill
+    size_t cellCount = static_cast<size_t>(m_cellsPerSide) * m_cellsPerSide;
+    m_cellStart.assign(cellCount + 1, 0);
+    auto forEachCell = [this](const TrunkCollider& trunk, auto&& fn) {
+        int minX = cellOf(trunk.center.x - trunk.radius, m_originX);
+        int maxX = cellOf(trunk.center.x + trunk.radius, m_originX);
+        int minZ = cellOf(trunk.center.y - trunk.radius, m_originZ);
+        int maxZ = cellOf(trunk.center.y + trunk.radius, m_originZ);
+        for (int cz = minZ; cz <= maxZ; cz++) {
+            for (int cx = minX; cx <= maxX; cx++) {
+                fn(cz * m_cellsPerSide + cx);
+            }
+        }
+    };
+    for (const TrunkCollider& trunk : m_trunks) {
+        forEachCell(trunk, [this](int cell) { m_cellStart[cell + 1]++; });
+    }
+    for (size_t c = 1; c < m_cellStart.size(); c++) {
+        m_cellStart[c] += m_cellStart[c - 1];
+    }
+    m_cellItems.resize(m_cellStart.back());
+    std::vector<uint32_t> cursor(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (uint32_t t = 0; t < m_trunks.size(); t++) {
+        forEachCell(m_trunks[t], [&](int cell) { m_cellItems[cursor[cell]++] = t; });
+    }
+}
+
+void TrunkColliders::clear() {
+    m_trunks.clear();
+    m_cellStart.clear();
+    m_cellItems.clear();
+}
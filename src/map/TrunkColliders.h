@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+//vertical cylinder, what a tree trunk looks like to the collision code
+struct TrunkCollider {
+    glm::vec2 center;   //xz
+    float radius;
+    float minY;
+    float maxY;
+};
+
+//a chunk's trunks bucketed into CELL_SIZE squares on xz, built once when the chunk is generated and never
+//touched again. a trunk goes into every cell its bounds touch, so a query only walks the cells under its rect
+//and the cost depends on how many trunks are right there, not on how many the chunk has
+class TrunkColliders {
+public:
+    static constexpr int CELL_SIZE = 4;
+    //generous upper bound on a trunk's radius, neighbouring chunks are searched this far out
+    static constexpr float MAX_RADIUS = 1.0f;
+
+    void build(int originX, int originZ, int chunkSize, std::vector<TrunkCollider> trunks);
+    void clear();
+    bool empty() const { return m_trunks.empty(); }
+
+    //calls visit(trunk) for the trunks whose cells overlap [min, max] on xz. one crossing a cell border
+    //can come up twice, the collision code only takes minimums so that doesn't matter
+    template <typename Visit>
+    void forEachInRect(const glm::vec2& min, const glm::vec2& max, Visit&& visit) const {
+        if (m_trunks.empty()) {
+            return;
+        }
+        int minX = cellOf(min.x, m_originX);
+        int maxX = cellOf(max.x, m_originX);
+        int minZ = cellOf(min.y, m_originZ);
+        int maxZ = cellOf(max.y, m_originZ);
+        for (int cz = minZ; cz <= maxZ; cz++) {
+            for (int cx = minX; cx <= maxX; cx++) {
+                int cell = cz * m_cellsPerSide + cx;
+                for (uint32_t i = m_cellStart[cell]; i < m_cellStart[cell + 1]; i++) {
+                    visit(m_trunks[m_cellItems[i]]);
+                }
+            }
+        }
+    }
+
+private:
+    //clamped, anything off the edge of the chunk lands in the border cells
+    int cellOf(float v, int origin) const {
+        int cell = static_cast<int>(std::floor((v - static_cast<float>(origin)) / CELL_SIZE));
+        return std::clamp(cell, 0, m_cellsPerSide - 1);
+    }
+
+    int m_originX = 0;
+    int m_originZ = 0;
+    int m_cellsPerSide = 1;
+    std::vector<TrunkCollider> m_trunks;
+    std::vector<uint32_t> m_cellStart;     //cellsPerSide^2 + 1 offsets into m_cellItems
+    std::vector<uint32_t> m_cellItems;     //indices into m_trunks
+};
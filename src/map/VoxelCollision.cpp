@@ -0,0 +1,235 @@
+#include "VoxelCollision.h"
+#include "Map.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    //shrinks the perpendicular span a bit so a box resting exactly on a cell boundary doesnt pick up the neighbour
+    const float INSET = VoxelCollision::SKIN * 0.5f;
+
+    int cellOf(float v) {
+        return static_cast<int>(std::floor(v));
+    }
+
+    //xz distance from a trunk's axis to the closest point of the box footprint, 0 when the axis is inside it
+    float footprintDistance(const TrunkCollider& trunk, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+        float dx = std::max(std::max(boxMin.x - trunk.center.x, trunk.center.x - boxMax.x), 0.0f);
+        float dz = std::max(std::max(boxMin.z - trunk.center.y, trunk.center.y - boxMax.z), 0.0f);
+        return std::sqrt(dx * dx + dz * dz);
+    }
+}
+
+float VoxelCollision::clipAgainstTrunks(const Map* map, int axis, const glm::vec3& boxMin, const glm::vec3& boxMax,
+                                        float distance, bool& hit) {
+    if (distance == 0.0f) {
+        return distance;
+    }
+    //only the trunks under the swept footprint
+    glm::vec2 rectMin(boxMin.x, boxMin.z);
+    glm::vec2 rectMax(boxMax.x, boxMax.z);
+    if (axis == 0) {
+        rectMin.x += std::min(distance, 0.0f);
+        rectMax.x += std::max(distance, 0.0f);
+    } else if (axis == 2) {
+        rectMin.y += std::min(distance, 0.0f);
+        rectMax.y += std::max(distance, 0.0f);
+    }
+
+    float moved = distance;
+    map->forEachTrunk(rectMin, rectMax, [&](const TrunkCollider& trunk) {
+        if (axis == 1) {
+            //caps: land on the top or bump the bottom, only if the footprint is over the circle
+            if (footprintDistance(trunk, boxMin, boxMax) >= trunk.radius - INSET) {
+                return;
+            }
+            if (moved < 0.0f && boxMin.y >= trunk.maxY - SKIN) {
+                float limit = std::min(trunk.maxY - boxMin.y + SKIN, 0.0f);
+                if (limit > moved) {
+                    moved = limit;
+                    hit = true;
+                }
+            } else if (moved > 0.0f && boxMax.y <= trunk.minY + SKIN) {
+                float limit = std::max(trunk.minY - boxMax.y - SKIN, 0.0f);
+                if (limit < moved) {
+                    moved = limit;
+                    hit = true;
+                }
+            }
+            return;
+        }
+        if (trunk.minY >= boxMax.y - INSET || trunk.maxY <= boxMin.y + INSET) {
+            return;
+        }
+        //sideways: the circle is as wide as its chord at the box's nearest edge on the other axis
+        int other = 2 - axis;
+        float center = axis == 0 ? trunk.center.x : trunk.center.y;
+        float otherCenter = axis == 0 ? trunk.center.y : trunk.center.x;
+        float gap = std::max(std::max(boxMin[other] - otherCenter, otherCenter - boxMax[other]), 0.0f);
+        if (gap >= trunk.radius - INSET) {
+            return;
+        }
+        float halfChord = std::sqrt(trunk.radius * trunk.radius - gap * gap);
+        //already inside it (spawned there, tree grew in) just lets the box walk back out
+        if (moved > 0.0f && boxMax[axis] <= center - halfChord + SKIN) {
+            float limit = std::max(center - halfChord - boxMax[axis] - SKIN, 0.0f);
+            if (limit < moved) {
+                moved = limit;
+                hit = true;
+            }
+        } else if (moved < 0.0f && boxMin[axis] >= center + halfChord - SKIN) {
+            float limit = std::min(center + halfChord - boxMin[axis] + SKIN, 0.0f);
+            if (limit > moved) {
+                moved = limit;
+                hit = true;
+            }
+        }
+    });
+    return moved;
+}
+
+bool VoxelCollision::layerBlocked(const Map* map, int axis, int layer, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    int u = (axis + 1) % 3;
+    int v = (axis + 2) % 3;
+    int uMin = cellOf(boxMin[u] + INSET);
+    int uMax = cellOf(boxMax[u] - INSET);
+    int vMin = cellOf(boxMin[v] + INSET);
+    int vMax = cellOf(boxMax[v] - INSET);
+
+    int cell[3];
+    cell[axis] = layer;
+    for (int cu = uMin; cu <= uMax; cu++) {
+        cell[u] = cu;
+        for (int cv = vMin; cv <= vMax; cv++) {
+            cell[v] = cv;
+            if (map->hasBlock(cell[0], cell[1], cell[2])) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+float VoxelCollision::sweepAxis(const Map* map, int axis, const glm::vec3& boxMin, const glm::vec3& boxMax,
+                                float distance, bool& hit) {
+    hit = false;
+    if (distance > 0.0f) {
+        //walk the layers the max face enters, the first solid one is the time of impact
+        float face = boxMax[axis];
+        int first = cellOf(face - INSET) + 1;
+        int last = cellOf(face + distance - INSET);
+        for (int layer = first; layer <= last; layer++) {
+            if (layerBlocked(map, axis, layer, boxMin, boxMax)) {
+                hit = true;
+                return std::clamp(static_cast<float>(layer) - face - SKIN, 0.0f, distance);
+            }
+        }
+    } else if (distance < 0.0f) {
+        float face = boxMin[axis];
+        int first = cellOf(face + INSET) - 1;
+        int last = cellOf(face + distance + INSET);
+        for (int layer = first; layer >= last; layer--) {
+            if (layerBlocked(map, axis, layer, boxMin, boxMax)) {
+                hit = true;
+                return std::clamp(static_cast<float>(layer + 1) - face + SKIN, distance, 0.0f);
+            }
+        }
+    }
+    return distance;
+}
+
+SweepResult VoxelCollision::sweep(const Map* map, const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& delta) {
+    SweepResult result;
+    result.delta = glm::vec3(0.0f);
+    result.hit = glm::bvec3(false);
+    if (map == nullptr) {
+        result.delta = delta;
+        return result;
+    }
+
+    //y first so landing/ceilings get resolved before sliding along walls
+    const int order[3] = {1, 0, 2};
+    glm::vec3 min = boxMin;
+    glm::vec3 max = boxMax;
+    for (int axis : order) {
+        bool hit = false;
+        float moved = sweepAxis(map, axis, min, max, delta[axis], hit);
+        moved = clipAgainstTrunks(map, axis, min, max, moved, hit);
+        min[axis] += moved;
+        max[axis] += moved;
+        result.delta[axis] = moved;
+        result.hit[axis] = hit;
+    }
+    return result;
+}
+
+bool VoxelCollision::overlaps(const Map* map, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    if (map == nullptr) {
+        return false;
+    }
+    int yMin = cellOf(boxMin.y + INSET);
+    int yMax = cellOf(boxMax.y - INSET);
+    for (int y = yMin; y <= yMax; y++) {
+        if (layerBlocked(map, 1, y, boxMin, boxMax)) {
+            return true;
+        }
+    }
+    bool blocked = false;
+    map->forEachTrunk(glm::vec2(boxMin.x, boxMin.z), glm::vec2(boxMax.x, boxMax.z), [&](const TrunkCollider& trunk) {
+        if (trunk.minY < boxMax.y - INSET && trunk.maxY > boxMin.y + INSET &&
+            footprintDistance(trunk, boxMin, boxMax) < trunk.radius - INSET) {
+            blocked = true;
+        }
+    });
+    return blocked;
+}
+
+bool VoxelCollision::isSupported(const Map* map, const glm::vec3& boxMin, const glm::vec3& boxMax,
+                                 float probeDepth, float* groundY) {
+    if (map == nullptr) {
+        return false;
+    }
+    //a trunk top inside the probe holds the box up too, the highest thing underneath wins
+    float trunkTop = -INFINITY;
+    map->forEachTrunk(glm::vec2(boxMin.x, boxMin.z), glm::vec2(boxMax.x, boxMax.z), [&](const TrunkCollider& trunk) {
+        if (trunk.maxY <= boxMin.y + SKIN && trunk.maxY >= boxMin.y - probeDepth &&
+            footprintDistance(trunk, boxMin, boxMax) < trunk.radius - INSET) {
+            trunkTop = std::max(trunkTop, trunk.maxY);
+        }
+    });
+    bool onTrunk = trunkTop > -INFINITY;
+
+    int layer = cellOf(boxMin.y - probeDepth);
+    float top = static_cast<float>(layer + 1);
+    //the probe stayed inside the cell the feet are already in, nothing underneath within reach
+    if (top > boxMin.y + SKIN) {
+        if (onTrunk && groundY != nullptr) {
+            *groundY = trunkTop;
+        }
+        return onTrunk;
+    }
+    //terrain is one block per column, so the per-chunk surface heights answer this without probing cells.
+    //a column with no height data (builder map, chunk not in yet) sends it back to probing the layer
+    bool supported = false;
+    bool haveHeights = true;
+    const Chunk* chunk = nullptr;
+    for (int cz = cellOf(boxMin.z + INSET); cz <= cellOf(boxMax.z - INSET) && haveHeights; cz++) {
+        for (int cx = cellOf(boxMin.x + INSET); cx <= cellOf(boxMax.x - INSET); cx++) {
+            int height = 0;
+            if (!map->getColumnHeight(cx, cz, height, chunk)) {
+                haveHeights = false;
+                break;
+            }
+            supported = supported || height == layer;
+        }
+    }
+    if (!haveHeights) {
+        supported = layerBlocked(map, 1, layer, boxMin, boxMax);
+    }
+    if (!supported && !onTrunk) {
+        return false;
+    }
+    if (groundY != nullptr) {
+        *groundY = supported ? std::max(top, trunkTop) : trunkTop;
+    }
+    return true;
+}
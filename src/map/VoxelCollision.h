@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+class Map;
+
+struct SweepResult {
+    glm::vec3 delta;    //how far the box actually got
+    glm::bvec3 hit;     //axes that got clipped by a block
+};
+
+//swept aabb vs the block grid and tree trunks, shared by the player and enemies.
+//moves one axis at a time (y, x, z) and only looks at the cell layers the leading face crosses,
+//so a move costs (layers crossed) * (cells under the face) hasBlock calls and never allocates.
+//trunks are vertical cylinders from the chunks' collider cells, each axis move is clipped against the few under it
+class VoxelCollision {
+public:
+    //gap left between a box and the block it stopped against, keeps touching faces from counting as overlap
+    static constexpr float SKIN = 0.001f;
+
+    static SweepResult sweep(const Map* map, const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& delta);
+    static bool overlaps(const Map* map, const glm::vec3& boxMin, const glm::vec3& boxMax);
+
+    //true if a block or trunk top sits within probeDepth under the box, groundY gets the highest one.
+    //reads column heights where the map has them, so only surface blocks count there
+    static bool isSupported(const Map* map, const glm::vec3& boxMin, const glm::vec3& boxMax,
+                            float probeDepth, float* groundY = nullptr);
+
+private:
+    static float sweepAxis(const Map* map, int axis, const glm::vec3& boxMin, const glm::vec3& boxMax,
+                           float distance, bool& hit);
+    static float clipAgainstTrunks(const Map* map, int axis, const glm::vec3& boxMin, const glm::vec3& boxMax,
+                                   float distance, bool& hit);
+    static bool layerBlocked(const Map* map, int axis, int layer, const glm::vec3& boxMin, const glm::vec3& boxMax);
+};
@@ -1,29 +1,37 @@
 #include "terraintreegenerator.h"
-#include <random>
 #include <cmath>
-#include <memory>
 #include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
 
-static std::random_device rd;
-static std::mt19937 gen(rd());
-static std::uniform_real_distribution<float> angleDist(0.0f, 360.0f);
-static std::uniform_real_distribution<float> coneDist(0.0f, 1.0f);
-static std::uniform_int_distribution<int> branchCountDist(1, 3);
-
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-Tree TerrainTreeGenerator::generateTerrainTree(glm::vec3 basePosition) {
-    AxialTree lSystemTree = generateLSystemTree();
-    return convertAxialTreeToTreePieces(lSystemTree, basePosition);
+uint64_t TerrainTreeGenerator::seedAt(glm::vec3 basePosition, uint32_t worldSeed) {
+    //chained so (x, z) and (z, x) don't land on the same tree
+    uint32_t hash = FastRandom::hash(worldSeed);
+    hash = FastRandom::hash(hash ^ static_cast<uint32_t>(static_cast<int32_t>(std::floor(basePosition.x))));
+    hash = FastRandom::hash(hash ^ static_cast<uint32_t>(static_cast<int32_t>(std::floor(basePosition.y))));
+    hash = FastRandom::hash(hash ^ static_cast<uint32_t>(static_cast<int32_t>(std::floor(basePosition.z))));
+    return (static_cast<uint64_t>(hash) << 32) | FastRandom::hash(hash ^ 0x9e3779b9u);
 }
 
-AxialTree TerrainTreeGenerator::generateLSystemTree() {
-    AxialTree tree;
-    
-    generateTrunk(tree.rootBranch, TRUNK_HEIGHT, TRUNK_RADIUS);
+Tree TerrainTreeGenerator::generateTerrainTree(glm::vec3 basePosition, uint64_t seed) {
+    AxialTree lSystemTree;
+    return generateTerrainTree(basePosition, seed, lSystemTree);
+}
+
+Tree TerrainTreeGenerator::generateTerrainTree(glm::vec3 basePosition, uint64_t seed, AxialTree& scratch) {
+    scratch.clear();
+    FastRandom random(seed);
+    generateLSystemTree(scratch, random);
+    return convertAxialTreeToTreePieces(scratch, basePosition);
+}
+
+void TerrainTreeGenerator::generateLSystemTree(AxialTree& tree, FastRandom& random) {
+    //at most 3 layers x 3 branches x (1 + 3 + 3) segments over the trunk
+    tree.reserve(4 + 63, 64);
+    generateTrunk(tree, TRUNK_HEIGHT, TRUNK_RADIUS);
     
     float trunkSegmentLength = TRUNK_HEIGHT / 4.0f;
     glm::vec3 trunkDir(0.0f, 1.0f, 0.0f);
@@ -36,11 +44,13 @@ AxialTree TerrainTreeGenerator::generateLSystemTree() {
         float branchLength = TRUNK_HEIGHT * 0.4f * (1.0f - heightRatio * 0.5f);
         float branchRadius = TRUNK_RADIUS * 0.6f;
         
-        int numBranches = branchCountDist(gen);
+        int numBranches = randomBranchCount(random);
         for (int b = 0; b < numBranches; ++b) {
-            glm::vec3 branchDir = getRandomDirectionInCone(trunkDir, BRANCH_CONE_ANGLE);
+            glm::vec3 branchDir = getRandomDirectionInCone(random, trunkDir, BRANCH_CONE_ANGLE);
             
-            auto branchSegment = std::make_shared<Segment>(
+            //trunk segment i - 1 ends at this height
+            uint32_t branchSegment = tree.addSegment(
+                static_cast<uint32_t>(i - 1),
                 branchPoint,
                 branchDir,
                 branchLength,
@@ -50,38 +60,33 @@ AxialTree TerrainTreeGenerator::generateLSystemTree() {
                 true
             );
             
-            tree.rootBranch->mainAxis->addSegment(branchSegment);
-            
             if (TREE_DEPTH > 1) {
                 generateBranches(
-                    branchSegment->end,  // Start recursive branches where this branch ends
-                    branchDir,
-                    branchLength,
-                    branchRadius,
-                    1,
-                    tree.rootBranch
+                    tree,
+                    random,
+                    branchSegment,  // Start recursive branches where this branch ends
+                    1
                 );
             }
         }
     }
-    
-    tree.collectAllSegments();
-    return tree;
 }
 
-void TerrainTreeGenerator::generateTrunk(std::shared_ptr<Branch> rootBranch, float height, float radius) {
+void TerrainTreeGenerator::generateTrunk(AxialTree& tree, float height, float radius) {
     int trunkSegments = 4;
     float segmentLength = height / static_cast<float>(trunkSegments);
     glm::vec3 trunkStart(0.0f, 0.0f, 0.0f);
     glm::vec3 trunkDir(0.0f, 1.0f, 0.0f);
     
+    uint32_t trunkSegment = AxialTree::NO_INDEX;
     for (int i = 0; i < trunkSegments; ++i) {
         float heightRatio = static_cast<float>(i) / static_cast<float>(trunkSegments);
         float radiusReduction = 1.0f - (heightRatio * 0.3f);
         float currentRadius = radius * radiusReduction;
         currentRadius = glm::max(0.05f, currentRadius);
         
-        auto trunkSegment = std::make_shared<Segment>(
+        trunkSegment = tree.addSegment(
+            trunkSegment,
             trunkStart,
             trunkDir,
             segmentLength,
@@ -91,17 +96,20 @@ void TerrainTreeGenerator::generateTrunk(std::shared_ptr<Branch> rootBranch, flo
             false
         );
         
-        rootBranch->mainAxis->addSegment(trunkSegment);
-        trunkStart = trunkSegment->end;
+        trunkStart = tree.segments[trunkSegment].end;
     }
 }
 
-void TerrainTreeGenerator::generateBranches(glm::vec3 startPos, glm::vec3 parentDir,
-                                            float parentLength, float parentRadius,
-                                            int currentDepth, std::shared_ptr<Branch> parentBranch) {
+void TerrainTreeGenerator::generateBranches(AxialTree& tree, FastRandom& random, uint32_t parentSegment,
+                                            int currentDepth) {
     if (currentDepth >= TREE_DEPTH) {
         return;
     }
+    //copies, adding segments can move the array
+    glm::vec3 startPos = tree.segments[parentSegment].end;
+    glm::vec3 parentDir = tree.segments[parentSegment].direction;
+    float parentLength = tree.segments[parentSegment].length;
+    float parentRadius = tree.segments[parentSegment].radius;
     
     float depthLengthReduction = std::pow(BRANCH_LENGTH_REDUCTION, currentDepth);
     float depthRadiusReduction = std::pow(BRANCH_RADIUS_REDUCTION, currentDepth);
@@ -115,12 +123,13 @@ void TerrainTreeGenerator::generateBranches(glm::vec3 startPos, glm::vec3 parent
     branchLength = glm::max(0.3f, branchLength);
     branchRadius = glm::max(0.02f, branchRadius);
     
-    int numBranches = (currentDepth < TREE_DEPTH - 1) ? branchCountDist(gen) : 1;
+    int numBranches = (currentDepth < TREE_DEPTH - 1) ? randomBranchCount(random) : 1;
     
     for (int b = 0; b < numBranches; ++b) {
-        glm::vec3 branchDir = getRandomDirectionInCone(parentDir, BRANCH_CONE_ANGLE);
+        glm::vec3 branchDir = getRandomDirectionInCone(random, parentDir, BRANCH_CONE_ANGLE);
         
-        auto branchSegment = std::make_shared<Segment>(
+        uint32_t branchSegment = tree.addSegment(
+            parentSegment,
             startPos,
             branchDir,
             branchLength,
@@ -130,38 +139,40 @@ void TerrainTreeGenerator::generateBranches(glm::vec3 startPos, glm::vec3 parent
             true
         );
         
-        parentBranch->mainAxis->addSegment(branchSegment);
-        
         if (currentDepth + 1 < TREE_DEPTH) {
             generateBranches(
-                branchSegment->end,  // Start next branch where this one ends
-                branchDir,
-                branchLength,
-                branchRadius,
-                currentDepth + 1,
-                parentBranch
+                tree,
+                random,
+                branchSegment,  // Start next branch where this one ends
+                currentDepth + 1
             );
         }
     }
 }
 
-glm::vec3 TerrainTreeGenerator::getRandomDirectionInCone(glm::vec3 parentDir, float coneAngle) {
+int TerrainTreeGenerator::randomBranchCount(FastRandom& random) {
+    return 1 + static_cast<int>(random.next() % 3u);
+}
+
+glm::vec3 TerrainTreeGenerator::getRandomDirectionInCone(FastRandom& random, glm::vec3 parentDir, float coneAngle) {
     parentDir = glm::normalize(parentDir);
     float angleRad = glm::radians(coneAngle);
     
-    float u = coneDist(gen);
-    float v = angleDist(gen) * M_PI / 180.0f;
+    float u = random.nextFloat();
+    float v = random.range(0.0f, 360.0f) * M_PI / 180.0f;
     
     float theta = std::acos(1.0f - u * (1.0f - std::cos(angleRad)));
     float phi = v;
     
-    glm::vec3 perpAxis = glm::normalize(glm::cross(parentDir, glm::vec3(0.0f, 1.0f, 0.0f)));
+    //normalized after the checks, a straight up parent crosses to zero and that would normalize to nan
+    glm::vec3 perpAxis = glm::cross(parentDir, glm::vec3(0.0f, 1.0f, 0.0f));
     if (glm::length(perpAxis) < 0.001f) {
-        perpAxis = glm::normalize(glm::cross(parentDir, glm::vec3(1.0f, 0.0f, 0.0f)));
+        perpAxis = glm::cross(parentDir, glm::vec3(1.0f, 0.0f, 0.0f));
         if (glm::length(perpAxis) < 0.001f) {
             perpAxis = glm::vec3(1.0f, 0.0f, 0.0f);
         }
     }
+    perpAxis = glm::normalize(perpAxis);
     
     glm::vec3 upAxis = glm::normalize(glm::cross(perpAxis, parentDir));
     
@@ -211,13 +222,13 @@ glm::vec3 TerrainTreeGenerator::directionToRotation(glm::vec3 direction) {
 Tree TerrainTreeGenerator::convertAxialTreeToTreePieces(const AxialTree& tree, glm::vec3 basePosition) {
     Tree result(basePosition);
     
-    for (const auto& segment : tree.allSegments) {
-        glm::vec3 segmentCenter = (segment->start + segment->end) * 0.5f;
-        glm::vec3 segmentDir = segment->direction;
+    for (const Segment& segment : tree.segments) {
+        glm::vec3 segmentCenter = (segment.start + segment.end) * 0.5f;
+        glm::vec3 segmentDir = segment.direction;
         
         glm::vec3 position = basePosition + segmentCenter;
         glm::vec3 rotation = directionToRotation(segmentDir);
-        glm::vec3 scale(segment->radius * 2.0f, segment->length, segment->radius * 2.0f);
+        glm::vec3 scale(segment.radius * 2.0f, segment.length, segment.radius * 2.0f);
         
         TreePieceData piece(position, rotation, scale);
         result.addPiece(piece);
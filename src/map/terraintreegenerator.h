@@ -1,9 +1,10 @@
 #pragma once
 
 #include "lsystem/axialtree.h"
+#include "utils/fastrandom.h"
 #include "Tree.h"
 #include <glm/glm.hpp>
-#include <memory>
+#include <cstdint>
 
 class TerrainTreeGenerator {
 public:
@@ -14,16 +15,21 @@ public:
     static constexpr float BRANCH_RADIUS_REDUCTION = 0.7f;
     static constexpr float BRANCH_CONE_ANGLE = 90.0f;
     
-    static Tree generateTerrainTree(glm::vec3 basePosition);
+    //a seed for the tree standing at basePosition, same world seed and spot always gives the same tree
+    static uint64_t seedAt(glm::vec3 basePosition, uint32_t worldSeed);
+    //all randomness comes from seed and nothing is shared, so chunk workers can build trees side by side
+    static Tree generateTerrainTree(glm::vec3 basePosition, uint64_t seed);
+    //same, building the axial tree in scratch so its storage gets reused from tree to tree
+    static Tree generateTerrainTree(glm::vec3 basePosition, uint64_t seed, AxialTree& scratch);
     
 private:
-    static AxialTree generateLSystemTree();
-    static void generateTrunk(std::shared_ptr<Branch> rootBranch, float height, float radius);
-    static void generateBranches(glm::vec3 startPos, glm::vec3 parentDir, 
-                                 float parentLength, float parentRadius, 
-                                 int currentDepth, std::shared_ptr<Branch> parentBranch);
+    static void generateLSystemTree(AxialTree& tree, FastRandom& random);
+    static void generateTrunk(AxialTree& tree, float height, float radius);
+    static void generateBranches(AxialTree& tree, FastRandom& random, uint32_t parentSegment,
+                                 int currentDepth);
     static Tree convertAxialTreeToTreePieces(const AxialTree& tree, glm::vec3 basePosition);
-    static glm::vec3 getRandomDirectionInCone(glm::vec3 parentDir, float coneAngle);
+    static int randomBranchCount(FastRandom& random);     //1 to 3
+    static glm::vec3 getRandomDirectionInCone(FastRandom& random, glm::vec3 parentDir, float coneAngle);
     static glm::vec3 directionToRotation(glm::vec3 direction);
 };
 
@@ -0,0 +1,139 @@
+#include "treearchetypes.h"
+#include "terraintreegenerator.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+const std::vector<TreeArchetype>& TreeArchetypes::get() {
+    static const std::vector<TreeArchetype> archetypes = build();
+    return archetypes;
+}
+
+TreeInstance TreeArchetypes::place(glm::vec3 basePosition, uint32_t worldSeed) {
+    FastRandom random(TerrainTreeGenerator::seedAt(basePosition, worldSeed));
+    TreeInstance instance;
+    instance.position = basePosition;
+    instance.archetype = static_cast<uint16_t>(random.next() % static_cast<uint32_t>(count()));
+    instance.yaw = random.range(0.0f, 2.0f * static_cast<float>(M_PI));
+    instance.scale = random.range(0.85f, 1.15f);
+    return instance;
+}
+
+int TreeArchetypes::selectLods(float pixels, int lods[2], float fades[2]) {
+    const float THRESHOLDS[] = {FULL_MESH_PIXELS, IMPOSTOR_PIXELS};
+    for (int near = 0; near < TreeArchetype::LOD_COUNT - 1; near++) {
+        float threshold = THRESHOLDS[near];
+        if (pixels >= threshold * (1.0f + FADE_BAND)) {
+            lods[0] = near;
+            fades[0] = 1.0f;
+            return 1;
+        }
+        if (pixels > threshold) {
+            float fade = (pixels - threshold) / (threshold * FADE_BAND);
+            lods[0] = near;
+            fades[0] = fade;
+            lods[1] = near + 1;
+            fades[1] = fade - 1.0f;
+            return 2;
+        }
+    }
+    lods[0] = TreeArchetype::LOD_IMPOSTOR;
+    fades[0] = 1.0f;
+    return 1;
+}
+
+std::vector<TreeArchetype> TreeArchetypes::build() {
+    const TreeType TYPES[] = {TreeType::DEAD_PINE, TreeType::DEAD_OAK, TreeType::DEAD_BIRCH};
+    std::vector<TreeArchetype> archetypes;
+    AxialTree tree;
+    for (TreeType type : TYPES) {
+        for (int variant = 0; variant < VARIANTS_PER_TYPE; variant++) {
+            uint32_t seed = FastRandom::hash((static_cast<uint32_t>(type) << 8) | static_cast<uint32_t>(variant));
+            FastRandom random(seed);
+            TreeParameters params = variantParameters(type, random);
+            TreeGenerator::generateTree(params, random.next(), tree);
+
+            TreeArchetype archetype;
+            archetype.type = type;
+            archetype.segmentCount = static_cast<int>(tree.segments.size());
+            for (int lod = 0; lod < TreeArchetype::MESH_LOD_COUNT; lod++) {
+                bakeMesh(tree, lod, archetype.meshes[lod]);
+            }
+
+            float height = 0.0f;
+            float spread = 0.0f;
+            const std::vector<float>& full = archetype.meshes[TreeArchetype::LOD_FULL].vertexData;
+            for (size_t v = 0; v < full.size(); v += 14) {
+                height = std::max(height, full[v + 1]);
+                spread = std::max(spread, std::sqrt(full[v] * full[v] + full[v + 2] * full[v + 2]));
+            }
+            archetype.height = height;
+            archetype.impostorSize = std::max(height, 2.0f * spread) * 1.02f;
+
+            //branch 0 is the trunk
+            const Branch& trunk = tree.branches[0];
+            const Segment& top = tree.segments[trunk.firstSegment + trunk.segmentCount - 1];
+            archetype.trunkRadius = tree.segments[trunk.firstSegment].radius;
+            archetype.trunkHeight = top.end.y;
+            archetypes.push_back(std::move(archetype));
+        }
+    }
+    return archetypes;
+}
+
+TreeParameters TreeArchetypes::variantParameters(TreeType type, FastRandom& random) {
+    //sized like the old single cylinder trees, around 20 tall
+    TreeParameters params;
+    params.treeType = type;
+    params.branchAngle = 30.0f;
+    params.subBranchAngle = 45.0f;
+    switch (type) {
+        case TreeType::DEAD_OAK:
+            params.trunkLength = 16.0f;
+            params.trunkRadius = 0.55f;
+            params.branchLength = 6.0f;
+            params.numBranchLayers = 3;
+            params.branchesPerLayer = 4;
+            params.branchDepth = 4;
+            break;
+        case TreeType::DEAD_BIRCH:
+            params.trunkLength = 20.0f;
+            params.trunkRadius = 0.45f;
+            params.branchLength = 5.0f;
+            params.numBranchLayers = 4;
+            params.branchesPerLayer = 4;
+            params.branchDepth = 3;
+            break;
+        case TreeType::DEAD_PINE:
+        default:
+            params.trunkLength = 22.0f;
+            params.trunkRadius = 0.4f;
+            params.branchLength = 6.0f;
+            params.numBranchLayers = 5;
+            params.branchesPerLayer = 5;
+            params.branchDepth = 3;
+            break;
+    }
+    params.trunkLength *= random.range(0.85f, 1.15f);
+    params.branchLength *= random.range(0.8f, 1.2f);
+    params.subBranchAngle += random.range(-10.0f, 10.0f);
+    params.branchesPerLayer = std::max(2, params.branchesPerLayer + static_cast<int>(random.next() % 3u) - 1);
+    return params;
+}
+
+void TreeArchetypes::bakeMesh(const AxialTree& tree, int lod, TreeMesh& mesh) {
+    //the reduced mesh drops the twigs (order 3 and up) and goes down to as few sides as still read as round
+    TreeMesher::Options options;
+    if (lod == TreeArchetype::LOD_FULL) {
+        options.minSides = 4;
+        options.maxSides = 12;
+    } else {
+        options.minSides = 3;
+        options.maxSides = 6;
+        options.maxOrder = 2;
+    }
+    TreeMesher::build(tree, options, mesh);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "lsystem/treegenerator.h"
+#include "lsystem/treemesher.h"
+#include "Tree.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+//one baked l-system tree, every terrain tree is an instance of one of these. it comes in LOD_COUNT levels of
+//detail: the full mesh up close, a reduced one past that and a camera facing impostor far away
+struct TreeArchetype {
+    static constexpr int LOD_FULL = 0;
+    static constexpr int LOD_REDUCED = 1;
+    static constexpr int LOD_IMPOSTOR = 2;
+    static constexpr int LOD_COUNT = 3;
+    static constexpr int MESH_LOD_COUNT = 2;    //the impostor is rendered on the gl side, no mesh here
+
+    TreeType type;
+    TreeMesh meshes[MESH_LOD_COUNT];    //base of the trunk at the origin
+    int segmentCount;
+    //what the collision code sees, a straight cylinder up from the base
+    float trunkRadius;
+    float trunkHeight;
+    //top of the tallest branch, what lod selection measures on screen
+    float height;
+    //side of the square, standing on the base, that the whole tree fits in from any side. impostors are this big
+    float impostorSize;
+};
+
+//the fixed set of tree shapes the terrain draws from, VARIANTS_PER_TYPE seeded variations of each dead tree type.
+//built once and never changed after, so any thread can read it
+class TreeArchetypes {
+public:
+    static constexpr int VARIANTS_PER_TYPE = 4;
+
+    //lod switches by how tall a tree is on screen in pixels. each switch is spread over the FADE_BAND above its
+    //threshold, both levels get drawn there with complementary dither patterns so nothing pops
+    static constexpr float FULL_MESH_PIXELS = 200.0f;
+    static constexpr float IMPOSTOR_PIXELS = 60.0f;
+    static constexpr float FADE_BAND = 0.25f;
+
+    //impostor atlas layout, views evenly spaced around the tree starting from +z
+    static constexpr int IMPOSTOR_VIEWS = 8;
+    static constexpr int IMPOSTOR_CELL_PIXELS = 128;
+
+    //built on the first call (the gl side calls it at startup), thread safe
+    static const std::vector<TreeArchetype>& get();
+    static int count() { return static_cast<int>(get().size()); }
+
+    //archetype, yaw and scale for the tree standing at basePosition, the same every time for the same world seed
+    static TreeInstance place(glm::vec3 basePosition, uint32_t worldSeed);
+
+    //lods to draw a tree at for how many pixels tall it is on screen, returns how many (1 or 2). inside a fade
+    //band it's 2: the nearer lod with a fade in (0, 1) and the farther one with that fade - 1, the dither in
+    //default.frag draws the first where its threshold is under the fade and the second everywhere else
+    static int selectLods(float pixels, int lods[2], float fades[2]);
+
+private:
+    static std::vector<TreeArchetype> build();
+    static TreeParameters variantParameters(TreeType type, FastRandom& random);
+    static void bakeMesh(const AxialTree& tree, int lod, TreeMesh& mesh);
+};
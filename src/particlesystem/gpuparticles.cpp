@@ -0,0 +1,198 @@
+#include "gpuparticles.h"
+#include "utils/shaderloader.h"
+#include "utils/fastrandom.h"
+#include "utils/fastmath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+GpuParticles::GpuParticles()
+    : m_updateProgram(0)
+    , m_emitterBuffer(0)
+    , m_buffers{0, 0}
+    , m_updateVAOs{0, 0}
+    , m_current(0)
+    , m_poolSize(0)
+    , m_fogSlots(0)
+    , m_spawnCursor(0)
+    , m_spawnCarry(0.0f)
+    , m_primed(false)
+{
+}
+
+GpuParticles::~GpuParticles() {
+    cleanup();
+}
+
+bool GpuParticles::initialize(int poolSize, int fogSlots) {
+    cleanup();
+    if (poolSize <= 0) {
+        return false;
+    }
+
+    const char* varyings[] = {"outPosition", "outVelocity", "outDrift", "outLife"};
+    try {
+        m_updateProgram = ShaderLoader::createTransformFeedbackProgram(
+            ":/resources/shaders/gpuparticles_update.vert", varyings, 4);
+    } catch (const std::runtime_error &e) {
+        std::cerr << "Error loading gpu particle shader: " << e.what() << std::endl;
+        return false;
+    }
+    GLuint blockIndex = glGetUniformBlockIndex(m_updateProgram, "Emitter");
+    glUniformBlockBinding(m_updateProgram, blockIndex, 0);
+
+    glGenBuffers(1, &m_emitterBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_emitterBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Emitter), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    m_poolSize = poolSize;
+    m_fogSlots = std::clamp(fogSlots, 0, poolSize);
+    //all zeros is a dead slot
+    std::vector<Particle> empty(static_cast<size_t>(poolSize), Particle{});
+    glGenBuffers(BUFFER_COUNT, m_buffers);
+    glGenVertexArrays(BUFFER_COUNT, m_updateVAOs);
+    for (int i = 0; i < BUFFER_COUNT; i++) {
+        glBindVertexArray(m_updateVAOs[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(empty.size() * sizeof(Particle)), empty.data(), GL_DYNAMIC_COPY);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, velocity));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, drift));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, life));
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_current = 0;
+    m_spawnCursor = 0;
+    m_spawnCarry = 0.0f;
+    m_primed = false;
+    return true;
+}
+
+void GpuParticles::cleanup() {
+    if (m_updateVAOs[0] != 0) {
+        glDeleteVertexArrays(BUFFER_COUNT, m_updateVAOs);
+        m_updateVAOs[0] = m_updateVAOs[1] = 0;
+    }
+    if (m_buffers[0] != 0) {
+        glDeleteBuffers(BUFFER_COUNT, m_buffers);
+        m_buffers[0] = m_buffers[1] = 0;
+    }
+    if (m_emitterBuffer != 0) {
+        glDeleteBuffers(1, &m_emitterBuffer);
+        m_emitterBuffer = 0;
+    }
+    if (m_updateProgram != 0) {
+        glDeleteProgram(m_updateProgram);
+        m_updateProgram = 0;
+    }
+    m_poolSize = 0;
+    m_fogSlots = 0;
+}
+
+void GpuParticles::advanceSpawnWindow(Emitter& emitter) {
+    uint32_t pool = static_cast<uint32_t>(std::max(m_poolSize, 1));
+    emitter.spawn.z = pool;
+    emitter.split.x = static_cast<uint32_t>(m_fogSlots);
+    emitter.spawn.x = m_spawnCursor;
+    if (!m_primed) {
+        //first tick fills the whole pool at once instead of ramping up over a lifetime
+        emitter.spawn.y = pool;
+        m_primed = true;
+        return;
+    }
+
+    //sweep at the rate of the shortest lived kind, longer lived slots are still alive when it passes
+    //and just get picked up a lap later
+    float averageLife = 0.0f;
+    for (const KindParams& kind : emitter.kinds) {
+        float life = 0.5f * (kind.band.z + kind.band.w);
+        averageLife = averageLife == 0.0f ? life : std::min(averageLife, life);
+    }
+    float window = m_spawnCarry + static_cast<float>(pool) * emitter.origin.w / std::max(averageLife, 0.001f);
+    uint32_t count = std::min(static_cast<uint32_t>(window), pool);
+    m_spawnCarry = window - static_cast<float>(count);
+    emitter.spawn.y = count;
+    m_spawnCursor = (m_spawnCursor + count) % pool;
+}
+
+void GpuParticles::step(const Emitter& emitter) {
+    if (!isInitialized()) {
+        return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, m_emitterBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Emitter), &emitter);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_emitterBuffer);
+
+    int next = 1 - m_current;
+    glUseProgram(m_updateProgram);
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(m_updateVAOs[m_current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_buffers[next]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, m_poolSize);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    glUseProgram(0);
+    m_current = next;
+}
+
+void GpuParticles::readBack(std::vector<Particle>& out) const {
+    out.resize(static_cast<size_t>(m_poolSize));
+    if (!isInitialized()) {
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffers[m_current]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(out.size() * sizeof(Particle)), out.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GpuParticles::stepReference(std::vector<Particle>& pool, const Emitter& emitter) {
+    float deltaTime = emitter.origin.w;
+    uint32_t seed = emitter.spawn.w;
+    for (size_t i = 0; i < pool.size(); i++) {
+        Particle& particle = pool[i];
+        uint32_t slot = static_cast<uint32_t>(i);
+        int kind = slot < emitter.split.x ? KIND_FOG : KIND_DUST;
+        const KindParams& p = emitter.kinds[kind];
+
+        particle.life -= deltaTime;
+        particle.position += particle.drift * (p.motion.x * deltaTime);
+        particle.position.y += FastMath::sin((particle.startLife - particle.life) * p.motion.y) * (p.motion.z * deltaTime);
+        particle.velocity.x += (FastRandom::hashFloat(seed + slot) - 0.5f) * (p.jitter.x * deltaTime);
+        particle.velocity.y += (FastRandom::hashFloat((seed ^ 0x68e31da4u) + slot) - 0.5f) * (p.jitter.y * deltaTime);
+        particle.velocity.z += (FastRandom::hashFloat((seed ^ 0xb5297a4du) + slot) - 0.5f) * (p.jitter.x * deltaTime);
+        particle.position += particle.velocity * deltaTime;
+
+        uint32_t windowOffset = (slot + emitter.spawn.z - emitter.spawn.x) % emitter.spawn.z;
+        bool canSpawn = (emitter.split.y & (1u << kind)) != 0;
+        if (particle.life <= 0.0f && windowOffset < emitter.spawn.y && canSpawn) {
+            uint32_t stream = FastRandom::hash(seed ^ 0x1b873593u ^ slot);
+            float angle = emitter.heading.x + (FastRandom::hashFloat(stream) - 0.5f) * 2.0f * p.ring.z;
+            float dist = p.ring.x + FastRandom::hashFloat(stream + 1u) * (p.ring.y - p.ring.x);
+            float height = p.band.x + FastRandom::hashFloat(stream + 2u) * (p.band.y - p.band.x);
+            particle.position = glm::vec3(emitter.origin) + glm::vec3(std::cos(angle) * dist, height, std::sin(angle) * dist);
+
+            float driftAngle = FastRandom::hashFloat(stream + 3u) * 6.283185f;
+            particle.drift = glm::normalize(glm::vec3(std::cos(driftAngle) * p.shape.w, p.shape.z,
+                                                      std::sin(driftAngle) * p.shape.w));
+            particle.velocity = glm::vec3((FastRandom::hashFloat(stream + 4u) - 0.5f) * p.jitter.z,
+                                          p.ring.w + FastRandom::hashFloat(stream + 5u) * p.jitter.w,
+                                          (FastRandom::hashFloat(stream + 6u) - 0.5f) * p.jitter.z);
+
+            particle.life = p.band.z + FastRandom::hashFloat(stream + 7u) * (p.band.w - p.band.z);
+            particle.startLife = particle.life;
+            particle.size = p.shape.x + FastRandom::hashFloat(stream + 8u) * (p.shape.y - p.shape.x);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+//fog / dust simulated entirely on the gpu. a fixed pool of slots lives in two buffers and a transform feedback
+//pass steps one into the other every tick, so nothing is updated or uploaded on the cpu. a slot is fog or dust by
+//its index, dead ones respawn when the emitter's spawn window sweeps over them. stepReference() is the same tick
+//written in c++, to check the shader against. gl thread only
+class GpuParticles {
+public:
+    enum Kind {
+        KIND_FOG,
+        KIND_DUST,
+        KIND_COUNT
+    };
+
+    //one slot the way it sits in the buffers, transform feedback writes the four vec3s back to back
+    struct Particle {
+        glm::vec3 position;
+        glm::vec3 velocity;
+        glm::vec3 drift;
+        float life;
+        float startLife;
+        float size;
+    };
+
+    //std140 copy of the Emitter block in gpuparticles_update.vert, all vec4s so there's no padding to get wrong
+    struct KindParams {
+        glm::vec4 motion;       //drift speed, bob speed, bob amount, peak alpha
+        glm::vec4 jitter;       //jitter xz, jitter y, spawn velocity xz spread, spawn velocity y spread
+        glm::vec4 ring;         //min distance, max distance, angle spread either side (radians), spawn velocity y
+        glm::vec4 band;         //spawn height min, max (from the eye), life min, life max
+        glm::vec4 shape;        //size min, size max, drift y, drift xz (drift gets normalized)
+    };
+    struct Emitter {
+        glm::vec4 origin;       //eye, w = delta time
+        glm::vec4 heading;      //x = look angle in xz, atan2(z, x)
+        glm::uvec4 spawn;       //spawn window first slot, window size, pool size, seed
+        glm::uvec4 split;       //fog slots (the rest are dust), bit per Kind allowed to spawn
+        KindParams kinds[KIND_COUNT];
+    };
+
+    GpuParticles();
+    ~GpuParticles();
+    GpuParticles(const GpuParticles&) = delete;
+    GpuParticles& operator=(const GpuParticles&) = delete;
+
+    //every slot starts dead, the first tick spawns the whole pool. false if the shader didn't build
+    bool initialize(int poolSize, int fogSlots);
+    void cleanup();
+    bool isInitialized() const { return m_updateProgram != 0; }
+    int getPoolSize() const { return m_poolSize; }
+    int getFogSlots() const { return m_fogSlots; }
+
+    //fills in emitter.spawn xyz and split.x for the next tick, moving the window on so the pool turns over
+    //about once per average lifetime. origin.w (delta time) has to be set already
+    void advanceSpawnWindow(Emitter& emitter);
+    void step(const Emitter& emitter);
+    //state after the last step(), for drawing straight from. flips between two buffers every step
+    GLuint getStateBuffer() const { return m_buffers[m_current]; }
+
+    //the pool back on the cpu, stalls until the gpu is done. for validation only
+    void readBack(std::vector<Particle>& out) const;
+    //the update shader's tick on the cpu. pool starts as all zeros (dead) like the buffers do
+    static void stepReference(std::vector<Particle>& pool, const Emitter& emitter);
+
+private:
+    static constexpr int BUFFER_COUNT = 2;
+
+    GLuint m_updateProgram;
+    GLuint m_emitterBuffer;
+    GLuint m_buffers[BUFFER_COUNT];
+    GLuint m_updateVAOs[BUFFER_COUNT];      //reads buffer i
+    int m_current;
+    int m_poolSize;
+    int m_fogSlots;
+    uint32_t m_spawnCursor;
+    float m_spawnCarry;                     //fraction of a slot the window still owes
+    bool m_primed;
+};
@@ -1,13 +1,35 @@
 #include "particlesystem.h"
 #include "utils/camera.h"
 #include "utils/shaderloader.h"
+#include "utils/profiler.h"
+#include "utils/parallelfor.h"
+#include "utils/fastmath.h"
+#include "map/Map.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
-#include <cstdlib>
 #include <ctime>
 
+namespace {
+
+//rgb and sprite per bucket, alpha comes from the particle
+const glm::vec3 BUCKET_COLORS[ParticleSystem::BUCKET_COUNT] = {
+    glm::vec3(0.4f, 0.3f, 0.2f),
+    glm::vec3(0.8f, 0.82f, 0.85f),
+    glm::vec3(0.6f, 0.55f, 0.45f),
+    glm::vec3(0.3f, 0.5f, 0.2f)
+};
+const int BUCKET_LAYERS[ParticleSystem::BUCKET_COUNT] = {
+    ParticleSystem::SPRITE_DIRT, ParticleSystem::SPRITE_WISP, ParticleSystem::SPRITE_DUST_MOUNTAIN, ParticleSystem::SPRITE_LEAF
+};
+
+}
+
 ParticleSystem::ParticleSystem()
-    : m_maxParticles(200)
-    , m_nextParticle(0)
+    : m_groundMap(nullptr)
+    , m_maxParticles(200)
+    , m_random(static_cast<uint64_t>(std::time(nullptr)))
+    , m_tick(0)
     , m_particlesEnabled(true)
     , m_dirtParticlesEnabled(true)
     , m_fogWispsEnabled(true)
@@ -18,18 +40,31 @@ ParticleSystem::ParticleSystem()
     , m_particleShader(0)
     , m_particleVAO(0)
     , m_particleVBO(0)
-    , m_particleInstanceVBO(0)
-    , m_dirtParticleTexture(0)
-    , m_wispParticleTexture(0)
-    , m_dustMountainTexture(0)
-    , m_dustForestTexture(0)
-    , m_dustGrasslandTexture(0)
-    , m_leafParticleTexture(0)
+    , m_viewLoc(-1)
+    , m_projLoc(-1)
+    , m_softFadeLoc(-1)
+    , m_viewportSizeLoc(-1)
+    , m_fadeDistanceLoc(-1)
+    , m_spriteArray(0)
     , m_dustSpawnTimer(0.0f)
     , m_leafSpawnTimer(0.0f)
     , m_dustSpawnInterval(0.1f)
     , m_leafSpawnInterval(0.4f)
+    , m_gpuSimulation(false)
+    , m_gpuTick(0)
+    , m_gpuFailed(false)
+    , m_gpuShader(0)
+    , m_gpuVAO(0)
+    , m_gpuViewLoc(-1)
+    , m_gpuProjLoc(-1)
+    , m_gpuSoftFadeLoc(-1)
+    , m_gpuViewportSizeLoc(-1)
+    , m_gpuFadeDistanceLoc(-1)
+    , m_gpuFogSlotsLoc(-1)
+    , m_gpuKindColorsLoc(-1)
+    , m_gpuKindLayersLoc(-1)
 {
+    std::fill(std::begin(m_spriteLoaded), std::end(m_spriteLoaded), false);
 }
 
 ParticleSystem::~ParticleSystem() {
@@ -37,10 +72,12 @@ ParticleSystem::~ParticleSystem() {
 }
 
 void ParticleSystem::initialize() {
-    m_particles.resize(m_maxParticles);
+    for (ParticleArrays& bucket : m_buckets) {
+        bucket.reserve(static_cast<size_t>(m_maxParticles));
+    }
     
-    // Generate instance-data VBO
-    glGenBuffers(1, &m_particleInstanceVBO);
+    // Instance data is streamed, a frame's worth per region. grows on its own past max particles
+    m_instanceStream.initialize(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_maxParticles) * sizeof(ParticleInstance));
     
     float particle_quad[] = {
         -0.5f, -0.5f,  0.0f, 0.0f,
@@ -66,23 +103,15 @@ void ParticleSystem::initialize() {
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     
-    glBindBuffer(GL_ARRAY_BUFFER, m_particleInstanceVBO);
-    
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, pos));
-    glVertexAttribDivisor(2, 1);
+    bindInstanceAttributes(0);
     
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, size));
-    glVertexAttribDivisor(3, 1);
-    
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, color));
-    glVertexAttribDivisor(4, 1);
-    
-    glEnableVertexAttribArray(5);
-    glVertexAttribIPointer(5, 1, GL_INT, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, type));
-    glVertexAttribDivisor(5, 1);
+    //same quad for the gpu pool, its instance attributes get pointed at whichever state buffer is current
+    glGenVertexArrays(1, &m_gpuVAO);
+    glBindVertexArray(m_gpuVAO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     
     glBindVertexArray(0);
     
@@ -95,105 +124,84 @@ void ParticleSystem::initialize() {
         if (m_particleShader != 0) {
             glUseProgram(m_particleShader);
             glUniform1i(glGetUniformLocation(m_particleShader, "sprite"), 0);
+            glUniform1i(glGetUniformLocation(m_particleShader, "sceneDepth"), 1);
             glUseProgram(0);
+            m_viewLoc = glGetUniformLocation(m_particleShader, "view");
+            m_projLoc = glGetUniformLocation(m_particleShader, "proj");
+            m_softFadeLoc = glGetUniformLocation(m_particleShader, "softFade");
+            m_viewportSizeLoc = glGetUniformLocation(m_particleShader, "viewportSize");
+            m_fadeDistanceLoc = glGetUniformLocation(m_particleShader, "fadeDistance");
         }
     } catch (const std::runtime_error &e) {
         std::cerr << "Error loading particle shader: " << e.what() << std::endl;
     }
     
-    QImage dirtImg(":/resources/textures/particles/dirtparticle1.png");
-    if (!dirtImg.isNull()) {
-        dirtImg = dirtImg.convertToFormat(QImage::Format_RGBA8888);
-        if (dirtImg.width() != 256 || dirtImg.height() != 256) {
-            dirtImg = dirtImg.scaled(256, 256, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        }
-        glGenTextures(1, &m_dirtParticleTexture);
-        glBindTexture(GL_TEXTURE_2D, m_dirtParticleTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dirtImg.width(), dirtImg.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, dirtImg.bits());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    }
-    
-    QImage wispImg(":/resources/textures/particles/wisp.png");
-    if (!wispImg.isNull()) {
-        wispImg = wispImg.convertToFormat(QImage::Format_RGBA8888).flipped(Qt::Vertical);
-        if (wispImg.width() != 256 || wispImg.height() != 256) {
-            wispImg = wispImg.scaled(256, 256, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        }
-        glGenTextures(1, &m_wispParticleTexture);
-        glBindTexture(GL_TEXTURE_2D, m_wispParticleTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, wispImg.width(), wispImg.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, wispImg.bits());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    }
-    
-    QImage dustMountainImg(":/resources/textures/particles/dust_mountains.png");
-    if (!dustMountainImg.isNull()) {
-        dustMountainImg = dustMountainImg.convertToFormat(QImage::Format_RGBA8888).flipped(Qt::Vertical);
-        if (dustMountainImg.width() != 256 || dustMountainImg.height() != 256) {
-            dustMountainImg = dustMountainImg.scaled(256, 256, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    try {
+        m_gpuShader = ShaderLoader::createShaderProgram(
+            ":/resources/shaders/gpuparticles.vert",
+            ":/resources/shaders/particles.frag"
+        );
+        if (m_gpuShader != 0) {
+            glUseProgram(m_gpuShader);
+            glUniform1i(glGetUniformLocation(m_gpuShader, "sprite"), 0);
+            glUniform1i(glGetUniformLocation(m_gpuShader, "sceneDepth"), 1);
+            glUseProgram(0);
+            m_gpuViewLoc = glGetUniformLocation(m_gpuShader, "view");
+            m_gpuProjLoc = glGetUniformLocation(m_gpuShader, "proj");
+            m_gpuSoftFadeLoc = glGetUniformLocation(m_gpuShader, "softFade");
+            m_gpuViewportSizeLoc = glGetUniformLocation(m_gpuShader, "viewportSize");
+            m_gpuFadeDistanceLoc = glGetUniformLocation(m_gpuShader, "fadeDistance");
+            m_gpuFogSlotsLoc = glGetUniformLocation(m_gpuShader, "fogSlots");
+            m_gpuKindColorsLoc = glGetUniformLocation(m_gpuShader, "kindColors");
+            m_gpuKindLayersLoc = glGetUniformLocation(m_gpuShader, "kindLayers");
         }
-        glGenTextures(1, &m_dustMountainTexture);
-        glBindTexture(GL_TEXTURE_2D, m_dustMountainTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dustMountainImg.width(), dustMountainImg.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, dustMountainImg.bits());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        std::cout << "Successfully loaded dust_mountains texture" << std::endl;
-    } else {
-        std::cerr << "Warning: dust_mountains.png not found" << std::endl;
+    } catch (const std::runtime_error &e) {
+        std::cerr << "Error loading gpu particle shader: " << e.what() << std::endl;
     }
     
-    QImage dustForestImg(":/resources/textures/particles/dust_forest.png");
-    if (!dustForestImg.isNull()) {
-        dustForestImg = dustForestImg.convertToFormat(QImage::Format_RGBA8888).flipped(Qt::Vertical);
-        if (dustForestImg.width() != 256 || dustForestImg.height() != 256) {
-            dustForestImg = dustForestImg.scaled(256, 256, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        }
-        glGenTextures(1, &m_dustForestTexture);
-        glBindTexture(GL_TEXTURE_2D, m_dustForestTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dustForestImg.width(), dustForestImg.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, dustForestImg.bits());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        std::cout << "Successfully loaded dust_forest texture" << std::endl;
-    } else {
+    glGenTextures(1, &m_spriteArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_spriteArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, SPRITE_SIZE, SPRITE_SIZE, SPRITE_LAYER_COUNT, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    
+    loadSpriteLayer(":/resources/textures/particles/dirtparticle1.png", SPRITE_DIRT, false);
+    loadSpriteLayer(":/resources/textures/particles/wisp.png", SPRITE_WISP, true);
+    if (!loadSpriteLayer(":/resources/textures/particles/dust_mountains.png", SPRITE_DUST_MOUNTAIN, true)) {
+        std::cerr << "Warning: dust_mountains.png not found" << std::endl;
+    }
+    if (!loadSpriteLayer(":/resources/textures/particles/dust_forest.png", SPRITE_DUST_FOREST, true)) {
         std::cerr << "Warning: dust_forest.png not found" << std::endl;
     }
-    
-    QImage dustGrasslandImg(":/resources/textures/particles/dust_grasslands.png");
-    if (!dustGrasslandImg.isNull()) {
-        dustGrasslandImg = dustGrasslandImg.convertToFormat(QImage::Format_RGBA8888).flipped(Qt::Vertical);
-        if (dustGrasslandImg.width() != 256 || dustGrasslandImg.height() != 256) {
-            dustGrasslandImg = dustGrasslandImg.scaled(256, 256, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        }
-        glGenTextures(1, &m_dustGrasslandTexture);
-        glBindTexture(GL_TEXTURE_2D, m_dustGrasslandTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dustGrasslandImg.width(), dustGrasslandImg.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, dustGrasslandImg.bits());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        std::cout << "Successfully loaded dust_grasslands texture" << std::endl;
-    } else {
+    if (!loadSpriteLayer(":/resources/textures/particles/dust_grasslands.png", SPRITE_DUST_GRASSLAND, true)) {
         std::cerr << "Warning: dust_grasslands.png not found" << std::endl;
     }
-    
-    QImage leafImg(":/resources/textures/particles/dust_forest.png");
-    if (!leafImg.isNull()) {
-        leafImg = leafImg.convertToFormat(QImage::Format_RGBA8888);
-        if (leafImg.width() != 256 || leafImg.height() != 256) {
-            leafImg = leafImg.scaled(256, 256, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        }
-        glGenTextures(1, &m_leafParticleTexture);
-        glBindTexture(GL_TEXTURE_2D, m_leafParticleTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, leafImg.width(), leafImg.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, leafImg.bits());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        std::cout << "Successfully loaded leaf texture" << std::endl;
-    } else {
+    if (!loadSpriteLayer(":/resources/textures/particles/dust_forest.png", SPRITE_LEAF, false)) {
         std::cerr << "Warning: Leaf texture not found" << std::endl;
     }
     
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+bool ParticleSystem::loadSpriteLayer(const QString& path, SpriteLayer layer, bool flip) {
+    QImage image(path);
+    if (image.isNull()) {
+        return false;
+    }
+    image = image.convertToFormat(QImage::Format_RGBA8888);
+    if (flip) {
+        image = image.flipped(Qt::Vertical);
+    }
+    if (image.width() != SPRITE_SIZE || image.height() != SPRITE_SIZE) {
+        image = image.scaled(SPRITE_SIZE, SPRITE_SIZE, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, SPRITE_SIZE, SPRITE_SIZE, 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, image.constBits());
+    m_spriteLoaded[layer] = true;
+    return true;
 }
 
 void ParticleSystem::cleanup() {
@@ -205,37 +213,26 @@ void ParticleSystem::cleanup() {
         glDeleteBuffers(1, &m_particleVBO);
         m_particleVBO = 0;
     }
-    if (m_particleInstanceVBO != 0) {
-        glDeleteBuffers(1, &m_particleInstanceVBO);
-        m_particleInstanceVBO = 0;
-    }
+    m_instanceStream.cleanup();
     if (m_particleShader != 0) {
         glDeleteProgram(m_particleShader);
         m_particleShader = 0;
     }
-    if (m_dirtParticleTexture != 0) {
-        glDeleteTextures(1, &m_dirtParticleTexture);
-        m_dirtParticleTexture = 0;
-    }
-    if (m_wispParticleTexture != 0) {
-        glDeleteTextures(1, &m_wispParticleTexture);
-        m_wispParticleTexture = 0;
-    }
-    if (m_dustMountainTexture != 0) {
-        glDeleteTextures(1, &m_dustMountainTexture);
-        m_dustMountainTexture = 0;
-    }
-    if (m_dustForestTexture != 0) {
-        glDeleteTextures(1, &m_dustForestTexture);
-        m_dustForestTexture = 0;
+    if (m_spriteArray != 0) {
+        glDeleteTextures(1, &m_spriteArray);
+        m_spriteArray = 0;
     }
-    if (m_dustGrasslandTexture != 0) {
-        glDeleteTextures(1, &m_dustGrasslandTexture);
-        m_dustGrasslandTexture = 0;
+    std::fill(std::begin(m_spriteLoaded), std::end(m_spriteLoaded), false);
+    m_depthSort.reset();
+    
+    m_gpuParticles.cleanup();
+    if (m_gpuVAO != 0) {
+        glDeleteVertexArrays(1, &m_gpuVAO);
+        m_gpuVAO = 0;
     }
-    if (m_leafParticleTexture != 0) {
-        glDeleteTextures(1, &m_leafParticleTexture);
-        m_leafParticleTexture = 0;
+    if (m_gpuShader != 0) {
+        glDeleteProgram(m_gpuShader);
+        m_gpuShader = 0;
     }
 }
 
@@ -247,24 +244,135 @@ glm::vec3 ParticleSystem::getCameraFeetPosition(const Camera& camera, float came
     return camPos;
 }
 
+bool ParticleSystem::getGroundHeight(float x, float z, float& groundY) const {
+    return m_groundMap != nullptr && m_groundMap->getSurfaceHeight(x, z, groundY);
+}
+
+void ParticleSystem::DrawArrays::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    prevX.clear();
+    prevY.clear();
+    prevZ.clear();
+    particleSize.clear();
+    alpha.clear();
+}
+
+size_t ParticleSystem::DrawState::count() const {
+    size_t total = 0;
+    for (const DrawArrays& bucket : buckets) {
+        total += bucket.size();
+    }
+    return total;
+}
+
+void ParticleSystem::DrawState::clear() {
+    for (DrawArrays& bucket : buckets) {
+        bucket.clear();
+    }
+    gpu = GpuEmitter();
+}
+
+void ParticleSystem::ParticleArrays::push(const glm::vec3& position, const glm::vec3& velocity, const glm::vec3& drift,
+                                          float lifetime, float size, float startAlpha) {
+    x.push_back(position.x);
+    y.push_back(position.y);
+    z.push_back(position.z);
+    prevX.push_back(position.x);
+    prevY.push_back(position.y);
+    prevZ.push_back(position.z);
+    particleSize.push_back(size);
+    alpha.push_back(startAlpha);
+    velX.push_back(velocity.x);
+    velY.push_back(velocity.y);
+    velZ.push_back(velocity.z);
+    driftX.push_back(drift.x);
+    driftY.push_back(drift.y);
+    driftZ.push_back(drift.z);
+    life.push_back(lifetime);
+    startLife.push_back(lifetime);
+}
+
+void ParticleSystem::ParticleArrays::swapRemove(size_t i) {
+    size_t last = size() - 1;
+    if (i != last) {
+        x[i] = x[last];
+        y[i] = y[last];
+        z[i] = z[last];
+        prevX[i] = prevX[last];
+        prevY[i] = prevY[last];
+        prevZ[i] = prevZ[last];
+        particleSize[i] = particleSize[last];
+        alpha[i] = alpha[last];
+        velX[i] = velX[last];
+        velY[i] = velY[last];
+        velZ[i] = velZ[last];
+        driftX[i] = driftX[last];
+        driftY[i] = driftY[last];
+        driftZ[i] = driftZ[last];
+        life[i] = life[last];
+        startLife[i] = startLife[last];
+    }
+    x.pop_back();
+    y.pop_back();
+    z.pop_back();
+    prevX.pop_back();
+    prevY.pop_back();
+    prevZ.pop_back();
+    particleSize.pop_back();
+    alpha.pop_back();
+    velX.pop_back();
+    velY.pop_back();
+    velZ.pop_back();
+    driftX.pop_back();
+    driftY.pop_back();
+    driftZ.pop_back();
+    life.pop_back();
+    startLife.pop_back();
+}
+
+void ParticleSystem::ParticleArrays::clear() {
+    DrawArrays::clear();
+    velX.clear();
+    velY.clear();
+    velZ.clear();
+    driftX.clear();
+    driftY.clear();
+    driftZ.clear();
+    life.clear();
+    startLife.clear();
+}
+
+void ParticleSystem::ParticleArrays::reserve(size_t count) {
+    for (std::vector<float>* array : {&x, &y, &z, &prevX, &prevY, &prevZ, &particleSize, &alpha,
+                                      &velX, &velY, &velZ, &driftX, &driftY, &driftZ, &life, &startLife}) {
+        array->reserve(count);
+    }
+}
+
+int ParticleSystem::getParticleCount() const {
+    size_t total = 0;
+    for (const ParticleArrays& bucket : m_buckets) {
+        total += bucket.size();
+    }
+    return static_cast<int>(total);
+}
+
 void ParticleSystem::spawnSingleDirtParticle(const Camera& camera, float cameraHeightMultiplier) {
-    Particle &p = m_particles[m_nextParticle];
-    
+    if (!hasRoom()) {
+        return;
+    }
     glm::vec3 feet = getCameraFeetPosition(camera, cameraHeightMultiplier);
     
     float spread = 0.45f;
-    float rX = ((rand() % 100) / 100.0f - 0.5f) * spread;
-    float rZ = ((rand() % 100) / 100.0f - 0.5f) * spread;
+    float rX = (m_random.nextFloat() - 0.5f) * spread;
+    float rZ = (m_random.nextFloat() - 0.5f) * spread;
     
-    p.Position = feet + glm::vec3(rX, 0.0f, rZ);
-    p.Velocity = glm::vec3(0.0f, 1.0f, 0.0f);
-    p.Color = glm::vec4(0.4f, 0.3f, 0.2f, 1.0f);
-    p.Life = 0.7f;
-    p.StartLife = 0.7f;
-    p.Size = 0.15f;
-    p.pType = PARTICLE_DIRT;
-    
-    m_nextParticle = (m_nextParticle + 1) % m_maxParticles;
+    glm::vec3 position = feet + glm::vec3(rX, 0.0f, rZ);
+    //kicked up off the ground rather than the feet, which float a bit on slopes and mid jump
+    getGroundHeight(position.x, position.z, position.y);
+    m_buckets[BUCKET_DIRT].push(position, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f), 0.7f, 0.15f, 1.0f);
 }
 
 void ParticleSystem::spawnDirtParticles(float deltaTime, const Camera& camera, bool isMoving, float cameraHeightMultiplier) {
@@ -281,25 +389,11 @@ void ParticleSystem::spawnDirtParticles(float deltaTime, const Camera& camera, b
     }
 }
 
-void ParticleSystem::spawnFogWisp(float deltaTime, const Camera& camera) {
-    if (!m_particlesEnabled || !m_fogWispsEnabled) {
-        return;
-    }
-    
-    m_wispSpawnTimer -= deltaTime;
-    if (m_wispSpawnTimer > 0.0f) {
+void ParticleSystem::spawnSingleFogWisp(const Camera& camera) {
+    if (!hasRoom()) {
         return;
     }
-    
-    // Random spawn interval
-    m_wispSpawnTimer = m_fogWispSpawnInterval + ((rand() % 100) / 100.0f) * 1.2f;
-    
-    Particle &p = m_particles[m_nextParticle];
-    m_nextParticle = (m_nextParticle + 1) % m_maxParticles;
-    
-    p.Life = 8.0f + ((rand() % 100) / 100.0f) * 4.0f;
-    p.StartLife = p.Life;
-    p.pType = PARTICLE_FOG_WISP;
+    float life = 8.0f + m_random.nextFloat() * 4.0f;
     
     glm::vec3 camPos = camera.getPosition();
     glm::vec3 forward = camera.getLook();
@@ -310,42 +404,59 @@ void ParticleSystem::spawnFogWisp(float deltaTime, const Camera& camera) {
     float baseAngle = atan2(forward.z, forward.x);
     float spread = glm::radians(55.0f);
     
-    float angle = baseAngle + (((rand() % 100) / 100.0f - 0.5f) * 2.0f * spread);
-    float dist = minDist + ((rand() % 100) / 100.0f) * (maxDist - minDist);
+    float angle = baseAngle + ((m_random.nextFloat() - 0.5f) * 2.0f * spread);
+    float dist = minDist + m_random.nextFloat() * (maxDist - minDist);
     
     float x = cos(angle) * dist;
     float z = sin(angle) * dist;
-    float y = ((rand() % 100) / 100.0f) * 2.0f - 1.0f;
+    float y = m_random.nextFloat() * 2.0f - 1.0f;
     
-    p.Position = camPos + glm::vec3(x, y, z);
+    glm::vec3 position = camPos + glm::vec3(x, y, z);
+    //same band over the ground out there instead of at our eye level, so they don't end up inside hills
+    float groundY;
+    if (getGroundHeight(position.x, position.z, groundY)) {
+        position.y = groundY + 1.6f + y;
+    }
     
-    float driftAngle = ((rand() % 100) / 100.0f) * 6.283185f;
-    p.DriftDir = glm::vec3(cos(driftAngle), 0.0f, sin(driftAngle));
+    float driftAngle = m_random.nextFloat() * 6.283185f;
+    glm::vec3 drift(cos(driftAngle), 0.0f, sin(driftAngle));
     
-    p.Velocity = glm::vec3(
-        ((rand() % 100) / 100.0f - 0.5f) * 0.01f,
-        ((rand() % 100) / 100.0f - 0.5f) * 0.005f,
-        ((rand() % 100) / 100.0f - 0.5f) * 0.01f
+    glm::vec3 velocity(
+        (m_random.nextFloat() - 0.5f) * 0.01f,
+        (m_random.nextFloat() - 0.5f) * 0.005f,
+        (m_random.nextFloat() - 0.5f) * 0.01f
     );
     
-    p.Color = glm::vec4(0.8f, 0.82f, 0.85f, 0.0f);
-    p.Size = 3.0f + ((rand() % 100) / 100.0f) * 1.0f;
+    float size = 3.0f + m_random.nextFloat() * 1.0f;
+    m_buckets[BUCKET_FOG].push(position, velocity, drift, life, size, 0.0f);
 }
 
-void ParticleSystem::spawnDustParticle(const Camera& camera, float cameraHeightMultiplier, int biomeType) {
-    Particle &p = m_particles[m_nextParticle];
-    m_nextParticle = (m_nextParticle + 1) % m_maxParticles;
+void ParticleSystem::spawnFogWisp(float deltaTime, const Camera& camera) {
+    if (!m_particlesEnabled || !m_fogWispsEnabled) {
+        return;
+    }
     
-    p.Life = 3.0f + ((rand() % 100) / 100.0f) * 2.0f;
-    p.StartLife = p.Life;
-    p.pType = PARTICLE_DUST;
+    m_wispSpawnTimer -= deltaTime;
+    if (m_wispSpawnTimer > 0.0f) {
+        return;
+    }
+    
+    // Random spawn interval
+    m_wispSpawnTimer = m_fogWispSpawnInterval + m_random.nextFloat() * 1.2f;
+    spawnSingleFogWisp(camera);
+}
+
+void ParticleSystem::spawnDustParticle(const Camera& camera, float cameraHeightMultiplier, int biomeType) {
+    if (!hasRoom()) {
+        return;
+    }
+    float life = 3.0f + m_random.nextFloat() * 2.0f;
     
     glm::vec3 camPos = camera.getPosition();
     glm::vec3 forward = camera.getLook();
     
     if (glm::length(camPos) < 0.1f || !std::isfinite(camPos.x) || !std::isfinite(camPos.y) || !std::isfinite(camPos.z)) {
         std::cerr << "Warning: Invalid camera position, skipping dust particle spawn" << std::endl;
-        p.Life = 0.0f;
         return;
     }
     
@@ -360,34 +471,35 @@ void ParticleSystem::spawnDustParticle(const Camera& camera, float cameraHeightM
     float baseAngle = atan2(forward.z, forward.x);
     float spread = glm::radians(120.0f);
     
-    float angle = baseAngle + (((rand() % 100) / 100.0f - 0.5f) * 2.0f * spread);
-    float dist = minDist + ((rand() % 100) / 100.0f) * (maxDist - minDist);
+    float angle = baseAngle + ((m_random.nextFloat() - 0.5f) * 2.0f * spread);
+    float dist = minDist + m_random.nextFloat() * (maxDist - minDist);
     
     float x = cos(angle) * dist;
     float z = sin(angle) * dist;
-    float y = -3.0f + ((rand() % 100) / 100.0f) * 0.8f;
+    float y = -3.0f + m_random.nextFloat() * 0.8f;
     
-    p.Position = camPos + glm::vec3(x, y, z);
+    glm::vec3 position = camPos + glm::vec3(x, y, z);
+    float groundY;
+    if (getGroundHeight(position.x, position.z, groundY)) {
+        position.y = groundY + 0.2f + m_random.nextFloat() * 0.8f;
+    }
     
-    if (!std::isfinite(p.Position.x) || !std::isfinite(p.Position.y) || !std::isfinite(p.Position.z)) {
+    if (!std::isfinite(position.x) || !std::isfinite(position.y) || !std::isfinite(position.z)) {
         std::cerr << "Warning: Invalid dust particle position calculated!" << std::endl;
-        p.Life = 0.0f;
         return;
     }
     
-    float driftAngle = ((rand() % 100) / 100.0f) * 6.283185f;
-    p.DriftDir = glm::vec3(cos(driftAngle) * 0.3f, 0.7f, sin(driftAngle) * 0.3f);
-    p.DriftDir = glm::normalize(p.DriftDir);
+    float driftAngle = m_random.nextFloat() * 6.283185f;
+    glm::vec3 drift = glm::normalize(glm::vec3(cos(driftAngle) * 0.3f, 0.7f, sin(driftAngle) * 0.3f));
     
-    p.Velocity = glm::vec3(
-        ((rand() % 100) / 100.0f - 0.5f) * 0.2f,
-        0.15f + ((rand() % 100) / 100.0f) * 0.2f,
-        ((rand() % 100) / 100.0f - 0.5f) * 0.2f
+    glm::vec3 velocity(
+        (m_random.nextFloat() - 0.5f) * 0.2f,
+        0.15f + m_random.nextFloat() * 0.2f,
+        (m_random.nextFloat() - 0.5f) * 0.2f
     );
     
-    p.Color = glm::vec4(0.6f, 0.55f, 0.45f, 0.0f);
-    p.Size = 0.12f + ((rand() % 100) / 100.0f) * 0.12f;
-    p.pType = PARTICLE_DUST_MOUNTAIN;
+    float size = 0.12f + m_random.nextFloat() * 0.12f;
+    m_buckets[BUCKET_DUST].push(position, velocity, drift, life, size, 0.0f);
 }
 
 void ParticleSystem::spawnDustParticles(float deltaTime, const Camera& camera, float cameraHeightMultiplier, int biomeType) {
@@ -399,38 +511,35 @@ void ParticleSystem::spawnDustParticles(float deltaTime, const Camera& camera, f
     if (m_dustSpawnTimer <= 0.0f) {
         spawnDustParticle(camera, cameraHeightMultiplier, biomeType);
         spawnDustParticle(camera, cameraHeightMultiplier, biomeType);
-        if ((rand() % 100) < 70) {
+        if (m_random.nextFloat() < 0.7f) {
             spawnDustParticle(camera, cameraHeightMultiplier, biomeType);
         }
-        m_dustSpawnTimer = m_dustSpawnInterval + ((rand() % 100) / 100.0f) * 0.1f;
+        m_dustSpawnTimer = m_dustSpawnInterval + m_random.nextFloat() * 0.1f;
     }
 }
 
 void ParticleSystem::spawnLeafParticle(const Camera& camera, float cameraHeightMultiplier) {
-    Particle &p = m_particles[m_nextParticle];
-    
+    if (!hasRoom()) {
+        return;
+    }
     glm::vec3 camPos = camera.getPosition();
     float spread = 1.5f;
-    float rX = ((rand() % 100) / 100.0f - 0.5f) * spread;
-    float rZ = ((rand() % 100) / 100.0f - 0.5f) * spread;
-    float rY = 2.0f + ((rand() % 100) / 100.0f) * 3.0f;
-    
-    p.Position = camPos + glm::vec3(rX, rY, rZ);
-    float driftAngle = ((rand() % 100) / 100.0f) * 6.283185f;
-    float driftSpeed = 0.3f + ((rand() % 100) / 100.0f) * 0.3f;
-    p.Velocity = glm::vec3(
+    float rX = (m_random.nextFloat() - 0.5f) * spread;
+    float rZ = (m_random.nextFloat() - 0.5f) * spread;
+    float rY = 2.0f + m_random.nextFloat() * 3.0f;
+    
+    glm::vec3 position = camPos + glm::vec3(rX, rY, rZ);
+    float driftAngle = m_random.nextFloat() * 6.283185f;
+    float driftSpeed = 0.3f + m_random.nextFloat() * 0.3f;
+    glm::vec3 velocity(
         cos(driftAngle) * driftSpeed,
-        -0.4f - ((rand() % 100) / 100.0f) * 0.3f,
+        -0.4f - m_random.nextFloat() * 0.3f,
         sin(driftAngle) * driftSpeed
     );
-    p.Color = glm::vec4(0.3f, 0.5f, 0.2f, 1.0f);
-    p.Life = 4.0f + ((rand() % 100) / 100.0f) * 2.0f;
-    p.StartLife = p.Life;
-    p.Size = 0.4f + ((rand() % 100) / 100.0f) * 0.3f;
-    p.pType = PARTICLE_LEAF;
-    p.DriftDir = glm::vec3(cos(driftAngle), 0.0f, sin(driftAngle));
-    
-    m_nextParticle = (m_nextParticle + 1) % m_maxParticles;
+    float life = 4.0f + m_random.nextFloat() * 2.0f;
+    float size = 0.4f + m_random.nextFloat() * 0.3f;
+    glm::vec3 drift(cos(driftAngle), 0.0f, sin(driftAngle));
+    m_buckets[BUCKET_LEAF].push(position, velocity, drift, life, size, 1.0f);
 }
 
 void ParticleSystem::spawnLeafParticles(float deltaTime, const Camera& camera, float cameraHeightMultiplier) {
@@ -441,189 +550,499 @@ void ParticleSystem::spawnLeafParticles(float deltaTime, const Camera& camera, f
     m_leafSpawnTimer -= deltaTime;
     if (m_leafSpawnTimer <= 0.0f) {
         spawnLeafParticle(camera, cameraHeightMultiplier);
-        m_leafSpawnTimer = m_leafSpawnInterval + ((rand() % 100) / 100.0f) * 0.3f;
-        if ((rand() % 100) < 60) {
+        m_leafSpawnTimer = m_leafSpawnInterval + m_random.nextFloat() * 0.3f;
+        if (m_random.nextFloat() < 0.6f) {
             spawnLeafParticle(camera, cameraHeightMultiplier);
         }
     }
 }
 
-void ParticleSystem::update(float deltaTime, const Camera& camera, bool isMoving, float cameraHeightMultiplier, int currentBiome) {
+namespace {
+    //the kernels are built from short passes over a few arrays each. one big loop touching every array is
+    //more pointers than the compiler will check for aliasing, and then it doesn't vectorize at all
+    
+    void addScaled(float* values, const float* add, float scale, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            values[i] += add[i] * scale;
+        }
+    }
+    
+    void subtract(float* values, float amount, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            values[i] -= amount;
+        }
+    }
+    
+    //tiny random walk, hashed from the particle's slot so it needs no rng state
+    void jitter(float* values, float amount, uint32_t seed, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            values[i] += (FastRandom::hashFloat(seed + static_cast<uint32_t>(i)) - 0.5f) * amount;
+        }
+    }
+}
+
+void ParticleSystem::startStep(ParticleArrays& p, size_t begin, size_t end, float deltaTime) {
+    std::copy(p.x.begin() + begin, p.x.begin() + end, p.prevX.begin() + begin);
+    std::copy(p.y.begin() + begin, p.y.begin() + end, p.prevY.begin() + begin);
+    std::copy(p.z.begin() + begin, p.z.begin() + end, p.prevZ.begin() + begin);
+    subtract(p.life.data(), deltaTime, begin, end);
+}
+
+void ParticleSystem::integrate(ParticleArrays& p, size_t begin, size_t end, float deltaTime) {
+    addScaled(p.x.data(), p.velX.data(), deltaTime, begin, end);
+    addScaled(p.y.data(), p.velY.data(), deltaTime, begin, end);
+    addScaled(p.z.data(), p.velZ.data(), deltaTime, begin, end);
+}
+
+//no per particle branches anywhere below. dead particles still get stepped until removeDeadParticles,
+//that's cheaper than testing for them here
+
+void ParticleSystem::updateDirt(ParticleArrays& p, size_t begin, size_t end, float deltaTime) {
+    startStep(p, begin, end, deltaTime);
+    subtract(p.alpha.data(), deltaTime * 1.2f, begin, end);
+    integrate(p, begin, end, deltaTime);
+}
+
+void ParticleSystem::updateDrifting(ParticleArrays& p, size_t begin, size_t end, float deltaTime,
+                                    const DriftParams& params, uint32_t seed) {
+    startStep(p, begin, end, deltaTime);
+    
+    float drift = params.driftSpeed * deltaTime;
+    addScaled(p.x.data(), p.driftX.data(), drift, begin, end);
+    addScaled(p.y.data(), p.driftY.data(), drift, begin, end);
+    addScaled(p.z.data(), p.driftZ.data(), drift, begin, end);
+    
+    float* y = p.y.data();
+    const float* life = p.life.data();
+    const float* startLife = p.startLife.data();
+    float bob = params.bobAmount * deltaTime;
+    for (size_t i = begin; i < end; i++) {
+        y[i] += FastMath::sin((startLife[i] - life[i]) * params.bobSpeed) * bob;
+    }
+    
+    //different stream per axis so x, y and z don't get the same numbers
+    jitter(p.velX.data(), params.jitterXZ * deltaTime, seed, begin, end);
+    jitter(p.velY.data(), params.jitterY * deltaTime, seed ^ 0x68e31da4u, begin, end);
+    jitter(p.velZ.data(), params.jitterXZ * deltaTime, seed ^ 0xb5297a4du, begin, end);
+    
+    //fades in over the first 20% of its life and out over the rest
+    float* alpha = p.alpha.data();
+    for (size_t i = begin; i < end; i++) {
+        float lifeRatio = life[i] / startLife[i];
+        float fadeIn = (1.0f - lifeRatio) * 5.0f;
+        float fadeOut = lifeRatio * 1.25f;
+        //selects rather than std::min / max, those come out as branches
+        float fade = fadeIn < fadeOut ? fadeIn : fadeOut;
+        fade = fade > 0.0f ? fade : 0.0f;
+        fade = fade < 1.0f ? fade : 1.0f;
+        alpha[i] = params.peakAlpha * fade;
+    }
+    
+    integrate(p, begin, end, deltaTime);
+}
+
+void ParticleSystem::updateLeaves(ParticleArrays& p, size_t begin, size_t end, float deltaTime) {
+    startStep(p, begin, end, deltaTime);
+    
+    float drift = 0.2f * deltaTime;
+    addScaled(p.x.data(), p.driftX.data(), drift, begin, end);
+    addScaled(p.z.data(), p.driftZ.data(), drift, begin, end);
+    
+    float* velX = p.velX.data();
+    float* velZ = p.velZ.data();
+    const float* life = p.life.data();
+    const float* startLife = p.startLife.data();
+    float swirl = 0.05f * deltaTime;
+    for (size_t i = begin; i < end; i++) {
+        float rotation = FastMath::sin((startLife[i] - life[i]) * 2.0f) * 0.1f;
+        velX[i] += FastMath::cos(rotation) * swirl;
+        velZ[i] += FastMath::sin(rotation) * swirl;
+    }
+    
+    subtract(p.alpha.data(), deltaTime * 0.25f, begin, end);
+    integrate(p, begin, end, deltaTime);
+}
+
+void ParticleSystem::removeDeadParticles() {
+    //backwards so whatever gets swapped in has already been looked at
+    for (ParticleArrays& bucket : m_buckets) {
+        for (size_t i = bucket.size(); i-- > 0;) {
+            if (bucket.life[i] <= 0.0f) {
+                bucket.swapRemove(i);
+            }
+        }
+    }
+}
+
+void ParticleSystem::update(float deltaTime, const Camera& camera, const Map* map, bool isMoving, float cameraHeightMultiplier, int currentBiome) {
     if (!m_particlesEnabled) {
         return;
     }
+    m_groundMap = map;
+    m_tick++;
     
     spawnDirtParticles(deltaTime, camera, isMoving, cameraHeightMultiplier);
     
-    spawnDustParticles(deltaTime, camera, cameraHeightMultiplier, 1);
-    
-    if (currentBiome == 1) {
-        spawnFogWisp(deltaTime, camera);
-    }
-    
-    m_aliveFogInstances.clear();
-    m_aliveDirtInstances.clear();
-    m_aliveDustInstances.clear();
-    m_aliveLeafInstances.clear();
-    m_aliveFogInstances.reserve(m_maxParticles);
-    m_aliveDirtInstances.reserve(m_maxParticles);
-    m_aliveDustInstances.reserve(m_maxParticles);
-    m_aliveLeafInstances.reserve(m_maxParticles);
-    
-    for (Particle &p : m_particles) {
-        if (p.Life > 0.0f) {
-            p.Life -= deltaTime;
-            
-            if (p.pType == PARTICLE_FOG_WISP) {
-                float driftSpeed = 0.4f;
-                p.Position += p.DriftDir * driftSpeed * deltaTime;
-                
-                float bobSpeed = 1.2f;
-                float bobAmount = 0.25f;
-                p.Position.y += sin((p.StartLife - p.Life) * bobSpeed) * bobAmount * deltaTime;
-                
-                glm::vec3 spread(
-                    ((rand() % 100) / 100.0f - 0.5f) * 0.002f,
-                    ((rand() % 100) / 100.0f - 0.5f) * 0.001f,
-                    ((rand() % 100) / 100.0f - 0.5f) * 0.002f
-                );
-                p.Velocity += spread * deltaTime;
-                
-                float lifeRatio = p.Life / p.StartLife;
-                if (lifeRatio > 0.8f) {
-                    float t = (1.0f - lifeRatio) / 0.2f;
-                    t = glm::clamp(t, 0.0f, 1.0f);
-                    p.Color.a = glm::mix(0.0f, 0.15f, t);
-                } else {
-                    float t = lifeRatio / 0.8f;
-                    t = glm::clamp(t, 0.0f, 1.0f);
-                    p.Color.a = glm::mix(0.15f, 0.0f, 1.0f - t);
-                }
-            } else if (p.pType == PARTICLE_DUST || p.pType == PARTICLE_DUST_MOUNTAIN || 
-                       p.pType == PARTICLE_DUST_FOREST || p.pType == PARTICLE_DUST_GRASSLAND) {
-                float driftSpeed = 0.3f;
-                p.Position += p.DriftDir * driftSpeed * deltaTime;
-                
-                float bobSpeed = 0.8f;
-                float bobAmount = 0.15f;
-                p.Position.y += sin((p.StartLife - p.Life) * bobSpeed) * bobAmount * deltaTime;
-                
-                glm::vec3 spread(
-                    ((rand() % 100) / 100.0f - 0.5f) * 0.001f,
-                    ((rand() % 100) / 100.0f - 0.5f) * 0.0005f,
-                    ((rand() % 100) / 100.0f - 0.5f) * 0.001f
-                );
-                p.Velocity += spread * deltaTime;
-                
-                float lifeRatio = p.Life / p.StartLife;
-                if (lifeRatio > 0.8f) {
-                    float t = (1.0f - lifeRatio) / 0.2f;
-                    t = glm::clamp(t, 0.0f, 1.0f);
-                    p.Color.a = glm::mix(0.0f, 0.5f, t);
-                } else {
-                    float t = lifeRatio / 0.8f;
-                    t = glm::clamp(t, 0.0f, 1.0f);
-                    p.Color.a = glm::mix(0.5f, 0.0f, 1.0f - t);
-                }
-            } else if (p.pType == PARTICLE_LEAF) {
-                p.Position += p.DriftDir * 0.2f * deltaTime;
-                float rotation = sin((p.StartLife - p.Life) * 2.0f) * 0.1f;
-                p.Velocity.x += cos(rotation) * 0.05f * deltaTime;
-                p.Velocity.z += sin(rotation) * 0.05f * deltaTime;
-                p.Color.a -= deltaTime * 0.25f;
-            } else {
-                p.Color.a -= deltaTime * 1.2f;
-            }
-            
-            p.Position += p.Velocity * deltaTime;
-            
-            ParticleInstance inst;
-            inst.pos = p.Position;
-            inst.size = p.Size;
-            inst.color = p.Color;
-            inst.type = static_cast<int>(p.pType);
-            
-            if (p.pType == PARTICLE_FOG_WISP) {
-                m_aliveFogInstances.push_back(inst);
-            } else if (p.pType == PARTICLE_DUST || p.pType == PARTICLE_DUST_MOUNTAIN || 
-                       p.pType == PARTICLE_DUST_FOREST || p.pType == PARTICLE_DUST_GRASSLAND) {
-                m_aliveDustInstances.push_back(inst);
-            } else if (p.pType == PARTICLE_LEAF) {
-                m_aliveLeafInstances.push_back(inst);
-            } else {
-                m_aliveDirtInstances.push_back(inst);
+    //on the gpu fog and dust are only an emitter for the renderer, their buckets stay empty
+    m_gpuEmitter.enabled = m_gpuSimulation;
+    if (m_gpuSimulation) {
+        m_buckets[BUCKET_FOG].clear();
+        m_buckets[BUCKET_DUST].clear();
+        m_gpuEmitter.tick = m_tick;
+        m_gpuEmitter.deltaTime = deltaTime;
+        m_gpuEmitter.eye = camera.getPosition();
+        m_gpuEmitter.look = camera.getLook();
+        m_gpuEmitter.spawnFog = m_fogWispsEnabled && currentBiome == 1;
+        m_gpuEmitter.poolSize = m_maxParticles;
+    } else {
+        spawnDustParticles(deltaTime, camera, cameraHeightMultiplier, 1);
+        
+        if (currentBiome == 1) {
+            spawnFogWisp(deltaTime, camera);
+        }
+    }
+    
+    uint32_t seed = FastRandom::hash(m_tick);
+    
+    ParallelFor::run(m_buckets[BUCKET_DIRT].size(), PARTICLES_PER_JOB, [&](size_t begin, size_t end) {
+        updateDirt(m_buckets[BUCKET_DIRT], begin, end, deltaTime);
+    });
+    ParallelFor::run(m_buckets[BUCKET_FOG].size(), PARTICLES_PER_JOB, [&](size_t begin, size_t end) {
+        updateDrifting(m_buckets[BUCKET_FOG], begin, end, deltaTime, FOG_PARAMS, seed);
+    });
+    ParallelFor::run(m_buckets[BUCKET_DUST].size(), PARTICLES_PER_JOB, [&](size_t begin, size_t end) {
+        updateDrifting(m_buckets[BUCKET_DUST], begin, end, deltaTime, DUST_PARAMS, seed ^ 0x9e3779b9u);
+    });
+    ParallelFor::run(m_buckets[BUCKET_LEAF].size(), PARTICLES_PER_JOB, [&](size_t begin, size_t end) {
+        updateLeaves(m_buckets[BUCKET_LEAF], begin, end, deltaTime);
+    });
+    
+    removeDeadParticles();
+}
+
+void ParticleSystem::copyParticles(DrawState& out, const glm::vec3& eye, const glm::vec3& look, float fovY) const {
+    //half angle out to the corner of a very wide screen, plus slack for sprite size and a tick of turning
+    const float MAX_ASPECT_DIAGONAL = 2.7f;   //sqrt(1 + 2.5^2)
+    const float CONE_SLACK = glm::radians(10.0f);
+    const float KEEP_RADIUS = 2.0f;            //sprites this close can cover the screen from any side
+    float halfAngle = std::atan(std::tan(glm::radians(fovY) * 0.5f) * MAX_ASPECT_DIAGONAL) + CONE_SLACK;
+    out.gpu = m_gpuEmitter;
+    if (halfAngle >= glm::radians(90.0f) || glm::length(look) < 0.0001f) {
+        for (int b = 0; b < BUCKET_COUNT; b++) {
+            out.buckets[b] = static_cast<const DrawArrays&>(m_buckets[b]);
+        }
+        return;
+    }
+    glm::vec3 forward = glm::normalize(look);
+    float cosSq = std::cos(halfAngle) * std::cos(halfAngle);
+    
+    for (int b = 0; b < BUCKET_COUNT; b++) {
+        const DrawArrays& in = m_buckets[b];
+        DrawArrays& dst = out.buckets[b];
+        dst.clear();
+        for (size_t i = 0; i < in.size(); i++) {
+            glm::vec3 offset(in.x[i] - eye.x, in.y[i] - eye.y, in.z[i] - eye.z);
+            float along = glm::dot(offset, forward);
+            float distSq = glm::dot(offset, offset);
+            //along / |offset| > cos(halfAngle) without the sqrt
+            if (distSq > KEEP_RADIUS * KEEP_RADIUS && (along <= 0.0f || along * along < cosSq * distSq)) {
+                continue;
             }
+            dst.x.push_back(in.x[i]);
+            dst.y.push_back(in.y[i]);
+            dst.z.push_back(in.z[i]);
+            dst.prevX.push_back(in.prevX[i]);
+            dst.prevY.push_back(in.prevY[i]);
+            dst.prevZ.push_back(in.prevZ[i]);
+            dst.particleSize.push_back(in.particleSize[i]);
+            dst.alpha.push_back(in.alpha[i]);
         }
     }
 }
 
-void ParticleSystem::draw(const Camera& camera) {
-    if (!m_particlesEnabled || (m_aliveFogInstances.empty() && m_aliveDirtInstances.empty() && m_aliveDustInstances.empty() && m_aliveLeafInstances.empty())) {
+size_t ParticleSystem::writeInstances(const DrawState& state, float alpha, uint32_t bucketMask, ParticleInstance* out,
+                                      uint32_t* runSizes) {
+    //draw() sorts these by depth afterwards, the order here only decides ties. fog first, behind everything
+    const Bucket DRAW_ORDER[BUCKET_COUNT] = {BUCKET_FOG, BUCKET_DIRT, BUCKET_DUST, BUCKET_LEAF};
+    
+    size_t offset = 0;
+    for (int run = 0; run < BUCKET_COUNT; run++) {
+        Bucket b = DRAW_ORDER[run];
+        if (runSizes != nullptr) {
+            runSizes[run] = (bucketMask & (1u << b)) ? static_cast<uint32_t>(state.buckets[b].size()) : 0u;
+        }
+        if ((bucketMask & (1u << b)) == 0) {
+            continue;
+        }
+        const DrawArrays& bucket = state.buckets[b];
+        ParticleInstance* bucketOut = out + offset;
+        glm::vec3 color = BUCKET_COLORS[b];
+        int layer = BUCKET_LAYERS[b];
+        //sim runs at a fixed rate, blend the last two ticks for whatever frame we're drawing
+        ParallelFor::run(bucket.size(), PARTICLES_PER_JOB, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                ParticleInstance& inst = bucketOut[i];
+                inst.pos = glm::vec3(bucket.prevX[i] + (bucket.x[i] - bucket.prevX[i]) * alpha,
+                                     bucket.prevY[i] + (bucket.y[i] - bucket.prevY[i]) * alpha,
+                                     bucket.prevZ[i] + (bucket.z[i] - bucket.prevZ[i]) * alpha);
+                inst.size = bucket.particleSize[i];
+                inst.color = glm::vec4(color, bucket.alpha[i]);
+                inst.layer = layer;
+            }
+        }, ParallelFor::RENDER);
+        offset += bucket.size();
+    }
+    return offset;
+}
+
+void ParticleSystem::writeSortKeys(const ParticleInstance* instances, size_t count, const glm::vec3& eye,
+                                   const glm::vec3& forward, float farDistance, uint16_t* keys) {
+    //no finer than SORT_KEY_STEP: nobody sees two wisps a hair apart blend the wrong way round, and coarser keys
+    //tie more often, so more of last frame's order survives
+    float scale = std::min(65535.0f / std::max(farDistance, 0.001f), 1.0f / SORT_KEY_STEP);
+    float eyeDepth = glm::dot(eye, forward) * scale;
+    glm::vec3 step = forward * scale;
+    ParallelFor::run(count, PARTICLES_PER_JOB, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const glm::vec3& pos = instances[i].pos;
+            float depth = pos.x * step.x + pos.y * step.y + pos.z * step.z - eyeDepth;
+            depth = depth > 0.0f ? depth : 0.0f;
+            depth = depth < 65535.0f ? depth : 65535.0f;
+            //farthest gets the smallest key so an ascending sort comes out back to front. flipped as an int,
+            //flipping the float first stops gcc turning the clamps into selects
+            keys[i] = static_cast<uint16_t>(65535 - static_cast<int>(depth));
+        }
+    }, ParallelFor::RENDER);
+}
+
+void ParticleSystem::bindInstanceAttributes(GLintptr byteOffset) {
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceStream.getBuffer());
+    size_t base = static_cast<size_t>(byteOffset);
+    
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)(base + offsetof(ParticleInstance, pos)));
+    glVertexAttribDivisor(2, 1);
+    
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)(base + offsetof(ParticleInstance, size)));
+    glVertexAttribDivisor(3, 1);
+    
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)(base + offsetof(ParticleInstance, color)));
+    glVertexAttribDivisor(4, 1);
+    
+    glEnableVertexAttribArray(5);
+    glVertexAttribIPointer(5, 1, GL_INT, sizeof(ParticleInstance), (void*)(base + offsetof(ParticleInstance, layer)));
+    glVertexAttribDivisor(5, 1);
+}
+
+GpuParticles::Emitter ParticleSystem::buildGpuEmitter(const GpuEmitter& emitter) {
+    //same numbers as the cpu kernels and spawners. no map on the gpu, so heights are from the eye not the ground
+    GpuParticles::Emitter params = {};
+    params.origin = glm::vec4(emitter.eye, emitter.deltaTime);
+    params.heading.x = std::atan2(emitter.look.z, emitter.look.x);
+    GpuParticles::KindParams& fog = params.kinds[GpuParticles::KIND_FOG];
+    fog.motion = glm::vec4(FOG_PARAMS.driftSpeed, FOG_PARAMS.bobSpeed, FOG_PARAMS.bobAmount, FOG_PARAMS.peakAlpha);
+    fog.jitter = glm::vec4(FOG_PARAMS.jitterXZ, FOG_PARAMS.jitterY, 0.01f, 0.005f);
+    fog.ring = glm::vec4(25.0f, 35.0f, glm::radians(55.0f), -0.0025f);
+    fog.band = glm::vec4(-1.0f, 1.0f, 8.0f, 12.0f);
+    fog.shape = glm::vec4(3.0f, 4.0f, 0.0f, 1.0f);
+    GpuParticles::KindParams& dust = params.kinds[GpuParticles::KIND_DUST];
+    dust.motion = glm::vec4(DUST_PARAMS.driftSpeed, DUST_PARAMS.bobSpeed, DUST_PARAMS.bobAmount, DUST_PARAMS.peakAlpha);
+    dust.jitter = glm::vec4(DUST_PARAMS.jitterXZ, DUST_PARAMS.jitterY, 0.2f, 0.2f);
+    dust.ring = glm::vec4(16.0f, 25.0f, glm::radians(120.0f), 0.15f);
+    dust.band = glm::vec4(-3.0f, -2.2f, 3.0f, 5.0f);
+    dust.shape = glm::vec4(0.12f, 0.24f, 0.7f, 0.3f);
+    params.split.y = (emitter.spawnFog ? (1u << GpuParticles::KIND_FOG) : 0u) | (1u << GpuParticles::KIND_DUST);
+    return params;
+}
+
+void ParticleSystem::stepGpuParticles(const GpuEmitter& emitter) {
+    if (!emitter.enabled || emitter.poolSize <= 0) {
+        if (m_gpuParticles.isInitialized()) {
+            m_gpuParticles.cleanup();
+        }
+        m_gpuFailed = false;
         return;
     }
+    int fogSlots = static_cast<int>(static_cast<float>(emitter.poolSize) * GPU_FOG_FRACTION);
+    if (m_gpuParticles.getPoolSize() != emitter.poolSize) {
+        //a shader that didn't build won't build next frame either, wait for the next time it's switched on
+        if (m_gpuFailed || !m_gpuParticles.initialize(emitter.poolSize, fogSlots)) {
+            m_gpuFailed = true;
+            return;
+        }
+        m_gpuTick = emitter.tick - 1;
+    }
+    if (emitter.tick == m_gpuTick) {
+        return;
+    }
+    
+    GpuParticles::Emitter params = buildGpuEmitter(emitter);
     
-    if (m_particleShader == 0) {
+    //a slow frame can cover a few sim ticks, they all get the newest camera but their own seed
+    uint32_t pending = std::min(emitter.tick - m_gpuTick, MAX_GPU_STEPS_PER_FRAME);
+    ProfileScope stepScope("GPU particle step", true);
+    for (uint32_t tick = emitter.tick - pending + 1; tick != emitter.tick + 1; tick++) {
+        params.spawn.w = FastRandom::hash(tick);
+        m_gpuParticles.advanceSpawnWindow(params);
+        m_gpuParticles.step(params);
+    }
+    m_gpuTick = emitter.tick;
+}
+
+void ParticleSystem::drawGpuParticles(const glm::mat4& view, const glm::mat4& proj, bool softFade,
+                                      const glm::vec2& viewportSize) {
+    glUseProgram(m_gpuShader);
+    glUniformMatrix4fv(m_gpuViewLoc, 1, GL_FALSE, &view[0][0]);
+    glUniformMatrix4fv(m_gpuProjLoc, 1, GL_FALSE, &proj[0][0]);
+    glUniform1i(m_gpuSoftFadeLoc, softFade ? 1 : 0);
+    glUniform2f(m_gpuViewportSizeLoc, viewportSize.x, viewportSize.y);
+    glUniform1f(m_gpuFadeDistanceLoc, SOFT_FADE_DISTANCE);
+    glUniform1i(m_gpuFogSlotsLoc, m_gpuParticles.getFogSlots());
+    //fog switched off mid life just goes invisible, its slots stop respawning on their own
+    float fogAlpha = m_fogWispsEnabled ? FOG_PARAMS.peakAlpha : 0.0f;
+    float dustAlpha = m_spriteLoaded[SPRITE_DUST_MOUNTAIN] ? DUST_PARAMS.peakAlpha : 0.0f;
+    const glm::vec4 kindColors[GpuParticles::KIND_COUNT] = {
+        glm::vec4(BUCKET_COLORS[BUCKET_FOG], fogAlpha),
+        glm::vec4(BUCKET_COLORS[BUCKET_DUST], dustAlpha)
+    };
+    const GLint kindLayers[GpuParticles::KIND_COUNT] = {BUCKET_LAYERS[BUCKET_FOG], BUCKET_LAYERS[BUCKET_DUST]};
+    glUniform4fv(m_gpuKindColorsLoc, GpuParticles::KIND_COUNT, &kindColors[0][0]);
+    glUniform1iv(m_gpuKindLayersLoc, GpuParticles::KIND_COUNT, kindLayers);
+    
+    glBindVertexArray(m_gpuVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_gpuParticles.getStateBuffer());
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(GpuParticles::Particle),
+                          (void*)offsetof(GpuParticles::Particle, position));
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(GpuParticles::Particle),
+                          (void*)offsetof(GpuParticles::Particle, life));
+    glVertexAttribDivisor(3, 1);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, m_gpuParticles.getPoolSize());
+    Profiler::countDrawCall();
+    glBindVertexArray(0);
+}
+
+void ParticleSystem::draw(const Camera& camera, const DrawState& state, float alpha, GLuint sceneDepth) {
+    if (!m_particlesEnabled) {
+        return;
+    }
+    if (m_particleShader == 0 || m_spriteArray == 0) {
         return;
     }
     
-    glUseProgram(m_particleShader);
+    stepGpuParticles(state.gpu);
+    bool drawGpu = m_gpuParticles.isInitialized() && m_gpuShader != 0;
+    
+    //kinds that are switched off or whose sprite never loaded just don't get written
+    uint32_t bucketMask = 0;
+    bucketMask |= m_dirtParticlesEnabled ? (1u << BUCKET_DIRT) : 0u;
+    bucketMask |= m_fogWispsEnabled ? (1u << BUCKET_FOG) : 0u;
+    bucketMask |= m_spriteLoaded[SPRITE_DUST_MOUNTAIN] ? (1u << BUCKET_DUST) : 0u;
+    bucketMask |= m_spriteLoaded[SPRITE_LEAF] ? (1u << BUCKET_LEAF) : 0u;
+    size_t total = 0;
+    for (int b = 0; b < BUCKET_COUNT; b++) {
+        if (bucketMask & (1u << b)) {
+            total += state.buckets[b].size();
+        }
+    }
+    if (total == 0 && !drawGpu) {
+        return;
+    }
     
-    // Camera matrices
     glm::mat4 view = camera.getViewMatrix();
     glm::mat4 proj = camera.getProjMatrix();
-    glUniformMatrix4fv(glGetUniformLocation(m_particleShader, "view"), 1, GL_FALSE, &view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(m_particleShader, "proj"), 1, GL_FALSE, &proj[0][0]);
-    
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDepthMask(GL_FALSE);
-    glDisable(GL_DEPTH_TEST);
-    
-    glBindVertexArray(m_particleVAO);
     
-    if (!m_aliveFogInstances.empty() && m_fogWispsEnabled) {
-        glBindBuffer(GL_ARRAY_BUFFER, m_particleInstanceVBO);
-        glBufferData(GL_ARRAY_BUFFER, m_aliveFogInstances.size() * sizeof(ParticleInstance), m_aliveFogInstances.data(), GL_DYNAMIC_DRAW);
-        
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_wispParticleTexture);
-        glUniform1i(glGetUniformLocation(m_particleShader, "sprite"), 0);
+    //one upload per frame: every bucket's instances go into a single slice of the stream buffer
+    m_instanceStream.beginFrame();
+    StreamBuffer::Allocation instances = {};
+    if (total > 0) {
+        //alpha blending wants back to front. instances are built on the side, sorted by view depth and then
+        //written into the stream in that order, so the mapped memory only ever sees sequential writes
+        m_unsortedInstances.resize(total);
+        m_sortKeys.resize(total);
+        uint32_t runSizes[BUCKET_COUNT];
+        writeInstances(state, alpha, bucketMask, m_unsortedInstances.data(), runSizes);
+        const std::vector<uint32_t>* order = nullptr;
+        {
+            ProfileScope sortScope("Particle sort");
+            //far plane straight out of the projection, proj[3][2] / (1 + proj[2][2])
+            float farDistance = proj[3][2] / (1.0f + proj[2][2]);
+            glm::vec3 forward = -glm::vec3(view[0][2], view[1][2], view[2][2]);
+            writeSortKeys(m_unsortedInstances.data(), total, camera.getPosition(), forward, farDistance, m_sortKeys.data());
+            //buckets only grow and shrink at their ends, which lets the sort pick up last frame's order
+            order = &m_depthSort.sort(m_sortKeys.data(), runSizes, BUCKET_COUNT);
+        }
         
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(m_aliveFogInstances.size()));
+        instances = m_instanceStream.allocate(static_cast<GLsizeiptr>(total * sizeof(ParticleInstance)));
+        if (instances.data != nullptr) {
+            ParticleInstance* sorted = static_cast<ParticleInstance*>(instances.data);
+            const ParticleInstance* unsorted = m_unsortedInstances.data();
+            const uint32_t* sortedOrder = order->data();
+            ParallelFor::run(total, PARTICLES_PER_JOB, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    sorted[i] = unsorted[sortedOrder[i]];
+                }
+            }, ParallelFor::RENDER);
+        }
+        if (instances.data == nullptr || !m_instanceStream.finish(instances)) {
+            //the gpu pool can still go out on its own
+            total = 0;
+        }
+    }
+    if (total == 0 && !drawGpu) {
+        m_instanceStream.endFrame();
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
     }
     
-    if (!m_aliveDirtInstances.empty() && m_dirtParticlesEnabled) {
-        glBindBuffer(GL_ARRAY_BUFFER, m_particleInstanceVBO);
-        glBufferData(GL_ARRAY_BUFFER, m_aliveDirtInstances.size() * sizeof(ParticleInstance), m_aliveDirtInstances.data(), GL_DYNAMIC_DRAW);
-        
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_dirtParticleTexture);
-        glUniform1i(glGetUniformLocation(m_particleShader, "sprite"), 0);
-        
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(m_aliveDirtInstances.size()));
+    //every kind uses the same alpha blend so they all fit in one draw. one that needs another blend mode
+    //would get its own range of the buffer and a second draw
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glm::vec2 viewportSize(0.0f);
+    if (sceneDepth != 0) {
+        //the bound framebuffer has no scene depth (drawn after the upscale), the shader tests the texture itself
+        //and fades particles out as they get close to it instead of cutting them off
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        viewportSize = glm::vec2(static_cast<float>(viewport[2]), static_cast<float>(viewport[3]));
+        glDisable(GL_DEPTH_TEST);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, sceneDepth);
+    } else {
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS);
     }
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_spriteArray);
     
-    if (!m_aliveDustInstances.empty() && m_dustMountainTexture != 0) {
-        glBindBuffer(GL_ARRAY_BUFFER, m_particleInstanceVBO);
-        glBufferData(GL_ARRAY_BUFFER, m_aliveDustInstances.size() * sizeof(ParticleInstance), m_aliveDustInstances.data(), GL_DYNAMIC_DRAW);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_dustMountainTexture);
-        glUniform1i(glGetUniformLocation(m_particleShader, "sprite"), 0);
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(m_aliveDustInstances.size()));
+    //the gpu pool isn't sorted, it goes first so the sorted cpu particles at least land on top of it
+    if (drawGpu) {
+        drawGpuParticles(view, proj, sceneDepth != 0, viewportSize);
     }
     
-    if (!m_aliveLeafInstances.empty() && m_leafParticleTexture != 0) {
-        glBindBuffer(GL_ARRAY_BUFFER, m_particleInstanceVBO);
-        glBufferData(GL_ARRAY_BUFFER, m_aliveLeafInstances.size() * sizeof(ParticleInstance), m_aliveLeafInstances.data(), GL_DYNAMIC_DRAW);
+    if (total > 0) {
+        glUseProgram(m_particleShader);
         
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_leafParticleTexture);
-        glUniform1i(glGetUniformLocation(m_particleShader, "sprite"), 0);
+        // Camera matrices
+        glUniformMatrix4fv(m_viewLoc, 1, GL_FALSE, &view[0][0]);
+        glUniformMatrix4fv(m_projLoc, 1, GL_FALSE, &proj[0][0]);
+        glUniform1i(m_softFadeLoc, sceneDepth != 0 ? 1 : 0);
+        glUniform2f(m_viewportSizeLoc, viewportSize.x, viewportSize.y);
+        glUniform1f(m_fadeDistanceLoc, SOFT_FADE_DISTANCE);
         
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(m_aliveLeafInstances.size()));
+        glBindVertexArray(m_particleVAO);
+        bindInstanceAttributes(instances.offset);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(total));
+        Profiler::countDrawCall();
+        glBindVertexArray(0);
     }
-    
-    glBindVertexArray(0);
+    m_instanceStream.endFrame();
     
     glVertexAttribDivisor(2, 0);
     glVertexAttribDivisor(3, 0);
@@ -636,8 +1055,12 @@ void ParticleSystem::draw(const Camera& camera) {
     
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    if (sceneDepth != 0) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
     
     glEnable(GL_DEPTH_TEST);
     glDepthMask(GL_TRUE);
@@ -665,8 +1088,15 @@ void ParticleSystem::setFogWispSpawnInterval(float interval) {
     m_fogWispSpawnInterval = interval;
 }
 
+void ParticleSystem::setGpuSimulation(bool enabled) {
+    m_gpuSimulation = enabled;
+}
+
 void ParticleSystem::setMaxParticles(int maxParticles) {
-    m_maxParticles = maxParticles;
-    m_particles.resize(m_maxParticles);
+    m_maxParticles = std::max(maxParticles, 0);
+    //over the new cap just stops spawning until enough have died off
+    for (ParticleArrays& bucket : m_buckets) {
+        bucket.reserve(static_cast<size_t>(m_maxParticles));
+    }
 }
 
@@ -5,10 +5,16 @@
 #endif
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
 #include <QImage>
+#include "utils/depthsort.h"
+#include "utils/fastrandom.h"
+#include "utils/streambuffer.h"
+#include "gpuparticles.h"
 
 class Camera;
+class Map;
 
 class ParticleSystem {
 public:
@@ -23,26 +29,64 @@ public:
         PARTICLE_LEAF
     };
     
+    //layers of the sprite texture array, one per particle image
+    enum SpriteLayer {
+        SPRITE_DIRT,
+        SPRITE_WISP,
+        SPRITE_DUST_MOUNTAIN,
+        SPRITE_DUST_FOREST,
+        SPRITE_DUST_GRASSLAND,
+        SPRITE_LEAF,
+        SPRITE_LAYER_COUNT
+    };
+    
     struct ParticleInstance {
         glm::vec3 pos;
         float size;
         glm::vec4 color;
-        int type;
+        int layer;      //SpriteLayer
+    };
+    
+    //particles live in one bucket per kind, each with its own update kernel, texture and draw call
+    enum Bucket {
+        BUCKET_DIRT,
+        BUCKET_FOG,
+        BUCKET_DUST,
+        BUCKET_LEAF,
+        BUCKET_COUNT
+    };
+    static constexpr uint32_t ALL_BUCKETS = (1u << BUCKET_COUNT) - 1;
+    
+    //what drawing a bucket needs, particle i is index i in every array. the sim's own buckets extend this,
+    //so a snapshot is a straight copy of these arrays
+    struct DrawArrays {
+        std::vector<float> x, y, z;
+        std::vector<float> prevX, prevY, prevZ;   //position at the start of the last tick, for render interpolation
+        std::vector<float> particleSize;
+        std::vector<float> alpha;                 //rgb is the same for the whole bucket
+        
+        size_t size() const { return x.size(); }
+        void clear();
+    };
+    
+    //what the gpu pool needs to step one tick, the sim thread fills it in instead of updating fog / dust itself
+    struct GpuEmitter {
+        bool enabled = false;
+        uint32_t tick = 0;
+        float deltaTime = 0.0f;
+        glm::vec3 eye = glm::vec3(0.0f);
+        glm::vec3 look = glm::vec3(0.0f, 0.0f, -1.0f);
+        bool spawnFog = false;
+        int poolSize = 0;
     };
     
-    struct Particle {
-        glm::vec3 Position;
-        glm::vec3 Velocity;
-        glm::vec4 Color;
-        float StartLife;
-        float Life;
-        float Size;
-        ParticleType pType;
-        glm::vec3 DriftDir;
+    //one tick's particles for the renderer, copied out on the sim thread
+    struct DrawState {
+        DrawArrays buckets[BUCKET_COUNT];
+        GpuEmitter gpu;
         
-        Particle()
-            : Position(0.0f), Velocity(0.0f),
-            Color(1.0f), Life(0.0f) {}
+        size_t count() const;
+        void clear();
     };
     
     ParticleSystem();
@@ -50,8 +94,30 @@ public:
     
     void initialize();
     void cleanup();
-    void update(float deltaTime, const Camera& camera, bool isMoving, float cameraHeightMultiplier, int currentBiome);
-    void draw(const Camera& camera);
+    //map can be null, it's only used to set particles down on the ground
+    void update(float deltaTime, const Camera& camera, const Map* map, bool isMoving, float cameraHeightMultiplier, int currentBiome);
+    //draws a copy from copyParticles(), the sim thread keeps the live buckets to itself.
+    //alpha blends between the last two update() positions (1 = newest). sceneDepth is a depth texture of what's
+    //already drawn (any resolution), particles fade out where they meet it. 0 depth tests against the bound
+    //framebuffer's own depth instead
+    void draw(const Camera& camera, const DrawState& state, float alpha, GLuint sceneDepth = 0);
+    //reuses out's storage, so after a few ticks this doesn't allocate. only particles in a cone around look
+    //(wider than any screen at fovY) or right next to the eye get copied, the rest can't be on screen
+    void copyParticles(DrawState& out, const glm::vec3& eye, const glm::vec3& look, float fovY) const;
+    //instances of the buckets in bucketMask (bit per Bucket) back to back in draw order, fog first so it ends up
+    //behind the rest. out needs room for state.count(), returns how many were written. runSizes (optional,
+    //BUCKET_COUNT of them) gets how many each bucket wrote in that order, 0 for masked ones
+    static size_t writeInstances(const DrawState& state, float alpha, uint32_t bucketMask, ParticleInstance* out,
+                                 uint32_t* runSizes = nullptr);
+    //view depth along forward quantized to 16 bits, far first, for DepthSort. past farDistance all look the same
+    static void writeSortKeys(const ParticleInstance* instances, size_t count, const glm::vec3& eye,
+                              const glm::vec3& forward, float farDistance, uint16_t* keys);
+    //the update shader's emitter block for one tick of emitter, seed and spawn window still to fill in.
+    //fog and dust use the cpu kernels' and spawners' numbers
+    static GpuParticles::Emitter buildGpuEmitter(const GpuEmitter& emitter);
+    //how the last draw()'s back to front sort went
+    const DepthSort::Stats& getSortStats() const { return m_depthSort.getStats(); }
+    int getParticleCount() const;
     
     // Settings
     void setEnabled(bool enabled);
@@ -60,22 +126,88 @@ public:
     void setDirtSpawnRate(float rate);
     void setFogWispSpawnInterval(float interval);
     void setMaxParticles(int maxParticles);
+    //fog and dust stepped by GpuParticles on the gl thread instead of the cpu kernels, max particles slots of it.
+    //the pool is made in the first draw() after this and dropped in the first one after it's turned off
+    void setGpuSimulation(bool enabled);
     
     bool isEnabled() const { return m_particlesEnabled; }
+    bool isGpuSimulation() const { return m_gpuSimulation; }
     
 private:
+    //stress tests top the buckets up straight through the spawners
+    friend class Benchmark;
+    
+    //the sim's side of a bucket. removing a particle moves the last one into its slot, order means nothing
+    struct ParticleArrays : DrawArrays {
+        std::vector<float> velX, velY, velZ;
+        std::vector<float> driftX, driftY, driftZ;
+        std::vector<float> life;
+        std::vector<float> startLife;
+        
+        void push(const glm::vec3& position, const glm::vec3& velocity, const glm::vec3& drift,
+                  float lifetime, float size, float startAlpha);
+        void swapRemove(size_t i);
+        void clear();
+        void reserve(size_t count);
+    };
+    
+    //drifting wisps / dust, same motion with different numbers
+    struct DriftParams {
+        float driftSpeed;
+        float bobSpeed;
+        float bobAmount;
+        float jitterXZ;
+        float jitterY;
+        float peakAlpha;
+    };
+    static constexpr DriftParams FOG_PARAMS = {0.4f, 1.2f, 0.25f, 0.002f, 0.001f, 0.15f};
+    static constexpr DriftParams DUST_PARAMS = {0.3f, 0.8f, 0.15f, 0.001f, 0.0005f, 0.5f};
+    
+    static constexpr size_t PARTICLES_PER_JOB = 4096;
+    static constexpr int SPRITE_SIZE = 256;
+    //world units over which a particle fades out in front of the scene behind it
+    static constexpr float SOFT_FADE_DISTANCE = 0.5f;
+    //world units per sort key
+    static constexpr float SORT_KEY_STEP = 1.0f / 64.0f;
+    //share of the gpu pool that's fog, the rest is dust
+    static constexpr float GPU_FOG_FRACTION = 0.25f;
+    //ticks the gpu pool catches up in one frame, past that it just falls behind the sim
+    static constexpr uint32_t MAX_GPU_STEPS_PER_FRAME = 4;
+    
+    bool hasRoom() const { return getParticleCount() < m_maxParticles; }
+    //copies the positions to prev and takes deltaTime off the lives
+    static void startStep(ParticleArrays& p, size_t begin, size_t end, float deltaTime);
+    static void integrate(ParticleArrays& p, size_t begin, size_t end, float deltaTime);
+    static void updateDirt(ParticleArrays& p, size_t begin, size_t end, float deltaTime);
+    static void updateDrifting(ParticleArrays& p, size_t begin, size_t end, float deltaTime,
+                               const DriftParams& params, uint32_t seed);
+    static void updateLeaves(ParticleArrays& p, size_t begin, size_t end, float deltaTime);
+    void removeDeadParticles();
+    //makes / drops the gpu pool to match emitter and steps it up to emitter.tick
+    void stepGpuParticles(const GpuEmitter& emitter);
+    //the gpu pool straight from its state buffer, blend and depth state already set by draw()
+    void drawGpuParticles(const glm::mat4& view, const glm::mat4& proj, bool softFade, const glm::vec2& viewportSize);
+    //points the per instance attributes at the instance stream, byteOffset in, vao must be bound
+    void bindInstanceAttributes(GLintptr byteOffset);
+    //scales / flips one image into its layer of m_spriteArray, false if it couldn't be read
+    bool loadSpriteLayer(const QString& path, SpriteLayer layer, bool flip);
     void spawnSingleDirtParticle(const Camera& camera, float cameraHeightMultiplier);
     void spawnDirtParticles(float deltaTime, const Camera& camera, bool isMoving, float cameraHeightMultiplier);
+    void spawnSingleFogWisp(const Camera& camera);
     void spawnFogWisp(float deltaTime, const Camera& camera);
     void spawnDustParticle(const Camera& camera, float cameraHeightMultiplier, int biomeType);
     void spawnDustParticles(float deltaTime, const Camera& camera, float cameraHeightMultiplier, int biomeType);
     void spawnLeafParticle(const Camera& camera, float cameraHeightMultiplier);
     void spawnLeafParticles(float deltaTime, const Camera& camera, float cameraHeightMultiplier);
     glm::vec3 getCameraFeetPosition(const Camera& camera, float cameraHeightMultiplier) const;
+    //ground level at (x, z) from the map's surface heights, false if there's no map or no data there
+    bool getGroundHeight(float x, float z, float& groundY) const;
     
-    std::vector<Particle> m_particles;
+    ParticleArrays m_buckets[BUCKET_COUNT];
+    const Map* m_groundMap;     //the map update() was called with, for the spawn functions
     int m_maxParticles;
-    int m_nextParticle;
+    FastRandom m_random;        //spawning, sim thread only
+    uint32_t m_tick;            //seeds the kernels' per particle jitter
     bool m_particlesEnabled;
     bool m_dirtParticlesEnabled;
     bool m_fogWispsEnabled;
@@ -87,20 +219,38 @@ private:
     GLuint m_particleShader;
     GLuint m_particleVAO;
     GLuint m_particleVBO;
-    GLuint m_particleInstanceVBO;
-    std::vector<ParticleInstance> m_aliveFogInstances;
-    std::vector<ParticleInstance> m_aliveDirtInstances;
-    std::vector<ParticleInstance> m_aliveDustInstances;
-    std::vector<ParticleInstance> m_aliveLeafInstances;
-    GLuint m_dirtParticleTexture;
-    GLuint m_wispParticleTexture;
-    GLuint m_dustMountainTexture;
-    GLuint m_dustForestTexture;
-    GLuint m_dustGrasslandTexture;
-    GLuint m_leafParticleTexture;
+    StreamBuffer m_instanceStream;
+    GLint m_viewLoc;
+    GLint m_projLoc;
+    GLint m_softFadeLoc;
+    GLint m_viewportSizeLoc;
+    GLint m_fadeDistanceLoc;
+    //draw order is back to front over every kind at once, sorted from last frame's order
+    DepthSort m_depthSort;
+    std::vector<ParticleInstance> m_unsortedInstances;
+    std::vector<uint16_t> m_sortKeys;
+    //every particle image as one 256x256 texture array, so all kinds go out in one draw
+    GLuint m_spriteArray;
+    bool m_spriteLoaded[SPRITE_LAYER_COUNT];
     float m_dustSpawnTimer;
     float m_leafSpawnTimer;
     float m_dustSpawnInterval;
     float m_leafSpawnInterval;
+    
+    bool m_gpuSimulation;
+    GpuEmitter m_gpuEmitter;    //sim thread's copy, goes out with copyParticles
+    GpuParticles m_gpuParticles;
+    uint32_t m_gpuTick;         //last tick the pool was stepped to
+    bool m_gpuFailed;
+    GLuint m_gpuShader;
+    GLuint m_gpuVAO;
+    GLint m_gpuViewLoc;
+    GLint m_gpuProjLoc;
+    GLint m_gpuSoftFadeLoc;
+    GLint m_gpuViewportSizeLoc;
+    GLint m_gpuFadeDistanceLoc;
+    GLint m_gpuFogSlotsLoc;
+    GLint m_gpuKindColorsLoc;
+    GLint m_gpuKindLayersLoc;
 };
 
@@ -9,9 +9,11 @@
 #include "utils/shapefactory.h"
 #include "utils/shaderloader.h"
 #include "utils/debug.h"
+#include "utils/profiler.h"
 #include "utils/audiomanager.h"
 #include "map/mapproperties.h"
 #include "map/Map.h"
+#include "map/treearchetypes.h"
 #include "blocks/Block.h"
 #include <glm/gtx/transform.hpp>
 #include <glm/glm.hpp>
@@ -28,30 +30,70 @@
 #include <QStringList>
 #include <random>
 #include <iostream>
+#include <chrono>
+#include <QMetaObject>
+#include <QThread>
 #include "settings.h"
 
+//the path is sim state (playback moves m_simCamera), so the ui side pauses the sim around it
 void Realtime::addPathWaypoint() {
-    glm::vec3 pos = m_camera.getPosition();
-    glm::vec3 look = m_camera.getLook();
+    SimulationThread::Pause pause(m_simThread);
+    glm::vec3 pos = m_simCamera.getPosition();
+    glm::vec3 look = m_simCamera.getLook();
     m_cameraPath.addWaypoint(pos, look);
 }
 
 void Realtime::startPathPlayback() {
+    SimulationThread::Pause pause(m_simThread);
     if (m_cameraPath.getWaypointCount() >= 2) {
         m_cameraPath.startPlayback(m_cameraPath.getPlaybackDuration());
     }
+    m_pathPlaying = m_cameraPath.isPlaying();
 }
 
 void Realtime::setPathDuration(float durationSeconds) {
+    SimulationThread::Pause pause(m_simThread);
     m_cameraPath.setPlaybackDuration(durationSeconds);
 }
 
 void Realtime::stopPathPlayback() {
+    SimulationThread::Pause pause(m_simThread);
     m_cameraPath.stopPlayback();
+    m_pathPlaying = false;
 }
 
 void Realtime::clearPath() {
+    SimulationThread::Pause pause(m_simThread);
     m_cameraPath.clear();
+    m_pathPlaying = false;
+}
+
+bool Realtime::loadCameraPath(const std::string& filePath) {
+    SimulationThread::Pause pause(m_simThread);
+    m_cameraPath.stopPlayback();
+    m_pathPlaying = false;
+    return m_cameraPath.loadFromFile(filePath);
+}
+
+bool Realtime::saveCameraPath(const std::string& filePath) const {
+    SimulationThread::Pause pause(m_simThread);
+    return m_cameraPath.saveToFile(filePath);
+}
+
+int Realtime::getPathWaypointCount() const {
+    SimulationThread::Pause pause(m_simThread);
+    return m_cameraPath.getWaypointCount();
+}
+
+float Realtime::getPathDuration() const {
+    SimulationThread::Pause pause(m_simThread);
+    return m_cameraPath.getPlaybackDuration();
+}
+
+void Realtime::renderFrame() {
+    makeCurrent();
+    paintGL();
+    doneCurrent();
 }
 
 
@@ -91,6 +133,23 @@ Realtime::Realtime(QWidget *parent)
     m_motionBlurEnabled = false;
     m_motionBlurSamples = 3;
     m_motionBlurAutoEnabled = false;
+    m_appliedRenderScale = 1.0f;
+    m_paintCpuMs = 0.0f;
+    m_viewAspect = 16.0f / 9.0f;
+    m_simAccumulator = 0.0;
+    m_simAlpha = 1.0f;
+    m_prevCameraPos = m_simCamera.getPosition();
+    m_threadedSimulation = true;
+    m_simTick = 0;
+    m_simInputOverflowCount = 0;
+    m_pathPlaying = false;
+    m_collectedCubeMask = 0;
+    m_appliedCubeMask = 0;
+    m_simTickCount = 0;
+    m_renderFrameCount = 0;
+    m_rateTimer = 0.0f;
+    m_simRate = 0.0f;
+    m_renderRate = 0.0f;
     m_depthVisualizationEnabled = false;
     m_gbufferVisualizationMode = 0;
     m_fpsMode = false;
@@ -112,6 +171,7 @@ Realtime::Realtime(QWidget *parent)
     
     m_flashlight.color = glm::vec3(1.0f, 1.0f, 0.6f);
     m_flashlight.coneAngle = glm::radians(20.0f);
+    m_renderFlashlight = m_flashlight;
     
     m_audioManager = new AudioManager();
     
@@ -233,7 +293,10 @@ Realtime::Realtime(QWidget *parent)
     m_blockVertexCount = 0;
     m_treeVAO = 0;
     m_treeVBO = 0;
-    m_treeVertexCount = 0;
+    m_treeEBO = 0;
+    m_treeQuadFirst = 0;
+    m_treeImpostorAtlas = 0;
+    m_blockInstancedLoc = -1;
     m_completionCubeVAO = 0;
     m_completionCubeVBO = 0;
     m_completionCubeVertexCount = 0;
@@ -246,13 +309,28 @@ Realtime::Realtime(QWidget *parent)
 }
 
 void Realtime::finish() {
+    //stop ticking before anything the sim touches (audio, particles) goes away
+    m_simThread.stop();
     killTimer(m_timer);
     this->makeCurrent();
 
     m_shapeManager.destroyShapes();
     GBuffer::cleanup(this);
     m_particleSystem.cleanup();
+    m_dynamicResolution.cleanup();
+    Profiler::cleanup();
     m_ui.cleanup();
+    m_treeInstanceStream.cleanup();
+    if (m_treeVAO != 0) {
+        glDeleteVertexArrays(1, &m_treeVAO);
+        glDeleteBuffers(1, &m_treeVBO);
+        glDeleteBuffers(1, &m_treeEBO);
+        m_treeVAO = 0;
+    }
+    if (m_treeImpostorAtlas != 0) {
+        glDeleteTextures(1, &m_treeImpostorAtlas);
+        m_treeImpostorAtlas = 0;
+    }
     
     if (m_postShaderProgram != 0) {
         glDeleteProgram(m_postShaderProgram);
@@ -329,6 +407,7 @@ void Realtime::initializeGL() {
         m_blockViewLoc = glGetUniformLocation(m_blockShaderProgram, "viewMatrix");
         m_blockCameraPosLoc = glGetUniformLocation(m_blockShaderProgram, "cameraPos");
         m_blockNumLightsLoc = glGetUniformLocation(m_blockShaderProgram, "numLights");
+        m_blockInstancedLoc = glGetUniformLocation(m_blockShaderProgram, "instanced");
     }
 
     m_useNormalMapping = false;
@@ -339,6 +418,9 @@ void Realtime::initializeGL() {
     m_blockVBO = 0;
     m_blockVertexCount = 0;
 
+    //bakes the tree meshes up front instead of in the middle of the first chunk that needs them
+    TreeArchetypes::get();
+
     // Load all textures using helper
     TextureLoader::initializeTextures(this);
 
@@ -357,6 +439,8 @@ void Realtime::initializeGL() {
     
     initializeFilterSystem();
     m_particleSystem.initialize();
+    m_dynamicResolution.initialize();
+    Profiler::initialize();
     m_ui.initialize(this);
     m_ui.resize(size().width() * m_devicePixelRatio, size().height() * m_devicePixelRatio);
     
@@ -386,16 +470,40 @@ void Realtime::initializeGL() {
     glBindVertexArray(0);
     
     doneCurrent();
+    
+    //first snapshot so the renderer has something before the first tick
+    publishSnapshot();
+    if (m_threadedSimulation) {
+        m_simThread.start(this);
+    }
+}
+
+namespace {
+//writes how long the enclosing scope took into out when it ends, early returns included
+struct ScopeTimer {
+    explicit ScopeTimer(float& out) : m_out(out), m_start(std::chrono::steady_clock::now()) {}
+    ~ScopeTimer() { m_out = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_start).count(); }
+    float& m_out;
+    std::chrono::steady_clock::time_point m_start;
+};
 }
 
 void Realtime::paintGL() {
+    ScopeTimer paintTimer(m_paintCpuMs);
+    ProfilerFrameScope profilerFrame;
+    PROFILE_SCOPE("paintGL");
+    //newest tick the sim has finished, stays put for the whole frame even if the sim publishes mid-draw
+    const SimSnapshot& state = m_simSnapshots.acquire();
+    applyRenderState(state);
+    m_renderFrameCount++;
+    
     // Capture view/projection matrices at the START of the frame for consistent frame-to-frame comparison
     glm::mat4 proj = m_camera.getProjMatrix();
     glm::mat4 view = m_camera.getViewMatrix();
     glm::mat4 viewProj = proj * view;
     
-        bool needsPostProcessing = (m_fogEnabled || m_flashlightEnabled) && m_postShaderProgram != 0;
-        bool needsGBuffer = m_motionBlurEnabled || m_depthVisualizationEnabled || m_gbufferVisualizationMode != 0 || needsPostProcessing || m_filterMode != 0 || m_grainOverlayEnabled || m_pixelateEnabled || m_bloomEnabled;
+        bool needsPostProcessing = (m_fogEnabled || state.flashlightEnabled) && m_postShaderProgram != 0;
+        bool needsGBuffer = m_motionBlurEnabled || m_depthVisualizationEnabled || m_gbufferVisualizationMode != 0 || needsPostProcessing || m_filterMode != 0 || state.grainOverlayEnabled || m_pixelateEnabled || m_bloomEnabled;
     
     if (needsGBuffer) {
         if (!GBuffer::m_initialized) {
@@ -410,9 +518,22 @@ void Realtime::paintGL() {
             GBuffer::m_prevViewProj = viewProj;
         }
         
+        //pick up a new render scale before anything is drawn, the gbuffer targets follow it
+        m_dynamicResolution.update();
+        if (m_dynamicResolution.getScale() != m_appliedRenderScale) {
+            m_appliedRenderScale = m_dynamicResolution.getScale();
+            GBuffer::resize(this, size().width(), size().height());
+        }
+        if (m_dynamicResolution.isEnabled()) {
+            m_dynamicResolution.ensureTarget(width() * m_devicePixelRatio, height() * m_devicePixelRatio);
+        }
+        
+        m_dynamicResolution.beginFrame();
+        ProfileScope geometryScope("Geometry pass", true);
         GBuffer::beginGeometryPass(this);
         
         if (GBuffer::m_gbufferShaderProgram == 0) {
+            m_dynamicResolution.endFrame();
             GBuffer::m_prevViewProj = viewProj;
             return;
         }
@@ -451,12 +572,12 @@ void Realtime::paintGL() {
             
             glBindVertexArray(data.vao);
             glDrawArrays(GL_TRIANGLES, 0, data.numVertices);
-            
+            Profiler::countDrawCall();
         }
         
         if (m_activeMap != nullptr) {
             glm::vec3 cameraPos = m_camera.getPosition();
-            int renderDistance = 4;
+            int renderDistance = settings.viewDistance;
             auto blocks = m_activeMap->getBlocksInRenderDistance(cameraPos, renderDistance);
             if (blocks.empty()) {
                 blocks = m_activeMap->getBlocksToRender();
@@ -552,12 +673,16 @@ void Realtime::paintGL() {
                 }
                 
                 glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+                
+                Profiler::countDrawCall();
             }
         }
         
         GBuffer::endGeometryPass(this);
+        geometryScope.end();
         
         if (m_depthVisualizationEnabled) {
+            m_dynamicResolution.endFrame();
             GBuffer::endGeometryPass(this);
             GBuffer::renderDepthVisualization(this, settings.nearPlane, settings.farPlane);
             GBuffer::m_prevViewProj = viewProj;
@@ -565,16 +690,19 @@ void Realtime::paintGL() {
         }
         
         if (m_gbufferVisualizationMode != 0) {
+            m_dynamicResolution.endFrame();
             GBuffer::endGeometryPass(this);
             GBuffer::renderGBufferVisualization(this, m_gbufferVisualizationMode);
             GBuffer::m_prevViewProj = viewProj;
             return;
         }
         
+        ProfileScope sceneScope("Scene pass", true);
         GBuffer::beginScenePass(this);
         
         if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
             GBuffer::endScenePass(this);
+            sceneScope.end();
             if (!needsPostProcessing) {
                 m_motionBlurEnabled = false;
             }
@@ -602,6 +730,7 @@ void Realtime::paintGL() {
                 
                 glBindVertexArray(data.vao);
                 glDrawArrays(GL_TRIANGLES, 0, data.numVertices);
+                Profiler::countDrawCall();
             }
             
             float currentTime = m_elapsedTimer.elapsed() / 1000.0f;
@@ -615,41 +744,55 @@ void Realtime::paintGL() {
             Rendering::renderEnemies(this, currentTime);
             
             GBuffer::endScenePass(this);
+            sceneScope.end();
             
             if (m_motionBlurEnabled) {
-                bool renderToTexture = needsPostProcessing || m_filterMode != 0 || m_grainOverlayEnabled || m_pixelateEnabled;
+                PROFILE_GPU_SCOPE("Motion blur");
+                bool renderToTexture = needsPostProcessing || m_filterMode != 0 || state.grainOverlayEnabled || m_pixelateEnabled;
                 GBuffer::renderMotionBlur(this, renderToTexture);
                 
                 if (renderToTexture && !needsPostProcessing && GBuffer::m_motionBlurTexture != 0 && GBuffer::m_motionBlurFBO != 0) {
-                    int w = width() * m_devicePixelRatio;
-                    int h = height() * m_devicePixelRatio;
+                    int w = renderWidth();
+                    int h = renderHeight();
                     
                     glBindFramebuffer(GL_READ_FRAMEBUFFER, GBuffer::m_motionBlurFBO);
-                    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, defaultFramebufferObject());
+                    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer());
                     glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_LINEAR);
-                    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+                    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer());
                 }
                 
                 if (renderToTexture && needsPostProcessing) {
-                    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+                    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer());
                 }
             }
             
             if (needsPostProcessing) {
-                updateFlashlightPosition();
-                if (m_filterMode != 0 || m_grainOverlayEnabled || m_pixelateEnabled || m_bloomEnabled) {
+                PROFILE_GPU_SCOPE("Post processing");
+                updateFlashlightPosition(m_renderFlashlight, m_camera);
+                if (m_filterMode != 0 || state.grainOverlayEnabled || m_pixelateEnabled || m_bloomEnabled) {
                     renderPostProcessingToTexture();
                 } else {
                     renderPostProcessing();
                 }
             }
             
-            if (m_filterMode != 0 || m_grainOverlayEnabled || m_pixelateEnabled || m_bloomEnabled) {
-                glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+            if (m_filterMode != 0 || state.grainOverlayEnabled || m_pixelateEnabled || m_bloomEnabled) {
+                PROFILE_GPU_SCOPE("Post filters");
+                glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer());
                 renderPostFilters();
             }
             
+            m_dynamicResolution.endFrame();
+            
+            //upscale the scaled chain into the real backbuffer, particles + ui stay at full res
+            if (outputFramebuffer() != defaultFramebufferObject()) {
+                PROFILE_GPU_SCOPE("Upscale");
+                m_dynamicResolution.present(defaultFramebufferObject(), renderWidth(), renderHeight(),
+                                            width() * m_devicePixelRatio, height() * m_devicePixelRatio, GBuffer::m_quadVAO);
+            }
+            
             if (m_particleSystem.isEnabled()) {
+                PROFILE_GPU_SCOPE("Particles");
                 GLuint defaultFBO = defaultFramebufferObject();
                 glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
                 
@@ -657,9 +800,12 @@ void Realtime::paintGL() {
                 int h = height() * m_devicePixelRatio;
                 glViewport(0, 0, w, h);
                 
-                m_particleSystem.draw(m_camera);
+                //the default framebuffer has no scene depth here, particles fade against the scene pass's instead
+                GLuint sceneDepth = GBuffer::m_sceneDepthTexture != 0 ? GBuffer::m_sceneDepthTexture : GBuffer::m_depthTexture;
+                m_particleSystem.draw(m_camera, state.particles, m_simAlpha, sceneDepth);
             }
             
+            PROFILE_GPU_SCOPE("UI");
             GLuint defaultFBO = defaultFramebufferObject();
             glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
             int w = width() * m_devicePixelRatio;
@@ -671,6 +817,7 @@ void Realtime::paintGL() {
         
         GBuffer::m_prevViewProj = viewProj;
     } else {
+        ProfileScope forwardScope("Forward pass", true);
         glClearColor(103/255.f, 142/255.f, 166/255.f, 1);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
@@ -695,6 +842,7 @@ void Realtime::paintGL() {
 
         glBindVertexArray(data.vao);
         glDrawArrays(GL_TRIANGLES, 0, data.numVertices);
+        Profiler::countDrawCall();
     }
     
     float currentTime = m_elapsedTimer.elapsed() / 1000.0f;
@@ -708,8 +856,10 @@ void Realtime::paintGL() {
         Rendering::renderEnemies(this, currentTime);
 
     glUseProgram(0);
+    forwardScope.end();
     
     if (m_particleSystem.isEnabled()) {
+        PROFILE_GPU_SCOPE("Particles");
         GLuint defaultFBO = defaultFramebufferObject();
         glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
         
@@ -717,10 +867,11 @@ void Realtime::paintGL() {
         int h = height() * m_devicePixelRatio;
         glViewport(0, 0, w, h);
         
-        m_particleSystem.draw(m_camera);
+        m_particleSystem.draw(m_camera, state.particles, m_simAlpha);
     }
     
     // Render UI on top of everything (after all filters and particles)
+    PROFILE_GPU_SCOPE("UI");
     glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
     int w = width() * m_devicePixelRatio;
     int h = height() * m_devicePixelRatio;
@@ -734,6 +885,9 @@ void Realtime::resizeGL(int w, int h) {
     glViewport(0, 0, size().width() * m_devicePixelRatio, size().height() * m_devicePixelRatio);
     float aspect = static_cast<float>(w) / static_cast<float>(h);
     m_camera.updateProjectionMatrix(aspect, settings.nearPlane, settings.farPlane);
+    if (h > 0) {
+        m_viewAspect.store(aspect, std::memory_order_relaxed);
+    }
     makeCurrent();
     GBuffer::resize(this, w, h);
     m_ui.resize(w * m_devicePixelRatio, h * m_devicePixelRatio);
@@ -756,6 +910,12 @@ void Realtime::sceneChanged() {
     addLightsToShader(metaData.lights);
     float aspectRatio = static_cast<float>(width()) / static_cast<float>(height());
     m_camera = Camera(metaData.cameraData, aspectRatio, settings.nearPlane, settings.farPlane);
+    {
+        SimulationThread::Pause pause(m_simThread);
+        m_simCamera = m_camera;
+        m_prevCameraPos = m_simCamera.getPosition();
+        publishSnapshot();
+    }
     glUseProgram(0);
     update();
 }
@@ -881,17 +1041,15 @@ void Realtime::settingsChanged() {
 }
 
 void Realtime::setActiveMap(Map* map) {
-    m_activeMap = map;
-    
-    if (m_activeMap != nullptr) {
-        // Enable endless mode for procedural generation
-        m_activeMap->setEndlessMode(true);
-        
+    //work out the spawn before pausing, the block scan is the slow part and the sim never writes a map's blocks
+    bool haveSpawn = false;
+    glm::vec3 cameraPos(0.0f);
+    glm::vec3 lookDir(0.0f, 0.0f, -1.0f);
+    if (map != nullptr) {
         // If map was initialized from builder, we still want endless mode
         // but we can use the noise params that were set
-        int mapWidth = m_activeMap->getWidth();
-        int mapDepth = m_activeMap->getHeight();
-        int maxHeight = m_activeMap->getMaxHeight();
+        int mapWidth = map->getWidth();
+        int mapDepth = map->getHeight();
         
         // In endless mode, width/depth might be 0, which is fine
         // In that case, start at origin
@@ -902,7 +1060,7 @@ void Realtime::setActiveMap(Map* map) {
             int worldX = middleX - (mapWidth / 2);
             int worldZ = middleZ - (mapDepth / 2);
             
-            auto blocks = m_activeMap->getBlocksToRender();
+            auto blocks = map->getBlocksToRender();
             if (!blocks.empty()) {
                 int centerBlockY = 0;
                 bool foundCenterBlock = false;
@@ -927,7 +1085,7 @@ void Realtime::setActiveMap(Map* map) {
                 const float EYE_HEIGHT = 1.6f;
                 int maxDimension = std::max(mapWidth, mapDepth);
                 int cameraOffset = std::max(5, maxDimension / 4);
-                glm::vec3 cameraPos(
+                cameraPos = glm::vec3(
                     static_cast<float>(worldX + cameraOffset),
                     static_cast<float>(centerBlockY + 1) + EYE_HEIGHT,
                     static_cast<float>(worldZ + cameraOffset)
@@ -938,23 +1096,36 @@ void Realtime::setActiveMap(Map* map) {
                     static_cast<float>(centerBlockY),
                     static_cast<float>(worldZ)
                 );
-                glm::vec3 lookDir = glm::normalize(lookTarget - cameraPos);
-                
-                m_camera.setPosition(cameraPos);
-                m_camera.setLook(lookDir);
+                lookDir = glm::normalize(lookTarget - cameraPos);
+                haveSpawn = true;
             }
         }
+    }
+    
+    SimulationThread::Pause pause(m_simThread);
+    m_activeMap = map;
+    //pickups belong to the map they happened on
+    m_collectedCubeMask = 0;
+    m_appliedCubeMask = 0;
+    
+    if (m_activeMap != nullptr) {
+        // Enable endless mode for procedural generation
+        m_activeMap->setEndlessMode(true);
+        
+        if (haveSpawn) {
+            m_simCamera.setPosition(cameraPos);
+            m_simCamera.setLook(lookDir);
+        }
+        m_simCamera.setUp(glm::vec3(0.0f, 1.0f, 0.0f));
         m_camera.setUp(glm::vec3(0.0f, 1.0f, 0.0f));
         if (m_baseFOV == 0.0f) {
             m_baseFOV = 70.0f;
             m_currentFOV = m_baseFOV;
         }
-        m_camera.setFOV(m_currentFOV);
-        
-        float aspect = static_cast<float>(width()) / static_cast<float>(height());
-        if (aspect > 0) {
-            m_camera.updateProjectionMatrix(aspect, settings.nearPlane, settings.farPlane);
-        }
+        m_simCamera.setFOV(m_currentFOV);
+        updateSimProjection();
+        m_prevCameraPos = m_simCamera.getPosition();
+        publishSnapshot();
         
         update();
     }
@@ -1001,14 +1172,226 @@ void Realtime::timerEvent(QTimerEvent *event) {
     }
     
     int elapsedms   = m_elapsedTimer.elapsed();
-    float deltaTime = elapsedms * 0.001f;
     m_elapsedTimer.restart();
+    advanceFrame(elapsedms * 0.001f);
+}
+
+void Realtime::advanceFrame(float frameTime) {
+    int elapsedms = static_cast<int>(frameTime * 1000.0f);
+    //anything held back while the queue was full goes in even if no new input comes along
+    flushSimInputOverflow();
     
     if (!m_motionBlurAutoEnabled && elapsedms >= 1000) {
         m_motionBlurEnabled = true;
         m_motionBlurAutoEnabled = true;
         emit motionBlurToggled(true);
     }
+    
+    //always the same dt so physics/enemies behave the same no matter the framerate,
+    //a long hitch runs at most MAX_SIM_STEPS_PER_FRAME ticks and drops the rest instead of spiraling.
+    //with the sim thread running the ticks happen over there and this only paces the repaint
+    if (!m_simThread.isRunning()) {
+        m_simAccumulator += frameTime;
+        int steps = 0;
+        while (m_simAccumulator >= SIM_TIMESTEP && steps < MAX_SIM_STEPS_PER_FRAME) {
+            stepSimulation(static_cast<float>(SIM_TIMESTEP));
+            m_simAccumulator -= SIM_TIMESTEP;
+            steps++;
+        }
+        if (steps == MAX_SIM_STEPS_PER_FRAME && m_simAccumulator >= SIM_TIMESTEP) {
+            m_simAccumulator = std::fmod(m_simAccumulator, SIM_TIMESTEP);
+        }
+        if (steps > 0) {
+            publishSnapshot();
+        }
+        m_simAlpha = static_cast<float>(m_simAccumulator / SIM_TIMESTEP);
+        m_simTickCount += steps;
+    }
+    
+    m_rateTimer += frameTime;
+    if (m_rateTimer >= 1.0f) {
+        m_simRate = m_simTickCount.exchange(0) / m_rateTimer;
+        m_renderRate = m_renderFrameCount / m_rateTimer;
+        m_renderFrameCount = 0;
+        m_rateTimer = 0.0f;
+        emit frameRatesChanged(m_simRate, m_renderRate);
+    }
+    
+    //auto view distance, generation time is drained every frame so it doesnt pile up while auto is off
+    if (m_activeMap != nullptr) {
+        float generationMs = m_activeMap->takeGenerationTime();
+        if (m_viewDistanceController.isEnabled()) {
+            //cost of the frame, not the interval between them: paintGL's cpu time, or the gpu time of the scene
+            //chain when dynamic resolution is measuring it and that's the slower side
+            float frameCostMs = m_paintCpuMs;
+            if (m_dynamicResolution.isEnabled()) {
+                frameCostMs = std::max(frameCostMs, m_dynamicResolution.getGpuFrameTime());
+            }
+            int distance = m_viewDistanceController.update(frameTime, frameCostMs, generationMs, settings.viewDistance);
+            if (distance != settings.viewDistance) {
+                applyViewDistance(distance);
+                emit viewDistanceChanged(distance);
+            }
+        }
+    }
+    
+    updateTelemetry();
+    update();
+}
+
+glm::vec3 Realtime::getRenderCameraPosition(const SimSnapshot& state) const {
+    //teleports (respawn, new map) shouldnt get smeared across a frame
+    if (glm::length(state.cameraPos - state.prevCameraPos) > 4.0f) {
+        return state.cameraPos;
+    }
+    return glm::mix(state.prevCameraPos, state.cameraPos, m_simAlpha);
+}
+
+void Realtime::applyRenderState(const SimSnapshot& state) {
+    //no accumulator on this side when the sim is threaded, how long ago the snapshot landed says where between ticks we are
+    if (m_simThread.isRunning()) {
+        double sincePublish = std::chrono::duration<double>(std::chrono::steady_clock::now() - state.publishedAt).count();
+        m_simAlpha = static_cast<float>(std::clamp(sincePublish / SIM_TIMESTEP, 0.0, 1.0));
+    }
+    
+    m_camera.setPosition(getRenderCameraPosition(state));
+    m_camera.setLook(state.cameraLook);
+    m_camera.setFOV(state.fov);
+    float aspect = static_cast<float>(width()) / static_cast<float>(height());
+    if (aspect > 0) {
+        m_camera.updateProjectionMatrix(aspect, settings.nearPlane, settings.farPlane);
+    }
+    
+    //picked up cubes get dropped from the map here, this is the only thread allowed to change chunks
+    unsigned int newlyCollected = state.collectedCubeMask & ~m_appliedCubeMask;
+    if (newlyCollected != 0 && m_activeMap != nullptr) {
+        for (int biome = BIOME_FIELD; biome <= BIOME_FOREST; biome++) {
+            if (newlyCollected & (1u << biome)) {
+                m_activeMap->removeCompletionCubes(static_cast<BiomeType>(biome));
+            }
+        }
+    }
+    m_appliedCubeMask = state.collectedCubeMask;
+}
+
+void Realtime::publishSnapshot() {
+    SimSnapshot& snapshot = m_simSnapshots.back();
+    snapshot.tick = ++m_simTick;
+    snapshot.publishedAt = std::chrono::steady_clock::now();
+    
+    snapshot.prevCameraPos = m_prevCameraPos;
+    snapshot.cameraPos = m_simCamera.getPosition();
+    snapshot.cameraLook = m_simCamera.getLook();
+    snapshot.fov = m_currentFOV;
+    
+    //copies reuse the slot's capacity, so after a few ticks this doesnt allocate. particles are the big one,
+    //only the ones this tick's view can show go across
+    m_enemyManager.copyEnemies(snapshot.enemies);
+    if (m_particleSystem.isEnabled()) {
+        m_particleSystem.copyParticles(snapshot.particles, snapshot.cameraPos, snapshot.cameraLook, snapshot.fov);
+    } else {
+        snapshot.particles.clear();
+    }
+    
+    snapshot.fogColor = m_fogColor;
+    snapshot.fogIntensity = m_fogIntensity;
+    snapshot.playerHealth = m_playerHealth;
+    snapshot.grainOpacity = m_grainOpacity;
+    snapshot.grainOverlayEnabled = m_grainOverlayEnabled;
+    snapshot.flashlightEnabled = m_flashlightEnabled;
+    snapshot.flashlightCharge = m_flashlightCharge;
+    snapshot.flashlightPenaltyTimer = m_flashlightPenaltyTimer;
+    snapshot.flashlightFlickerIntensity = m_flashlightFlickerIntensity;
+    snapshot.filterTime = m_filterTime;
+    snapshot.fieldPenaltyValue = m_fieldPenaltyValue;
+    snapshot.mountainPenaltyValue = m_mountainPenaltyValue;
+    snapshot.forestPenaltyValue = m_forestPenaltyValue;
+    snapshot.hasFieldCube = m_fieldPenaltyTimer > 0.0f || m_fieldPenaltyValue >= 1.0f;
+    snapshot.hasMountainCube = m_mountainPenaltyTimer > 0.0f || m_mountainPenaltyValue >= 1.0f;
+    snapshot.hasForestCube = m_forestPenaltyTimer > 0.0f || m_forestPenaltyValue >= 1.0f;
+    snapshot.collectedCubeMask = m_collectedCubeMask;
+    bool pathPlaying = m_cameraPath.isPlaying();
+    snapshot.pathPlaying = pathPlaying;
+    
+    m_simSnapshots.publish();
+    m_pathPlaying = pathPlaying;
+}
+
+void Realtime::postToGuiThread(std::function<void()> fn) {
+    if (QThread::currentThread() == thread()) {
+        fn();
+    } else {
+        QMetaObject::invokeMethod(this, std::move(fn), Qt::QueuedConnection);
+    }
+}
+
+void Realtime::updateSimProjection() {
+    m_simCamera.updateProjectionMatrix(m_viewAspect.load(std::memory_order_relaxed), settings.nearPlane, settings.farPlane);
+}
+
+void Realtime::queueSimInput(const SimInputEvent& event) {
+    //only full if the sim has been stuck for a while. blocking the ui is worse, but a lost key up or flashlight
+    //toggle sticks until the next press, so whatever doesn't fit waits here in order instead of being dropped
+    flushSimInputOverflow();
+    if (m_simInputOverflow.empty() && m_simInput.push(event)) {
+        return;
+    }
+    //mouse deltas just add up, no need to keep every one
+    if (event.type == SimInputEvent::Rotate && !m_simInputOverflow.empty() &&
+        m_simInputOverflow.back().type == SimInputEvent::Rotate) {
+        m_simInputOverflow.back().rotation += event.rotation;
+    } else {
+        m_simInputOverflow.push_back(event);
+    }
+    if (m_simInputOverflowCount++ % 256 == 0) {
+        std::cout << "Sim input queue full, " << m_simInputOverflowCount << " events held back so far" << std::endl;
+    }
+}
+
+void Realtime::flushSimInputOverflow() {
+    while (!m_simInputOverflow.empty() && m_simInput.push(m_simInputOverflow.front())) {
+        m_simInputOverflow.pop_front();
+    }
+}
+
+void Realtime::drainSimInput() {
+    SimInputEvent event;
+    while (m_simInput.pop(event)) {
+        switch (event.type) {
+            case SimInputEvent::KeyDown:
+                m_keyMap[static_cast<Qt::Key>(event.key)] = true;
+                break;
+            case SimInputEvent::KeyUp:
+                m_keyMap[static_cast<Qt::Key>(event.key)] = false;
+                break;
+            case SimInputEvent::Rotate:
+                m_pendingRotation += event.rotation;
+                break;
+            case SimInputEvent::ToggleFlashlight:
+                applyFlashlightEnabled(!m_flashlightEnabled);
+                break;
+        }
+    }
+}
+
+void Realtime::setThreadedSimulation(bool enabled) {
+    m_threadedSimulation = enabled;
+    //before initializeGL the thread gets started there instead
+    if (!isValid()) {
+        return;
+    }
+    if (enabled) {
+        m_simThread.start(this);
+    } else {
+        m_simThread.stop();
+        m_simAccumulator = 0.0;
+    }
+}
+
+void Realtime::stepSimulation(float deltaTime) {
+    PROFILE_SCOPE("Simulation");
+    m_prevCameraPos = m_simCamera.getPosition();
+    drainSimInput();
 
     m_filterTime += deltaTime;
     
@@ -1059,8 +1442,8 @@ void Realtime::timerEvent(QTimerEvent *event) {
         m_footstepCount++;
         if (m_footstepCount >= 4 && !m_isDead) {
             m_footstepCount = 0;
-            glm::vec3 pos = m_camera.getPosition();
-            glm::vec3 look = m_camera.getLook();
+            glm::vec3 pos = m_simCamera.getPosition();
+            glm::vec3 look = m_simCamera.getLook();
             
             // Add to queue, remove oldest if at capacity
             m_ghostPathQueue.push_back(GhostWaypoint(pos, look));
@@ -1074,43 +1457,57 @@ void Realtime::timerEvent(QTimerEvent *event) {
 
     if (glm::length(m_pendingRotation) > 0.0001f) {
         glm::vec2 rotationToApply = m_pendingRotation * m_rotationSmoothingFactor;
-        m_camera.rotate(rotationToApply.x, rotationToApply.y);
+        m_simCamera.rotate(rotationToApply.x, rotationToApply.y);
         m_pendingRotation -= rotationToApply;
         if (glm::length(m_pendingRotation) < 0.0001f) {
             m_pendingRotation = glm::vec2(0.0f);
         }
     }
 
-    glm::vec3 cameraPos = m_camera.getPosition();
+    glm::vec3 cameraPos = m_simCamera.getPosition();
+    //far enemies outside this view drop to the cheap update. projection redone here too so a resize lands
+    updateSimProjection();
+    m_enemyManager.setViewer(m_simCamera.getProjMatrix() * m_simCamera.getViewMatrix());
     
     //update fog color based on biome
-    FogSystem::updateFogColor(this, deltaTime);
+    {
+        PROFILE_SCOPE("Fog");
+        FogSystem::updateFogColor(this, deltaTime);
+    }
     
     //update particles
     if (m_particleSystem.isEnabled()) {
+        PROFILE_SCOPE("Particles update");
         bool isMoving = (m_keyMap[Qt::Key_W] || m_keyMap[Qt::Key_A] || m_keyMap[Qt::Key_S] || m_keyMap[Qt::Key_D]);
         // Get current biome for particle spawning
         int currentBiome = 0; // Default to FIELD
         if (m_activeMap != nullptr) {
-            glm::vec3 cameraPos = m_camera.getPosition();
+            glm::vec3 cameraPos = m_simCamera.getPosition();
             int playerX = static_cast<int>(std::floor(cameraPos.x));
             int playerZ = static_cast<int>(std::floor(cameraPos.z));
             BiomeType biome = m_activeMap->getBiomeAt(playerX, playerZ);
             currentBiome = static_cast<int>(biome);
         }
-        m_particleSystem.update(deltaTime, m_camera, isMoving, static_cast<float>(m_cameraHeightMultiplier), currentBiome);
+        m_particleSystem.update(deltaTime, m_simCamera, m_activeMap, isMoving, static_cast<float>(m_cameraHeightMultiplier), currentBiome);
     }
+    
+    updateCompletionCubePickup();
 
     if (m_cameraPath.isPlaying()) {
         glm::vec3 newPos, newLook;
         bool wasPlaying = m_cameraPath.isPlaying();
         m_cameraPath.update(deltaTime, newPos, newLook);
         if (wasPlaying) {
-            m_camera.setPosition(newPos);
-            m_camera.setLook(newLook);
+            m_simCamera.setPosition(newPos);
+            m_simCamera.setLook(newLook);
             cameraPos = newPos;
         }
         if (!m_cameraPath.isPlaying() && wasPlaying) {
+            postToGuiThread([this] {
+                if (m_motionBlurEnabled) {
+                    GBuffer::reportMotionBlurTiming();
+                }
+            });
             emit pathPlaybackFinished();
             // After ghost respawn path finishes, clear the queue and respawn
             if (m_isDead) {
@@ -1123,13 +1520,13 @@ void Realtime::timerEvent(QTimerEvent *event) {
                     if (!m_ghostPathQueue.empty()) {
                         // The first waypoint in the original queue is the respawn point
                         const GhostWaypoint& respawnPoint = m_ghostPathQueue.front();
-                        m_camera.setPosition(respawnPoint.position);
-                        m_camera.setLook(respawnPoint.lookDirection);
+                        m_simCamera.setPosition(respawnPoint.position);
+                        m_simCamera.setLook(respawnPoint.lookDirection);
                     }
                 }
                 
                 // Revert to warm LUT (choice 2)
-                setLUTChoice(2); // Warm LUT
+                postToGuiThread([this] { setLUTChoice(2); }); // Warm LUT
                 
                 m_ghostPathQueue.clear();
                 m_isDead = false;
@@ -1137,8 +1534,9 @@ void Realtime::timerEvent(QTimerEvent *event) {
                 std::cout << "[Ghost] Respawn complete, cleared path queue" << std::endl;
             }
         }
+        ProfileScope enemyScope("Enemies");
         if (m_flashlightEnabled) {
-            updateFlashlightPosition();
+            updateFlashlightPosition(m_flashlight, m_simCamera);
             m_enemyManager.updateWithFlashlight(deltaTime, cameraPos, m_activeMap,
                                                 m_flashlightEnabled, m_flashlight.position,
                                                 m_flashlight.direction, m_flashlight.coneAngle,
@@ -1146,13 +1544,14 @@ void Realtime::timerEvent(QTimerEvent *event) {
         } else {
             m_enemyManager.update(deltaTime, cameraPos, m_activeMap, m_audioManager);
         }
-        update();
+        enemyScope.end();
         return;
     }
 
         //update enemies with flashlight state
+        ProfileScope enemyScope("Enemies");
         if (m_flashlightEnabled) {
-            updateFlashlightPosition();
+            updateFlashlightPosition(m_flashlight, m_simCamera);
             m_enemyManager.updateWithFlashlight(deltaTime, cameraPos, m_activeMap,
                                                 m_flashlightEnabled, m_flashlight.position,
                                                 m_flashlight.direction, m_flashlight.coneAngle,
@@ -1160,17 +1559,19 @@ void Realtime::timerEvent(QTimerEvent *event) {
         } else {
             m_enemyManager.update(deltaTime, cameraPos, m_activeMap, m_audioManager);
         }
+        enemyScope.end();
 
     float moveSpeed = 1.125f * deltaTime;
     
     if (m_flyingMode) {
-    if (m_keyMap[Qt::Key_W]) m_camera.moveForward(moveSpeed);
-    if (m_keyMap[Qt::Key_S]) m_camera.moveForward(-moveSpeed);
-    if (m_keyMap[Qt::Key_A]) m_camera.moveRight(-moveSpeed);
-    if (m_keyMap[Qt::Key_D]) m_camera.moveRight(moveSpeed);
-    if (m_keyMap[Qt::Key_Space]) m_camera.moveUp(moveSpeed);
-    if (m_keyMap[Qt::Key_Control]) m_camera.moveUp(-moveSpeed);
+    if (m_keyMap[Qt::Key_W]) m_simCamera.moveForward(moveSpeed);
+    if (m_keyMap[Qt::Key_S]) m_simCamera.moveForward(-moveSpeed);
+    if (m_keyMap[Qt::Key_A]) m_simCamera.moveRight(-moveSpeed);
+    if (m_keyMap[Qt::Key_D]) m_simCamera.moveRight(moveSpeed);
+    if (m_keyMap[Qt::Key_Space]) m_simCamera.moveUp(moveSpeed);
+    if (m_keyMap[Qt::Key_Control]) m_simCamera.moveUp(-moveSpeed);
     } else {
+        PROFILE_SCOPE("Physics");
         Physics::updatePhysics(this, deltaTime);
     }
 
@@ -1196,18 +1597,13 @@ void Realtime::timerEvent(QTimerEvent *event) {
         m_currentFOV = std::max(targetFOV, m_currentFOV - fovSpeed * deltaTime);
     }
     
-    m_camera.setFOV(m_currentFOV);
-    float aspect = static_cast<float>(width()) / static_cast<float>(height());
-    if (aspect > 0) {
-        m_camera.updateProjectionMatrix(aspect, settings.nearPlane, settings.farPlane);
-    }
+    //the renderer picks the fov up from the snapshot, the sim's own projection is for the enemy lod's view test
+    m_simCamera.setFOV(m_currentFOV);
+    updateSimProjection();
 
     // Update player health system
     updatePlayerHealth(deltaTime);
     updateCompletionCubePenalties(deltaTime);
-    
-    updateTelemetry();
-    update();
 }
 
 void Realtime::updateTelemetry() {
@@ -1244,6 +1640,7 @@ void Realtime::updateTelemetry() {
     }
     
     emit telemetryUpdate(cameraPos.x, cameraPos.y, cameraPos.z, chunkX, chunkZ);
+    emit renderScaleChanged(m_dynamicResolution.getScale(), m_dynamicResolution.getGpuFrameTime());
 }
 
 bool Realtime::isCompletionCubeWithinOneBlock(const glm::vec3& cameraPos) {
@@ -1277,6 +1674,71 @@ bool Realtime::isCompletionCubeWithinOneBlock(const glm::vec3& cameraPos) {
     return false;
 }
 
+void Realtime::updateCompletionCubePickup() {
+    if (m_activeMap == nullptr) {
+        return;
+    }
+    
+    const float PICKUP_RANGE = 1.8f;
+    glm::vec3 cameraPos = m_simCamera.getPosition();
+    
+    for (const auto& chunkPair : m_activeMap->getChunks()) {
+        if (chunkPair.second == nullptr || !chunkPair.second->isPopulated()) {
+            continue;
+        }
+        
+        for (const auto& cube : chunkPair.second->getCompletionCubes()) {
+            BiomeType biome = cube.getBiome();
+            if (cube.isCollected() || (m_collectedCubeMask & (1u << biome)) != 0) {
+                continue;
+            }
+            if (glm::length(cameraPos - cube.getPosition()) >= PICKUP_RANGE) {
+                continue;
+            }
+            
+            m_collectedCubeMask |= 1u << biome;
+            switch (biome) {
+                case BIOME_FIELD:
+                    if (m_fieldPenaltyTimer <= 0.0f) {
+                        m_fieldPenaltyTimer = PENALTY_INCREASE_DURATION;
+                    }
+                    break;
+                case BIOME_MOUNTAINS:
+                    if (m_mountainPenaltyTimer <= 0.0f) {
+                        m_mountainPenaltyTimer = PENALTY_INCREASE_DURATION;
+                    }
+                    break;
+                case BIOME_FOREST:
+                    if (m_forestPenaltyTimer <= 0.0f) {
+                        m_forestPenaltyTimer = PENALTY_INCREASE_DURATION;
+                    }
+                    break;
+            }
+            
+            if (m_audioManager != nullptr) {
+                QString cubeGrabPath = QStandardPaths::writableLocation(QStandardPaths::TempLocation) + "/cube_grab.wav";
+                QString resourcePath = ":/resources/soundeffects/cube_grab.wav";
+                if (QFile::exists(resourcePath) && !QFile::exists(cubeGrabPath)) {
+                    QFile::copy(resourcePath, cubeGrabPath);
+                }
+                if (QFile::exists(cubeGrabPath)) {
+                    m_audioManager->playSound(cubeGrabPath.toUtf8().constData());
+                }
+            }
+            
+            int cubesCollected = 0;
+            if (m_fieldPenaltyTimer > 0.0f || m_fieldPenaltyValue >= 1.0f) cubesCollected++;
+            if (m_mountainPenaltyTimer > 0.0f || m_mountainPenaltyValue >= 1.0f) cubesCollected++;
+            if (m_forestPenaltyTimer > 0.0f || m_forestPenaltyValue >= 1.0f) cubesCollected++;
+            
+            int enemiesToSpawn = 2 * cubesCollected;
+            if (enemiesToSpawn > 0) {
+                m_enemyManager.spawnEnemiesOnRing(cameraPos, m_activeMap, enemiesToSpawn);
+            }
+        }
+    }
+}
+
 void Realtime::damagePlayer(float damageAmount) {
     float previousHealth = m_playerHealth;
     m_playerHealth -= damageAmount;
@@ -1310,21 +1772,23 @@ void Realtime::updatePlayerHealth(float deltaTime) {
         return;
     }
     
-    glm::vec3 cameraPos = m_camera.getPosition();
+    glm::vec3 cameraPos = m_simCamera.getPosition();
     bool cubeNearby = isCompletionCubeWithinOneBlock(cameraPos);
     
     const float ENEMY_DAMAGE_DISTANCE = 1.2f;
     const float damagePerSecond = 45.0f;
     
-    int enemyCount = m_enemyManager.getEnemyCount();
     bool enemyNearby = false;
     bool damageApplied = false;
     
-    // Check all enemies - if any enemy is within 1.0f AND a cube is nearby, damage player
-    for (int i = 0; i < enemyCount; ++i) {
-        const Enemy* enemy = m_enemyManager.getEnemy(i);
-        if (enemy != nullptr && enemy->isAlive()) {
-            glm::vec3 enemyPos = enemy->getPosition();
+    //grid is from the start of this tick's enemy update, half a unit covers how far they moved since
+    m_nearbyEnemies.clear();
+    m_enemyManager.queryEnemiesInRadius(cameraPos, ENEMY_DAMAGE_DISTANCE + 0.5f, m_nearbyEnemies);
+    
+    // Check enemies near the player - if any enemy is within ENEMY_DAMAGE_DISTANCE, damage player
+    for (int i : m_nearbyEnemies) {
+        if (m_enemyManager.isEnemyAlive(i)) {
+            glm::vec3 enemyPos = m_enemyManager.getEnemyPosition(i);
             float distToEnemy = glm::length(cameraPos - enemyPos);
             
             if (distToEnemy <= ENEMY_DAMAGE_DISTANCE) {
@@ -1411,8 +1875,11 @@ void Realtime::handleDeath() {
     
     m_isDead = true;
     
-    m_originalLUTChoice = m_lutChoice;
-    setLUTChoice(3); //black and white
+    //lut lives on the gl side
+    postToGuiThread([this] {
+        m_originalLUTChoice = m_lutChoice;
+        setLUTChoice(3); //black and white
+    });
     
     //kill all enemies when player dies
     m_enemyManager.killAllEnemies();
@@ -1423,8 +1890,8 @@ void Realtime::handleDeath() {
     m_grainOverlayEnabled = false;
     
     //add current death position as final waypoint
-    glm::vec3 deathPos = m_camera.getPosition();
-    glm::vec3 deathLook = m_camera.getLook();
+    glm::vec3 deathPos = m_simCamera.getPosition();
+    glm::vec3 deathLook = m_simCamera.getLook();
     m_ghostPathQueue.push_back(GhostWaypoint(deathPos, deathLook));
     
     //need at least 2 waypoints to play a path
@@ -1432,7 +1899,7 @@ void Realtime::handleDeath() {
         std::cout << "[Ghost] Not enough waypoints for ghost respawn" << std::endl;
         m_ghostPathQueue.clear();
         m_isDead = false;
-        setLUTChoice(m_originalLUTChoice);
+        postToGuiThread([this] { setLUTChoice(m_originalLUTChoice); });
         return;
     }
     
@@ -1456,6 +1923,7 @@ void Realtime::handleDeath() {
 
 //all from ui control
 void Realtime::setFlyingMode(bool flying) {
+    SimulationThread::Pause pause(m_simThread);
     m_flyingMode = flying;
     if (flying) {
         m_velocity = glm::vec3(0.0f);
@@ -1464,14 +1932,17 @@ void Realtime::setFlyingMode(bool flying) {
 }
 
 void Realtime::setMovementSpeedMultiplier(double multiplier) {
+    SimulationThread::Pause pause(m_simThread);
     m_movementSpeedMultiplier = multiplier;
 }
 
 void Realtime::setJumpHeightMultiplier(double multiplier) {
+    SimulationThread::Pause pause(m_simThread);
     m_jumpHeightMultiplier = multiplier;
 }
 
 void Realtime::setCameraHeightMultiplier(double multiplier) {
+    SimulationThread::Pause pause(m_simThread);
     m_cameraHeightMultiplier = multiplier;
 }
 
@@ -1480,6 +1951,7 @@ void Realtime::setPlayerLightColor(float r, float g, float b) {
 }
 
 void Realtime::setGravityMultiplier(double multiplier) {
+    SimulationThread::Pause pause(m_simThread);
     m_gravityMultiplier = multiplier;
 }
 
@@ -1496,6 +1968,48 @@ void Realtime::setMotionBlurSamples(int samples) {
     m_motionBlurSamples = samples;
 }
 
+void Realtime::setDynamicResolutionEnabled(bool enabled) {
+    m_dynamicResolution.setEnabled(enabled);
+    update();
+}
+
+void Realtime::setViewDistance(int chunks) {
+    applyViewDistance(chunks);
+    update();
+}
+
+void Realtime::setAutoViewDistance(bool enabled) {
+    settings.autoViewDistance = enabled;
+    m_viewDistanceController.setEnabled(enabled);
+}
+
+void Realtime::applyViewDistance(int chunks) {
+    settings.viewDistance = std::clamp(chunks, ViewDistanceController::MIN_VIEW_DISTANCE, ViewDistanceController::MAX_VIEW_DISTANCE);
+    //far plane sits just inside the loaded ring so fog (fogEnd = farPlane * 0.8) hides the chunk edge
+    int chunkSize = (m_activeMap != nullptr) ? m_activeMap->getChunkSize() : 16;
+    settings.farPlane = settings.viewDistance * chunkSize * 0.8f;
+    float aspect = static_cast<float>(width()) / static_cast<float>(height());
+    if (aspect > 0) {
+        m_camera.updateProjectionMatrix(aspect, settings.nearPlane, settings.farPlane);
+    }
+}
+
+int Realtime::renderWidth() const {
+    return std::max(1, static_cast<int>(width() * m_devicePixelRatio * m_appliedRenderScale));
+}
+
+int Realtime::renderHeight() const {
+    return std::max(1, static_cast<int>(height() * m_devicePixelRatio * m_appliedRenderScale));
+}
+
+GLuint Realtime::outputFramebuffer() const {
+    //scaled frames land in the dynamic res target and get upscaled afterwards
+    if (m_appliedRenderScale < 1.0f && m_dynamicResolution.getFramebuffer() != 0) {
+        return m_dynamicResolution.getFramebuffer();
+    }
+    return defaultFramebufferObject();
+}
+
 void Realtime::setDepthVisualizationEnabled(bool enabled) {
     m_depthVisualizationEnabled = enabled;
 }
@@ -1530,10 +2044,12 @@ void Realtime::setFpsMode(bool enabled) {
 }
 
 void Realtime::setFogEnabled(bool enabled) {
+    SimulationThread::Pause pause(m_simThread);
     m_fogEnabled = enabled;
 }
 
 void Realtime::setFogColor(float r, float g, float b) {
+    SimulationThread::Pause pause(m_simThread);
     m_fogColor = glm::vec3(r, g, b);
     m_targetFogColor = m_fogColor;
 }
@@ -1543,17 +2059,19 @@ glm::vec3 Realtime::getBiomeFogColor(BiomeType biome) const {
 }
 
 void Realtime::setFogIntensity(float intensity) {
+    SimulationThread::Pause pause(m_simThread);
     m_fogIntensity = intensity;
 }
 
 void Realtime::teleportToOrigin() {
+    SimulationThread::Pause pause(m_simThread);
     const float BASE_EYE_HEIGHT = 1.6f;
     float cameraHeightMultiplier = static_cast<float>(m_cameraHeightMultiplier);
     cameraHeightMultiplier = std::max(0.25f, std::min(3.0f, cameraHeightMultiplier));
     float eyeHeight = BASE_EYE_HEIGHT * cameraHeightMultiplier;
     
     glm::vec3 originPos(0.0f, eyeHeight, 0.0f);
-    m_camera.setPosition(originPos);
+    m_simCamera.setPosition(originPos);
     m_velocity = glm::vec3(0.0f);
 }
 
@@ -1562,10 +2080,12 @@ void Realtime::setFilterMode(int mode) {
 }
 
 void Realtime::setGrainOverlayEnabled(bool enabled) {
+    SimulationThread::Pause pause(m_simThread);
     m_grainOverlayEnabled = enabled;
 }
 
 void Realtime::setGrainOpacity(float opacity) {
+    SimulationThread::Pause pause(m_simThread);
     m_grainOpacity = glm::clamp(opacity, 0.0f, 1.0f);
 }
 
@@ -1585,14 +2105,46 @@ void Realtime::setLUTChoice(int choice) {
 }
 
 // Particle system setters
-void Realtime::setParticlesEnabled(bool enabled) {m_particleSystem.setEnabled(enabled);}
-void Realtime::setDirtParticlesEnabled(bool enabled) {m_particleSystem.setDirtParticlesEnabled(enabled);}
-void Realtime::setFogWispsEnabled(bool enabled) {m_particleSystem.setFogWispsEnabled(enabled);}
-void Realtime::setDirtSpawnRate(float rate) {m_particleSystem.setDirtSpawnRate(rate);}
-void Realtime::setFogWispSpawnInterval(float interval) {m_particleSystem.setFogWispSpawnInterval(interval);}
-void Realtime::setMaxParticles(int maxParticles) {m_particleSystem.setMaxParticles(maxParticles);}
+void Realtime::setParticlesEnabled(bool enabled) {SimulationThread::Pause pause(m_simThread); m_particleSystem.setEnabled(enabled);}
+void Realtime::setDirtParticlesEnabled(bool enabled) {SimulationThread::Pause pause(m_simThread); m_particleSystem.setDirtParticlesEnabled(enabled);}
+void Realtime::setFogWispsEnabled(bool enabled) {SimulationThread::Pause pause(m_simThread); m_particleSystem.setFogWispsEnabled(enabled);}
+void Realtime::setDirtSpawnRate(float rate) {SimulationThread::Pause pause(m_simThread); m_particleSystem.setDirtSpawnRate(rate);}
+void Realtime::setFogWispSpawnInterval(float interval) {SimulationThread::Pause pause(m_simThread); m_particleSystem.setFogWispSpawnInterval(interval);}
+void Realtime::setMaxParticles(int maxParticles) {SimulationThread::Pause pause(m_simThread); m_particleSystem.setMaxParticles(maxParticles);}
+void Realtime::setGpuParticlesEnabled(bool enabled) {SimulationThread::Pause pause(m_simThread); m_particleSystem.setGpuSimulation(enabled);}
+
+// Enemy controls
+void Realtime::setEnemySpawnDelay(float delay) {
+    SimulationThread::Pause pause(m_simThread);
+    m_enemyManager.setSpawnDelay(delay);
+}
+
+void Realtime::setEnemyAutoSpawnEnabled(bool enabled) {
+    SimulationThread::Pause pause(m_simThread);
+    m_enemyManager.setAutoSpawnEnabled(enabled);
+}
+
+void Realtime::spawnEnemy(const glm::vec3& position) {
+    SimulationThread::Pause pause(m_simThread);
+    m_enemyManager.spawnEnemy(position);
+}
+
+FlowField::Stats Realtime::getFlowFieldStats() const {
+    SimulationThread::Pause pause(m_simThread);
+    return m_enemyManager.getFlowFieldStats();
+}
+
+EnemyManager::LodStats Realtime::getEnemyLodStats() const {
+    SimulationThread::Pause pause(m_simThread);
+    return m_enemyManager.getLodStats();
+}
 
 void Realtime::setFlashlightEnabled(bool enabled) {
+    SimulationThread::Pause pause(m_simThread);
+    applyFlashlightEnabled(enabled);
+}
+
+void Realtime::applyFlashlightEnabled(bool enabled) {
     bool previousState = m_flashlightEnabled;
     
     // Allow toggling on/off anytime (penalty only affects recharging)
@@ -1720,12 +2272,12 @@ void Realtime::updateFlashlightCharge(float deltaTime) {
     emit flashlightChargeChanged(m_flashlightCharge, m_flashlightPenaltyTimer > 0.0f);
 }
 
-void Realtime::updateFlashlightPosition() {
-    glm::vec3 right = glm::normalize(glm::cross(m_camera.getLook(), m_camera.getUp()));
+void Realtime::updateFlashlightPosition(Flashlight& flashlight, const Camera& camera) const {
+    glm::vec3 right = glm::normalize(glm::cross(camera.getLook(), camera.getUp()));
     glm::vec3 camOffset(0.2f, -0.1f, 0.0f);
-    glm::mat3 camBasis(right, glm::normalize(m_camera.getUp()), glm::normalize(m_camera.getLook()));
-    m_flashlight.position = m_camera.getPosition() + camBasis * camOffset;
-    m_flashlight.direction = glm::normalize(m_camera.getLook());
+    glm::mat3 camBasis(right, glm::normalize(camera.getUp()), glm::normalize(camera.getLook()));
+    flashlight.position = camera.getPosition() + camBasis * camOffset;
+    flashlight.direction = glm::normalize(camera.getLook());
 }
 
 void Realtime::renderPostProcessing() {
@@ -1733,9 +2285,9 @@ void Realtime::renderPostProcessing() {
         return;
     }
     
-    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer());
     glDisable(GL_DEPTH_TEST);
-    glViewport(0, 0, width() * m_devicePixelRatio, height() * m_devicePixelRatio);
+    glViewport(0, 0, renderWidth(), renderHeight());
     
     glUseProgram(m_postShaderProgram);
     glBindVertexArray(m_postQuadVAO);
@@ -1759,17 +2311,17 @@ void Realtime::renderPostProcessing() {
     glUniform3fv(glGetUniformLocation(m_postShaderProgram, "camPos"), 1, &camPos[0]);
     
     glUniform1i(glGetUniformLocation(m_postShaderProgram, "enableFog"), m_fogEnabled ? 1 : 0);
-    glUniform1i(glGetUniformLocation(m_postShaderProgram, "enableFlashlight"), m_flashlightEnabled ? 1 : 0);
+    glUniform1i(glGetUniformLocation(m_postShaderProgram, "enableFlashlight"), renderState().flashlightEnabled ? 1 : 0);
     
-    glUniform3fv(glGetUniformLocation(m_postShaderProgram, "fogColor"), 1, &m_fogColor[0]);
-    glUniform1f(glGetUniformLocation(m_postShaderProgram, "fogIntensity"), m_fogIntensity);
+    glUniform3fv(glGetUniformLocation(m_postShaderProgram, "fogColor"), 1, &renderState().fogColor[0]);
+    glUniform1f(glGetUniformLocation(m_postShaderProgram, "fogIntensity"), renderState().fogIntensity);
     
-    glUniform3fv(glGetUniformLocation(m_postShaderProgram, "flashlightPos"), 1, &m_flashlight.position[0]);
-    glUniform3fv(glGetUniformLocation(m_postShaderProgram, "flashlightDir"), 1, &m_flashlight.direction[0]);
-    glUniform1f(glGetUniformLocation(m_postShaderProgram, "flashlightConeAngle"), m_flashlight.coneAngle);
+    glUniform3fv(glGetUniformLocation(m_postShaderProgram, "flashlightPos"), 1, &m_renderFlashlight.position[0]);
+    glUniform3fv(glGetUniformLocation(m_postShaderProgram, "flashlightDir"), 1, &m_renderFlashlight.direction[0]);
+    glUniform1f(glGetUniformLocation(m_postShaderProgram, "flashlightConeAngle"), m_renderFlashlight.coneAngle);
     
     // Apply flicker intensity to flashlight color
-    glm::vec3 flickeredColor = m_flashlight.color * m_flashlightFlickerIntensity;
+    glm::vec3 flickeredColor = m_renderFlashlight.color * renderState().flashlightFlickerIntensity;
     glUniform3fv(glGetUniformLocation(m_postShaderProgram, "flashlightColor"), 1, &flickeredColor[0]);
     
     glm::mat4 invView = glm::inverse(m_camera.getViewMatrix());
@@ -1779,6 +2331,7 @@ void Realtime::renderPostProcessing() {
     
     glDrawArrays(GL_TRIANGLES, 0, 6);
     
+    Profiler::countDrawCall();
     glBindVertexArray(0);
     glUseProgram(0);
     glEnable(GL_DEPTH_TEST);
@@ -1951,8 +2504,8 @@ void Realtime::renderBloom() {
         return;
     }
     
-    int width = size().width() * m_devicePixelRatio;
-    int height = size().height() * m_devicePixelRatio;
+    int width = renderWidth();
+    int height = renderHeight();
     
     //resize bloom textures if needed
     if (m_bloomExtractTexture != 0) {
@@ -2002,7 +2555,7 @@ void Realtime::renderBloom() {
         glBindVertexArray(m_filterQuadVAO);
         
         glActiveTexture(GL_TEXTURE0);
-        bool needsPostProcessing = (m_fogEnabled || m_flashlightEnabled) && m_postShaderProgram != 0;
+        bool needsPostProcessing = (m_fogEnabled || renderState().flashlightEnabled) && m_postShaderProgram != 0;
         if (needsPostProcessing && m_filterTexture != 0) {
             glBindTexture(GL_TEXTURE_2D, m_filterTexture);
         } else if (m_motionBlurEnabled && GBuffer::m_motionBlurTexture != 0) {
@@ -2015,6 +2568,7 @@ void Realtime::renderBloom() {
         
         glDrawArrays(GL_TRIANGLES, 0, 6);
         
+        Profiler::countDrawCall();
         glBindVertexArray(0);
         glUseProgram(0);
     }
@@ -2045,6 +2599,8 @@ void Realtime::renderBloom() {
         }
         
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        
+        Profiler::countDrawCall();
         horizontal = !horizontal;
     }
     
@@ -2093,19 +2649,32 @@ void Realtime::loadLUT(int choice) {
 }
 
 void Realtime::renderPostFilters() {
-    if ((m_filterMode == 0 && !m_grainOverlayEnabled && !m_pixelateEnabled && !m_bloomEnabled) || m_filterShaderProgram == 0 || m_filterQuadVAO == 0) {
+    if ((m_filterMode == 0 && !renderState().grainOverlayEnabled && !m_pixelateEnabled && !m_bloomEnabled) || m_filterShaderProgram == 0 || m_filterQuadVAO == 0) {
         return;
     }
     
-    bool needsPostProcessing = (m_fogEnabled || m_flashlightEnabled) && m_postShaderProgram != 0;
-    int width = size().width() * m_devicePixelRatio;
-    int height = size().height() * m_devicePixelRatio;
+    bool needsPostProcessing = (m_fogEnabled || renderState().flashlightEnabled) && m_postShaderProgram != 0;
+    int width = renderWidth();
+    int height = renderHeight();
+    
+    //bloom writes straight into the filter texture when post processing didnt, so keep it at render size too
+    if (m_filterTexture != 0) {
+        glBindTexture(GL_TEXTURE_2D, m_filterTexture);
+        GLint texWidth, texHeight;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &texWidth);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &texHeight);
+        if (texWidth != width || texHeight != height) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
     
     if (m_bloomEnabled && m_blurShaderProgram != 0 && m_bloomInitialized) {
+        PROFILE_GPU_SCOPE("Bloom");
         renderBloom();
     }
     
-    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer());
     glDisable(GL_DEPTH_TEST);
     glViewport(0, 0, width, height);
     
@@ -2140,10 +2709,12 @@ void Realtime::renderPostFilters() {
         
         glDrawArrays(GL_TRIANGLES, 0, 6);
         
-        if (m_filterMode != 0 || m_grainOverlayEnabled || m_pixelateEnabled) {
+        Profiler::countDrawCall();
+        if (m_filterMode != 0 || renderState().grainOverlayEnabled || m_pixelateEnabled) {
             glBindFramebuffer(GL_FRAMEBUFFER, m_filterFBO);
             glDrawArrays(GL_TRIANGLES, 0, 6);
-            glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+            Profiler::countDrawCall();
+            glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer());
         } else {
             glBindVertexArray(0);
             glUseProgram(0);
@@ -2172,16 +2743,16 @@ void Realtime::renderPostFilters() {
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, m_filterLUTTexture);
     
-    glUniform1i(glGetUniformLocation(m_filterShaderProgram, "postProcessing"), (m_filterMode != 0 || m_grainOverlayEnabled || m_pixelateEnabled) ? 1 : 0);
+    glUniform1i(glGetUniformLocation(m_filterShaderProgram, "postProcessing"), (m_filterMode != 0 || renderState().grainOverlayEnabled || m_pixelateEnabled) ? 1 : 0);
     glUniform1i(glGetUniformLocation(m_filterShaderProgram, "ppMode"), m_filterMode);
     glUniform1f(glGetUniformLocation(m_filterShaderProgram, "near"), settings.nearPlane);
     glUniform1f(glGetUniformLocation(m_filterShaderProgram, "far"), settings.farPlane);
-    glUniform1f(glGetUniformLocation(m_filterShaderProgram, "offset"), m_filterTime * 2.0f * 3.14159f * 0.75f);
-    glUniform1f(glGetUniformLocation(m_filterShaderProgram, "time"), m_filterTime);
+    glUniform1f(glGetUniformLocation(m_filterShaderProgram, "offset"), renderState().filterTime * 2.0f * 3.14159f * 0.75f);
+    glUniform1f(glGetUniformLocation(m_filterShaderProgram, "time"), renderState().filterTime);
     glUniform1f(glGetUniformLocation(m_filterShaderProgram, "lutSize"), m_lutSize);
     GLint grainOverlayLoc = glGetUniformLocation(m_filterShaderProgram, "enableGrainOverlay");
     if (grainOverlayLoc >= 0) {
-        glUniform1i(grainOverlayLoc, m_grainOverlayEnabled ? 1 : 0);
+        glUniform1i(grainOverlayLoc, renderState().grainOverlayEnabled ? 1 : 0);
     }
     
     GLint grainSizeLoc = glGetUniformLocation(m_filterShaderProgram, "grainSize");
@@ -2191,7 +2762,7 @@ void Realtime::renderPostFilters() {
     
     GLint grainOpacityLoc = glGetUniformLocation(m_filterShaderProgram, "grainOpacity");
     if (grainOpacityLoc >= 0) {
-        glUniform1f(grainOpacityLoc, m_grainOpacity);
+        glUniform1f(grainOpacityLoc, renderState().grainOpacity);
     }
     GLint pixelateLoc = glGetUniformLocation(m_filterShaderProgram, "enablePixelate");
     if (pixelateLoc >= 0) {
@@ -2205,17 +2776,17 @@ void Realtime::renderPostFilters() {
     
     GLint fieldPenaltyLoc = glGetUniformLocation(m_filterShaderProgram, "fieldPenalty");
     if (fieldPenaltyLoc >= 0) {
-        glUniform1f(fieldPenaltyLoc, m_fieldPenaltyValue);
+        glUniform1f(fieldPenaltyLoc, renderState().fieldPenaltyValue);
     }
     
     GLint forestPenaltyLoc = glGetUniformLocation(m_filterShaderProgram, "forestPenalty");
     if (forestPenaltyLoc >= 0) {
-        glUniform1f(forestPenaltyLoc, m_forestPenaltyValue);
+        glUniform1f(forestPenaltyLoc, renderState().forestPenaltyValue);
     }
     
     GLint mountainPenaltyLoc = glGetUniformLocation(m_filterShaderProgram, "mountainPenalty");
     if (mountainPenaltyLoc >= 0) {
-        glUniform1f(mountainPenaltyLoc, m_mountainPenaltyValue);
+        glUniform1f(mountainPenaltyLoc, renderState().mountainPenaltyValue);
     }
     
     GLint colorPenaltyStrengthLoc = glGetUniformLocation(m_filterShaderProgram, "colorPenaltyStrength");
@@ -2225,6 +2796,7 @@ void Realtime::renderPostFilters() {
     
     glDrawArrays(GL_TRIANGLES, 0, 6);
     
+    Profiler::countDrawCall();
     glBindVertexArray(0);
     glUseProgram(0);
     glEnable(GL_DEPTH_TEST);
@@ -2235,8 +2807,8 @@ void Realtime::renderPostProcessingToTexture() {
         return;
     }
     
-    int width = size().width() * m_devicePixelRatio;
-    int height = size().height() * m_devicePixelRatio;
+    int width = renderWidth();
+    int height = renderHeight();
     
     if (m_filterTexture != 0) {
         glBindTexture(GL_TEXTURE_2D, m_filterTexture);
@@ -2275,17 +2847,17 @@ void Realtime::renderPostProcessingToTexture() {
     glUniform3fv(glGetUniformLocation(m_postShaderProgram, "camPos"), 1, &camPos[0]);
     
     glUniform1i(glGetUniformLocation(m_postShaderProgram, "enableFog"), m_fogEnabled ? 1 : 0);
-    glUniform1i(glGetUniformLocation(m_postShaderProgram, "enableFlashlight"), m_flashlightEnabled ? 1 : 0);
+    glUniform1i(glGetUniformLocation(m_postShaderProgram, "enableFlashlight"), renderState().flashlightEnabled ? 1 : 0);
     
-    glUniform3fv(glGetUniformLocation(m_postShaderProgram, "fogColor"), 1, &m_fogColor[0]);
-    glUniform1f(glGetUniformLocation(m_postShaderProgram, "fogIntensity"), m_fogIntensity);
+    glUniform3fv(glGetUniformLocation(m_postShaderProgram, "fogColor"), 1, &renderState().fogColor[0]);
+    glUniform1f(glGetUniformLocation(m_postShaderProgram, "fogIntensity"), renderState().fogIntensity);
     
-    glUniform3fv(glGetUniformLocation(m_postShaderProgram, "flashlightPos"), 1, &m_flashlight.position[0]);
-    glUniform3fv(glGetUniformLocation(m_postShaderProgram, "flashlightDir"), 1, &m_flashlight.direction[0]);
-    glUniform1f(glGetUniformLocation(m_postShaderProgram, "flashlightConeAngle"), m_flashlight.coneAngle);
+    glUniform3fv(glGetUniformLocation(m_postShaderProgram, "flashlightPos"), 1, &m_renderFlashlight.position[0]);
+    glUniform3fv(glGetUniformLocation(m_postShaderProgram, "flashlightDir"), 1, &m_renderFlashlight.direction[0]);
+    glUniform1f(glGetUniformLocation(m_postShaderProgram, "flashlightConeAngle"), m_renderFlashlight.coneAngle);
     
     //flicker intensity to flashlight color
-    glm::vec3 flickeredColor = m_flashlight.color * m_flashlightFlickerIntensity;
+    glm::vec3 flickeredColor = m_renderFlashlight.color * renderState().flashlightFlickerIntensity;
     glUniform3fv(glGetUniformLocation(m_postShaderProgram, "flashlightColor"), 1, &flickeredColor[0]);
     
     glm::mat4 invView = glm::inverse(m_camera.getViewMatrix());
@@ -2295,6 +2867,7 @@ void Realtime::renderPostProcessingToTexture() {
     
     glDrawArrays(GL_TRIANGLES, 0, 6);
     
+    Profiler::countDrawCall();
     glBindVertexArray(0);
     glUseProgram(0);
     glEnable(GL_DEPTH_TEST);
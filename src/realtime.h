@@ -9,6 +9,8 @@
 
 #include <unordered_map>
 #include <deque>
+#include <atomic>
+#include <functional>
 #include <QElapsedTimer>
 #include <QOpenGLWidget>
 #include <QTime>
@@ -25,9 +27,15 @@
 #include "realtime/physics.h"
 #include "realtime/rendering.h"
 #include "realtime/gbuffer.h"
+#include "realtime/dynamicresolution.h"
+#include "realtime/viewdistance.h"
+#include "realtime/simulationthread.h"
 #include "enemies/enemymanager.h"
 #include "particlesystem/particlesystem.h"
 #include "ui/ui.h"
+#include "utils/spscqueue.h"
+#include "utils/triplebuffer.h"
+#include "utils/streambuffer.h"
 
 // Forward declarations
 class AudioManager;
@@ -70,6 +78,9 @@ public:
     void setOverheadLightIntensity(double intensity);
     void setMotionBlurEnabled(bool enabled);
     void setMotionBlurSamples(int samples);
+    void setDynamicResolutionEnabled(bool enabled);
+    void setViewDistance(int chunks);
+    void setAutoViewDistance(bool enabled);
     void setDepthVisualizationEnabled(bool enabled);
     void setGBufferVisualizationMode(int mode);
     void setFpsMode(bool enabled);
@@ -90,34 +101,62 @@ public:
     void setDirtSpawnRate(float rate);
     void setFogWispSpawnInterval(float interval);
     void setMaxParticles(int maxParticles);
+    void setGpuParticlesEnabled(bool enabled);
     int getLUTChoice() const { return m_lutChoice; }
     
-        float getFlashlightCharge() const { return m_flashlightCharge; }
-        bool isFlashlightEnabled() const { return m_flashlightEnabled; }
-        float getFlashlightPenaltyTimer() const { return m_flashlightPenaltyTimer; }
+        //ui getters read the last published sim snapshot, not the live sim state
+        float getFlashlightCharge() const { return renderState().flashlightCharge; }
+        bool isFlashlightEnabled() const { return renderState().flashlightEnabled; }
+        float getFlashlightPenaltyTimer() const { return renderState().flashlightPenaltyTimer; }
         
-        bool hasFieldCompletionCube() const { return m_fieldPenaltyTimer > 0.0f || m_fieldPenaltyValue >= 1.0f; }
-        bool hasMountainCompletionCube() const { return m_mountainPenaltyTimer > 0.0f || m_mountainPenaltyValue >= 1.0f; }
-        bool hasForestCompletionCube() const { return m_forestPenaltyTimer > 0.0f || m_forestPenaltyValue >= 1.0f; }
+        bool hasFieldCompletionCube() const { return renderState().hasFieldCube; }
+        bool hasMountainCompletionCube() const { return renderState().hasMountainCube; }
+        bool hasForestCompletionCube() const { return renderState().hasForestCube; }
         
         //getters for penalty values
-        float getFieldPenaltyValue() const { return m_fieldPenaltyValue; }
-        float getMountainPenaltyValue() const { return m_mountainPenaltyValue; }
-        float getForestPenaltyValue() const { return m_forestPenaltyValue; }
+        float getFieldPenaltyValue() const { return renderState().fieldPenaltyValue; }
+        float getMountainPenaltyValue() const { return renderState().mountainPenaltyValue; }
+        float getForestPenaltyValue() const { return renderState().forestPenaltyValue; }
         
         //getter for player health
-        float getPlayerHealth() const { return m_playerHealth; }
+        float getPlayerHealth() const { return renderState().playerHealth; }
     
     void addPathWaypoint();
     void startPathPlayback();
     void stopPathPlayback();
     void clearPath();
     void setPathDuration(float durationSeconds);
-    bool isPathPlaying() const { return m_cameraPath.isPlaying(); }
-    int getPathWaypointCount() const { return m_cameraPath.getWaypointCount(); }
-    
-    EnemyManager& getEnemyManager() { return m_enemyManager; }
-    const EnemyManager& getEnemyManager() const { return m_enemyManager; }
+    bool isPathPlaying() const { return m_pathPlaying.load(std::memory_order_acquire); }
+    int getPathWaypointCount() const;
+    bool loadCameraPath(const std::string& filePath);
+    bool saveCameraPath(const std::string& filePath) const;
+    float getPathDuration() const;
+    
+    //fixed timestep sim: advanceFrame feeds frameTime into the accumulator and runs whole
+    //SIM_TIMESTEP ticks, the leftover fraction is used to interpolate what gets rendered.
+    //the benchmark drives these directly without the event loop
+    static constexpr double SIM_TIMESTEP = 1.0 / 60.0;
+    static constexpr int MAX_SIM_STEPS_PER_FRAME = 5;
+    void advanceFrame(float frameTime);
+    void stepSimulation(float deltaTime);
+    void renderFrame();
+    float getSimAlpha() const { return m_simAlpha; }
+    float getSimRate() const { return m_simRate; }
+    float getRenderRate() const { return m_renderRate; }
+    
+    //threaded: ticks run on SimulationThread and advanceFrame only paces rendering.
+    //off: advanceFrame ticks on the gui thread like before (the benchmark wants it deterministic)
+    void setThreadedSimulation(bool enabled);
+    bool isThreadedSimulation() const { return m_threadedSimulation; }
+    
+    //enemy controls for the ui, they pause the sim since the enemy manager lives on its thread
+    void setEnemySpawnDelay(float delay);
+    void setEnemyAutoSpawnEnabled(bool enabled);
+    void spawnEnemy(const glm::vec3& position);
+    FlowField::Stats getFlowFieldStats() const;
+    EnemyManager::LodStats getEnemyLodStats() const;
+    
+    //the camera frames are drawn from, the simulated one is m_simCamera
     Camera& getCamera() { return m_camera; }
     const Camera& getCamera() const { return m_camera; }
     
@@ -129,6 +168,9 @@ signals:
     void fpsModeToggled(bool enabled);
     void flashlightChargeChanged(float charge, bool inPenalty);
     void motionBlurToggled(bool enabled);
+    void renderScaleChanged(float scale, float gpuFrameMs);
+    void viewDistanceChanged(int chunks);
+    void frameRatesChanged(float simHz, float renderHz);
 
     // Friend declarations for helper functions
     friend void TextureLoader::initializeTextures(Realtime* realtime);
@@ -138,6 +180,7 @@ signals:
     friend void InputHandler::handleMousePress(Realtime* realtime, QMouseEvent* event);
     friend void InputHandler::handleMouseRelease(Realtime* realtime, QMouseEvent* event);
     friend void InputHandler::handleMouseMove(Realtime* realtime, QMouseEvent* event);
+    friend class SimulationThread;
 
 protected:
     void initializeGL() override;
@@ -159,8 +202,18 @@ protected:
     bool m_ignoreNextMouseMove;
     glm::vec2 m_pendingRotation;
     CameraPath m_cameraPath;
+    //sim side key state, only written by drainSimInput
     std::unordered_map<Qt::Key, bool> m_keyMap;
     
+    //input goes gui thread -> sim through here, drained at the start of every tick
+    SpscQueue<SimInputEvent, 256> m_simInput;
+    //gui side spill for when the queue is full, goes in ahead of anything newer once there's room
+    std::deque<SimInputEvent> m_simInputOverflow;
+    long long m_simInputOverflowCount;
+    void queueSimInput(const SimInputEvent& event);
+    void flushSimInputOverflow();
+    void drainSimInput();
+    
     //texture members (accessible by TextureLoader)
     GLuint m_colorTexture;
     GLuint m_sandTexture;
@@ -179,7 +232,8 @@ protected:
     
     //map and camera (accessible by FogSystem)
     Map* m_activeMap;
-    Camera m_camera;
+    Camera m_camera;      //render camera, rebuilt from the snapshot every frame
+    Camera m_simCamera;   //player camera the sim moves around
 
 private:
     void keyPressEvent(QKeyEvent *event) override;
@@ -190,14 +244,41 @@ private:
     void timerEvent(QTimerEvent *event) override;
 
     void addLightsToShader(const std::vector<SceneLightData> &lights);
-    void updateFlashlightPosition();
     void updateFlashlightCharge(float deltaTime);
+    void applyFlashlightEnabled(bool enabled);
     void updateCompletionCubePenalties(float deltaTime);
     void renderPostProcessing();
 
     int m_timer;
     QElapsedTimer m_elapsedTimer;
     
+    //fixed timestep state, alpha is how far between the last two ticks the next frame sits
+    double m_simAccumulator;
+    float m_simAlpha;
+    glm::vec3 m_prevCameraPos;
+    glm::vec3 getRenderCameraPosition(const SimSnapshot& state) const;
+    
+    //sim thread + the snapshots it hands the renderer. publishSnapshot runs on the sim side after a tick,
+    //renderState() is the newest snapshot paintGL picked up
+    SimulationThread m_simThread;
+    bool m_threadedSimulation;
+    TripleBuffer<SimSnapshot> m_simSnapshots;
+    unsigned long long m_simTick;
+    std::atomic<bool> m_pathPlaying;
+    void publishSnapshot();
+    const SimSnapshot& renderState() const { return m_simSnapshots.front(); }
+    void applyRenderState(const SimSnapshot& state);
+    
+    //gl calls triggered by the sim (lut swaps, blur timing) have to run on the gui thread
+    void postToGuiThread(std::function<void()> fn);
+    
+    //ticks and painted frames over the last second, reported separately
+    std::atomic<int> m_simTickCount;
+    int m_renderFrameCount;
+    float m_rateTimer;
+    float m_simRate;
+    float m_renderRate;
+    
     float m_rotationSmoothingFactor;
 
     double m_devicePixelRatio;
@@ -225,6 +306,21 @@ private:
     bool m_motionBlurEnabled;
     int m_motionBlurSamples;
     bool m_motionBlurAutoEnabled;
+    
+    //dynamic resolution, scene + post chain renders at renderWidth() x renderHeight()
+    DynamicResolution m_dynamicResolution;
+    float m_appliedRenderScale;
+    int renderWidth() const;
+    int renderHeight() const;
+    GLuint outputFramebuffer() const;
+    
+    //view distance in chunks, auto mode steps it from frame + chunk generation times
+    ViewDistanceController m_viewDistanceController;
+    float m_paintCpuMs;     //wall time of the last paintGL, what a frame costs on the cpu side
+    //width / height from resizeGL, the sim reads it to keep m_simCamera's projection in step with the screen
+    std::atomic<float> m_viewAspect;
+    void updateSimProjection();
+    void applyViewDistance(int chunks);
     bool m_depthVisualizationEnabled;
     int m_gbufferVisualizationMode;
     int m_fpsCenterTimer;
@@ -242,6 +338,7 @@ private:
     glm::vec3 getBiomeFogColor(BiomeType biome) const; // Get target fog color for biome
     void updatePhysics(float deltaTime);
     void updatePlayerHealth(float deltaTime);
+    std::vector<int> m_nearbyEnemies; //scratch for the enemy grid query in updatePlayerHealth
     void handleDeath(); // Handle player death and ghost respawn
     
     float m_flashlightFlickerIntensity; // Current flicker intensity (0.0 to 1.0)
@@ -253,7 +350,9 @@ private:
         float coneAngle;
         glm::vec3 color;
     };
-    Flashlight m_flashlight;
+    Flashlight m_flashlight;          //sim side, drives enemy illumination
+    Flashlight m_renderFlashlight;    //follows the render camera for the post shader
+    void updateFlashlightPosition(Flashlight& flashlight, const Camera& camera) const;
     
     GLuint m_postShaderProgram;
     GLuint m_postQuadVAO;
@@ -359,15 +458,24 @@ private:
     GLint m_blockViewLoc;
     GLint m_blockCameraPosLoc;
     GLint m_blockNumLightsLoc;
+    GLint m_blockInstancedLoc;
 
     //block VAO/VBO
     GLuint m_blockVAO;
     GLuint m_blockVBO;
     int m_blockVertexCount;
 
+    //every TreeArchetypes mesh lod back to back and then the impostor quad, one instanced draw per archetype and lod
     GLuint m_treeVAO;
     GLuint m_treeVBO;
-    int m_treeVertexCount;
+    GLuint m_treeEBO;
+    std::vector<GLuint> m_treeMeshFirstIndex;       //archetype * TreeArchetype::MESH_LOD_COUNT + lod
+    std::vector<GLsizei> m_treeMeshIndexCount;
+    GLint m_treeQuadFirst;                          //drawn unindexed, straight off the vertex buffer
+    //IMPOSTOR_VIEWS views around each archetype, one row per archetype, baked once on the first tree draw
+    GLuint m_treeImpostorAtlas;
+    std::vector<std::vector<TreeInstanceData>> m_treeBatches;     //archetype * TreeArchetype::LOD_COUNT + lod, reused every frame
+    StreamBuffer m_treeInstanceStream;
     
     GLuint m_completionCubeVAO;
     GLuint m_completionCubeVBO;
@@ -376,5 +484,10 @@ private:
     void addLightsToBlockShader(const std::vector<SceneLightData> &lights);
     
     bool isCompletionCubeWithinOneBlock(const glm::vec3& cameraPos);
+    
+    //pickups are decided on the sim side, the gui thread drops the picked biomes' cubes from the map
+    void updateCompletionCubePickup();
+    unsigned int m_collectedCubeMask;
+    unsigned int m_appliedCubeMask;
 
 };
@@ -0,0 +1,217 @@
+#include "realtime/dynamicresolution.h"
+#include "utils/shaderloader.h"
+#include "utils/profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+DynamicResolution::DynamicResolution()
+    : m_enabled(false)
+    , m_edgeAware(true)
+    , m_scale(1.0f)
+    , m_targetFrameTimeMs(12.0f)
+    , m_gpuFrameTimeMs(0.0f)
+    , m_framesSinceChange(0)
+    , m_timerQueries{0, 0, 0, 0}
+    , m_queryPending{false, false}
+    , m_queryIndex(0)
+    , m_queryActive(false)
+    , m_fbo(0)
+    , m_texture(0)
+    , m_targetWidth(0)
+    , m_targetHeight(0)
+    , m_upscaleShader(0)
+{
+}
+
+DynamicResolution::~DynamicResolution() {
+}
+
+void DynamicResolution::initialize() {
+    if (m_timerQueries[0] == 0) {
+        glGenQueries(4, m_timerQueries);
+    }
+    
+    if (m_upscaleShader == 0) {
+        try {
+            m_upscaleShader = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/motionblur.vert",
+                ":/resources/shaders/upscale.frag"
+            );
+        } catch (const std::runtime_error &e) {
+            std::cerr << "Error loading upscale shader: " << e.what() << std::endl;
+        }
+    }
+}
+
+void DynamicResolution::cleanup() {
+    if (m_timerQueries[0] != 0) {
+        glDeleteQueries(4, m_timerQueries);
+        std::fill(m_timerQueries, m_timerQueries + 4, 0u);
+    }
+    if (m_fbo != 0) {
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteTextures(1, &m_texture);
+        m_fbo = 0;
+        m_texture = 0;
+    }
+    if (m_upscaleShader != 0) {
+        glDeleteProgram(m_upscaleShader);
+        m_upscaleShader = 0;
+    }
+}
+
+void DynamicResolution::setEnabled(bool enabled) {
+    m_enabled = enabled;
+    m_framesSinceChange = 0;
+    if (!enabled) {
+        m_scale = MAX_SCALE;
+    }
+}
+
+void DynamicResolution::beginFrame() {
+    if (!m_enabled || m_timerQueries[0] == 0 || m_queryActive || m_queryPending[m_queryIndex]) {
+        return;
+    }
+    glQueryCounter(m_timerQueries[m_queryIndex * 2], GL_TIMESTAMP);
+    m_queryActive = true;
+}
+
+void DynamicResolution::endFrame() {
+    if (!m_queryActive) {
+        return;
+    }
+    glQueryCounter(m_timerQueries[m_queryIndex * 2 + 1], GL_TIMESTAMP);
+    m_queryActive = false;
+    m_queryPending[m_queryIndex] = true;
+    m_queryIndex = 1 - m_queryIndex;
+}
+
+bool DynamicResolution::update() {
+    if (!m_enabled) {
+        return false;
+    }
+    
+    //read the older query, it's a frame behind so this shouldnt stall
+    int idx = m_queryIndex;
+    if (!m_queryPending[idx]) {
+        return false;
+    }
+    //the end stamp lands after the begin one, once it's in both are
+    GLuint available = 0;
+    glGetQueryObjectuiv(m_timerQueries[idx * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return false;
+    }
+    GLuint64 beginNs = 0;
+    GLuint64 endNs = 0;
+    glGetQueryObjectui64v(m_timerQueries[idx * 2], GL_QUERY_RESULT, &beginNs);
+    glGetQueryObjectui64v(m_timerQueries[idx * 2 + 1], GL_QUERY_RESULT, &endNs);
+    m_queryPending[idx] = false;
+    
+    float frameMs = static_cast<float>((endNs > beginNs ? endNs - beginNs : 0) / 1.0e6);
+    if (m_gpuFrameTimeMs <= 0.0f) {
+        m_gpuFrameTimeMs = frameMs;
+    } else {
+        m_gpuFrameTimeMs += (frameMs - m_gpuFrameTimeMs) * 0.1f;
+    }
+    
+    m_framesSinceChange++;
+    if (m_framesSinceChange < CHANGE_COOLDOWN_FRAMES || m_gpuFrameTimeMs <= 0.0f) {
+        return false;
+    }
+    
+    //only react outside a dead band around the target so the scale doesnt oscillate
+    bool overBudget = m_gpuFrameTimeMs > m_targetFrameTimeMs;
+    bool underBudget = m_gpuFrameTimeMs < m_targetFrameTimeMs * 0.75f;
+    if (!overBudget && !underBudget) {
+        return false;
+    }
+    
+    //fill cost goes with pixel count (scale^2), so step by the sqrt of the budget ratio
+    float wanted = m_scale * std::sqrt(m_targetFrameTimeMs / m_gpuFrameTimeMs);
+    wanted = std::clamp(wanted, m_scale - 2.0f * SCALE_STEP, m_scale + 2.0f * SCALE_STEP);
+    wanted = std::round(wanted / SCALE_STEP) * SCALE_STEP;
+    wanted = std::clamp(wanted, MIN_SCALE, MAX_SCALE);
+    
+    if (std::abs(wanted - m_scale) < SCALE_STEP * 0.5f) {
+        return false;
+    }
+    
+    m_scale = wanted;
+    m_framesSinceChange = 0;
+    return true;
+}
+
+void DynamicResolution::ensureTarget(int fullWidth, int fullHeight) {
+    if (fullWidth <= 0 || fullHeight <= 0) {
+        return;
+    }
+    if (m_fbo != 0 && m_targetWidth == fullWidth && m_targetHeight == fullHeight) {
+        return;
+    }
+    
+    if (m_fbo == 0) {
+        glGenFramebuffers(1, &m_fbo);
+        glGenTextures(1, &m_texture);
+    }
+    
+    //allocated at full size once, the chain only fills the scaled corner of it
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, fullWidth, fullHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Dynamic resolution FBO incomplete: " << status << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    m_targetWidth = fullWidth;
+    m_targetHeight = fullHeight;
+}
+
+void DynamicResolution::present(GLuint targetFBO, int renderWidth, int renderHeight, int fullWidth, int fullHeight, GLuint quadVAO) {
+    if (m_fbo == 0 || m_targetWidth <= 0 || m_targetHeight <= 0) {
+        return;
+    }
+    
+    //no shader, fall back to a plain bilinear blit
+    if (m_upscaleShader == 0 || quadVAO == 0) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFBO);
+        glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, fullWidth, fullHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+        return;
+    }
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    glViewport(0, 0, fullWidth, fullHeight);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    
+    glUseProgram(m_upscaleShader);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glUniform1i(glGetUniformLocation(m_upscaleShader, "sourceTexture"), 0);
+    glUniform2f(glGetUniformLocation(m_upscaleShader, "uvScale"),
+                static_cast<float>(renderWidth) / m_targetWidth,
+                static_cast<float>(renderHeight) / m_targetHeight);
+    glUniform1i(glGetUniformLocation(m_upscaleShader, "edgeAware"), m_edgeAware ? 1 : 0);
+    glUniform1f(glGetUniformLocation(m_upscaleShader, "sharpness"), 1.0f - m_scale);
+    
+    glBindVertexArray(quadVAO);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    Profiler::countDrawCall();
+    glBindVertexArray(0);
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+    glEnable(GL_DEPTH_TEST);
+}
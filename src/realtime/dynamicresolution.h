@@ -0,0 +1,64 @@
+#pragma once
+
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+//picks a render scale for the scene + post chain so the GPU time of those passes stays under a budget,
+//then upscales the result into the default framebuffer
+class DynamicResolution {
+public:
+    DynamicResolution();
+    ~DynamicResolution();
+    
+    void initialize();
+    void cleanup();
+    
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+    void setTargetFrameTime(float ms) { m_targetFrameTimeMs = ms; }
+    void setEdgeAwareUpscale(bool enabled) { m_edgeAware = enabled; }
+    
+    float getScale() const { return m_enabled ? m_scale : 1.0f; }
+    float getGpuFrameTime() const { return m_gpuFrameTimeMs; }
+    
+    //brackets the scaled part of the frame with a GL_TIMESTAMP pair. not GL_TIME_ELAPSED, those can't nest and
+    //the passes inside (motion blur) run their own
+    void beginFrame();
+    void endFrame();
+    
+    //feeds the latest finished query into the controller, returns true if the scale changed
+    bool update();
+    
+    //offscreen target the scaled chain writes into instead of the default framebuffer
+    void ensureTarget(int fullWidth, int fullHeight);
+    GLuint getFramebuffer() const { return m_fbo; }
+    
+    void present(GLuint targetFBO, int renderWidth, int renderHeight, int fullWidth, int fullHeight, GLuint quadVAO);
+    
+private:
+    static constexpr float MIN_SCALE = 0.5f;
+    static constexpr float MAX_SCALE = 1.0f;
+    static constexpr float SCALE_STEP = 0.05f;
+    static constexpr int CHANGE_COOLDOWN_FRAMES = 20;
+    
+    bool m_enabled;
+    bool m_edgeAware;
+    float m_scale;
+    float m_targetFrameTimeMs;
+    float m_gpuFrameTimeMs;
+    int m_framesSinceChange;
+    
+    GLuint m_timerQueries[4];     //begin, end for each of the two frames in flight
+    bool m_queryPending[2];
+    int m_queryIndex;
+    bool m_queryActive;
+    
+    GLuint m_fbo;
+    GLuint m_texture;
+    int m_targetWidth;
+    int m_targetHeight;
+    
+    GLuint m_upscaleShader;
+};
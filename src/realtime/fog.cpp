@@ -28,7 +28,7 @@ namespace FogSystem {
             return;
         }
         
-        glm::vec3 cameraPos = realtime->m_camera.getPosition();
+        glm::vec3 cameraPos = realtime->m_simCamera.getPosition();
         int playerX = static_cast<int>(std::floor(cameraPos.x));
         int playerZ = static_cast<int>(std::floor(cameraPos.z));
         BiomeType currentBiome = realtime->m_activeMap->getBiomeAt(playerX, playerZ);
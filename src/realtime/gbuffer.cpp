@@ -1,6 +1,8 @@
 #include "realtime/gbuffer.h"
 #include "realtime.h"
 #include "utils/shaderloader.h"
+#include "utils/profiler.h"
+#include <algorithm>
 #include <iostream>
 
 GLuint GBuffer::m_gbufferFBO = 0;
@@ -17,8 +19,24 @@ GLuint GBuffer::m_sceneDepthTexture = 0;
 GLuint GBuffer::m_motionBlurFBO = 0;
 GLuint GBuffer::m_motionBlurTexture = 0;
 
+GLuint GBuffer::m_tileMaxFBO = 0;
+GLuint GBuffer::m_tileMaxTexture = 0;
+GLuint GBuffer::m_neighborMaxFBO = 0;
+GLuint GBuffer::m_neighborMaxTexture = 0;
+int GBuffer::m_tileCountX = 0;
+int GBuffer::m_tileCountY = 0;
+bool GBuffer::m_useTileMax = true;
+
+GLuint GBuffer::m_motionBlurTimerQueries[2] = {0, 0};
+bool GBuffer::m_motionBlurQueryPending[2] = {false, false};
+int GBuffer::m_motionBlurQueryIndex = 0;
+double GBuffer::m_motionBlurTimeAccumMs = 0.0;
+int GBuffer::m_motionBlurTimedFrames = 0;
+
 GLuint GBuffer::m_gbufferShaderProgram = 0;
 GLuint GBuffer::m_motionBlurShaderProgram = 0;
+GLuint GBuffer::m_tileMaxShaderProgram = 0;
+GLuint GBuffer::m_neighborMaxShaderProgram = 0;
 GLuint GBuffer::m_depthVizShaderProgram = 0;
 GLuint GBuffer::m_gbufferVizShaderProgram = 0;
 
@@ -100,6 +118,7 @@ void GBuffer::renderGBufferVisualization(Realtime* realtime, int mode) {
         
         glBindVertexArray(m_quadVAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        Profiler::countDrawCall();
         glBindVertexArray(0);
     }
     
@@ -134,6 +153,26 @@ void GBuffer::initialize(Realtime* realtime, int width, int height) {
         }
     }
     
+    if (m_tileMaxShaderProgram == 0) {
+        try {
+            m_tileMaxShaderProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/motionblur.vert",
+                ":/resources/shaders/velocitytilemax.frag"
+            );
+        } catch (const std::runtime_error &e) {
+        }
+    }
+    
+    if (m_neighborMaxShaderProgram == 0) {
+        try {
+            m_neighborMaxShaderProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/motionblur.vert",
+                ":/resources/shaders/velocityneighbormax.frag"
+            );
+        } catch (const std::runtime_error &e) {
+        }
+    }
+    
     if (m_depthVizShaderProgram == 0) {
         try {
             m_depthVizShaderProgram = ShaderLoader::createShaderProgram(
@@ -195,6 +234,10 @@ void GBuffer::initialize(Realtime* realtime, int width, int height) {
         
         glBindVertexArray(0);
     }
+    
+    if (m_motionBlurTimerQueries[0] == 0) {
+        glGenQueries(2, m_motionBlurTimerQueries);
+    }
 
     //lowk bad association but this isnt cs15
     makeFBOs(realtime);
@@ -225,8 +268,8 @@ void GBuffer::beginGeometryPass(Realtime* realtime) {
     GLenum attachments[4] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3};
     glDrawBuffers(4, attachments);
     
-    int w = realtime->size().width() * realtime->m_devicePixelRatio;
-    int h = realtime->size().height() * realtime->m_devicePixelRatio;
+    int w = realtime->renderWidth();
+    int h = realtime->renderHeight();
     glViewport(0, 0, w, h);
     
     // Reset vertex attribute state that particles might have modified
@@ -279,8 +322,8 @@ void GBuffer::beginScenePass(Realtime* realtime) {
     GLenum attachments[1] = {GL_COLOR_ATTACHMENT0};
     glDrawBuffers(1, attachments);
     
-    int w = realtime->size().width() * realtime->m_devicePixelRatio;
-    int h = realtime->size().height() * realtime->m_devicePixelRatio;
+    int w = realtime->renderWidth();
+    int h = realtime->renderHeight();
     glViewport(0, 0, w, h);
     
     glEnable(GL_DEPTH_TEST);
@@ -296,13 +339,46 @@ void GBuffer::renderMotionBlur(Realtime* realtime, bool renderToTexture) {
         return;
     }
     
-    int w = realtime->size().width() * realtime->m_devicePixelRatio;
-    int h = realtime->size().height() * realtime->m_devicePixelRatio;
+    int w = realtime->renderWidth();
+    int h = realtime->renderHeight();
     
     if (w <= 0 || h <= 0) {
         return;
     }
     
+    //time the whole blur (tile passes + gather) while a camera path is playing
+    bool timing = realtime->isPathPlaying() && m_motionBlurTimerQueries[0] != 0;
+    if (timing) {
+        int idx = m_motionBlurQueryIndex;
+        //read back the query from the previous frame so we never stall on this one
+        int prev = 1 - idx;
+        if (m_motionBlurQueryPending[prev]) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(m_motionBlurTimerQueries[prev], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 elapsedNs = 0;
+                glGetQueryObjectui64v(m_motionBlurTimerQueries[prev], GL_QUERY_RESULT, &elapsedNs);
+                m_motionBlurTimeAccumMs += elapsedNs / 1.0e6;
+                m_motionBlurTimedFrames++;
+                m_motionBlurQueryPending[prev] = false;
+            }
+        }
+        //elapsed queries cant nest, skip the sample if some other pass has one open (dynamic resolution and the
+        //profiler use timestamps, so they never do)
+        GLint activeQuery = 0;
+        glGetQueryiv(GL_TIME_ELAPSED, GL_CURRENT_QUERY, &activeQuery);
+        if (!m_motionBlurQueryPending[idx] && activeQuery == 0) {
+            glBeginQuery(GL_TIME_ELAPSED, m_motionBlurTimerQueries[idx]);
+        } else {
+            timing = false;
+        }
+    }
+    
+    bool useTileMax = m_useTileMax && m_tileMaxShaderProgram != 0 && m_neighborMaxShaderProgram != 0 && m_neighborMaxTexture != 0;
+    if (useTileMax) {
+        renderVelocityTiles(realtime);
+    }
+    
     if (renderToTexture) {
         // Render to texture for post-processing/filters
         if (m_motionBlurFBO == 0) {
@@ -330,9 +406,8 @@ void GBuffer::renderMotionBlur(Realtime* realtime, bool renderToTexture) {
         GLenum attachments[1] = {GL_COLOR_ATTACHMENT0};
         glDrawBuffers(1, attachments);
     } else {
-        // Render directly to default framebuffer (original behavior)
-        GLuint defaultFBO = realtime->defaultFramebufferObject();
-        glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
+        // Render directly to the output framebuffer (default, or the dynamic res target)
+        glBindFramebuffer(GL_FRAMEBUFFER, realtime->outputFramebuffer());
         glViewport(0, 0, w, h);
     }
     
@@ -353,6 +428,8 @@ void GBuffer::renderMotionBlur(Realtime* realtime, bool renderToTexture) {
     GLint gVelocityLoc = glGetUniformLocation(m_motionBlurShaderProgram, "gVelocity");
     GLint sceneTexLoc = glGetUniformLocation(m_motionBlurShaderProgram, "sceneTexture");
     GLint numSamplesLoc = glGetUniformLocation(m_motionBlurShaderProgram, "numSamples");
+    GLint neighborMaxLoc = glGetUniformLocation(m_motionBlurShaderProgram, "neighborMaxTexture");
+    GLint useTileMaxLoc = glGetUniformLocation(m_motionBlurShaderProgram, "useTileMax");
     
     if (gPosLoc != -1) {
         glActiveTexture(GL_TEXTURE0);
@@ -392,10 +469,31 @@ void GBuffer::renderMotionBlur(Realtime* realtime, bool renderToTexture) {
         glUniform1i(numSamplesLoc, realtime->m_motionBlurSamples);
     }
     
+    if (neighborMaxLoc != -1) {
+        glActiveTexture(GL_TEXTURE5);
+        glBindTexture(GL_TEXTURE_2D, m_neighborMaxTexture);
+        glUniform1i(neighborMaxLoc, 5);
+    }
+    
+    if (useTileMaxLoc != -1) {
+        glUniform1i(useTileMaxLoc, useTileMax ? 1 : 0);
+    }
+    
     glBindVertexArray(m_quadVAO);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    Profiler::countDrawCall();
     glBindVertexArray(0);
     
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    
+    if (timing) {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_motionBlurQueryPending[m_motionBlurQueryIndex] = true;
+        m_motionBlurQueryIndex = 1 - m_motionBlurQueryIndex;
+    }
+    
     // If we rendered to texture, unbind the FBO so the texture can be safely read
     if (renderToTexture) {
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -406,6 +504,51 @@ void GBuffer::renderMotionBlur(Realtime* realtime, bool renderToTexture) {
     glUseProgram(0);
 }
 
+//reduces the velocity buffer to per-tile maxima, then takes the max over each tile's 3x3 neighbourhood
+void GBuffer::renderVelocityTiles(Realtime* realtime) {
+    if (m_tileMaxFBO == 0 || m_neighborMaxFBO == 0 || m_tileCountX <= 0 || m_tileCountY <= 0) {
+        return;
+    }
+    
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glViewport(0, 0, m_tileCountX, m_tileCountY);
+    glBindVertexArray(m_quadVAO);
+    
+    //tile max
+    glBindFramebuffer(GL_FRAMEBUFFER, m_tileMaxFBO);
+    glUseProgram(m_tileMaxShaderProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_velocityTexture);
+    glUniform1i(glGetUniformLocation(m_tileMaxShaderProgram, "gVelocity"), 0);
+    glUniform1i(glGetUniformLocation(m_tileMaxShaderProgram, "tileSize"), TILE_SIZE);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    Profiler::countDrawCall();
+    //neighbour max
+    glBindFramebuffer(GL_FRAMEBUFFER, m_neighborMaxFBO);
+    glUseProgram(m_neighborMaxShaderProgram);
+    glBindTexture(GL_TEXTURE_2D, m_tileMaxTexture);
+    glUniform1i(glGetUniformLocation(m_neighborMaxShaderProgram, "tileMaxTexture"), 0);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    Profiler::countDrawCall();
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, realtime->defaultFramebufferObject());
+}
+
+void GBuffer::reportMotionBlurTiming() {
+    if (m_motionBlurTimedFrames > 0) {
+        std::cout << "Motion blur (" << (m_useTileMax ? "tile-max" : "per-pixel") << "): "
+                  << (m_motionBlurTimeAccumMs / m_motionBlurTimedFrames) << " ms avg over "
+                  << m_motionBlurTimedFrames << " frames" << std::endl;
+    }
+    m_motionBlurTimeAccumMs = 0.0;
+    m_motionBlurTimedFrames = 0;
+    m_motionBlurQueryPending[0] = false;
+    m_motionBlurQueryPending[1] = false;
+}
+
 void GBuffer::renderDepthVisualization(Realtime* realtime, float nearPlane, float farPlane) {
     if (m_depthVizShaderProgram == 0) {
         try {
@@ -492,6 +635,7 @@ void GBuffer::renderDepthVisualization(Realtime* realtime, float nearPlane, floa
         
         glBindVertexArray(m_quadVAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        Profiler::countDrawCall();
         glBindVertexArray(0);
     }
     
@@ -500,13 +644,14 @@ void GBuffer::renderDepthVisualization(Realtime* realtime, float nearPlane, floa
 }
 
 void GBuffer::makeFBOs(Realtime* realtime, int width, int height) {
+    //targets follow the dynamic resolution scale, not the widget size
     int w, h;
     if (width > 0 && height > 0) {
-        w = width * realtime->m_devicePixelRatio;
-        h = height * realtime->m_devicePixelRatio;
+        w = std::max(1, static_cast<int>(width * realtime->m_devicePixelRatio * realtime->m_appliedRenderScale));
+        h = std::max(1, static_cast<int>(height * realtime->m_devicePixelRatio * realtime->m_appliedRenderScale));
     } else {
-        w = realtime->size().width() * realtime->m_devicePixelRatio;
-        h = realtime->size().height() * realtime->m_devicePixelRatio;
+        w = realtime->renderWidth();
+        h = realtime->renderHeight();
     }
     
     if (w <= 0 || h <= 0) {
@@ -532,6 +677,15 @@ void GBuffer::makeFBOs(Realtime* realtime, int width, int height) {
     if (m_motionBlurFBO != 0) {
         glDeleteFramebuffers(1, &m_motionBlurFBO);
         glDeleteTextures(1, &m_motionBlurTexture);
+        m_motionBlurFBO = 0;
+        m_motionBlurTexture = 0;
+    }
+    
+    if (m_tileMaxFBO != 0) {
+        glDeleteFramebuffers(1, &m_tileMaxFBO);
+        glDeleteTextures(1, &m_tileMaxTexture);
+        glDeleteFramebuffers(1, &m_neighborMaxFBO);
+        glDeleteTextures(1, &m_neighborMaxTexture);
     }
     
     //g-buffer FBO
@@ -614,5 +768,30 @@ void GBuffer::makeFBOs(Realtime* realtime, int width, int height) {
     
     glCheckFramebufferStatus(GL_FRAMEBUFFER);
     
+    //velocity tiles, rounded up so partial tiles at the edges still get a texel
+    m_tileCountX = (w + TILE_SIZE - 1) / TILE_SIZE;
+    m_tileCountY = (h + TILE_SIZE - 1) / TILE_SIZE;
+    
+    GLuint* tileFBOs[2] = {&m_tileMaxFBO, &m_neighborMaxFBO};
+    GLuint* tileTextures[2] = {&m_tileMaxTexture, &m_neighborMaxTexture};
+    for (int i = 0; i < 2; i++) {
+        glGenFramebuffers(1, tileFBOs[i]);
+        glBindFramebuffer(GL_FRAMEBUFFER, *tileFBOs[i]);
+        
+        glGenTextures(1, tileTextures[i]);
+        glBindTexture(GL_TEXTURE_2D, *tileTextures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, m_tileCountX, m_tileCountY, 0, GL_RG, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *tileTextures[i], 0);
+        
+        GLenum tileStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (tileStatus != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "ERROR: velocity tile FBO not complete! Status: " << tileStatus << std::endl;
+        }
+    }
+    
     glBindFramebuffer(GL_FRAMEBUFFER, realtime->defaultFramebufferObject());
 }
@@ -22,6 +22,7 @@ public:
 
 
     static void renderMotionBlur(Realtime* realtime, bool renderToTexture = false);
+    static void reportMotionBlurTiming();
     static void renderDepthVisualization(Realtime* realtime, float nearPlane, float farPlane);
     static void renderGBufferVisualization(Realtime* realtime, int mode);
     
@@ -39,8 +40,27 @@ public:
     static GLuint m_motionBlurFBO;
     static GLuint m_motionBlurTexture;
     
+    //velocity tile buffers for motion blur, one texel per TILE_SIZE x TILE_SIZE block
+    static const int TILE_SIZE = 16;
+    static GLuint m_tileMaxFBO;
+    static GLuint m_tileMaxTexture;
+    static GLuint m_neighborMaxFBO;
+    static GLuint m_neighborMaxTexture;
+    static int m_tileCountX;
+    static int m_tileCountY;
+    static bool m_useTileMax;
+    
+    //GPU timing of the motion blur passes, only collected during camera path playback
+    static GLuint m_motionBlurTimerQueries[2];
+    static bool m_motionBlurQueryPending[2];
+    static int m_motionBlurQueryIndex;
+    static double m_motionBlurTimeAccumMs;
+    static int m_motionBlurTimedFrames;
+    
     static GLuint m_gbufferShaderProgram;
     static GLuint m_motionBlurShaderProgram;
+    static GLuint m_tileMaxShaderProgram;
+    static GLuint m_neighborMaxShaderProgram;
     static GLuint m_depthVizShaderProgram;
     static GLuint m_gbufferVizShaderProgram;
     
@@ -62,5 +82,6 @@ public:
     
 private:
     static void makeFBOs(Realtime* realtime, int width = -1, int height = -1);
+    static void renderVelocityTiles(Realtime* realtime);
 };
 
@@ -1,14 +1,18 @@
 #include "input.h"
 #include "../realtime.h"
+#include "gbuffer.h"
+#include "utils/profiler.h"
 #include <iostream>
 #include <cmath>
 #include <glm/glm.hpp>
+#include <QStandardPaths>
 
 namespace InputHandler {
     
     void handleKeyPress(Realtime* realtime, QKeyEvent* event) {
         Qt::Key key = Qt::Key(event->key());
-        realtime->m_keyMap[key] = true;
+        //movement keys are sim state, they go over in order and get applied at the start of the next tick
+        realtime->queueSimInput({SimInputEvent::KeyDown, key, glm::vec2(0.0f)});
         
         if (key == Qt::Key_P && !realtime->m_pKeyPressed) {
             realtime->m_pKeyPressed = true;
@@ -19,8 +23,7 @@ namespace InputHandler {
         
         if (key == Qt::Key_F && !realtime->m_flashlightFKeyPressed) {
             realtime->m_flashlightFKeyPressed = true;
-            realtime->setFlashlightEnabled(!realtime->m_flashlightEnabled);
-            emit realtime->flashlightChargeChanged(realtime->m_flashlightCharge, realtime->m_flashlightPenaltyTimer > 0.0f);
+            realtime->queueSimInput({SimInputEvent::ToggleFlashlight, key, glm::vec2(0.0f)});
         }
         
         if (key == Qt::Key_N) {
@@ -35,6 +38,26 @@ namespace InputHandler {
             realtime->update();
         }
         
+        if (key == Qt::Key_M) {
+            GBuffer::m_useTileMax = !GBuffer::m_useTileMax;
+            std::cout << "Tile-max motion blur: " << (GBuffer::m_useTileMax ? "ON" : "OFF") << std::endl;
+            realtime->update();
+        }
+        
+        if (key == Qt::Key_F3) {
+            Profiler::setOverlayEnabled(!Profiler::isOverlayEnabled());
+            std::cout << "Profiler overlay: " << (Profiler::isOverlayEnabled() ? "ON" : "OFF") << std::endl;
+            realtime->update();
+        }
+        
+        //dumps the captured frames (last few seconds) for chrome://tracing
+        if (key == Qt::Key_F4 && Profiler::isEnabled()) {
+            QString tempDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
+            QString tracePath = tempDir + "/frame_trace.json";
+            Profiler::exportChromeTrace(tracePath.toStdString());
+            Profiler::printSummary();
+        }
+        
         if (key == Qt::Key_Plus || key == Qt::Key_Equal) {
             realtime->m_bumpStrength += 2.0f;
             std::cout << "Bump strength: " << realtime->m_bumpStrength << std::endl;
@@ -49,7 +72,7 @@ namespace InputHandler {
     
     void handleKeyRelease(Realtime* realtime, QKeyEvent* event) {
         Qt::Key key = Qt::Key(event->key());
-        realtime->m_keyMap[key] = false;
+        realtime->queueSimInput({SimInputEvent::KeyUp, key, glm::vec2(0.0f)});
         
         if (key == Qt::Key_P) {
             realtime->m_pKeyPressed = false;
@@ -74,7 +97,7 @@ namespace InputHandler {
     }
     
     void handleMouseMove(Realtime* realtime, QMouseEvent* event) {
-        if (realtime->m_cameraPath.isPlaying()) {
+        if (realtime->isPathPlaying()) {
             return;
         }
         
@@ -96,15 +119,13 @@ namespace InputHandler {
             
             float sensitivity = 0.006f;
             if (std::abs(deltaX) > 0 || std::abs(deltaY) > 0) {
-                realtime->m_pendingRotation.x += -deltaX * sensitivity;
-                realtime->m_pendingRotation.y += -deltaY * sensitivity;
+                realtime->queueSimInput({SimInputEvent::Rotate, 0, glm::vec2(-deltaX * sensitivity, -deltaY * sensitivity)});
             }
         } else if (realtime->m_mouseDown) {
             int deltaX = posX - realtime->m_prev_mouse_pos.x;
             int deltaY = posY - realtime->m_prev_mouse_pos.y;
             realtime->m_prev_mouse_pos = glm::vec2(posX, posY);
-            realtime->m_pendingRotation.x += deltaX * 0.003f;
-            realtime->m_pendingRotation.y += deltaY * 0.003f;
+            realtime->queueSimInput({SimInputEvent::Rotate, 0, glm::vec2(deltaX * 0.003f, deltaY * 0.003f)});
         }
     }
 }
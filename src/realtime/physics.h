@@ -6,8 +6,7 @@ class Realtime;
 
 class Physics {
 public:
+    static void getPlayerBounds(const Realtime* realtime, const glm::vec3& pos, glm::vec3& boxMin, glm::vec3& boxMax);
     static bool checkCollision(const Realtime* realtime, const glm::vec3& pos);
-    static glm::vec3 resolveCollision(Realtime* realtime, const glm::vec3& pos, const glm::vec3& oldPos);
     static void updatePhysics(Realtime* realtime, float deltaTime);
 };
-
@@ -5,18 +5,26 @@
 #include "map/Tree.h"
 #include "map/CompletionCube.h"
 #include "blocks/Block.h"
-#include "blocks/TreePiece.h"
+#include "map/treearchetypes.h"
 #include "utils/scenedata.h"
 #include "utils/debug.h"
+#include "utils/profiler.h"
 #include "utils/audiomanager.h"
+#include "settings.h"
 #include <GL/glew.h>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <cstddef>
 #include <limits>
 #include <glm/gtc/matrix_transform.hpp>
 #include <QStandardPaths>
 #include <QFile>
 
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
 void Rendering::setupMapLights(Realtime* realtime, const glm::vec3& cameraPos, std::vector<SceneLightData>& lights) {
     float baseIntensity = 0.4f;
     float overheadIntensity = baseIntensity * static_cast<float>(realtime->m_overheadLightIntensity);
@@ -61,6 +69,7 @@ void Rendering::setupMapLights(Realtime* realtime, const glm::vec3& cameraPos, s
 }
 
 void Rendering::renderMapBlocks(Realtime* realtime) {
+    PROFILE_SCOPE("renderMapBlocks");
     if (realtime->m_activeMap == nullptr) {
         return;
     }
@@ -135,7 +144,7 @@ void Rendering::renderMapBlocks(Realtime* realtime) {
         }
     }
     
-    int renderDistance = 4;
+    int renderDistance = settings.viewDistance;
     auto blocks = realtime->m_activeMap->getBlocksInRenderDistance(cameraPos, renderDistance);
     
     if (blocks.empty()) {
@@ -300,19 +309,23 @@ void Rendering::renderMapBlocks(Realtime* realtime) {
         }
         
         glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+        
+        Profiler::countDrawCall();
     }
     
     glBindVertexArray(0);
 }
 
 void Rendering::renderTrees(Realtime* realtime) {
+    PROFILE_SCOPE("renderTrees");
 
     if (realtime->m_activeMap == nullptr) {
         return;
     }
 
     glm::vec3 cameraPos = realtime->m_camera.getPosition();
-    int renderDistance = 2;
+    //trees stay at half the terrain distance, they're the most expensive thing to draw
+    int renderDistance = std::max(1, settings.viewDistance / 2);
 
     if (realtime->m_blockShaderProgram == 0) {
         return;
@@ -320,26 +333,30 @@ void Rendering::renderTrees(Realtime* realtime) {
 
     glUseProgram(realtime->m_blockShaderProgram);
 
-    glm::mat4 proj = realtime->m_camera.getProjMatrix();
-    glm::mat4 view = realtime->m_camera.getViewMatrix();
-
-    if (realtime->m_blockProjLoc >= 0) {
-        glUniformMatrix4fv(realtime->m_blockProjLoc, 1, GL_FALSE, &proj[0][0]);
-    }
-    if (realtime->m_blockViewLoc >= 0) {
-        glUniformMatrix4fv(realtime->m_blockViewLoc, 1, GL_FALSE, &view[0][0]);
-    }
-    if (realtime->m_blockCameraPosLoc >= 0) {
-        glUniform3fv(realtime->m_blockCameraPosLoc, 1, &cameraPos[0]);
-    }
-
-    std::vector<SceneLightData> lights;
-    setupMapLights(realtime, cameraPos, lights);
-    realtime->addLightsToBlockShader(lights);
-
     if (realtime->m_treeVAO == 0) {
-        TreePiece treePiece;
-        const auto& vertexData = treePiece.getVertexData();
+        //both mesh lods of every archetype back to back in one buffer, drawn by index range, and the impostor
+        //quad at the end
+        const std::vector<TreeArchetype>& archetypes = TreeArchetypes::get();
+        std::vector<float> vertexData;
+        std::vector<GLuint> indices;
+        for (const TreeArchetype& archetype : archetypes) {
+            for (const TreeMesh& mesh : archetype.meshes) {
+                GLuint baseVertex = static_cast<GLuint>(vertexData.size() / 14);
+                realtime->m_treeMeshFirstIndex.push_back(static_cast<GLuint>(indices.size()));
+                realtime->m_treeMeshIndexCount.push_back(static_cast<GLsizei>(mesh.indices.size()));
+                vertexData.insert(vertexData.end(), mesh.vertexData.begin(), mesh.vertexData.end());
+                for (uint32_t index : mesh.indices) {
+                    indices.push_back(baseVertex + index);
+                }
+            }
+        }
+        realtime->m_treeQuadFirst = static_cast<GLint>(vertexData.size() / 14);
+        const float QUAD[6][2] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
+        for (const float* corner : QUAD) {
+            vertexData.insert(vertexData.end(), {corner[0] - 0.5f, corner[1], 0.0f, 0.0f, 0.0f, 1.0f,
+                                                 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, corner[0], corner[1]});
+        }
+        realtime->m_treeBatches.resize(archetypes.size() * TreeArchetype::LOD_COUNT);
 
         glGenVertexArrays(1, &realtime->m_treeVAO);
         glGenBuffers(1, &realtime->m_treeVBO);
@@ -348,6 +365,9 @@ void Rendering::renderTrees(Realtime* realtime) {
         glBindBuffer(GL_ARRAY_BUFFER, realtime->m_treeVBO);
         glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float),
                      vertexData.data(), GL_STATIC_DRAW);
+        glGenBuffers(1, &realtime->m_treeEBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, realtime->m_treeEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
 
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)0);
@@ -368,16 +388,42 @@ void Rendering::renderTrees(Realtime* realtime) {
         glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, 14 * sizeof(float),
                               (void*)(12 * sizeof(float)));
 
+        //per instance placement, pointed at this frame's slice of the stream before each draw
+        realtime->m_treeInstanceStream.initialize(GL_ARRAY_BUFFER, 4096 * sizeof(TreeInstanceData));
+        glEnableVertexAttribArray(5);
+        glVertexAttribDivisor(5, 1);
+        glEnableVertexAttribArray(6);
+        glVertexAttribDivisor(6, 1);
+        glEnableVertexAttribArray(7);
+        glVertexAttribDivisor(7, 1);
+
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
 
-        realtime->m_treeVertexCount = treePiece.getVertexCount();
+        bakeTreeImpostors(realtime);
     }
     
-    if (realtime->m_treeVertexCount <= 0) {
+    if (realtime->m_treeMeshFirstIndex.empty()) {
         return;
     }
 
+    glm::mat4 proj = realtime->m_camera.getProjMatrix();
+    glm::mat4 view = realtime->m_camera.getViewMatrix();
+
+    if (realtime->m_blockProjLoc >= 0) {
+        glUniformMatrix4fv(realtime->m_blockProjLoc, 1, GL_FALSE, &proj[0][0]);
+    }
+    if (realtime->m_blockViewLoc >= 0) {
+        glUniformMatrix4fv(realtime->m_blockViewLoc, 1, GL_FALSE, &view[0][0]);
+    }
+    if (realtime->m_blockCameraPosLoc >= 0) {
+        glUniform3fv(realtime->m_blockCameraPosLoc, 1, &cameraPos[0]);
+    }
+
+    std::vector<SceneLightData> lights;
+    setupMapLights(realtime, cameraPos, lights);
+    realtime->addLightsToBlockShader(lights);
+
     if (realtime->m_woodColorTexture != 0) {
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, realtime->m_woodColorTexture);
@@ -422,7 +468,42 @@ void Rendering::renderTrees(Realtime* realtime) {
     }
     
 
-    glBindVertexArray(realtime->m_treeVAO);
+    SceneMaterial mat;
+    mat.cAmbient = glm::vec4(0.5f, 0.3f, 0.15f, 1.0f) * 0.5f;
+    mat.cDiffuse = glm::vec4(0.6f, 0.4f, 0.2f, 1.0f);
+    mat.cSpecular = glm::vec4(0.2f, 0.2f, 0.2f, 1.0f);
+    mat.shininess = 3.0f;
+
+    GLint ambientLoc = glGetUniformLocation(realtime->m_blockShaderProgram, "material.cAmbient");
+    GLint diffuseLoc = glGetUniformLocation(realtime->m_blockShaderProgram, "material.cDiffuse");
+    GLint specularLoc = glGetUniformLocation(realtime->m_blockShaderProgram, "material.cSpecular");
+    GLint shinyLoc = glGetUniformLocation(realtime->m_blockShaderProgram, "material.shininess");
+
+    if (ambientLoc >= 0) {
+        glUniform4fv(ambientLoc, 1, &mat.cAmbient[0]);
+    }
+    if (diffuseLoc >= 0) {
+        glUniform4fv(diffuseLoc, 1, &mat.cDiffuse[0]);
+    }
+    if (specularLoc >= 0) {
+        glUniform4fv(specularLoc, 1, &mat.cSpecular[0]);
+    }
+    if (shinyLoc >= 0) {
+        glUniform1f(shinyLoc, mat.shininess);
+    }
+
+    //visible trees bucketed by archetype and lod, then one instanced draw per bucket for the whole forest
+    std::vector<std::vector<TreeInstanceData>>& batches = realtime->m_treeBatches;
+    for (std::vector<TreeInstanceData>& batch : batches) {
+        batch.clear();
+    }
+    const std::vector<TreeArchetype>& archetypes = TreeArchetypes::get();
+    bool haveImpostors = realtime->m_treeImpostorAtlas != 0;
+
+    //screen pixels per world unit at distance 1, projected heights come out of this over the distance
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    float pixelsPerUnit = proj[1][1] * 0.5f * static_cast<float>(viewport[3]);
 
     int chunkSize = realtime->m_activeMap->getChunkSize();
     bool endlessMode = realtime->m_activeMap->isEndlessMode();
@@ -466,52 +547,278 @@ void Rendering::renderTrees(Realtime* realtime) {
                 continue;
             }
 
-            const auto& trees = it->second->getTrees();
-            for (const auto& tree : trees) {
-                for (const auto& piece : tree.getPieces()) {
-                    // piece.position is the center of the tree cylinder
-                    glm::mat4 model = glm::translate(glm::mat4(1.0f), piece.position);
-                    model = glm::scale(model, piece.scale);
-
-                    if (realtime->m_blockModelLoc >= 0) {
-                        glUniformMatrix4fv(realtime->m_blockModelLoc, 1, GL_FALSE, &model[0][0]);
-                    }
-
-                    SceneMaterial mat;
-                    mat.cAmbient = glm::vec4(0.5f, 0.3f, 0.15f, 1.0f) * 0.5f;
-                    mat.cDiffuse = glm::vec4(0.6f, 0.4f, 0.2f, 1.0f);
-                    mat.cSpecular = glm::vec4(0.2f, 0.2f, 0.2f, 1.0f);
-                    mat.shininess = 3.0f;
-
-                    GLint ambientLoc = glGetUniformLocation(realtime->m_blockShaderProgram, "material.cAmbient");
-                    GLint diffuseLoc = glGetUniformLocation(realtime->m_blockShaderProgram, "material.cDiffuse");
-                    GLint specularLoc = glGetUniformLocation(realtime->m_blockShaderProgram, "material.cSpecular");
-                    GLint shinyLoc = glGetUniformLocation(realtime->m_blockShaderProgram, "material.shininess");
-
-                    if (ambientLoc >= 0) {
-                        glUniform4fv(ambientLoc, 1, &mat.cAmbient[0]);
-                    }
-                    if (diffuseLoc >= 0) {
-                        glUniform4fv(diffuseLoc, 1, &mat.cDiffuse[0]);
-                    }
-                    if (specularLoc >= 0) {
-                        glUniform4fv(specularLoc, 1, &mat.cSpecular[0]);
-                    }
-                    if (shinyLoc >= 0) {
-                        glUniform1f(shinyLoc, mat.shininess);
-                    }
-
-                    glDrawArrays(GL_TRIANGLES, 0, realtime->m_treeVertexCount);
+            for (const TreeInstance& tree : it->second->getTrees()) {
+                float height = archetypes[tree.archetype].height * tree.scale;
+                glm::vec3 center = tree.position + glm::vec3(0.0f, height * 0.5f, 0.0f);
+                float distance = std::max(glm::length(center - cameraPos), 0.001f);
+                int lods[2];
+                float fades[2];
+                int lodCount = TreeArchetypes::selectLods(height * pixelsPerUnit / distance, lods, fades);
+
+                TreeInstanceData instance;
+                instance.placement = glm::vec4(tree.position, tree.scale);
+                instance.yaw = glm::vec2(std::cos(tree.yaw), std::sin(tree.yaw));
+                for (int i = 0; i < lodCount; i++) {
+                    //no atlas (the bake failed), the reduced mesh goes all the way out
+                    int lod = lods[i] == TreeArchetype::LOD_IMPOSTOR && !haveImpostors ? TreeArchetype::LOD_REDUCED : lods[i];
+                    instance.fade = fades[i];
+                    batches[tree.archetype * TreeArchetype::LOD_COUNT + lod].push_back(instance);
                 }
             }
         }
     }
 
+    size_t total = 0;
+    for (const std::vector<TreeInstanceData>& batch : batches) {
+        total += batch.size();
+    }
+    if (total == 0) {
+        return;
+    }
+
+    StreamBuffer& stream = realtime->m_treeInstanceStream;
+    stream.beginFrame();
+    StreamBuffer::Allocation instances = stream.allocate(static_cast<GLsizeiptr>(total * sizeof(TreeInstanceData)));
+    if (instances.data != nullptr) {
+        TreeInstanceData* out = static_cast<TreeInstanceData*>(instances.data);
+        for (const std::vector<TreeInstanceData>& batch : batches) {
+            std::copy(batch.begin(), batch.end(), out);
+            out += batch.size();
+        }
+    }
+    if (instances.data == nullptr || !stream.finish(instances)) {
+        stream.endFrame();
+        return;
+    }
+
+    glBindVertexArray(realtime->m_treeVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.getBuffer());
+    if (realtime->m_blockInstancedLoc >= 0) {
+        glUniform1i(realtime->m_blockInstancedLoc, 1);
+    }
+
+    //no base instance in 3.3, the attributes get moved along the buffer instead
+    GLintptr offset = instances.offset;
+    //indexCount 0 draws vertexCount vertices from first unindexed, otherwise first is where the indices start
+    auto drawBatch = [&](const std::vector<TreeInstanceData>& batch, GLuint first, GLsizei indexCount, GLsizei vertexCount) {
+        GLsizei count = static_cast<GLsizei>(batch.size());
+        if (count == 0) {
+            return;
+        }
+        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(TreeInstanceData),
+                              (void*)(offset + offsetof(TreeInstanceData, placement)));
+        glVertexAttribPointer(6, 2, GL_FLOAT, GL_FALSE, sizeof(TreeInstanceData),
+                              (void*)(offset + offsetof(TreeInstanceData, yaw)));
+        glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, sizeof(TreeInstanceData),
+                              (void*)(offset + offsetof(TreeInstanceData, fade)));
+        if (indexCount > 0) {
+            glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT,
+                                    (void*)(static_cast<size_t>(first) * sizeof(GLuint)), count);
+        } else {
+            glDrawArraysInstanced(GL_TRIANGLES, static_cast<GLint>(first), vertexCount, count);
+        }
+        Profiler::countDrawCall();
+        offset += static_cast<GLintptr>(count) * static_cast<GLintptr>(sizeof(TreeInstanceData));
+    };
+
+    for (size_t archetype = 0; archetype < archetypes.size(); archetype++) {
+        for (int lod = 0; lod < TreeArchetype::MESH_LOD_COUNT; lod++) {
+            size_t mesh = archetype * TreeArchetype::MESH_LOD_COUNT + lod;
+            drawBatch(batches[archetype * TreeArchetype::LOD_COUNT + lod],
+                      realtime->m_treeMeshFirstIndex[mesh], realtime->m_treeMeshIndexCount[mesh], 0);
+        }
+    }
+
+    if (haveImpostors) {
+        //flat cards out of the atlas, cut out by its alpha. normal and bump maps are off, the atlas already has
+        //the bark baked in
+        GLuint program = realtime->m_blockShaderProgram;
+        const char* MAP_FLAGS[] = {"useColorTexture", "useNormalMap", "useBumpMap"};
+        GLint mapFlagLocs[3];
+        GLint mapFlags[3] = {0, 0, 0};
+        for (int i = 0; i < 3; i++) {
+            mapFlagLocs[i] = glGetUniformLocation(program, MAP_FLAGS[i]);
+            if (mapFlagLocs[i] >= 0) {
+                glGetUniformiv(program, mapFlagLocs[i], &mapFlags[i]);
+            }
+        }
+        glUniform1i(glGetUniformLocation(program, "billboard"), 1);
+        glUniform1i(glGetUniformLocation(program, "alphaTest"), 1);
+        glUniform1i(glGetUniformLocation(program, "billboardViews"), TreeArchetypes::IMPOSTOR_VIEWS);
+        glUniform1i(mapFlagLocs[0], 1);
+        glUniform1i(mapFlagLocs[1], 0);
+        glUniform1i(mapFlagLocs[2], 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, realtime->m_treeImpostorAtlas);
+
+        GLint sizeLoc = glGetUniformLocation(program, "billboardSize");
+        GLint rectLoc = glGetUniformLocation(program, "billboardRect");
+        float rowHeight = 1.0f / static_cast<float>(archetypes.size());
+        for (size_t archetype = 0; archetype < archetypes.size(); archetype++) {
+            glUniform1f(sizeLoc, archetypes[archetype].impostorSize);
+            glUniform4f(rectLoc, 0.0f, static_cast<float>(archetype) * rowHeight,
+                        1.0f / static_cast<float>(TreeArchetypes::IMPOSTOR_VIEWS), rowHeight);
+            drawBatch(batches[archetype * TreeArchetype::LOD_COUNT + TreeArchetype::LOD_IMPOSTOR],
+                      static_cast<GLuint>(realtime->m_treeQuadFirst), 0, 6);
+        }
+
+        glUniform1i(glGetUniformLocation(program, "billboard"), 0);
+        glUniform1i(glGetUniformLocation(program, "alphaTest"), 0);
+        for (int i = 0; i < 3; i++) {
+            glUniform1i(mapFlagLocs[i], mapFlags[i]);
+        }
+        glBindTexture(GL_TEXTURE_2D, realtime->m_woodColorTexture);
+    }
+
+    if (realtime->m_blockInstancedLoc >= 0) {
+        glUniform1i(realtime->m_blockInstancedLoc, 0);
+    }
+    stream.endFrame();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     
     glUseProgram(realtime->m_shaderProgram);
 }
 
+void Rendering::bakeTreeImpostors(Realtime* realtime) {
+    const std::vector<TreeArchetype>& archetypes = TreeArchetypes::get();
+    GLuint program = realtime->m_blockShaderProgram;
+    if (archetypes.empty() || program == 0) {
+        return;
+    }
+    int cell = TreeArchetypes::IMPOSTOR_CELL_PIXELS;
+    int width = cell * TreeArchetypes::IMPOSTOR_VIEWS;
+    int height = cell * static_cast<int>(archetypes.size());
+
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4];
+    GLfloat previousClearColor[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColor);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+
+    glGenTextures(1, &realtime->m_treeImpostorAtlas);
+    glBindTexture(GL_TEXTURE_2D, realtime->m_treeImpostorAtlas);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    GLuint framebuffer = 0;
+    GLuint depth = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, realtime->m_treeImpostorAtlas, 0);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (complete) {
+        glViewport(0, 0, width, height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+
+        //lit head on with no ambient, so the atlas keeps the bark's shading and the scene lights the card on top
+        SceneLightData light{};
+        light.type = LightType::LIGHT_DIRECTIONAL;
+        light.color = glm::vec4(1.0f);
+        light.function = glm::vec3(1.0f, 0.0f, 0.0f);
+        std::vector<SceneLightData> lights(1, light);
+
+        SceneMaterial mat;
+        mat.cAmbient = glm::vec4(0.0f);
+        mat.cDiffuse = glm::vec4(0.6f, 0.4f, 0.2f, 1.0f);
+        mat.cSpecular = glm::vec4(0.0f);
+        mat.shininess = 1.0f;
+        glUniform4fv(glGetUniformLocation(program, "material.cAmbient"), 1, &mat.cAmbient[0]);
+        glUniform4fv(glGetUniformLocation(program, "material.cDiffuse"), 1, &mat.cDiffuse[0]);
+        glUniform4fv(glGetUniformLocation(program, "material.cSpecular"), 1, &mat.cSpecular[0]);
+        glUniform1f(glGetUniformLocation(program, "material.shininess"), mat.shininess);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, realtime->m_woodColorTexture);
+        glUniform1i(glGetUniformLocation(program, "colorTexture"), 0);
+        glUniform1i(glGetUniformLocation(program, "useColorTexture"), realtime->m_woodColorTexture != 0);
+        glUniform1i(glGetUniformLocation(program, "useNormalMap"), 0);
+        glUniform1i(glGetUniformLocation(program, "useBumpMap"), 0);
+        glUniform1i(glGetUniformLocation(program, "billboard"), 0);
+        glUniform1i(glGetUniformLocation(program, "alphaTest"), 0);
+        if (realtime->m_blockInstancedLoc >= 0) {
+            glUniform1i(realtime->m_blockInstancedLoc, 0);
+        }
+        glm::mat4 model(1.0f);
+        glUniformMatrix4fv(glGetUniformLocation(program, "modelMatrix"), 1, GL_FALSE, &model[0][0]);
+
+        //the per instance arrays have no buffer behind them until the first frame streams one in, and an enabled
+        //array without a buffer makes the draw fail. the bake doesn't read them, so they're off until it's done
+        glBindVertexArray(realtime->m_treeVAO);
+        glDisableVertexAttribArray(5);
+        glDisableVertexAttribArray(6);
+        glDisableVertexAttribArray(7);
+        for (size_t archetype = 0; archetype < archetypes.size(); archetype++) {
+            //ortho box just around the tree, the card is impostorSize wide and tall standing on the base
+            float size = archetypes[archetype].impostorSize;
+            glm::mat4 proj = glm::ortho(-0.5f * size, 0.5f * size, 0.0f, size, 0.01f, 2.0f * size);
+            glUniformMatrix4fv(realtime->m_blockProjLoc, 1, GL_FALSE, &proj[0][0]);
+            size_t mesh = archetype * TreeArchetype::MESH_LOD_COUNT + TreeArchetype::LOD_FULL;
+
+            for (int v = 0; v < TreeArchetypes::IMPOSTOR_VIEWS; v++) {
+                float angle = 2.0f * static_cast<float>(M_PI) * static_cast<float>(v) / static_cast<float>(TreeArchetypes::IMPOSTOR_VIEWS);
+                glm::vec3 direction(std::sin(angle), 0.0f, std::cos(angle));
+                glm::vec3 eye = direction * size;
+                glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+                glUniformMatrix4fv(realtime->m_blockViewLoc, 1, GL_FALSE, &view[0][0]);
+                glUniform3fv(realtime->m_blockCameraPosLoc, 1, &eye[0]);
+
+                lights[0].dir = glm::vec4(-direction, 0.0f);
+                realtime->addLightsToBlockShader(lights);
+                glUniform1f(glGetUniformLocation(program, "k_a"), 0.0f);
+                glUniform1f(glGetUniformLocation(program, "k_d"), 1.0f);
+                glUniform1f(glGetUniformLocation(program, "k_s"), 0.0f);
+
+                glViewport(v * cell, static_cast<int>(archetype) * cell, cell, cell);
+                glDrawElements(GL_TRIANGLES, realtime->m_treeMeshIndexCount[mesh], GL_UNSIGNED_INT,
+                               (void*)(static_cast<size_t>(realtime->m_treeMeshFirstIndex[mesh]) * sizeof(GLuint)));
+                Profiler::countDrawCall();
+            }
+        }
+        glEnableVertexAttribArray(5);
+        glEnableVertexAttribArray(6);
+        glEnableVertexAttribArray(7);
+        glBindVertexArray(0);
+    } else {
+        std::cerr << "Tree impostor framebuffer incomplete, far trees stay meshes" << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glDeleteRenderbuffers(1, &depth);
+    glDeleteFramebuffers(1, &framebuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    glClearColor(previousClearColor[0], previousClearColor[1], previousClearColor[2], previousClearColor[3]);
+    if (!depthTest) {
+        glDisable(GL_DEPTH_TEST);
+    }
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, realtime->m_treeImpostorAtlas);
+    if (complete) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    } else {
+        glDeleteTextures(1, &realtime->m_treeImpostorAtlas);
+        realtime->m_treeImpostorAtlas = 0;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 void Rendering::renderCompletionCubes(Realtime* realtime, float currentTime) {
     if (!realtime) return;
     
@@ -584,7 +891,7 @@ void Rendering::renderCompletionCubes(Realtime* realtime, float currentTime) {
     GLint mat_cSpecularLoc = glGetUniformLocation(realtime->m_shaderProgram, "material.cSpecular");
     GLint mat_shinyLoc = glGetUniformLocation(realtime->m_shaderProgram, "material.shininess");
     
-    int renderDistance = 4;
+    int renderDistance = settings.viewDistance;
 
     int chunkSize = realtime->m_activeMap->getChunkSize();
     bool endlessMode = realtime->m_activeMap->isEndlessMode();
@@ -603,7 +910,6 @@ void Rendering::renderCompletionCubes(Realtime* realtime, float currentTime) {
     int cameraChunkX = static_cast<int>(std::floor(cameraChunkXFloat));
     int cameraChunkZ = static_cast<int>(std::floor(cameraChunkZFloat));
 
-    const float PICKUP_RANGE = 1.8f;
     const float COMPLETION_CUBE_SIZE = 1.0f;
 
     static bool debugChecked = false;
@@ -645,85 +951,17 @@ void Rendering::renderCompletionCubes(Realtime* realtime, float currentTime) {
                 continue;
             }
 
-            auto& completionCubes = it->second->getCompletionCubesMutable();
+            //pickup happens on the sim side, cubes it already took are skipped until the map drops them
+            unsigned int collectedMask = realtime->renderState().collectedCubeMask;
             
-            for (auto cubeIt = completionCubes.begin(); cubeIt != completionCubes.end();) {
-                if (cubeIt->isCollected()) {
-                    cubeIt = completionCubes.erase(cubeIt);
+            for (const auto& cube : it->second->getCompletionCubes()) {
+                if (cube.isCollected() || (collectedMask & (1u << cube.getBiome())) != 0) {
                     continue;
                 }
 
-                glm::vec3 cubePos = cubeIt->getPosition();
-                glm::vec3 cubeColor = cubeIt->getColor();
+                glm::vec3 cubePos = cube.getPosition();
+                glm::vec3 cubeColor = cube.getColor();
                 cubesFoundThisFrame++;
-                
-                //check pickup distance for collection
-                float distToCube = glm::length(cameraPos - cubePos);
-                if (distToCube < PICKUP_RANGE) {
-                    BiomeType biome = cubeIt->getBiome();
-                    realtime->m_activeMap->markCompletionCubeCollected(biome);
-                    
-                    switch (biome) {
-                        case BIOME_FIELD:
-                            if (realtime->m_fieldPenaltyTimer <= 0.0f) {
-                                realtime->m_fieldPenaltyTimer = Realtime::PENALTY_INCREASE_DURATION;
-                            }
-                            break;
-                        case BIOME_MOUNTAINS:
-                            if (realtime->m_mountainPenaltyTimer <= 0.0f) {
-                                realtime->m_mountainPenaltyTimer = Realtime::PENALTY_INCREASE_DURATION;
-                            }
-                            break;
-                        case BIOME_FOREST:
-                            if (realtime->m_forestPenaltyTimer <= 0.0f) {
-                                realtime->m_forestPenaltyTimer = Realtime::PENALTY_INCREASE_DURATION;
-                            }
-                            break;
-                    }
-                    
-                    if (realtime->m_audioManager != nullptr) {
-                        QString tempDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
-                        QString cubeGrabPath = tempDir + "/cube_grab.wav";
-                        
-                        QString resourcePath = ":/resources/soundeffects/cube_grab.wav";
-                        if (QFile::exists(resourcePath) && !QFile::exists(cubeGrabPath)) {
-                            QFile::copy(resourcePath, cubeGrabPath);
-                        }
-                        
-                        if (QFile::exists(cubeGrabPath)) {
-                            realtime->m_audioManager->playSound(cubeGrabPath.toUtf8().constData());
-                        }
-                    }
-                    
-                    cubeIt->collect();
-                    cubeIt = completionCubes.erase(cubeIt);
-                    
-                    auto& allChunks = realtime->m_activeMap->getChunks();
-                    for (auto& chunkPair : allChunks) {
-                        if (chunkPair.second != nullptr && chunkPair.second->isPopulated()) {
-                            auto& allCubes = chunkPair.second->getCompletionCubesMutable();
-                            for (auto it = allCubes.begin(); it != allCubes.end();) {
-                                if (it->getBiome() == biome) {
-                                    it = allCubes.erase(it);
-                                } else {
-                                    ++it;
-                                }
-                            }
-                        }
-                    }
-                    
-                    int cubesCollected = 0;
-                    if (realtime->hasFieldCompletionCube()) cubesCollected++;
-                    if (realtime->hasMountainCompletionCube()) cubesCollected++;
-                    if (realtime->hasForestCompletionCube()) cubesCollected++;
-                    
-                    int enemiesToSpawn = 2 * cubesCollected;
-                    if (enemiesToSpawn > 0) {
-                        realtime->m_enemyManager.spawnEnemiesOnRing(cameraPos, enemiesToSpawn);
-                    }
-                    
-                    continue;
-                }
 
                 glm::mat4 model = glm::translate(glm::mat4(1.0f), cubePos);
                 model = glm::scale(model, glm::vec3(COMPLETION_CUBE_SIZE));
@@ -763,9 +1001,9 @@ void Rendering::renderCompletionCubes(Realtime* realtime, float currentTime) {
                 }
                 
                 glDrawArrays(GL_TRIANGLES, 0, cubeData.numVertices);
-                cubesRenderedThisFrame++;
                 
-                ++cubeIt;
+                Profiler::countDrawCall();
+                cubesRenderedThisFrame++;
             }
         }
     }
@@ -784,11 +1022,11 @@ void Rendering::renderEnemies(Realtime* realtime, float currentTime) {
     GLint mat_cSpecularLoc = glGetUniformLocation(realtime->m_shaderProgram, "material.cSpecular");
     GLint mat_shinyLoc = glGetUniformLocation(realtime->m_shaderProgram, "material.shininess");
     
-    for (int i = 0; i < realtime->m_enemyManager.getEnemyCount(); ++i) {
-        const Enemy* enemy = realtime->m_enemyManager.getEnemy(i);
-        if (!enemy || (enemy->shouldBeRemoved())) continue;
+    for (const Enemy& enemyState : realtime->renderState().enemies) {
+        const Enemy* enemy = &enemyState;
+        if (enemy->shouldBeRemoved()) continue;
         
-        glm::vec3 pos = enemy->getPosition();
+        glm::vec3 pos = enemy->getRenderPosition(realtime->m_simAlpha);
         if (enemy->isDying()) {
             pos = enemy->getDeathStartPosition();
         }
@@ -869,7 +1107,7 @@ void Rendering::renderEnemies(Realtime* realtime, float currentTime) {
         
         glBindVertexArray(cubeData.vao);
         glDrawArrays(GL_TRIANGLES, 0, cubeData.numVertices);
-        
+        Profiler::countDrawCall();
         glm::vec3 renderPos2 = pos;
         if (isDying) {
             renderPos2 = pos + splitOffset2;
@@ -908,7 +1146,7 @@ void Rendering::renderEnemies(Realtime* realtime, float currentTime) {
         
         glBindVertexArray(cubeData.vao);
         glDrawArrays(GL_TRIANGLES, 0, cubeData.numVertices);
-        
+        Profiler::countDrawCall();
         glDepthMask(GL_TRUE);
         glDepthFunc(GL_LESS);
     }
@@ -6,10 +6,19 @@
 class Realtime;
 struct SceneLightData;
 
+//per tree attributes for the instanced tree draws, locations 5 to 7 in default.vert
+struct TreeInstanceData {
+    glm::vec4 placement;    //base of the trunk, w = scale
+    glm::vec2 yaw;          //cos, sin
+    float fade;             //lod dither, 1 when the tree is only drawn at one lod
+};
+
 class Rendering {
 public:
     static void renderMapBlocks(Realtime* realtime);
     static void renderTrees(Realtime* realtime);
+    //renders every archetype's full mesh from TreeArchetypes::IMPOSTOR_VIEWS sides into m_treeImpostorAtlas
+    static void bakeTreeImpostors(Realtime* realtime);
     static void renderCompletionCubes(Realtime* realtime, float currentTime);
     static void renderEnemies(Realtime* realtime, float currentTime = 0.0f);
     static void setupMapLights(Realtime* realtime, const glm::vec3& cameraPos, std::vector<SceneLightData>& lights);
@@ -0,0 +1,56 @@
+#include "simulationthread.h"
+#include "../realtime.h"
+#include "map/Map.h"
+#include <shared_mutex>
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+void SimulationThread::start(Realtime* realtime) {
+    if (isRunning() || realtime == nullptr) {
+        return;
+    }
+    m_realtime = realtime;
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    m_running.store(false, std::memory_order_release);
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void SimulationThread::run() {
+    using Clock = std::chrono::steady_clock;
+    const Clock::duration step = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(Realtime::SIM_TIMESTEP));
+
+    Clock::time_point nextTick = Clock::now();
+    while (m_running.load(std::memory_order_acquire)) {
+        //way behind (debugger, machine asleep), drop the backlog instead of fast forwarding through it
+        Clock::time_point now = Clock::now();
+        if (now - nextTick > step * Realtime::MAX_SIM_STEPS_PER_FRAME) {
+            nextTick = now;
+        }
+
+        int steps = 0;
+        while (nextTick <= now && steps < Realtime::MAX_SIM_STEPS_PER_FRAME) {
+            std::lock_guard<std::mutex> tickLock(m_tickMutex);
+            //active map only changes under Pause, so reading it here is safe
+            std::shared_lock<std::shared_mutex> mapLock;
+            if (m_realtime->m_activeMap != nullptr) {
+                mapLock = std::shared_lock<std::shared_mutex>(m_realtime->m_activeMap->getChunkMutex());
+            }
+            m_realtime->stepSimulation(static_cast<float>(Realtime::SIM_TIMESTEP));
+            m_realtime->publishSnapshot();
+            m_realtime->m_simTickCount.fetch_add(1, std::memory_order_relaxed);
+
+            nextTick += step;
+            steps++;
+        }
+        std::this_thread::sleep_until(nextTick);
+    }
+}
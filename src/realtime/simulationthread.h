@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "enemies/enemy.h"
+#include "particlesystem/particlesystem.h"
+
+class Realtime;
+
+//input the gui thread hands to the sim, key is a Qt::Key
+struct SimInputEvent {
+    enum Type {
+        KeyDown,
+        KeyUp,
+        Rotate,
+        ToggleFlashlight
+    };
+    Type type = KeyDown;
+    int key = 0;
+    glm::vec2 rotation = glm::vec2(0.0f);
+};
+
+//everything the renderer and the ui need from one sim tick, copied out so they never touch live sim state
+struct SimSnapshot {
+    unsigned long long tick = 0;
+    std::chrono::steady_clock::time_point publishedAt;
+
+    //camera at the start and end of the tick, the renderer blends between them
+    glm::vec3 prevCameraPos = glm::vec3(0.0f);
+    glm::vec3 cameraPos = glm::vec3(0.0f);
+    glm::vec3 cameraLook = glm::vec3(0.0f, 0.0f, -1.0f);
+    float fov = 70.0f;
+
+    std::vector<Enemy> enemies;
+    ParticleSystem::DrawState particles;
+
+    glm::vec3 fogColor = glm::vec3(0.05f, 0.05f, 0.15f);
+    float fogIntensity = 0.4f;
+
+    float playerHealth = 100.0f;
+    float grainOpacity = 1.0f;
+    bool grainOverlayEnabled = false;
+
+    bool flashlightEnabled = false;
+    float flashlightCharge = 100.0f;
+    float flashlightPenaltyTimer = 0.0f;
+    float flashlightFlickerIntensity = 1.0f;
+
+    float filterTime = 0.0f;
+    float fieldPenaltyValue = 0.0f;
+    float mountainPenaltyValue = 0.0f;
+    float forestPenaltyValue = 0.0f;
+    bool hasFieldCube = false;
+    bool hasMountainCube = false;
+    bool hasForestCube = false;
+    //bit per BiomeType the sim has picked up, the gui thread removes those cubes from the map
+    unsigned int collectedCubeMask = 0;
+
+    bool pathPlaying = false;
+};
+
+//runs Realtime::stepSimulation at SIM_TIMESTEP on its own thread so a slow frame (or a busy ui) doesnt stall it.
+//every tick holds the tick mutex + a shared lock on the active map's chunks, then publishes a snapshot
+class SimulationThread {
+public:
+    ~SimulationThread();
+
+    void start(Realtime* realtime);
+    void stop();
+    bool isRunning() const { return m_running.load(std::memory_order_acquire); }
+
+    //keeps the sim between ticks while it's alive, for gui code that changes sim state directly
+    class Pause {
+    public:
+        explicit Pause(const SimulationThread& thread) : m_lock(thread.m_tickMutex) {}
+
+    private:
+        std::lock_guard<std::mutex> m_lock;
+    };
+
+private:
+    void run();
+
+    Realtime* m_realtime = nullptr;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    mutable std::mutex m_tickMutex;
+};
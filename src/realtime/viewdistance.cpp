@@ -0,0 +1,70 @@
+#include "realtime/viewdistance.h"
+#include <algorithm>
+
+ViewDistanceController::ViewDistanceController()
+    : m_enabled(false)
+    , m_frameMsAvg(0.0f)
+    , m_generationMsAvg(0.0f)
+    , m_overBudgetTime(0.0f)
+    , m_underBudgetTime(0.0f)
+    , m_cooldown(0.0f)
+{
+}
+
+void ViewDistanceController::setEnabled(bool enabled) {
+    m_enabled = enabled;
+    reset();
+}
+
+void ViewDistanceController::reset() {
+    m_frameMsAvg = 0.0f;
+    m_generationMsAvg = 0.0f;
+    m_overBudgetTime = 0.0f;
+    m_underBudgetTime = 0.0f;
+    m_cooldown = CHANGE_COOLDOWN_SECONDS;
+}
+
+int ViewDistanceController::update(float dt, float frameCostMs, float generationMs, int currentDistance) {
+    if (!m_enabled || dt <= 0.0f || frameCostMs <= 0.0f) {
+        return currentDistance;
+    }
+    
+    //skip hitches (window drags, breakpoints) instead of letting one frame drag the average
+    if (dt > 0.25f || frameCostMs > 250.0f) {
+        return currentDistance;
+    }
+    
+    if (m_frameMsAvg <= 0.0f) {
+        m_frameMsAvg = frameCostMs;
+    }
+    m_frameMsAvg += (frameCostMs - m_frameMsAvg) * 0.1f;
+    m_generationMsAvg += (generationMs - m_generationMsAvg) * 0.1f;
+    
+    if (m_cooldown > 0.0f) {
+        m_cooldown -= dt;
+        return currentDistance;
+    }
+    
+    //generation gets its own budget since a new ring of chunks costs a lot more than drawing them.
+    //raising only with real headroom left, another ring adds a good chunk of draw cost
+    bool overBudget = m_frameMsAvg > TARGET_FRAME_MS * 0.9f || m_generationMsAvg > 4.0f;
+    bool underBudget = m_frameMsAvg < TARGET_FRAME_MS * 0.5f && m_generationMsAvg < 1.0f;
+    
+    m_overBudgetTime = overBudget ? m_overBudgetTime + dt : 0.0f;
+    m_underBudgetTime = underBudget ? m_underBudgetTime + dt : 0.0f;
+    
+    int newDistance = currentDistance;
+    if (m_overBudgetTime >= LOWER_HOLD_SECONDS) {
+        newDistance = currentDistance - 1;
+    } else if (m_underBudgetTime >= RAISE_HOLD_SECONDS) {
+        newDistance = currentDistance + 1;
+    }
+    newDistance = std::clamp(newDistance, MIN_VIEW_DISTANCE, MAX_VIEW_DISTANCE);
+    
+    if (newDistance != currentDistance) {
+        m_overBudgetTime = 0.0f;
+        m_underBudgetTime = 0.0f;
+        m_cooldown = CHANGE_COOLDOWN_SECONDS;
+    }
+    return newDistance;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+//auto mode for settings.viewDistance: steps the chunk radius up or down from measured
+//frame and chunk generation times, with separate thresholds + hold times so it doesnt flap
+class ViewDistanceController {
+public:
+    static constexpr int MIN_VIEW_DISTANCE = 2;
+    static constexpr int MAX_VIEW_DISTANCE = 10;
+    
+    ViewDistanceController();
+    
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+    void reset();
+    
+    //dt is the time since the last call, frameCostMs what the last frame actually cost to render (not the
+    //interval, that sits at the vsync/timer rate whatever the load), generationMs the chunk generation done in it.
+    //returns the view distance to use from now on
+    int update(float dt, float frameCostMs, float generationMs, int currentDistance);
+    
+    float getFrameTimeAverage() const { return m_frameMsAvg; }
+    float getGenerationTimeAverage() const { return m_generationMsAvg; }
+    
+private:
+    static constexpr float TARGET_FRAME_MS = 1000.0f / 60.0f;
+    static constexpr float LOWER_HOLD_SECONDS = 0.5f;
+    static constexpr float RAISE_HOLD_SECONDS = 3.0f;
+    static constexpr float CHANGE_COOLDOWN_SECONDS = 2.0f;
+    
+    bool m_enabled;
+    float m_frameMsAvg;
+    float m_generationMsAvg;
+    float m_overBudgetTime;
+    float m_underBudgetTime;
+    float m_cooldown;
+};
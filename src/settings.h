@@ -9,6 +9,8 @@ struct Settings {
     int shapeParameter2 = 1;
     float nearPlane = 1;
     float farPlane = 50;
+    int viewDistance = 4;          // in chunks, far plane follows it
+    bool autoViewDistance = false;
     bool perPixelFilter = false;
     bool kernelBasedFilter = false;
     bool extraCredit1 = false;
@@ -6,10 +6,12 @@
 #include "ui.h"
 #include "../realtime.h"
 #include "../utils/shaderloader.h"
+#include "../utils/profiler.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 #include <iostream>
+#include <algorithm>
 
 UI::UI()
     : m_realtime(nullptr)
@@ -134,6 +136,9 @@ void UI::render() {
     //bread and butter here lol
     renderChargeBar();
     renderCompletionCubeIndicators();
+    if (Profiler::isOverlayEnabled()) {
+        renderProfilerOverlay();
+    }
     
     glFlush();
     
@@ -198,6 +203,7 @@ void UI::renderChargeBar() {
         glUniform2f(sizeLoc, barWidth, barHeight);
         glUniform4fv(colorLoc, 1, &bgColor[0]);
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        Profiler::countDrawCall();
     }
     
     //lowk just added all of these catches bc the bottom kept moving up
@@ -207,6 +213,7 @@ void UI::renderChargeBar() {
         glUniform2f(sizeLoc, barWidth, chargeHeight);
         glUniform4fv(colorLoc, 1, &chargeColor[0]);
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        Profiler::countDrawCall();
     }
     
 }
@@ -250,20 +257,123 @@ void UI::renderCompletionCubeIndicators() {
         glUniform2f(sizeLoc, squareSize, squareSize);
         glUniform4fv(colorLoc, 1, &color[0]);
         glDrawArrays(GL_TRIANGLES, 0, 6);
-        
+        Profiler::countDrawCall();
         opacity = hasForest ? collectedOpacity : uncollectedOpacity;
         color = glm::vec4(forestColor.x, forestColor.y, forestColor.z, opacity);
         glUniform2f(positionLoc, startX, yPos + spacing);
         glUniform2f(sizeLoc, squareSize, squareSize);
         glUniform4fv(colorLoc, 1, &color[0]);
         glDrawArrays(GL_TRIANGLES, 0, 6);
-
+        Profiler::countDrawCall();
         opacity = hasMountain ? collectedOpacity : uncollectedOpacity;
         color = glm::vec4(mountainColor.x, mountainColor.y, mountainColor.z, opacity);
         glUniform2f(positionLoc, startX, yPos + spacing * 2.0f);
         glUniform2f(sizeLoc, squareSize, squareSize);
         glUniform4fv(colorLoc, 1, &color[0]);
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        Profiler::countDrawCall();
+    }
+}
+
+void UI::renderRect(float x0, float y0, float x1, float y1, const glm::vec4& color) {
+    GLint colorLoc = glGetUniformLocation(m_uiShaderProgram, "color");
+    GLint positionLoc = glGetUniformLocation(m_uiShaderProgram, "position");
+    GLint sizeLoc = glGetUniformLocation(m_uiShaderProgram, "size");
+    if (positionLoc == -1 || sizeLoc == -1 || colorLoc == -1) {
+        return;
     }
+    
+    //the quad spans -1..1 so position is the center and size the half extent
+    glUniform2f(positionLoc, (x0 + x1) * 0.5f, (y0 + y1) * 0.5f);
+    glUniform2f(sizeLoc, (x1 - x0) * 0.5f, (y1 - y0) * 0.5f);
+    glUniform4fv(colorLoc, 1, &color[0]);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    Profiler::countDrawCall();
 }
 
+//stable color per marker name so a pass keeps its color from frame to frame
+static glm::vec4 profilerMarkerColor(const char* name) {
+    unsigned int hash = 2166136261u;
+    for (const char* c = name; *c != '\0'; c++) {
+        hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+    }
+    float r = 0.35f + 0.65f * ((hash & 0xFF) / 255.0f);
+    float g = 0.35f + 0.65f * (((hash >> 8) & 0xFF) / 255.0f);
+    float b = 0.35f + 0.65f * (((hash >> 16) & 0xFF) / 255.0f);
+    return glm::vec4(r, g, b, 0.85f);
+}
+
+void UI::renderProfilerOverlay() {
+    GLint projLoc = glGetUniformLocation(m_uiShaderProgram, "projection");
+    if (projLoc != -1) {
+        glm::mat4 proj = glm::mat4(1.0f);
+        glUniformMatrix4fv(projLoc, 1, GL_FALSE, &proj[0][0]);
+    }
+    
+    //graph + bars are all scaled so the full width/height is two 60hz frames
+    const float scaleMs = 33.3f;
+    const float budgetMs = 1000.0f / 60.0f;
+    const float left = -0.96f;
+    const float width = 0.56f;
+    const int graphFrames = 120;
+    
+    renderRect(-0.98f, 0.44f, left + width + 0.02f, 0.95f, glm::vec4(0.0f, 0.0f, 0.0f, 0.55f));
+    
+    //frame time history, newest on the right
+    float graphBottom = 0.62f;
+    float graphHeight = 0.31f;
+    float barWidth = width / graphFrames;
+    for (int i = 0; i < graphFrames; i++) {
+        const ProfilerFrame* frame = Profiler::getFrame(i);
+        if (frame == nullptr) {
+            break;
+        }
+        float ms = static_cast<float>(frame->durationUs / 1000.0);
+        float h = graphHeight * std::min(ms / scaleMs, 1.0f);
+        glm::vec4 color = ms <= budgetMs ? glm::vec4(0.2f, 0.85f, 0.3f, 0.8f)
+                        : ms <= scaleMs ? glm::vec4(0.95f, 0.8f, 0.2f, 0.8f)
+                        : glm::vec4(0.95f, 0.25f, 0.2f, 0.8f);
+        float x1 = left + width - i * barWidth;
+        renderRect(x1 - barWidth * 0.8f, graphBottom, x1, graphBottom + h, color);
+    }
+    float budgetY = graphBottom + graphHeight * (budgetMs / scaleMs);
+    renderRect(left, budgetY, left + width, budgetY + 0.004f, glm::vec4(1.0f, 1.0f, 1.0f, 0.6f));
+    
+    const ProfilerFrame* frame = Profiler::getFrame(0);
+    if (frame == nullptr) {
+        return;
+    }
+    
+    //gui thread cpu timeline for the newest resolved frame, one row per nesting level
+    float rowHeight = 0.035f;
+    float cpuTop = 0.6f;
+    for (const ProfilerEvent& event : frame->events) {
+        if (event.gpu || event.thread != 0 || event.durationUs < 0.0 || event.depth > 1) {
+            continue;
+        }
+        float start = static_cast<float>((event.startUs - frame->startUs) / 1000.0) / scaleMs;
+        float end = start + static_cast<float>(event.durationUs / 1000.0) / scaleMs;
+        start = std::clamp(start, 0.0f, 1.0f);
+        end = std::clamp(end, 0.0f, 1.0f);
+        if (end - start < 0.002f) {
+            continue;
+        }
+        float y1 = cpuTop - event.depth * (rowHeight + 0.005f);
+        renderRect(left + start * width, y1 - rowHeight, left + end * width, y1, profilerMarkerColor(event.name));
+    }
+    
+    //gpu passes stacked end to end, the gpu clock only gives reliable durations
+    float gpuTop = 0.49f;
+    float cursor = 0.0f;
+    for (const ProfilerEvent& event : frame->events) {
+        if (!event.gpu || event.depth != 0 || event.durationUs < 0.0) {
+            continue;
+        }
+        float length = static_cast<float>(event.durationUs / 1000.0) / scaleMs;
+        float end = std::min(cursor + length, 1.0f);
+        if (end > cursor) {
+            renderRect(left + cursor * width, gpuTop - rowHeight, left + end * width, gpuTop, profilerMarkerColor(event.name));
+        }
+        cursor = end;
+    }
+}
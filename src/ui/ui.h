@@ -21,6 +21,8 @@ private:
     void initializeBuffers();
     void renderChargeBar();
     void renderCompletionCubeIndicators();
+    void renderProfilerOverlay();
+    void renderRect(float x0, float y0, float x1, float y1, const glm::vec4& color);
     
     Realtime* m_realtime;
     
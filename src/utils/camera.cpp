@@ -10,6 +10,8 @@ Camera::Camera() {
     m_up = glm::normalize(glm::vec3(0.0f, 1.0f, 0.0f));
     m_fovY = 70.0f * glm::pi<float>() / 180.0f;
     updateViewMatrix();
+    //glm leaves m_proj uninitialized, something sane until the owner sets the real aspect / planes
+    updateProjectionMatrix(1.0f, 0.1f, 100.0f);
 }
 
 Camera::Camera(const SceneCameraData &data, float aspect, float nearPlane, float farPlane) {
@@ -1,6 +1,11 @@
 #include "camerapath.h"
 #include <cmath>
 #include <algorithm>
+#include <iostream>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 
 CameraPath::CameraPath() 
     : m_isPlaying(false), m_currentTime(0.0f), m_duration(10.0f), m_speed(1.0f) {
@@ -201,3 +206,75 @@ void CameraPath::update(float deltaTime, glm::vec3& outPosition, glm::vec3& outL
     outLookDirection = glm::normalize(outLookDirection);
 }
 
+static glm::vec3 jsonToVec3(const QJsonValue& value, const glm::vec3& fallback) {
+    QJsonArray array = value.toArray();
+    if (array.size() != 3) {
+        return fallback;
+    }
+    return glm::vec3(array[0].toDouble(), array[1].toDouble(), array[2].toDouble());
+}
+
+static QJsonArray vec3ToJson(const glm::vec3& v) {
+    QJsonArray array;
+    array.append(v.x);
+    array.append(v.y);
+    array.append(v.z);
+    return array;
+}
+
+bool CameraPath::loadFromFile(const std::string& filePath) {
+    QFile file(QString::fromStdString(filePath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::cerr << "Failed to open camera path: " << filePath << std::endl;
+        return false;
+    }
+    
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    file.close();
+    if (doc.isNull() || !doc.isObject()) {
+        std::cerr << "Failed to parse camera path " << filePath << ": "
+                  << parseError.errorString().toStdString() << std::endl;
+        return false;
+    }
+    
+    QJsonObject root = doc.object();
+    QJsonArray waypoints = root["waypoints"].toArray();
+    if (waypoints.size() < 2) {
+        std::cerr << "Camera path " << filePath << " needs at least 2 waypoints" << std::endl;
+        return false;
+    }
+    
+    clear();
+    for (const QJsonValue& value : waypoints) {
+        QJsonObject waypoint = value.toObject();
+        glm::vec3 position = jsonToVec3(waypoint["position"], glm::vec3(0.0f));
+        glm::vec3 look = jsonToVec3(waypoint["look"], glm::vec3(0.0f, 0.0f, -1.0f));
+        addWaypoint(position, look);
+    }
+    m_duration = static_cast<float>(root["duration"].toDouble(m_duration));
+    return true;
+}
+
+bool CameraPath::saveToFile(const std::string& filePath) const {
+    QJsonArray waypoints;
+    for (const Waypoint& waypoint : m_waypoints) {
+        QJsonObject object;
+        object["position"] = vec3ToJson(waypoint.position);
+        object["look"] = vec3ToJson(waypoint.lookDirection);
+        waypoints.append(object);
+    }
+    
+    QJsonObject root;
+    root["duration"] = m_duration;
+    root["waypoints"] = waypoints;
+    
+    QFile file(QString::fromStdString(filePath));
+    if (!file.open(QIODevice::WriteOnly)) {
+        std::cerr << "Failed to write camera path: " << filePath << std::endl;
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    file.close();
+    return true;
+}
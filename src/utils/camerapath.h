@@ -2,6 +2,7 @@
 
 #include <glm/glm.hpp>
 #include <vector>
+#include <string>
 #include <QElapsedTimer>
 
 struct Waypoint {
@@ -30,6 +31,10 @@ public:
     float getPlaybackDuration() const { return m_duration; }
     void setPlaybackDuration(float durationSeconds) { m_duration = durationSeconds; }
     
+    //json: {"duration": seconds, "waypoints": [{"position": [x,y,z], "look": [x,y,z]}, ...]}
+    bool loadFromFile(const std::string& filePath);
+    bool saveToFile(const std::string& filePath) const;
+    
 private:
     std::vector<Waypoint> m_waypoints;
     bool m_isPlaying;
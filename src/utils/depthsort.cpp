@@ -0,0 +1,180 @@
+#include "depthsort.h"
+#include <algorithm>
+#include <utility>
+
+const std::vector<uint32_t>& DepthSort::sort(const uint16_t* keys, const uint32_t* runSizes, int runCount) {
+    size_t count = 0;
+    for (int r = 0; r < runCount; r++) {
+        count += runSizes[r];
+    }
+    m_stats = Stats();
+    m_stats.count = count;
+    if (static_cast<int>(m_runSizes.size()) != runCount) {
+        m_order.clear();
+        m_runSizes.assign(runCount, 0);
+    }
+
+    //carry the old order over, each index moves with its run's start. items are swap removed, so an index can
+    //belong to a different particle now, that one just ends up out of order. new indices go on the back
+    size_t previousCount = m_order.size();
+    std::vector<uint32_t>& oldStarts = m_oldRunStarts;
+    std::vector<uint32_t>& newStarts = m_newRunStarts;
+    oldStarts.assign(runCount + 1, 0);
+    newStarts.assign(runCount + 1, 0);
+    for (int r = 0; r < runCount; r++) {
+        oldStarts[r + 1] = oldStarts[r] + m_runSizes[r];
+        newStarts[r + 1] = newStarts[r] + runSizes[r];
+    }
+    m_orderScratch.resize(count);
+    size_t n = 0;
+    for (uint32_t index : m_order) {
+        //last run starting at or before it, empty runs share a start with the next one so they lose
+        int r = 0;
+        for (int run = 1; run < runCount; run++) {
+            r += index >= oldStarts[run] ? 1 : 0;
+        }
+        uint32_t local = index - oldStarts[r];
+        if (local < runSizes[r]) {
+            m_orderScratch[n++] = newStarts[r] + local;
+        }
+    }
+    for (int r = 0; r < runCount; r++) {
+        for (uint32_t local = m_runSizes[r]; local < runSizes[r]; local++) {
+            m_orderScratch[n++] = newStarts[r] + local;
+        }
+        m_runSizes[r] = runSizes[r];
+    }
+    std::swap(m_order, m_orderScratch);
+
+    m_keys.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        m_keys[i] = keys[m_order[i]];
+    }
+
+    if (previousCount > 0 && sortIncremental()) {
+        m_stats.incremental = true;
+        return m_order;
+    }
+    m_stats.outOfOrder = count;
+    radixSort(m_keys, m_order);
+    return m_order;
+}
+
+void DepthSort::reset() {
+    m_order.clear();
+    m_runSizes.clear();
+    m_keys.clear();
+    m_stats = Stats();
+}
+
+bool DepthSort::sortIncremental() {
+    size_t count = m_keys.size();
+    size_t limit = count / INCREMENTAL_DIVISOR;
+    m_outOfOrder.clear();
+    m_outOfOrderKeys.clear();
+
+    //one pass keeps everything that still fits in place (compacted) and pulls the rest out. a key bigger than
+    //either of the next two goes too, or one or two items that jumped forward would push out everything after them
+    size_t kept = 0;
+    uint16_t last = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint16_t key = m_keys[i];
+        bool fits = key >= last && (i + 1 >= count || key <= m_keys[i + 1]) && (i + 2 >= count || key <= m_keys[i + 2]);
+        if (fits) {
+            m_keys[kept] = key;
+            m_order[kept] = m_order[i];
+            kept++;
+            last = key;
+        } else {
+            if (m_outOfOrder.size() >= limit) {
+                //kept + pulled is always i, so the pulled ones go back in the gap and the arrays match again
+                for (size_t j = 0; j < m_outOfOrder.size(); j++) {
+                    m_keys[kept + j] = m_outOfOrderKeys[j];
+                    m_order[kept + j] = m_outOfOrder[j];
+                }
+                return false;
+            }
+            m_outOfOrder.push_back(m_order[i]);
+            m_outOfOrderKeys.push_back(key);
+        }
+    }
+    m_stats.outOfOrder = m_outOfOrder.size();
+    if (m_outOfOrder.empty()) {
+        return true;
+    }
+
+    //merge the two sorted runs
+    radixSort(m_outOfOrderKeys, m_outOfOrder);
+    m_keyScratch.resize(count);
+    m_orderScratch.resize(count);
+    size_t a = 0;
+    size_t b = 0;
+    size_t out = 0;
+    size_t pulled = m_outOfOrder.size();
+    while (a < kept && b < pulled) {
+        if (m_outOfOrderKeys[b] < m_keys[a]) {
+            m_keyScratch[out] = m_outOfOrderKeys[b];
+            m_orderScratch[out++] = m_outOfOrder[b++];
+        } else {
+            m_keyScratch[out] = m_keys[a];
+            m_orderScratch[out++] = m_order[a++];
+        }
+    }
+    for (; a < kept; a++) {
+        m_keyScratch[out] = m_keys[a];
+        m_orderScratch[out++] = m_order[a];
+    }
+    for (; b < pulled; b++) {
+        m_keyScratch[out] = m_outOfOrderKeys[b];
+        m_orderScratch[out++] = m_outOfOrder[b];
+    }
+    std::swap(m_keys, m_keyScratch);
+    std::swap(m_order, m_orderScratch);
+    return true;
+}
+
+void DepthSort::radixSort(std::vector<uint16_t>& keys, std::vector<uint32_t>& order) {
+    //lsd, low byte then high byte. both histograms in one read, a pass every key agrees on is skipped
+    size_t count = keys.size();
+    if (count < 2) {
+        return;
+    }
+    size_t histogram[2][256] = {};
+    for (size_t i = 0; i < count; i++) {
+        histogram[0][keys[i] & 0xff]++;
+        histogram[1][keys[i] >> 8]++;
+    }
+
+    m_keyScratch.resize(count);
+    m_orderScratch.resize(count);
+    uint16_t* sourceKeys = keys.data();
+    uint32_t* sourceOrder = order.data();
+    uint16_t* destinationKeys = m_keyScratch.data();
+    uint32_t* destinationOrder = m_orderScratch.data();
+    for (int pass = 0; pass < 2; pass++) {
+        int shift = pass * 8;
+        size_t* bins = histogram[pass];
+        if (bins[(keys[0] >> shift) & 0xff] == count) {
+            continue;
+        }
+        size_t offset = 0;
+        for (int bin = 0; bin < 256; bin++) {
+            size_t binCount = bins[bin];
+            bins[bin] = offset;
+            offset += binCount;
+        }
+        for (size_t i = 0; i < count; i++) {
+            uint16_t key = sourceKeys[i];
+            size_t destination = bins[(key >> shift) & 0xff]++;
+            destinationKeys[destination] = key;
+            destinationOrder[destination] = sourceOrder[i];
+        }
+        std::swap(sourceKeys, destinationKeys);
+        std::swap(sourceOrder, destinationOrder);
+    }
+    //an odd number of passes leaves the result in the scratch arrays
+    if (sourceKeys != keys.data()) {
+        std::copy(sourceKeys, sourceKeys + count, keys.data());
+        std::copy(sourceOrder, sourceOrder + count, order.data());
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//orders items by a 16 bit key, smallest first, for back to front blending. between frames hardly anything
+//changes places, so each call starts from the last call's order. the items that break it (moved a lot, new,
+//swapped into a dead one's slot) are pulled out, radix sorted on their own and merged back in. when too many
+//break it (first frame, camera spun around) everything gets the two pass radix sort. linear either way.
+//not thread safe, one per caller
+class DepthSort {
+public:
+    struct Stats {
+        size_t count = 0;
+        size_t outOfOrder = 0;      //items pulled out of last frame's order, count when it was a full sort
+        bool incremental = false;   //last frame's order was reused
+    };
+
+    //keys[i] belongs to item i. item indices in ascending key order, valid until the next sort().
+    //items come as runs back to back (one per particle kind, say) that only grow or shrink at their ends,
+    //which is what lets an item be found again next call. a different run count starts over
+    const std::vector<uint32_t>& sort(const uint16_t* keys, const uint32_t* runSizes, int runCount);
+    const std::vector<uint32_t>& sort(const uint16_t* keys, size_t count) {
+        uint32_t runSize = static_cast<uint32_t>(count);
+        return sort(keys, &runSize, 1);
+    }
+    //forget the last order, the next sort() is a full one
+    void reset();
+    const Stats& getStats() const { return m_stats; }
+
+private:
+    //more out of order items than count / this and a full sort is cheaper
+    static constexpr size_t INCREMENTAL_DIVISOR = 4;
+
+    //false (and nothing touched) if too much is out of order
+    bool sortIncremental();
+    //sorts keys ascending, order follows along. stable
+    void radixSort(std::vector<uint16_t>& keys, std::vector<uint32_t>& order);
+
+    std::vector<uint32_t> m_order;
+    std::vector<uint32_t> m_runSizes;   //last call's
+    std::vector<uint32_t> m_oldRunStarts;
+    std::vector<uint32_t> m_newRunStarts;
+    std::vector<uint16_t> m_keys;       //m_keys[i] is the key of m_order[i]
+    std::vector<uint32_t> m_outOfOrder;
+    std::vector<uint16_t> m_outOfOrderKeys;
+    std::vector<uint32_t> m_orderScratch;
+    std::vector<uint16_t> m_keyScratch;
+    Stats m_stats;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cmath>
+
+//sin / cos as plain arithmetic instead of a libm call, so loops using them still vectorize. max error is
+//around 0.001. the particle shaders carry the same function so gpu and cpu runs line up
+namespace FastMath {
+    inline float sin(float x) {
+        const float PI = 3.14159265f;
+        const float TWO_PI = 6.28318531f;
+        //wrap to [-pi, pi]. rounding by hand, std::floor keeps gcc from vectorizing
+        float turns = x * (1.0f / TWO_PI);
+        x -= TWO_PI * static_cast<float>(static_cast<int>(turns + (turns >= 0.0f ? 0.5f : -0.5f)));
+        float y = (4.0f / PI) * x - (4.0f / (PI * PI)) * x * std::fabs(x);
+        return 0.225f * (y * std::fabs(y) - y) + y;
+    }
+
+    inline float cos(float x) {
+        return FastMath::sin(x + 1.57079633f);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+//pcg32 (o'neill), a few instructions per number and no locks, unlike rand(). not thread safe, every thread
+//keeps its own. hash() is the stateless version for loops that want one number per element and no carried state
+class FastRandom {
+public:
+    explicit FastRandom(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0xda3e39cb94b95bdbULL) {
+        setSeed(seed, stream);
+    }
+
+    void setSeed(uint64_t seed, uint64_t stream = 0xda3e39cb94b95bdbULL) {
+        m_state = 0;
+        m_increment = (stream << 1u) | 1u;
+        next();
+        m_state += seed;
+        next();
+    }
+
+    uint32_t next() {
+        uint64_t old = m_state;
+        m_state = old * 6364136223846793005ULL + m_increment;
+        uint32_t xorShifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = static_cast<uint32_t>(old >> 59u);
+        return (xorShifted >> rot) | (xorShifted << ((32u - rot) & 31u));
+    }
+
+    //[0, 1)
+    float nextFloat() { return toFloat(next()); }
+    float range(float min, float max) { return min + (max - min) * nextFloat(); }
+
+    //pcg output permutation over one 32 bit value (jarzynski & olano), no branches so it vectorizes
+    static uint32_t hash(uint32_t value) {
+        uint32_t state = value * 747796405u + 2891336453u;
+        uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+    static float hashFloat(uint32_t value) { return toFloat(hash(value)); }
+
+private:
+    //top 24 bits, every float in [0, 1) a 24 bit mantissa can hit
+    static float toFloat(uint32_t bits) { return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f); }
+
+    uint64_t m_state;
+    uint64_t m_increment;
+};
@@ -0,0 +1,125 @@
+#include "parallelfor.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+thread_local bool t_insideBody = false;
+
+class WorkerPool {
+public:
+    explicit WorkerPool(int workers) {
+        for (int i = 0; i < workers; i++) {
+            m_threads.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    int threadCount() const { return static_cast<int>(m_threads.size()) + 1; }
+
+    void run(size_t count, size_t grain, const ParallelFor::Body& body) {
+        //one loop at a time, a second caller waits its turn
+        std::lock_guard<std::mutex> runLock(m_runMutex);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_body = &body;
+            m_count = count;
+            m_grain = grain;
+            m_next.store(0, std::memory_order_relaxed);
+            m_busy = static_cast<int>(m_threads.size());
+            m_generation++;
+        }
+        m_wake.notify_all();
+        work();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_busy == 0; });
+        m_body = nullptr;
+    }
+
+private:
+    void work() {
+        t_insideBody = true;
+        for (;;) {
+            size_t begin = m_next.fetch_add(m_grain, std::memory_order_relaxed);
+            if (begin >= m_count) {
+                break;
+            }
+            (*m_body)(begin, std::min(begin + m_grain, m_count));
+        }
+        t_insideBody = false;
+    }
+
+    void workerLoop() {
+        unsigned long long seen = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop) {
+                return;
+            }
+            seen = m_generation;
+            lock.unlock();
+            work();
+            lock.lock();
+            if (--m_busy == 0) {
+                m_done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_runMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const ParallelFor::Body* m_body = nullptr;
+    size_t m_count = 0;
+    size_t m_grain = 1;
+    std::atomic<size_t> m_next{0};
+    int m_busy = 0;
+    unsigned long long m_generation = 0;
+    bool m_stop = false;
+};
+
+WorkerPool& pool(ParallelFor::Pool which) {
+    unsigned int hardware = std::min(std::thread::hardware_concurrency(), 16u);
+    //the sim thread calls into the big one, leave a core for it and one for the gui thread
+    static WorkerPool sim(hardware > 2 ? static_cast<int>(hardware) - 2 : 0);
+    //the gl thread's loops are short bursts between draw calls, a couple of helpers is plenty
+    static WorkerPool render(hardware > 4 ? 2 : 0);
+    return which == ParallelFor::RENDER ? render : sim;
+}
+
+}
+
+void ParallelFor::run(size_t count, size_t grain, const Body& body, Pool which) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    WorkerPool& workers = pool(which);
+    if (count <= grain || t_insideBody || workers.threadCount() == 1) {
+        body(0, count);
+        return;
+    }
+    workers.run(count, grain, body);
+}
+
+int ParallelFor::threadCount(Pool which) {
+    return pool(which).threadCount();
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+//fixed pools of worker threads for data-parallel loops. run() cuts [0, count) into grain sized chunks that the
+//workers and the calling thread pull off a shared counter, and returns once all of them are done.
+//bodies must only touch their own range. a run() from inside a body, or with count <= grain, just runs inline.
+//a pool does one loop at a time, so the gl thread gets a small pool of its own and never queues behind a sim tick
+class ParallelFor {
+public:
+    using Body = std::function<void(size_t begin, size_t end)>;
+
+    enum Pool {
+        SIM,
+        RENDER
+    };
+
+    static void run(size_t count, size_t grain, const Body& body, Pool pool = SIM);
+    //workers + the caller
+    static int threadCount(Pool pool = SIM);
+};
@@ -0,0 +1,338 @@
+#include "utils/profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <thread>
+
+std::atomic<bool> Profiler::m_enabled{false};
+bool Profiler::m_overlayEnabled = false;
+bool Profiler::m_gpuReady = false;
+unsigned long long Profiler::m_frameIndex = 0;
+int Profiler::m_cpuDepth = 0;
+int Profiler::m_gpuDepth = 0;
+int Profiler::m_drawCalls = 0;
+int Profiler::m_lastFrameDrawCalls = 0;
+std::vector<ProfilerFrame> Profiler::m_history(Profiler::HISTORY_SIZE);
+Profiler::GpuQueryPool Profiler::m_gpuPools[2] = {};
+std::thread::id Profiler::m_mainThread;
+std::mutex Profiler::m_threadEventsMutex;
+std::vector<ProfilerEvent> Profiler::m_threadEvents;
+std::atomic<int> Profiler::m_threadCount{0};
+
+namespace {
+//markers still open on this (non gui) thread, closed ones get popped off the top
+thread_local std::vector<ProfilerEvent> t_openEvents;
+thread_local int t_threadSlot = 0;
+}
+
+void Profiler::initialize() {
+    if (m_gpuReady) {
+        return;
+    }
+    m_mainThread = std::this_thread::get_id();
+    for (GpuQueryPool& pool : m_gpuPools) {
+        glGenQueries(MAX_GPU_MARKERS * 2, pool.queries);
+        pool.count = 0;
+        pool.frameIndex = 0;
+        pool.pending = false;
+    }
+    m_gpuReady = true;
+}
+
+void Profiler::cleanup() {
+    if (!m_gpuReady) {
+        return;
+    }
+    for (GpuQueryPool& pool : m_gpuPools) {
+        glDeleteQueries(MAX_GPU_MARKERS * 2, pool.queries);
+        pool.count = 0;
+        pool.pending = false;
+    }
+    m_gpuReady = false;
+}
+
+void Profiler::setEnabled(bool enabled) {
+    if (enabled && !m_enabled) {
+        //restart the open frame so it doesnt span all the time the profiler was off
+        ProfilerFrame& frame = currentFrame();
+        frame.events.clear();
+        frame.index = m_frameIndex;
+        frame.startUs = nowUs();
+        m_cpuDepth = 0;
+        m_gpuDepth = 0;
+        std::lock_guard<std::mutex> lock(m_threadEventsMutex);
+        m_threadEvents.clear();
+    }
+    m_enabled = enabled;
+    if (!enabled) {
+        m_overlayEnabled = false;
+    }
+}
+
+void Profiler::setOverlayEnabled(bool enabled) {
+    if (enabled) {
+        setEnabled(true);
+    }
+    m_overlayEnabled = enabled;
+}
+
+double Profiler::nowUs() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+ProfilerFrame& Profiler::currentFrame() {
+    return m_history[m_frameIndex % HISTORY_SIZE];
+}
+
+int Profiler::threadSlot() {
+    if (t_threadSlot == 0) {
+        t_threadSlot = ++m_threadCount;
+    }
+    return t_threadSlot;
+}
+
+int Profiler::beginCpu(const char* name) {
+    if (!m_enabled) {
+        return -1;
+    }
+    if (std::this_thread::get_id() != m_mainThread) {
+        //the index is into this thread's own open stack
+        t_openEvents.push_back({name, nowUs(), -1.0, static_cast<int>(t_openEvents.size()), false, threadSlot()});
+        return static_cast<int>(t_openEvents.size()) - 1;
+    }
+    ProfilerFrame& frame = currentFrame();
+    frame.events.push_back({name, nowUs(), -1.0, m_cpuDepth, false, 0});
+    m_cpuDepth++;
+    return static_cast<int>(frame.events.size()) - 1;
+}
+
+void Profiler::endCpu(int eventIndex) {
+    if (std::this_thread::get_id() != m_mainThread) {
+        if (eventIndex < 0 || eventIndex >= static_cast<int>(t_openEvents.size())) {
+            return;
+        }
+        ProfilerEvent& event = t_openEvents[eventIndex];
+        event.durationUs = nowUs() - event.startUs;
+        {
+            std::lock_guard<std::mutex> lock(m_threadEventsMutex);
+            m_threadEvents.push_back(event);
+        }
+        while (!t_openEvents.empty() && t_openEvents.back().durationUs >= 0.0) {
+            t_openEvents.pop_back();
+        }
+        return;
+    }
+    ProfilerFrame& frame = currentFrame();
+    if (eventIndex < 0 || eventIndex >= static_cast<int>(frame.events.size()) || frame.events[eventIndex].gpu) {
+        return;
+    }
+    ProfilerEvent& event = frame.events[eventIndex];
+    event.durationUs = nowUs() - event.startUs;
+    m_cpuDepth = std::max(0, m_cpuDepth - 1);
+}
+
+int Profiler::beginGpu(const char* name) {
+    if (!m_enabled || !m_gpuReady) {
+        return -1;
+    }
+    GpuQueryPool& pool = m_gpuPools[m_frameIndex & 1];
+    if (pool.count >= MAX_GPU_MARKERS) {
+        return -1;
+    }
+
+    //timestamps instead of GL_TIME_ELAPSED so markers can nest, and so they dont collide with
+    //the elapsed queries dynamic resolution and the motion blur timer already keep open
+    int marker = pool.count++;
+    glQueryCounter(pool.queries[marker * 2], GL_TIMESTAMP);
+
+    ProfilerFrame& frame = currentFrame();
+    frame.events.push_back({name, nowUs(), -1.0, m_gpuDepth, true, 0});
+    pool.eventIndices[marker] = static_cast<int>(frame.events.size()) - 1;
+    m_gpuDepth++;
+    return marker;
+}
+
+void Profiler::endGpu(int marker) {
+    GpuQueryPool& pool = m_gpuPools[m_frameIndex & 1];
+    if (marker < 0 || marker >= pool.count || !m_gpuReady) {
+        return;
+    }
+    glQueryCounter(pool.queries[marker * 2 + 1], GL_TIMESTAMP);
+    m_gpuDepth = std::max(0, m_gpuDepth - 1);
+}
+
+void Profiler::endFrame() {
+    m_lastFrameDrawCalls = m_drawCalls;
+    m_drawCalls = 0;
+    if (!m_enabled) {
+        return;
+    }
+    double now = nowUs();
+
+    ProfilerFrame& frame = currentFrame();
+    frame.index = m_frameIndex;
+    frame.durationUs = now - frame.startUs;
+    {
+        std::lock_guard<std::mutex> lock(m_threadEventsMutex);
+        frame.events.insert(frame.events.end(), m_threadEvents.begin(), m_threadEvents.end());
+        m_threadEvents.clear();
+    }
+    frame.drawCalls = m_lastFrameDrawCalls;
+
+    GpuQueryPool& pool = m_gpuPools[m_frameIndex & 1];
+    pool.frameIndex = m_frameIndex;
+    pool.pending = pool.count > 0;
+
+    m_frameIndex++;
+
+    ProfilerFrame& next = currentFrame();
+    next.events.clear();
+    next.index = m_frameIndex;
+    next.startUs = now;
+    next.durationUs = 0.0;
+
+    //two pools, so this one was filled by the frame before the one that just ended. its queries have had that
+    //whole frame to come back, and resolveGpuPool drops them instead of waiting if they haven't
+    GpuQueryPool& nextPool = m_gpuPools[m_frameIndex & 1];
+    if (nextPool.pending) {
+        resolveGpuPool(nextPool);
+    }
+    nextPool.count = 0;
+    nextPool.pending = false;
+
+    m_cpuDepth = 0;
+    m_gpuDepth = 0;
+}
+
+void Profiler::resolveGpuPool(GpuQueryPool& pool) {
+    ProfilerFrame& frame = m_history[pool.frameIndex % HISTORY_SIZE];
+    if (frame.index != pool.frameIndex) {
+        return;
+    }
+
+    for (int i = 0; i < pool.count * 2; i++) {
+        GLint available = 0;
+        glGetQueryObjectiv(pool.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            //still in flight, drop this frame's gpu markers rather than stall
+            return;
+        }
+    }
+
+    GLuint64 base = 0;
+    double anchorUs = 0.0;
+    for (int i = 0; i < pool.count; i++) {
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(pool.queries[i * 2], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(pool.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+
+        ProfilerEvent& event = frame.events[pool.eventIndices[i]];
+        //gpu clock has no relation to steady_clock, pin the first marker to its submit time
+        if (i == 0) {
+            base = start;
+            anchorUs = event.startUs;
+        }
+        event.startUs = anchorUs + static_cast<double>(start - base) / 1000.0;
+        event.durationUs = end > start ? static_cast<double>(end - start) / 1000.0 : 0.0;
+    }
+}
+
+const ProfilerFrame* Profiler::getFrame(int framesAgo) {
+    unsigned long long offset = 2 + static_cast<unsigned long long>(framesAgo);
+    if (framesAgo < 0 || framesAgo >= HISTORY_SIZE - 2 || m_frameIndex < offset) {
+        return nullptr;
+    }
+    unsigned long long target = m_frameIndex - offset;
+    const ProfilerFrame& frame = m_history[target % HISTORY_SIZE];
+    if (frame.index != target || frame.durationUs <= 0.0) {
+        return nullptr;
+    }
+    return &frame;
+}
+
+bool Profiler::exportChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "[Profiler] Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+    //the other threads go after the gpu row, tid 3 and up
+    for (int thread = 1; thread <= m_threadCount; thread++) {
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread + 2
+            << ",\"args\":{\"name\":\"CPU thread " << thread << "\"}}";
+    }
+
+    int exportedFrames = 0;
+    unsigned long long first = m_frameIndex > HISTORY_SIZE - 1 ? m_frameIndex - (HISTORY_SIZE - 1) : 0;
+    for (unsigned long long index = first; index < m_frameIndex; index++) {
+        const ProfilerFrame& frame = m_history[index % HISTORY_SIZE];
+        if (frame.index != index || frame.durationUs <= 0.0) {
+            continue;
+        }
+        out << ",\n{\"name\":\"Frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+            << ",\"ts\":" << frame.startUs << ",\"dur\":" << frame.durationUs
+            << ",\"args\":{\"index\":" << frame.index << ",\"drawCalls\":" << frame.drawCalls << "}}";
+        for (const ProfilerEvent& event : frame.events) {
+            if (event.durationUs < 0.0) {
+                continue;
+            }
+            out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu")
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (event.gpu ? 2 : (event.thread == 0 ? 1 : event.thread + 2))
+                << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs << "}";
+        }
+        exportedFrames++;
+    }
+    out << "\n]}\n";
+
+    std::cout << "[Profiler] Wrote " << exportedFrames << " frames to " << path << std::endl;
+    return true;
+}
+
+void Profiler::printSummary() {
+    struct Totals { double us = 0.0; int frames = 0; };
+    std::map<std::string, Totals> cpuTotals;
+    std::map<std::string, Totals> gpuTotals;
+    double frameUs = 0.0;
+    int frameCount = 0;
+
+    for (int i = 0; i < HISTORY_SIZE - 2; i++) {
+        const ProfilerFrame* frame = getFrame(i);
+        if (frame == nullptr) {
+            break;
+        }
+        frameUs += frame->durationUs;
+        frameCount++;
+        for (const ProfilerEvent& event : frame->events) {
+            if (event.durationUs < 0.0) {
+                continue;
+            }
+            Totals& totals = event.gpu ? gpuTotals[event.name] : cpuTotals[event.name];
+            totals.us += event.durationUs;
+            totals.frames++;
+        }
+    }
+    if (frameCount == 0) {
+        std::cout << "[Profiler] No frames captured" << std::endl;
+        return;
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "[Profiler] " << frameCount << " frames, avg " << (frameUs / frameCount) / 1000.0 << " ms" << std::endl;
+    for (const auto& [name, totals] : cpuTotals) {
+        std::cout << "  cpu " << name << ": " << (totals.us / frameCount) / 1000.0 << " ms/frame" << std::endl;
+    }
+    for (const auto& [name, totals] : gpuTotals) {
+        std::cout << "  gpu " << name << ": " << (totals.us / frameCount) / 1000.0 << " ms/frame" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
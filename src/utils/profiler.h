@@ -0,0 +1,139 @@
+#pragma once
+
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//one marker in a captured frame, times are in microseconds since the profiler started
+struct ProfilerEvent {
+    const char* name;
+    double startUs;
+    double durationUs;   //-1 while a gpu result is still in flight (or got dropped)
+    int depth;
+    bool gpu;
+    int thread;          //0 for the gui thread, 1 and up for the others (the sim) in the order they first marked
+};
+
+struct ProfilerFrame {
+    unsigned long long index = 0;
+    double startUs = 0.0;
+    double durationUs = 0.0;
+    int drawCalls = 0;
+    std::vector<ProfilerEvent> events;
+};
+
+//frame profiler, cpu markers use steady_clock and gpu markers use GL_TIMESTAMP query pairs.
+//everything is static like GBuffer so Map and the helper classes can drop markers without a Realtime*.
+//gpu markers and frames belong to the gui thread. cpu markers work from any thread, the other threads keep their
+//own stacks and their finished markers join whichever frame is open when they finish.
+//names have to be string literals since only the pointer gets stored
+class Profiler {
+public:
+    static const int HISTORY_SIZE = 240;
+    static const int MAX_GPU_MARKERS = 32;
+
+    static void initialize();    //needs a current GL context for the query pools
+    static void cleanup();
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return m_enabled; }
+    static void setOverlayEnabled(bool enabled);
+    static bool isOverlayEnabled() { return m_overlayEnabled; }
+
+    static int beginCpu(const char* name);
+    static void endCpu(int eventIndex);
+    static int beginGpu(const char* name);
+    static void endGpu(int marker);
+
+    //closes the current frame, call once at the end of paintGL
+    static void endFrame();
+
+    //draw calls are counted even with the profiler off, they're just an int bump per call
+    static void countDrawCall(int count = 1) { m_drawCalls += count; }
+    static int getLastFrameDrawCalls() { return m_lastFrameDrawCalls; }
+
+    //framesAgo = 0 is the newest frame whose gpu results are in, nullptr if not captured yet
+    static const ProfilerFrame* getFrame(int framesAgo);
+    static unsigned long long getCurrentFrameIndex() { return m_frameIndex; }
+
+    static bool exportChromeTrace(const std::string& path);
+    static void printSummary();
+
+private:
+    struct GpuQueryPool {
+        GLuint queries[MAX_GPU_MARKERS * 2];
+        int eventIndices[MAX_GPU_MARKERS];
+        int count;
+        unsigned long long frameIndex;
+        bool pending;
+    };
+
+    static double nowUs();
+    static ProfilerFrame& currentFrame();
+    static void resolveGpuPool(GpuQueryPool& pool);
+
+    static int threadSlot();
+
+    static std::atomic<bool> m_enabled;
+    static bool m_overlayEnabled;
+    static bool m_gpuReady;
+    static unsigned long long m_frameIndex;
+    static int m_cpuDepth;
+    static int m_gpuDepth;
+    static int m_drawCalls;
+    static int m_lastFrameDrawCalls;
+    static std::vector<ProfilerFrame> m_history;
+    static GpuQueryPool m_gpuPools[2];
+    static std::thread::id m_mainThread;
+    //finished markers from the other threads, moved into the frame at endFrame
+    static std::mutex m_threadEventsMutex;
+    static std::vector<ProfilerEvent> m_threadEvents;
+    static std::atomic<int> m_threadCount;
+};
+
+//scoped marker, end() closes it early when a pass doesnt line up with a c++ scope
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name, bool gpu = false)
+        : m_cpuEvent(Profiler::beginCpu(name))
+        , m_gpuMarker(gpu ? Profiler::beginGpu(name) : -1)
+    {
+    }
+    ~ProfileScope() { end(); }
+
+    void end() {
+        if (m_gpuMarker >= 0) {
+            Profiler::endGpu(m_gpuMarker);
+            m_gpuMarker = -1;
+        }
+        if (m_cpuEvent >= 0) {
+            Profiler::endCpu(m_cpuEvent);
+            m_cpuEvent = -1;
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    int m_cpuEvent;
+    int m_gpuMarker;
+};
+
+//put first in paintGL so the frame closes after every other scope, early returns included
+class ProfilerFrameScope {
+public:
+    ProfilerFrameScope() = default;
+    ~ProfilerFrameScope() { Profiler::endFrame(); }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name, true)
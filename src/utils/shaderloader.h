@@ -20,6 +20,31 @@ public:
         GLuint programID = glCreateProgram();
         glAttachShader(programID, vertexShaderID);
         glAttachShader(programID, fragmentShaderID);
+        linkProgram(programID);
+
+        // Shaders no longer necessary, stored in program
+        glDeleteShader(vertexShaderID);
+        glDeleteShader(fragmentShaderID);
+
+        return programID;
+    }
+
+    //vertex shader only, its outputs named in varyings get captured interleaved by transform feedback.
+    //draw with GL_RASTERIZER_DISCARD on, there's nothing to rasterize
+    static GLuint createTransformFeedbackProgram(const char * vertex_file_path, const char * const * varyings, int varyingCount){
+        GLuint vertexShaderID = createShader(GL_VERTEX_SHADER, vertex_file_path);
+
+        GLuint programID = glCreateProgram();
+        glAttachShader(programID, vertexShaderID);
+        glTransformFeedbackVaryings(programID, varyingCount, varyings, GL_INTERLEAVED_ATTRIBS);
+        glDeleteShader(vertexShaderID);
+        linkProgram(programID);
+
+        return programID;
+    }
+
+private:
+    static void linkProgram(GLuint programID){
         glLinkProgram(programID);
 
         // Print the info log if error
@@ -36,15 +61,8 @@ public:
             glDeleteProgram(programID);
             throw std::runtime_error(log);
         }
-
-        // Shaders no longer necessary, stored in program
-        glDeleteShader(vertexShaderID);
-        glDeleteShader(fragmentShaderID);
-
-        return programID;
     }
 
-private:
     static GLuint createShader(GLenum shaderType, const char *filepath){
         GLuint shaderID = glCreateShader(shaderType);
 
@@ -0,0 +1,138 @@
+#include "spatialhash.h"
+#include <algorithm>
+#include <cmath>
+
+SpatialHash::SpatialHash(float cellSize, int bucketCount)
+    : m_cellSize(cellSize)
+    , m_invCellSize(1.0f / cellSize)
+{
+    //round up to a power of two so the hash can mask instead of mod
+    uint32_t buckets = 1;
+    while (buckets < static_cast<uint32_t>(std::max(bucketCount, 1))) {
+        buckets <<= 1;
+    }
+    m_bucketMask = buckets - 1;
+    m_bucketStart.assign(buckets + 1, 0);
+}
+
+void SpatialHash::clear() {
+    m_items.clear();
+}
+
+int SpatialHash::cellOf(float v) const {
+    return static_cast<int>(std::floor(v * m_invCellSize));
+}
+
+uint32_t SpatialHash::bucketOf(int cellX, int cellZ) const {
+    //large primes, same mixing most voxel engines use
+    uint32_t h = static_cast<uint32_t>(cellX) * 73856093u ^ static_cast<uint32_t>(cellZ) * 83492791u;
+    return h & m_bucketMask;
+}
+
+void SpatialHash::insert(int id, const glm::vec3& position) {
+    m_items.push_back({id, position, bucketOf(cellOf(position.x), cellOf(position.z))});
+}
+
+void SpatialHash::build() {
+    std::fill(m_bucketStart.begin(), m_bucketStart.end(), 0);
+    for (const Item& item : m_items) {
+        m_bucketStart[item.bucket + 1]++;
+    }
+    for (size_t b = 1; b < m_bucketStart.size(); b++) {
+        m_bucketStart[b] += m_bucketStart[b - 1];
+    }
+
+    m_sorted.resize(m_items.size());
+    //bucketStart[b] is used as the write cursor and ends up at bucketStart[b + 1], shift it back after
+    for (const Item& item : m_items) {
+        m_sorted[m_bucketStart[item.bucket]++] = item;
+    }
+    for (size_t b = m_bucketStart.size() - 1; b > 0; b--) {
+        m_bucketStart[b] = m_bucketStart[b - 1];
+    }
+    m_bucketStart[0] = 0;
+}
+
+template <typename Visit>
+void SpatialHash::forEachInRect(const glm::vec2& min, const glm::vec2& max, Visit&& visit) const {
+    if (m_sorted.empty()) {
+        return;
+    }
+    int minX = cellOf(min.x);
+    int minZ = cellOf(min.y);
+    int maxX = cellOf(max.x);
+    int maxZ = cellOf(max.y);
+
+    //covers more cells than there are buckets, every bucket gets hit anyway
+    long long cellCount = static_cast<long long>(maxX - minX + 1) * static_cast<long long>(maxZ - minZ + 1);
+    if (cellCount >= static_cast<long long>(m_bucketMask) + 1) {
+        for (const Item& item : m_sorted) {
+            visit(item);
+        }
+        return;
+    }
+
+    //two cells can share a bucket, collect them first and drop the repeats so none is walked twice.
+    //per thread scratch keeps queries from different threads out of each other's way
+    static thread_local std::vector<uint32_t> buckets;
+    buckets.clear();
+    for (int cz = minZ; cz <= maxZ; cz++) {
+        for (int cx = minX; cx <= maxX; cx++) {
+            buckets.push_back(bucketOf(cx, cz));
+        }
+    }
+    std::sort(buckets.begin(), buckets.end());
+    buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+    for (uint32_t bucket : buckets) {
+        for (uint32_t i = m_bucketStart[bucket]; i < m_bucketStart[bucket + 1]; i++) {
+            visit(m_sorted[i]);
+        }
+    }
+}
+
+void SpatialHash::queryRadius(const glm::vec3& center, float radius, std::vector<int>& out) const {
+    float radiusSq = radius * radius;
+    forEachInRect(glm::vec2(center.x - radius, center.z - radius), glm::vec2(center.x + radius, center.z + radius),
+                  [&](const Item& item) {
+        glm::vec3 offset = item.position - center;
+        if (glm::dot(offset, offset) <= radiusSq) {
+            out.push_back(item.id);
+        }
+    });
+}
+
+void SpatialHash::queryCone(const glm::vec3& apex, const glm::vec3& direction, float halfAngle, float range,
+                            std::vector<int>& out) const {
+    float dirLength = glm::length(direction);
+    if (dirLength < 1e-6f) {
+        return;
+    }
+    glm::vec3 dir = direction / dirLength;
+    float cosHalfAngle = std::cos(halfAngle);
+
+    //narrow cones: hull of the apex and the cap disc at range (radius range * tan), wide ones: the whole sphere
+    glm::vec2 rectMin(apex.x - range, apex.z - range);
+    glm::vec2 rectMax(apex.x + range, apex.z + range);
+    if (halfAngle < glm::radians(60.0f)) {
+        glm::vec3 capCenter = apex + dir * range;
+        float capRadius = range * std::tan(halfAngle);
+        rectMin = glm::min(glm::vec2(apex.x, apex.z), glm::vec2(capCenter.x - capRadius, capCenter.z - capRadius));
+        rectMax = glm::max(glm::vec2(apex.x, apex.z), glm::vec2(capCenter.x + capRadius, capCenter.z + capRadius));
+    }
+
+    float rangeSq = range * range;
+    forEachInRect(rectMin, rectMax, [&](const Item& item) {
+        glm::vec3 offset = item.position - apex;
+        float distSq = glm::dot(offset, offset);
+        if (distSq > rangeSq) {
+            return;
+        }
+        if (distSq < 1e-6f) {
+            out.push_back(item.id);
+            return;
+        }
+        if (glm::dot(offset, dir) >= cosHalfAngle * std::sqrt(distSq)) {
+            out.push_back(item.id);
+        }
+    });
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+//uniform grid over xz hashed into a fixed bucket table, for broad-phase queries on things that move every tick.
+//clear() + insert() everything + build(), then query. build is a counting sort so a rebuild is O(n) and,
+//once the vectors have grown, never allocates. queries hand back candidate ids that passed an exact test,
+//and are safe to run from several threads at once as long as nobody is rebuilding
+class SpatialHash {
+public:
+    explicit SpatialHash(float cellSize = 4.0f, int bucketCount = 4096);
+
+    void clear();
+    void insert(int id, const glm::vec3& position);
+    void build();
+
+    int size() const { return static_cast<int>(m_items.size()); }
+    float getCellSize() const { return m_cellSize; }
+
+    //ids within radius of center (3d distance), appended to out
+    void queryRadius(const glm::vec3& center, float radius, std::vector<int>& out) const;
+    //ids inside the cone (apex, unit-ish dir, half angle in radians) and within range of the apex
+    void queryCone(const glm::vec3& apex, const glm::vec3& direction, float halfAngle, float range,
+                   std::vector<int>& out) const;
+
+private:
+    struct Item {
+        int id;
+        glm::vec3 position;
+        uint32_t bucket;
+    };
+
+    int cellOf(float v) const;
+    uint32_t bucketOf(int cellX, int cellZ) const;
+    //calls visit(item) for every item in the buckets covering [min, max] on xz, each bucket once
+    template <typename Visit>
+    void forEachInRect(const glm::vec2& min, const glm::vec2& max, Visit&& visit) const;
+
+    float m_cellSize;
+    float m_invCellSize;
+    uint32_t m_bucketMask;
+    std::vector<Item> m_items;
+    std::vector<Item> m_sorted;
+    std::vector<uint32_t> m_bucketStart;    //bucketCount + 1 offsets into m_sorted
+};
@@ -0,0 +1,148 @@
+#include "streambuffer.h"
+#include <algorithm>
+
+namespace {
+    //one second, only ever hit if the gpu is three whole frames behind
+    const GLuint64 FENCE_TIMEOUT_NS = 1000000000ull;
+
+    void waitAndDelete(GLsync& fence) {
+        if (fence == nullptr) {
+            return;
+        }
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;) {
+            GLenum status = glClientWaitSync(fence, flags, FENCE_TIMEOUT_NS);
+            if (status != GL_TIMEOUT_EXPIRED) {
+                break;
+            }
+            flags = 0;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+StreamBuffer::~StreamBuffer() {
+    cleanup();
+}
+
+void StreamBuffer::initialize(GLenum target, GLsizeiptr bytesPerFrame) {
+    cleanup();
+    m_target = target;
+    m_persistent = GLEW_ARB_buffer_storage || GLEW_VERSION_4_4;
+    createStorage(std::max<GLsizeiptr>(bytesPerFrame, 256));
+}
+
+void StreamBuffer::cleanup() {
+    destroyStorage();
+    m_regionSize = 0;
+    m_cursor = 0;
+    m_region = 0;
+    m_inFrame = false;
+}
+
+void StreamBuffer::createStorage(GLsizeiptr bytesPerFrame) {
+    m_regionSize = bytesPerFrame;
+    GLsizeiptr total = m_regionSize * FRAME_COUNT;
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(m_target, m_buffer);
+    if (m_persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(m_target, total, nullptr, flags);
+        m_persistentData = static_cast<char*>(glMapBufferRange(m_target, 0, total, flags));
+        if (m_persistentData == nullptr) {
+            //driver claims the extension but won't map it, fall back to mapping per allocation
+            glBindBuffer(m_target, 0);
+            glDeleteBuffers(1, &m_buffer);
+            m_persistent = false;
+            glGenBuffers(1, &m_buffer);
+            glBindBuffer(m_target, m_buffer);
+            glBufferData(m_target, total, nullptr, GL_STREAM_DRAW);
+        }
+    } else {
+        glBufferData(m_target, total, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(m_target, 0);
+}
+
+void StreamBuffer::destroyStorage() {
+    for (GLsync& fence : m_fences) {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (m_buffer != 0) {
+        if (m_persistentData != nullptr) {
+            glBindBuffer(m_target, m_buffer);
+            glUnmapBuffer(m_target);
+            glBindBuffer(m_target, 0);
+            m_persistentData = nullptr;
+        }
+        //gl keeps the storage alive until draws already queued from it are done
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+}
+
+void StreamBuffer::beginFrame() {
+    m_region = (m_region + 1) % FRAME_COUNT;
+    m_cursor = 0;
+    m_inFrame = true;
+    waitAndDelete(m_fences[m_region]);
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+    Allocation allocation;
+    if (m_buffer == 0 || !m_inFrame || size <= 0) {
+        return allocation;
+    }
+    alignment = std::max<GLsizeiptr>(alignment, 1);
+    GLintptr start = (m_cursor + alignment - 1) / alignment * alignment;
+    if (start + size > m_regionSize) {
+        //out of room, start over in a bigger buffer. the old one stays alive for draws already issued from it
+        GLsizeiptr grown = std::max(m_regionSize * 2, start + size);
+        destroyStorage();
+        createStorage(grown);
+        m_region = 0;
+        start = 0;
+    }
+
+    allocation.offset = static_cast<GLintptr>(m_region) * m_regionSize + start;
+    allocation.size = size;
+    m_cursor = start + size;
+    if (m_persistent) {
+        allocation.data = m_persistentData + allocation.offset;
+    } else {
+        //the fence already guarantees nobody reads this range, so no need for the driver to sync
+        glBindBuffer(m_target, m_buffer);
+        allocation.data = glMapBufferRange(m_target, allocation.offset, size,
+                                           GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        if (allocation.data == nullptr) {
+            allocation.size = 0;
+        }
+    }
+    return allocation;
+}
+
+bool StreamBuffer::finish(const Allocation& allocation) {
+    if (allocation.data == nullptr) {
+        return false;
+    }
+    if (m_persistent) {
+        //coherent mapping, writes are visible to the next draw as is
+        return true;
+    }
+    glBindBuffer(m_target, m_buffer);
+    return glUnmapBuffer(m_target) == GL_TRUE;
+}
+
+void StreamBuffer::endFrame() {
+    if (!m_inFrame) {
+        return;
+    }
+    m_inFrame = false;
+    if (m_cursor > 0) {
+        m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+//gl buffer for data that gets rewritten every frame (instances, dynamic verts). split into FRAME_COUNT regions
+//used round robin, each one fenced after its frame so the cpu never writes what the gpu is still reading and
+//never has to orphan/reallocate. with ARB_buffer_storage (4.4) the whole thing stays persistently mapped,
+//otherwise every allocation maps its own range unsynchronized. gl thread only
+class StreamBuffer {
+public:
+    static constexpr int FRAME_COUNT = 3;
+
+    struct Allocation {
+        void* data = nullptr;       //write here, nullptr if the allocation failed
+        GLintptr offset = 0;        //bytes from the start of getBuffer(), for attrib pointers / draw offsets
+        GLsizeiptr size = 0;
+    };
+
+    StreamBuffer() = default;
+    ~StreamBuffer();
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    //bytesPerFrame is a starting size, a frame that asks for more grows every region
+    void initialize(GLenum target, GLsizeiptr bytesPerFrame);
+    void cleanup();
+
+    //moves on to the next region, waiting if the gpu hasn't finished the frame that last used it
+    void beginFrame();
+    //alignment is in bytes. the data has to be written and finish()ed before drawing from it
+    Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+    //false if the driver lost the contents (display mode change and such), skip drawing from it then
+    bool finish(const Allocation& allocation);
+    //fences this frame's region, call after the last draw that reads from it
+    void endFrame();
+
+    //can change when the buffer grows, so bind it again after every allocate()
+    GLuint getBuffer() const { return m_buffer; }
+    bool isPersistent() const { return m_persistent; }
+
+private:
+    void createStorage(GLsizeiptr bytesPerFrame);
+    void destroyStorage();
+
+    GLenum m_target = GL_ARRAY_BUFFER;
+    GLuint m_buffer = 0;
+    GLsizeiptr m_regionSize = 0;
+    GLintptr m_cursor = 0;          //next free byte in the current region
+    int m_region = 0;
+    bool m_inFrame = false;
+    bool m_persistent = false;
+    char* m_persistentData = nullptr;
+    GLsync m_fences[FRAME_COUNT] = {};
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//lock free triple buffer for handing whole structs from one writer thread to one reader thread.
+//the writer fills back() and publish()es it, the reader acquire()s the newest published slot.
+//neither side ever waits, the reader just keeps its current slot if nothing new came in
+template <typename T>
+class TripleBuffer {
+public:
+    //the slot the writer owns, holds whatever was published two swaps ago so fill every field
+    T& back() { return m_slots[m_back]; }
+
+    void publish() {
+        uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_back | DIRTY), std::memory_order_acq_rel);
+        m_back = previous & INDEX_MASK;
+    }
+
+    //swaps in the newest published slot if there is one, the returned ref stays valid until the next acquire
+    const T& acquire() {
+        if (m_middle.load(std::memory_order_acquire) & DIRTY) {
+            uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+            m_front = previous & INDEX_MASK;
+        }
+        return m_slots[m_front];
+    }
+
+    //the reader's current slot without looking for a newer one
+    const T& front() const { return m_slots[m_front]; }
+
+private:
+    static constexpr uint8_t DIRTY = 0x4;
+    static constexpr uint8_t INDEX_MASK = 0x3;
+
+    T m_slots[3];
+    uint8_t m_back = 0;
+    uint8_t m_front = 1;
+    std::atomic<uint8_t> m_middle{2};
+};